@@ -6,9 +6,153 @@
 #include "VulkanHelpers/DebugMessengerCallback.h"
 #include "VulkanHelpers/PhysicalDeviceHelpers.h"
 #include "VulkanHelpers/ShaderHelpers.h"
+#include "VulkanHelpers/Ktx2Helpers.h"
+#include "VulkanHelpers/PngStreamDecoder.h"
+#include "VulkanHelpers/BatchImageDecoder.h"
+#include "VulkanHelpers/HostImageCopy.h"
+#include "VulkanHelpers/PipelineManifest.h"
 
 namespace
 {
+    constexpr auto MemoryLogInterval = std::chrono::seconds(10);
+
+    constexpr auto TextureFileName = "textures/cat.png";
+    // Preferred over the PNG when present, block-compressed textures skip decoding and take a fraction of the VRAM
+    constexpr auto CompressedTextureFileName = "textures/cat.ktx2";
+    constexpr auto MipmapShaderFileName = "shaders/mipmap.comp.spv";
+
+    struct ShaderFiles
+    {
+        char const* vertex;
+        char const* fragment;
+    };
+
+    constexpr ShaderFiles MainShaders = { "shaders/shader.vert.spv", "shaders/shader.frag.spv" };
+
+    enum class LightingModel : int32_t
+    {
+        Unlit,
+        Lambert,
+        HalfLambert
+    };
+
+    // The specialization constants of the main fragment shader, pipelines check them against its SPIR-V
+    struct MainShaderConstants
+    {
+        static constexpr SpecializationConstant<bool> UseTexture{ 0 };
+        static constexpr SpecializationConstant<bool> UseVertexColor{ 1 };
+        static constexpr SpecializationConstant<LightingModel> Lighting{ 2 };
+        static constexpr SpecializationConstant<int32_t> FilterTaps{ 3 };
+    };
+
+    constexpr ShaderFiles PackedShaders = { "shaders/packed.vert.spv", "shaders/packed.frag.spv" };
+    constexpr ShaderFiles BindlessShaders = { "shaders/bindless.vert.spv", "shaders/bindless.frag.spv" };
+    // Drawn with while a material's pipeline compiles. Only fits packed.vert and bindless.vert, which write texture
+    // coordinates to location 0.
+    constexpr auto FallbackFragmentShader = "shaders/fallback.frag.spv";
+    // Every pipeline a run used, compiled ahead on the next start. Bindless runs draw with other shaders and layouts.
+    constexpr auto PipelineManifestFileName = "pipelines.manifest";
+    constexpr auto BindlessPipelineManifestFileName = "pipelines-bindless.manifest";
+    // Textures larger than this stream through it in slices
+    constexpr vk::DeviceSize TextureStagingSize = 8 * 1024 * 1024;
+
+    // Every PNG in here is loaded at startup with the batch decoder
+    constexpr auto SceneTextureDirectory = "textures/scene";
+    constexpr size_t SceneTextureBytesInFlight = 256 * 1024 * 1024;
+    // Scene textures up to this size share atlas pages, larger ones are grouped into arrays by size
+    constexpr uint32_t SceneAtlasSize = 2048;
+    constexpr uint32_t SceneAtlasMaxEntrySize = 256;
+    // The scene textures are shown as a grid of quads below the main one, drawn with the descriptor set already bound
+    constexpr uint32_t PackedQuadColumns = 8;
+    constexpr float PackedQuadSize = 0.2f;
+    // Length of the texture array binding, has to match packed.frag
+    constexpr uint32_t MaxPackedTextureArrays = 16;
+    // Sizes of the bindless table, clamped to what the device allows
+    constexpr uint32_t BindlessMaxTextures = 4096;
+    constexpr uint32_t BindlessMaxStorageBuffers = 64;
+
+    // The first transient pool of each frame, later pools grow up to the maximum
+    constexpr uint32_t FrameDescriptorSetsPerPool = 4;
+    constexpr uint32_t MaxDescriptorSetsPerPool = 256;
+
+    // Descriptors of the frame's set, laid out the way the update template reads them
+    struct FrameDescriptors
+    {
+        vk::DescriptorBufferInfo uniformBuffer;
+        vk::DescriptorImageInfo texture;
+        std::array<vk::DescriptorImageInfo, MaxPackedTextureArrays> packedArrays;
+    };
+
+    // Descriptors per set of the frame's layout, pools grow when other layouts come along
+    std::vector<DescriptorPoolRatio> getFrameDescriptorRatios()
+    {
+        return {
+            { vk::DescriptorType::eUniformBuffer, 1.0f },
+            { vk::DescriptorType::eCombinedImageSampler, 1.0f + MaxPackedTextureArrays }
+        };
+    }
+
+    // Bounds how much one frame spends on residency uploads, at least one level still loads per frame
+    constexpr vk::DeviceSize ResidencyUploadBytesPerFrame = 4 * 1024 * 1024;
+    // The synthetic residency scene is a square grid of tiles, one texture each, seen by a camera sweeping over it
+    constexpr float ResidencyCameraFov = glm::radians(45.0f);
+
+    // Upload latency is measured from decoded pixels in memory to the texture being ready to sample
+    constexpr std::array UploadBenchmarkSizes = { 256u, 1024u, 2048u, 4096u };
+    constexpr int UploadBenchmarkIterations = 10;
+
+    // Every set is written once per run, the allocation isn't timed
+    constexpr uint32_t DescriptorBenchmarkSets = 1024;
+    constexpr int DescriptorBenchmarkIterations = 20;
+
+    // Every combination of these with the toggles of MainShaderConstants
+    constexpr std::array ShaderVariantLightingModels = {
+        LightingModel::Unlit, LightingModel::Lambert, LightingModel::HalfLambert
+    };
+    constexpr std::array ShaderVariantFilterTaps = { 1, 3, 5 };
+
+    // Consecutive draws step through the materials by a stride coprime to their count, so neighbours share little state
+    constexpr int ShaderObjectBenchmarkFrames = 100;
+    constexpr uint32_t ShaderObjectBenchmarkDraws = 960;
+    constexpr uint32_t ShaderObjectBenchmarkStride = 37;
+
+    constexpr vk::MemoryPropertyFlags DirectWriteMemoryProperties =
+        vk::MemoryPropertyFlagBits::eDeviceLocal |
+        vk::MemoryPropertyFlagBits::eHostVisible |
+        vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    // Checkerboard in a hue of its own per texture, with every mip level a step darker so streamed levels stand out
+    void writeSyntheticTextureRows(uint32_t textureIndex, uint32_t size, uint32_t mipLevel, uint8_t* pDst,
+                                   uint32_t firstRow, uint32_t rowCount, size_t rowPitch)
+    {
+        auto const levelSize = std::max(size >> mipLevel, 1u);
+        auto const hue = std::fmod(static_cast<float>(textureIndex) * 0.618034f, 1.0f) * 6.0f;
+        auto const channel = [hue](float offset)
+        {
+            return std::clamp(std::abs(std::fmod(hue + offset, 6.0f) - 3.0f) - 1.0f, 0.0f, 1.0f) * 0.6f + 0.4f;
+        };
+        std::array const color = { channel(4.0f), channel(2.0f), channel(0.0f) };
+        auto const shade = std::max(1.0f - 0.08f * static_cast<float>(mipLevel), 0.2f);
+
+        for (uint32_t row = 0; row < rowCount; row++)
+        {
+            auto* pTexel = pDst + row * rowPitch;
+            auto const y = (firstRow + row) << mipLevel;
+
+            for (uint32_t x = 0; x < levelSize; x++, pTexel += 4)
+            {
+                auto const light = ((x << mipLevel) / 32 + y / 32) % 2 == 0;
+                auto const intensity = (light ? 1.0f : 0.35f) * shade;
+
+                // BGRA
+                pTexel[0] = static_cast<uint8_t>(color[0] * intensity * 255.0f);
+                pTexel[1] = static_cast<uint8_t>(color[1] * intensity * 255.0f);
+                pTexel[2] = static_cast<uint8_t>(color[2] * intensity * 255.0f);
+                pTexel[3] = 0xFF;
+            }
+        }
+    }
+
     vk::DebugUtilsMessengerCreateInfoEXT GetDebugMessengerCreateInfo(
         PFN_vkDebugUtilsMessengerCallbackEXT pDebugCallback
     )
@@ -144,6 +288,428 @@ void BasicTriangleApplication::run()
     cleanup();
 }
 
+int BasicTriangleApplication::runUploadBenchmark()
+{
+    initWindow();
+    initVulcan();
+
+    bool const hostCopy = canCopyTextureOnHost(vk::Format::eB8G8R8A8Srgb, vk::ImageUsageFlagBits::eSampled,
+                                               vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    std::cout << std::format("Texture upload benchmark, BGRA8 level 0, best of {} runs through {} MiB of staging, "
+                             "host image copy {}\n",
+                             UploadBenchmarkIterations, TextureStagingSize / (1024 * 1024),
+                             hostCopy ? "available" : "unavailable");
+
+    for (auto const size : UploadBenchmarkSizes)
+    {
+        auto const rowPitch = static_cast<size_t>(size) * 4;
+        std::vector<uint8_t> pixels(rowPitch * size);
+        writeSyntheticTextureRows(0, size, 0, pixels.data(), 0, size, rowPitch);
+
+        auto const stagingMs = measureTextureUploadMs(pixels.data(), size, false);
+        auto const megabytes = static_cast<double>(pixels.size()) / (1024.0 * 1024.0);
+
+        if (hostCopy)
+        {
+            auto const hostCopyMs = measureTextureUploadMs(pixels.data(), size, true);
+            std::cout << std::format("  {:>4}x{:<4} staging {:8.3f} ms {:8.1f} MB/s, host copy {:8.3f} ms {:8.1f} MB/s, "
+                                     "{:5.2f}x\n",
+                                     size, size, stagingMs, megabytes / (stagingMs / 1000.0), hostCopyMs,
+                                     megabytes / (hostCopyMs / 1000.0), stagingMs / hostCopyMs);
+        }
+        else
+        {
+            std::cout << std::format("  {:>4}x{:<4} staging {:8.3f} ms {:8.1f} MB/s\n", size, size, stagingMs,
+                                     megabytes / (stagingMs / 1000.0));
+        }
+    }
+
+    cleanup();
+
+    return EXIT_SUCCESS;
+}
+
+int BasicTriangleApplication::runDescriptorUpdateBenchmark()
+{
+    initWindow();
+    initVulcan();
+
+    DescriptorAllocator allocator(m_logicalDevice, getFrameDescriptorRatios(), DescriptorBenchmarkSets,
+                                  DescriptorBenchmarkSets, m_pAllocator);
+
+    std::vector<vk::DescriptorSet> sets;
+    for (uint32_t i = 0; i < DescriptorBenchmarkSets; i++)
+    {
+        sets.push_back(allocator.Allocate(m_descriptorSetLayout));
+    }
+
+    auto const descriptorCount = 2 + (bindsPackedArrays() ? MaxPackedTextureArrays : 0);
+    std::cout << std::format("Descriptor update benchmark, {} sets of {} descriptors, best of {} runs\n",
+                             DescriptorBenchmarkSets, descriptorCount, DescriptorBenchmarkIterations);
+
+    auto const measureSetsPerSecond = [&](bool useTemplate)
+    {
+        auto best = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < DescriptorBenchmarkIterations; i++)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            for (auto const set : sets)
+            {
+                writeDescriptorSet(set, 0, m_textureImageView, useTemplate);
+            }
+            auto const end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return static_cast<double>(DescriptorBenchmarkSets) / best;
+    };
+
+    auto const writesPerSecond = measureSetsPerSecond(false);
+    auto const templatePerSecond = measureSetsPerSecond(true);
+
+    std::cout << std::format("  WriteDescriptorSet {:12.0f} sets/s {:12.0f} descriptors/s\n", writesPerSecond,
+                             writesPerSecond * descriptorCount);
+    std::cout << std::format("  update template    {:12.0f} sets/s {:12.0f} descriptors/s, {:5.2f}x\n",
+                             templatePerSecond, templatePerSecond * descriptorCount,
+                             templatePerSecond / writesPerSecond);
+
+    allocator.Destroy();
+    cleanup();
+
+    return EXIT_SUCCESS;
+}
+
+int BasicTriangleApplication::runPipelineStateBenchmark()
+{
+    enableDynamicState();
+    initWindow();
+    initVulcan();
+
+    auto const materials = describeMaterials();
+
+    std::cout << std::format("Pipeline state benchmark, {} materials differing in cull mode, front face, topology, "
+                             "depth test, depth write and blending\n", materials.size());
+
+    auto const measurePipelines = [&](char const* pName, DynamicStateSupport const& dynamicState)
+    {
+        // Without libraries and on the calling thread, so every pipeline is one whole compile
+        GraphicsPipelineCache cache(m_logicalDevice, 1, false, dynamicState, m_pAllocator);
+
+        auto const start = std::chrono::steady_clock::now();
+        for (auto const& material : materials)
+        {
+            cache.RequestBlocking(material);
+        }
+        auto const totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        auto const stats = cache.GetStats();
+        cache.Destroy();
+
+        std::cout << std::format("  {:<14} {:4} pipelines created in {:8.1f} ms, {:6.2f} ms per material\n", pName,
+                                 stats.pipelines, totalMs, totalMs / static_cast<double>(materials.size()));
+    };
+
+    measurePipelines("static state", {});
+
+    if (m_dynamicState.extendedDynamicState || m_dynamicState.colorBlendEnable)
+    {
+        measurePipelines("dynamic state", m_dynamicState);
+
+        // Materials sorted the way they were generated, neighbours share most of their state
+        auto const commandBuffer = m_logicalDevice.allocateCommandBuffers({ m_commandPool,
+                                                                           vk::CommandBufferLevel::ePrimary,
+                                                                           1 }).front();
+        commandBuffer.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+        DynamicStateRecorder recorder(m_dynamicState);
+        recorder.Begin(commandBuffer);
+        for (auto const& material : materials)
+        {
+            recorder.Apply(material);
+        }
+
+        commandBuffer.end();
+        m_logicalDevice.freeCommandBuffers(m_commandPool, commandBuffer);
+
+        auto const stats = recorder.GetStats();
+        std::cout << std::format("  recording the materials in order sets {} states and skips {} redundant ones\n",
+                                 stats.setsRecorded, stats.setsSkipped);
+    }
+    else
+    {
+        std::cout << "  dynamic state unsupported\n";
+    }
+
+    cleanup();
+
+    return EXIT_SUCCESS;
+}
+
+int BasicTriangleApplication::runShaderObjectBenchmark()
+{
+    enableDynamicState();
+    enableShaderObjects();
+    initWindow();
+    initVulcan();
+
+    auto const materials = describeMaterials();
+
+    std::cout << std::format("Shader object benchmark, {} frames of {} draws switching between {} materials\n",
+                             ShaderObjectBenchmarkFrames, ShaderObjectBenchmarkDraws, materials.size());
+
+    auto const commandBuffer = m_logicalDevice.allocateCommandBuffers({ m_commandPool,
+                                                                       vk::CommandBufferLevel::ePrimary,
+                                                                       1 }).front();
+
+    // Draws the quad once per material into the first swap chain image, timing the recording on its own
+    auto const measureFrames = [&](char const* pName, double createMs, uint32_t objectCount, bool dynamicRendering,
+                                   auto const& beginFrame, auto const& applyMaterial)
+    {
+        double recordMs = 0.0;
+        double frameMs = 0.0;
+
+        for (int frame = 0; frame < ShaderObjectBenchmarkFrames; frame++)
+        {
+            auto const start = std::chrono::steady_clock::now();
+
+            commandBuffer.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+            beginSwapChainRendering(commandBuffer, 0, dynamicRendering);
+
+            beginFrame(commandBuffer);
+
+            commandBuffer.bindVertexBuffers(0, m_vertexBuffer, vk::DeviceSize{ 0 });
+            commandBuffer.bindIndexBuffer(m_indexBuffer, 0, vk::IndexType::eUint16);
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pipelineLayout, 0,
+                                             m_descriptorSets.front(), {});
+
+            for (uint32_t draw = 0; draw < ShaderObjectBenchmarkDraws; draw++)
+            {
+                applyMaterial(commandBuffer, (draw * ShaderObjectBenchmarkStride) % materials.size());
+                commandBuffer.drawIndexed(static_cast<uint32_t>(m_indices.size()), 1, 0, 0, 0);
+            }
+
+            endSwapChainRendering(commandBuffer, 0, dynamicRendering);
+            commandBuffer.end();
+
+            auto const recorded = std::chrono::steady_clock::now();
+
+            m_gfxQueue.submit(vk::SubmitInfo{ {}, {}, commandBuffer });
+            m_gfxQueue.waitIdle();
+
+            auto const end = std::chrono::steady_clock::now();
+            recordMs += std::chrono::duration<double, std::milli>(recorded - start).count();
+            frameMs += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        std::cout << std::format("  {:<14} {:4} objects created in {:8.1f} ms, {:7.3f} ms recording and {:7.3f} ms "
+                                 "per frame\n", pName, objectCount, createMs, recordMs / ShaderObjectBenchmarkFrames,
+                                 frameMs / ShaderObjectBenchmarkFrames);
+    };
+
+    auto const measurePipelines = [&](char const* pName, DynamicStateSupport const& dynamicState)
+    {
+        GraphicsPipelineCache cache(m_logicalDevice, 1, false, dynamicState, m_pAllocator);
+
+        auto const start = std::chrono::steady_clock::now();
+        std::vector<PipelineId> ids;
+        for (auto const& material : materials)
+        {
+            ids.push_back(cache.RequestBlocking(material));
+        }
+        auto const createMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        DynamicStateRecorder recorder(dynamicState);
+        vk::Pipeline bound;
+
+        measureFrames(pName, createMs, cache.GetStats().pipelines, false, [&](vk::CommandBuffer buffer)
+        {
+            bound = nullptr;
+            recorder.Begin(buffer);
+            setViewportAndScissor(buffer);
+        }, [&](vk::CommandBuffer buffer, size_t material)
+        {
+            if (auto const pipeline = cache.Get(ids[material]); pipeline != bound)
+            {
+                buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+                bound = pipeline;
+            }
+            recorder.Apply(materials[material]);
+        });
+
+        cache.Destroy();
+    };
+
+    measurePipelines("static state", {});
+
+    if (m_dynamicState.extendedDynamicState || m_dynamicState.colorBlendEnable)
+    {
+        measurePipelines("dynamic state", m_dynamicState);
+    }
+    else
+    {
+        std::cout << "  dynamic state unsupported\n";
+    }
+
+    if (m_shaderObjects)
+    {
+        // The renderer of the app already holds the main shaders, this one starts empty
+        ShaderObjectRenderer renderer(m_logicalDevice, { m_descriptorSetLayout }, m_pushConstantRanges, m_pAllocator);
+
+        for (auto const& material : materials)
+        {
+            renderer.Prepare(material);
+        }
+
+        auto const createStats = renderer.GetStats();
+        measureFrames("shader objects", createStats.createMs, createStats.shaders, true, [&](vk::CommandBuffer buffer)
+        {
+            renderer.Begin(buffer, m_swapChainExtent);
+        }, [&](vk::CommandBuffer, size_t material)
+        {
+            renderer.Apply(materials[material]);
+        });
+
+        auto const stats = renderer.GetStats();
+        std::cout << std::format("  shader objects skipped {} of {} binds and {} of {} state sets\n",
+                                 stats.bindsSkipped, stats.binds + stats.bindsSkipped, stats.setsSkipped,
+                                 stats.setsRecorded + stats.setsSkipped);
+
+        renderer.Destroy();
+    }
+    else
+    {
+        std::cout << "  shader objects unsupported\n";
+    }
+
+    m_logicalDevice.freeCommandBuffers(m_commandPool, commandBuffer);
+    cleanup();
+
+    return EXIT_SUCCESS;
+}
+
+int BasicTriangleApplication::runShaderVariantBenchmark()
+{
+    initWindow();
+    initVulcan();
+
+    std::vector<PipelineDesc> variants;
+    for (auto const useTexture : { false, true })
+    {
+        for (auto const useVertexColor : { false, true })
+        {
+            for (auto const lighting : ShaderVariantLightingModels)
+            {
+                for (auto const filterTaps : ShaderVariantFilterTaps)
+                {
+                    auto variant = m_mainPipelineDesc;
+                    variant.specialization.Set(MainShaderConstants::UseTexture, useTexture)
+                                          .Set(MainShaderConstants::UseVertexColor, useVertexColor)
+                                          .Set(MainShaderConstants::Lighting, lighting)
+                                          .Set(MainShaderConstants::FilterTaps, filterTaps);
+                    variants.push_back(variant);
+                }
+            }
+        }
+    }
+
+    std::cout << std::format("Shader variant benchmark, {} variants of the main shaders from one pair of SPIR-V "
+                             "files\n", variants.size());
+
+    // Set up like the app's own cache, but empty
+    GraphicsPipelineCache cache(m_logicalDevice, std::max(std::thread::hardware_concurrency(), 2u) - 1,
+                                m_pipelineLibraries, m_dynamicState, m_pAllocator);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const& variant : variants)
+    {
+        cache.Request(variant);
+    }
+    for (auto const& variant : variants)
+    {
+        cache.RequestBlocking(variant);
+    }
+    auto const compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto const compiled = cache.GetStats();
+    std::cout << std::format("  {} pipelines compiled in {:8.1f} ms, {:6.2f} ms per variant{}\n", compiled.pipelines,
+                             compileMs, compileMs / static_cast<double>(variants.size()),
+                             m_pipelineLibraries ? std::format(", sharing {} libraries", compiled.libraries) : "");
+
+    // What every later frame drawing the variants pays
+    auto const lookupStart = std::chrono::steady_clock::now();
+    for (auto const& variant : variants)
+    {
+        cache.Request(variant);
+    }
+    auto const lookupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lookupStart).count();
+
+    std::cout << std::format("  requested again in {:8.3f} ms, {} of {} requests hit the cache\n", lookupMs,
+                             cache.GetStats().hits - compiled.hits, variants.size());
+
+    cache.Destroy();
+    cleanup();
+
+    return EXIT_SUCCESS;
+}
+
+double BasicTriangleApplication::measureTextureUploadMs(uint8_t const* pPixels, uint32_t size, bool hostCopy)
+{
+    auto const usage = vk::ImageUsageFlagBits::eSampled | (hostCopy ? vk::ImageUsageFlagBits::eHostTransferEXT
+                                                                      : vk::ImageUsageFlagBits::eTransferDst);
+    auto best = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < UploadBenchmarkIterations; i++)
+    {
+        // Image creation and allocation cost the same either way, only the upload itself is timed
+        vk::Image image;
+        vk::DeviceMemory memory;
+        std::tie(image, memory) = createTexture(size, size, 1, vk::Format::eB8G8R8A8Srgb, vk::ImageTiling::eOptimal,
+                                                usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        auto const start = std::chrono::steady_clock::now();
+
+        if (hostCopy)
+        {
+            TransitionImageOnHost(m_logicalDevice, image, vk::ImageLayout::eUndefined,
+                                  vk::ImageLayout::eShaderReadOnlyOptimal, 1);
+            CopyToImageOnHost(m_logicalDevice, image, vk::ImageLayout::eShaderReadOnlyOptimal, 0, size, size,
+                              pPixels);
+        }
+        else
+        {
+            m_textureUploader.RecordCommands([this, image](vk::CommandBuffer commandBuffer)
+            {
+                recordTextureToTransferDst(commandBuffer, image, 1);
+            });
+
+            m_textureUploader.UploadLevel(image, vk::Format::eB8G8R8A8Srgb, 0, size, size,
+                                          [pPixels](uint8_t* pDst, uint32_t firstRow, uint32_t rowCount,
+                                                    size_t rowPitch)
+                                          {
+                                              memcpy(pDst, pPixels + firstRow * rowPitch, rowCount * rowPitch);
+                                          });
+
+            m_textureUploader.RecordCommands([this, image](vk::CommandBuffer commandBuffer)
+            {
+                recordTextureToShaderRead(commandBuffer, image, 1);
+            });
+
+            m_textureUploader.Flush();
+        }
+
+        auto const end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+
+        m_logicalDevice.destroyImage(image, m_pAllocator);
+        m_memoryTracker.Free(memory);
+    }
+
+    return best;
+}
+
 void BasicTriangleApplication::initWindow()
 {
     glfwInit();
@@ -167,18 +733,29 @@ void BasicTriangleApplication::initVulcan()
     createSwapChain();
     createImageViews();
     createRenderPass();
-    createDescriptorSetLayout();
+    createPipelineLayout();
+    warmPipelines();
     createGraphicsPipeline();
     createFrameBuffers();
     createCommandPool();
+    createTextureUploader();
     createTextureImage();
+    createSceneTextures();
+    createResidencyScene();
+    createTextureImageView();
+    createTextureSampler();
     createVertexBuffer();
     createIndexBuffer();
-    createUniformBuffers();
-    createDescriptorPool();
-    createDescriptorSets();
-    createCommandBuffer();
+    createPackedQuads();
+    createPackedPipeline();
+    createDescriptorAllocators();
+    createDescriptorUpdateTemplate();
+    for (size_t frame = 0; frame < m_framesInFlight; frame++)
+    {
+        createFrameResources(frame);
+    }
     createSyncObjects();
+    finishPipelineWarmUp();
 }
 
 void BasicTriangleApplication::createInstance()
@@ -210,7 +787,7 @@ void BasicTriangleApplication::createInstance()
         vk::makeApiVersion(0, 1, 0, 0),
         "No Engine",
         vk::makeApiVersion(0, 1, 0, 0),
-        vk::ApiVersion10
+        vk::ApiVersion11
     );
 
     vk::InstanceCreateInfo const instanceCreateInfo(
@@ -221,7 +798,7 @@ void BasicTriangleApplication::createInstance()
         pNext
     );
 
-    auto const result = vk::createInstance(&instanceCreateInfo, nullptr, &m_instance);
+    auto const result = vk::createInstance(&instanceCreateInfo, m_pAllocator, &m_instance);
     resultCheck(result, "Failure initializing the Vulkan instance");
 }
 
@@ -237,7 +814,7 @@ void BasicTriangleApplication::setupDebugMessenger()
         throw std::runtime_error("Failed to find required debug messenger functions");
     }
 
-    m_debugMessenger = m_instance.createDebugUtilsMessengerEXT(GetDebugMessengerCreateInfo(&debugCallback));
+    m_debugMessenger = m_instance.createDebugUtilsMessengerEXT(GetDebugMessengerCreateInfo(&debugCallback), m_pAllocator);
 }
 
 void BasicTriangleApplication::createSurface()
@@ -245,7 +822,7 @@ void BasicTriangleApplication::createSurface()
     if (auto const result = static_cast<vk::Result>(glfwCreateWindowSurface(
         m_instance,
         m_window,
-        nullptr,
+        reinterpret_cast<VkAllocationCallbacks const*>(m_pAllocator),
         reinterpret_cast<VkSurfaceKHR*>(&m_surface)
     ));
     result != vk::Result::eSuccess)
@@ -266,6 +843,31 @@ void BasicTriangleApplication::pickPhysicalDevice()
     m_physicalDevice = *bestDevice;
 }
 
+void BasicTriangleApplication::detectDirectDeviceWrites()
+{
+    auto const& memoryProperties = m_memoryTracker.GetMemoryProperties();
+
+    // Only treat host visible device local memory as usable when it lives in the main device local heap (UMA or
+    // resizable BAR). Without ReBAR discrete GPUs expose a separate 256MB BAR heap which is too scarce to fill.
+    auto const largestDeviceLocalHeap = m_memoryTracker.GetLargestDeviceLocalHeap();
+
+    m_directDeviceWrites = false;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        auto const& memoryType = memoryProperties.memoryTypes[i];
+        if ((memoryType.propertyFlags & DirectWriteMemoryProperties) == DirectWriteMemoryProperties &&
+            memoryType.heapIndex == largestDeviceLocalHeap)
+        {
+            m_directDeviceWrites = true;
+            break;
+        }
+    }
+
+    std::cout << (m_directDeviceWrites
+                      ? "Device local memory is host visible, geometry and uniforms are written directly\n"
+                      : "Device local memory is not host visible, geometry is uploaded through staging buffers\n");
+}
+
 void BasicTriangleApplication::createLogicalDevice()
 {
     auto const& queueFamilyIndices = m_physicalDevice.GetQueueFamilyIndices(m_surface);
@@ -297,40 +899,248 @@ void BasicTriangleApplication::createLogicalDevice()
         enabledLayerNames = ValidationLayers;
     }
 
-    std::vector<const char*> enabledExtensionNames = DeviceExtensions;
-
-    vk::PhysicalDeviceFeatures const deviceFeatures;
+    m_enabledDeviceExtensions = DeviceExtensions;
+    std::ranges::copy(GetSupportedDeviceExtensions(m_physicalDevice.GetPDevice(), OptionalDeviceExtensions),
+                      std::back_inserter(m_enabledDeviceExtensions));
+
+    auto const supportedFeatures = m_physicalDevice.GetPDevice().getFeatures();
+    m_samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+    m_storageImageWriteWithoutFormat = supportedFeatures.shaderStorageImageWriteWithoutFormat;
+    m_sampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+
+    vk::PhysicalDeviceFeatures deviceFeatures;
+    deviceFeatures.samplerAnisotropy = m_samplerAnisotropy;
+    // The compute mip generator writes through storage images declared without a format qualifier
+    deviceFeatures.shaderStorageImageWriteWithoutFormat = m_storageImageWriteWithoutFormat;
+    // The packed quads pick their texture array with a push constant
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = m_sampledImageArrayDynamicIndexing;
+
+    // Textures are copied straight from decoded pixels into their images when the device can, the extension only
+    // counts when its dependencies and the feature are there too
+    auto const hostImageCopyExtensions = GetSupportedDeviceExtensions(m_physicalDevice.GetPDevice(),
+                                                                      HostImageCopyExtensions);
+    if (hostImageCopyExtensions.size() == HostImageCopyExtensions.size())
+    {
+        m_hostCopyDstLayouts = GetHostImageCopyDstLayouts(m_physicalDevice.GetPDevice());
+    }
 
-    m_logicalDevice = m_physicalDevice.GetPDevice().createDevice(
-        vk::DeviceCreateInfo(
-            {},
-            queueCreateInfos,
-            enabledLayerNames,
-            enabledExtensionNames,
-            &deviceFeatures
-        )
-    );
+    vk::PhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures;
+    if (!m_hostCopyDstLayouts.empty())
+    {
+        std::ranges::copy(hostImageCopyExtensions, std::back_inserter(m_enabledDeviceExtensions));
+        hostImageCopyFeatures.hostImageCopy = true;
+    }
 
-    m_gfxQueue = m_logicalDevice.getQueue(*queueFamilyIndices.graphicsFamilyIndex, 0);
-    m_presentQueue = m_logicalDevice.getQueue(*queueFamilyIndices.presentFamilyIndex, 0);
-}
+    vk::PhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures;
+    if (m_bindlessRequested)
+    {
+        auto const bindlessExtensions = GetSupportedDeviceExtensions(m_physicalDevice.GetPDevice(), BindlessExtensions);
+        m_bindless = bindlessExtensions.size() == BindlessExtensions.size() &&
+                     SupportsBindlessDescriptors(m_physicalDevice.GetPDevice());
 
-void BasicTriangleApplication::createSwapChain(bool recreate /*= false*/)
-{
-    auto const swapChainSupport = m_physicalDevice.GetSwapChainSupport(m_surface, recreate);
+        if (m_bindless)
+        {
+            std::ranges::copy(bindlessExtensions, std::back_inserter(m_enabledDeviceExtensions));
+            descriptorIndexingFeatures = GetBindlessFeatures();
+            deviceFeatures.shaderStorageBufferArrayDynamicIndexing = true;
+        }
 
-    auto const surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats);
-    auto const presentMode = ChoosePresentMode(swapChainSupport.presentModes);
-    auto const swapExtent = ChooseSwapExtent(swapChainSupport.capabilities, m_window);
+        std::cout << std::format("Bindless descriptors {}\n", m_bindless ? "enabled"
+                                                                          : "unsupported, using fixed bindings");
+    }
 
-    auto imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    // Pipelines are put together from separately compiled parts when the device can link them quickly
+    auto const pipelineLibraryExtensions = GetSupportedDeviceExtensions(m_physicalDevice.GetPDevice(),
+                                                                        GraphicsPipelineLibraryExtensions);
+    m_pipelineLibraries = pipelineLibraryExtensions.size() == GraphicsPipelineLibraryExtensions.size() &&
+                          SupportsGraphicsPipelineLibrary(m_physicalDevice.GetPDevice());
 
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
+    vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures;
+    if (m_pipelineLibraries)
     {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
+        std::ranges::copy(pipelineLibraryExtensions, std::back_inserter(m_enabledDeviceExtensions));
+        pipelineLibraryFeatures.graphicsPipelineLibrary = true;
     }
 
-    auto const indices = m_physicalDevice.GetQueueFamilyIndices(m_surface, recreate);
+    std::cout << std::format("Graphics pipeline libraries {}\n", m_pipelineLibraries
+                                                                  ? "enabled"
+                                                                  : "unsupported, pipelines compile whole");
+
+    // Cull mode, front face, topology, depth and blend enable move from the pipelines into the command buffers
+    vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeatures;
+    vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features;
+    if (m_dynamicStateRequested)
+    {
+        m_dynamicState = GetDynamicStateSupport(m_physicalDevice.GetPDevice());
+
+        if (m_dynamicState.extendedDynamicState)
+        {
+            std::ranges::copy(ExtendedDynamicStateExtensions, std::back_inserter(m_enabledDeviceExtensions));
+            dynamicStateFeatures.extendedDynamicState = true;
+        }
+        if (m_dynamicState.colorBlendEnable)
+        {
+            std::ranges::copy(ExtendedDynamicState3Extensions, std::back_inserter(m_enabledDeviceExtensions));
+            dynamicState3Features.extendedDynamicState3ColorBlendEnable = true;
+        }
+    }
+
+    // Draws without pipelines, every piece of state is set while recording
+    vk::PhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures;
+    vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures;
+    if (m_shaderObjectsRequested)
+    {
+        auto const shaderObjectExtensions = GetSupportedDeviceExtensions(m_physicalDevice.GetPDevice(),
+                                                                         ShaderObjectExtensions);
+        m_shaderObjects = shaderObjectExtensions.size() == ShaderObjectExtensions.size() &&
+                          SupportsShaderObject(m_physicalDevice.GetPDevice());
+
+        if (m_shaderObjects)
+        {
+            std::ranges::copy(shaderObjectExtensions, std::back_inserter(m_enabledDeviceExtensions));
+            shaderObjectFeatures.shaderObject = true;
+            dynamicRenderingFeatures.dynamicRendering = true;
+        }
+    }
+
+    vk::DeviceCreateInfo deviceCreateInfo(
+        {},
+        queueCreateInfos,
+        enabledLayerNames,
+        m_enabledDeviceExtensions,
+        &deviceFeatures
+    );
+
+    // Optional feature structs are chained in front of each other
+    void* pFeatures = nullptr;
+    if (m_bindless)
+    {
+        descriptorIndexingFeatures.pNext = pFeatures;
+        pFeatures = &descriptorIndexingFeatures;
+    }
+    if (hostImageCopyFeatures.hostImageCopy)
+    {
+        hostImageCopyFeatures.pNext = pFeatures;
+        pFeatures = &hostImageCopyFeatures;
+    }
+    if (m_pipelineLibraries)
+    {
+        pipelineLibraryFeatures.pNext = pFeatures;
+        pFeatures = &pipelineLibraryFeatures;
+    }
+    if (dynamicStateFeatures.extendedDynamicState)
+    {
+        dynamicStateFeatures.pNext = pFeatures;
+        pFeatures = &dynamicStateFeatures;
+    }
+    if (dynamicState3Features.extendedDynamicState3ColorBlendEnable)
+    {
+        dynamicState3Features.pNext = pFeatures;
+        pFeatures = &dynamicState3Features;
+    }
+    if (m_shaderObjects)
+    {
+        shaderObjectFeatures.pNext = pFeatures;
+        dynamicRenderingFeatures.pNext = &shaderObjectFeatures;
+        pFeatures = &dynamicRenderingFeatures;
+    }
+    deviceCreateInfo.pNext = pFeatures;
+
+    m_logicalDevice = m_physicalDevice.GetPDevice().createDevice(deviceCreateInfo, m_pAllocator);
+
+    if (!m_hostCopyDstLayouts.empty() && !LoadHostImageCopyFunctions(m_logicalDevice))
+    {
+        m_hostCopyDstLayouts.clear();
+    }
+
+    std::cout << std::format("Host image copy {}\n", m_hostCopyDstLayouts.empty()
+                                                         ? "unavailable, textures upload through staging"
+                                                         : "available");
+
+    if (m_shaderObjectsRequested)
+    {
+        m_shaderObjects = m_shaderObjects && LoadShaderObjectFunctions(m_logicalDevice);
+    }
+
+    // Loaded once for whichever needs more, shader objects bring every function without the extensions enabled
+    if (m_dynamicStateRequested || m_shaderObjects)
+    {
+        if (!LoadDynamicStateFunctions(m_logicalDevice, m_shaderObjects ? ShaderObjectDynamicState : m_dynamicState))
+        {
+            m_dynamicState = {};
+            m_shaderObjects = false;
+        }
+    }
+
+    if (m_dynamicStateRequested)
+    {
+        std::cout << std::format("Extended dynamic state {}, dynamic blend enable {}\n",
+                                 m_dynamicState.extendedDynamicState ? "enabled" : "unsupported",
+                                 m_dynamicState.colorBlendEnable ? "enabled" : "unsupported");
+    }
+    m_stateRecorder = DynamicStateRecorder(m_dynamicState);
+
+    if (m_shaderObjectsRequested)
+    {
+        std::cout << std::format("Shader objects {}\n", m_shaderObjects ? "enabled, drawing without pipelines"
+                                                                         : "unsupported, drawing with pipelines");
+    }
+
+    m_gfxQueue = m_logicalDevice.getQueue(*queueFamilyIndices.graphicsFamilyIndex, 0);
+    m_presentQueue = m_logicalDevice.getQueue(*queueFamilyIndices.presentFamilyIndex, 0);
+
+    m_memoryTracker = MemoryTracker(m_physicalDevice.GetPDevice(), m_logicalDevice,
+                                    isDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME), m_pAllocator);
+    m_memoryTracker.AddOverBudgetCallback([](uint32_t heapIndex, HeapStats const& heapStats)
+    {
+        std::cout << std::format("Memory heap {} is over budget: {} of {} bytes\n", heapIndex,
+                                 heapStats.processUsage.value_or(heapStats.allocatedBytes), heapStats.budget);
+    });
+
+    // Shared by every texture, materials mostly ask for the same few samplers and views
+    m_samplerCache = SamplerCache(m_logicalDevice,
+                                  m_physicalDevice.GetPDevice().getProperties().limits.maxSamplerAllocationCount,
+                                  m_pAllocator);
+    m_imageViewCache = ImageViewCache(m_logicalDevice, m_pAllocator);
+    m_layoutCache = LayoutCache(m_logicalDevice, m_pAllocator);
+    // Compiles in the background next to the render thread, which only waits for the pipelines of the first frame
+    m_pipelineCache.emplace(m_logicalDevice, std::max(std::thread::hardware_concurrency(), 2u) - 1, m_pipelineLibraries,
+                            m_dynamicState, m_pAllocator);
+
+    detectDirectDeviceWrites();
+}
+
+bool BasicTriangleApplication::canCopyTextureOnHost(vk::Format format, vk::ImageUsageFlags usage,
+                                                    vk::ImageLayout layout) const
+{
+    return std::ranges::find(m_hostCopyDstLayouts, layout) != m_hostCopyDstLayouts.end() &&
+           SupportsHostImageCopy(m_physicalDevice.GetPDevice(), format, usage);
+}
+
+bool BasicTriangleApplication::isDeviceExtensionEnabled(std::string_view extension) const
+{
+    return std::ranges::any_of(m_enabledDeviceExtensions, [extension](char const* pEnabled)
+    {
+        return extension == pEnabled;
+    });
+}
+
+void BasicTriangleApplication::createSwapChain(bool recreate /*= false*/)
+{
+    auto const swapChainSupport = m_physicalDevice.GetSwapChainSupport(m_surface, recreate);
+
+    auto const surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats);
+    auto const presentMode = ChoosePresentMode(swapChainSupport.presentModes);
+    auto const swapExtent = ChooseSwapExtent(swapChainSupport.capabilities, m_window);
+
+    auto imageCount = swapChainSupport.capabilities.minImageCount + 1;
+
+    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
+    {
+        imageCount = swapChainSupport.capabilities.maxImageCount;
+    }
+
+    auto const indices = m_physicalDevice.GetQueueFamilyIndices(m_surface, recreate);
 
     std::set queueFamilyIndicesSet = { *indices.graphicsFamilyIndex, *indices.presentFamilyIndex };
     std::vector queueFamilyIndices(queueFamilyIndicesSet.begin(), queueFamilyIndicesSet.end());
@@ -354,7 +1164,7 @@ void BasicTriangleApplication::createSwapChain(bool recreate /*= false*/)
         true
     );
 
-    m_swapChain = m_logicalDevice.createSwapchainKHR(swapchainCreateInfo);
+    m_swapChain = m_logicalDevice.createSwapchainKHR(swapchainCreateInfo, m_pAllocator);
 
     m_swapChainImages = m_logicalDevice.getSwapchainImagesKHR(m_swapChain);
     m_swapChainImageFormat = surfaceFormat.format;
@@ -380,139 +1190,216 @@ void BasicTriangleApplication::createImageViews()
                 )
             );
 
-            return m_logicalDevice.createImageView(imageViewCreateInfo);
+            return m_logicalDevice.createImageView(imageViewCreateInfo, m_pAllocator);
         };
 
     std::ranges::transform(m_swapChainImages, std::back_inserter(m_swapChainImageViews), fnGetImageView);
 }
 
-void BasicTriangleApplication::createDescriptorSetLayout()
+void BasicTriangleApplication::createPipelineLayout()
 {
-    std::vector bindings = {
-        vk::DescriptorSetLayoutBinding
+    // Every pipeline binds the frame's set, so their shaders are reflected together and share one pipeline layout
+    auto const& packedShaders = m_bindless ? BindlessShaders : PackedShaders;
+    std::vector<ShaderInterface> interfaces;
+    for (auto const* pFileName : { MainShaders.vertex, MainShaders.fragment, packedShaders.vertex,
+                                   packedShaders.fragment })
+    {
+        interfaces.push_back(ReflectShader(ReadShaderFile(pFileName)));
+    }
+
+    auto const frameInterface = MergeShaderInterfaces(interfaces);
+
+    // Set 1 when enabled, allocated once and bound next to the frame's set
+    std::vector<vk::DescriptorSetLayout> externalSetLayouts;
+    if (m_bindless)
+    {
+        m_bindlessTable = BindlessDescriptorTable(m_logicalDevice, m_physicalDevice.GetPDevice(), BindlessMaxTextures,
+                                                  BindlessMaxStorageBuffers,
+                                                  vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+                                                  m_pAllocator);
+        externalSetLayouts = { nullptr, m_bindlessTable.GetLayout() };
+    }
+
+    m_descriptorSetLayout = m_layoutCache.GetSetLayout(frameInterface, 0);
+    m_pipelineLayout = m_layoutCache.GetPipelineLayout(frameInterface, externalSetLayouts);
+
+    m_pushConstantRanges = frameInterface.pushConstantRanges;
+    for (auto const& range : m_pushConstantRanges)
+    {
+        m_pushConstantStages |= range.stageFlags;
+    }
+
+    // The shaders are created against the same set layouts and ranges, descriptor sets bind through the layout above
+    if (m_shaderObjects)
+    {
+        std::vector setLayouts = { m_descriptorSetLayout };
+        if (m_bindless)
         {
-            0,
-            vk::DescriptorType::eUniformBuffer,
-            1,
-            vk::ShaderStageFlagBits::eVertex
+            setLayouts.push_back(m_bindlessTable.GetLayout());
         }
-    };
 
-    vk::DescriptorSetLayoutCreateInfo layoutInfo
-    {
-        {},
-        bindings
-    };
+        m_shaderObjectRenderer = ShaderObjectRenderer(m_logicalDevice, setLayouts, m_pushConstantRanges, m_pAllocator);
+    }
 
-    m_descriptorSetLayout = m_logicalDevice.createDescriptorSetLayout(layoutInfo);
+    auto const stats = m_layoutCache.GetStats();
+    std::cout << std::format("{} shaders reflected into {} set layouts and {} pipeline layouts\n", interfaces.size(),
+                             stats.setLayouts, stats.pipelineLayouts);
 }
 
-void BasicTriangleApplication::createGraphicsPipeline()
+void BasicTriangleApplication::warmPipelines()
 {
-    auto const vertShaderModule = CreateShaderModule(m_logicalDevice, "shaders/shader.vert.spv");
-    auto const fragShaderModule = CreateShaderModule(m_logicalDevice, "shaders/shader.frag.spv");
+    if (m_shaderObjects)
+    {
+        return;
+    }
 
-    std::array vertexBindingDescriptions = { Vertex::getBindingDescription() };
-    std::array vertexAttributeDescriptions = { Vertex::getAttributeDescriptions() };
+    auto const fileName = m_bindless ? BindlessPipelineManifestFileName : PipelineManifestFileName;
 
-    vk::PipelineVertexInputStateCreateInfo vertexInputState
+    std::vector<PipelineDesc> descs;
+    try
     {
-        {},
-        vertexBindingDescriptions,
-        vertexAttributeDescriptions
-    };
-
-    std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
-        { {}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main" },
-        { {}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main" }
-    };
+        descs = ReadPipelineManifest(fileName);
+    }
+    catch (std::exception const& e)
+    {
+        std::cout << std::format("Ignoring the pipeline manifest: {}\n", e.what());
+        return;
+    }
 
-    std::vector dynamicStates = {
-        vk::DynamicState::eViewport,
-        vk::DynamicState::eScissor
-    };
+    // Pipelines of another swap chain format would never be drawn with
+    RenderTargetFormats const renderTargets{ { m_swapChainImageFormat } };
+    std::erase_if(descs, [&renderTargets](PipelineDesc const& desc) { return desc.renderTargets != renderTargets; });
+    for (auto& desc : descs)
+    {
+        desc.layout = m_pipelineLayout;
+    }
 
-    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo{ {}, dynamicStates };
+    auto const queued = m_pipelineCache->Warm(descs);
+    std::cout << std::format("{} pipelines of the manifest compiling while loading\n", queued);
+}
 
-    constexpr vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState{
-        {},
-        vk::PrimitiveTopology::eTriangleList,
-        false
-    };
+void BasicTriangleApplication::finishPipelineWarmUp()
+{
+    if (m_shaderObjects)
+    {
+        return;
+    }
 
-    constexpr vk::PipelineViewportStateCreateInfo viewportState{ {}, 1, nullptr, 1, nullptr };
+    auto const waitStart = std::chrono::steady_clock::now();
+    m_pipelineCache->WaitIdle();
+    auto const waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
 
-    constexpr vk::PipelineRasterizationStateCreateInfo rasterizationState{
-        {},
-        false,
-        false,
-        vk::PolygonMode::eFill,
-        vk::CullModeFlagBits::eBack,
-        vk::FrontFace::eCounterClockwise,
-        false,
-        0.0f,
-        0.0f,
-        0.0f,
-        1.0f
-    };
+    std::cout << std::format("Waited {:.1f} ms for pipelines after loading\n", waitMs);
+}
 
-    constexpr vk::PipelineMultisampleStateCreateInfo multisampleState{};
+void BasicTriangleApplication::writePipelineManifest() const
+{
+    if (m_shaderObjects)
+    {
+        return;
+    }
 
-    std::vector colorBlendAttachments = {
-        vk::PipelineColorBlendAttachmentState {
-            false,
-            {},
-            {},
-            {},
-            {},
-            {},
-            {},
-            vk::FlagTraits<vk::ColorComponentFlagBits>::allFlags
-        }
-    };
+    try
+    {
+        WritePipelineManifest(m_bindless ? BindlessPipelineManifestFileName : PipelineManifestFileName,
+                              m_pipelineCache->GetRequestedDescs());
+    }
+    catch (std::exception const& e)
+    {
+        std::cout << std::format("Failed to write the pipeline manifest: {}\n", e.what());
+    }
+}
 
-    vk::PipelineColorBlendStateCreateInfo const colorBlendState{
-        {},
-        false,
-        vk::LogicOp::eCopy,
-        colorBlendAttachments
-    };
+void BasicTriangleApplication::createGraphicsPipeline()
+{
+    m_mainPipelineDesc = describePipeline(MainShaders.vertex, MainShaders.fragment, Vertex::getBindingDescription(),
+                                          Vertex::getAttributeDescriptions());
+    if (m_shaderObjects)
+    {
+        m_shaderObjectRenderer.Prepare(m_mainPipelineDesc);
+        return;
+    }
 
-    std::vector layouts = { m_descriptorSetLayout };
+    m_pipeline = m_pipelineCache->RequestBlocking(m_mainPipelineDesc);
+}
 
-    vk::PipelineLayoutCreateInfo pipelineLayout
+void BasicTriangleApplication::createPackedPipeline()
+{
+    if (m_packedDraws.empty())
     {
-        {},
-        layouts
-    };
+        return;
+    }
 
-    m_pipelineLayout = m_logicalDevice.createPipelineLayout(pipelineLayout);
+    auto const& shaders = m_bindless ? BindlessShaders : PackedShaders;
+    auto const binding = PackedVertex::getBindingDescription();
+    auto const attributes = PackedVertex::getAttributeDescriptions();
 
-    vk::GraphicsPipelineCreateInfo const pipelineCreateInfo{
-        {},
-        shaderStages,
-        &vertexInputState,
-        &inputAssemblyState,
-        {},
-        &viewportState,
-        &rasterizationState,
-        &multisampleState,
-        {},
-        &colorBlendState,
-        &dynamicStateCreateInfo,
-        m_pipelineLayout,
-        m_renderPass,
-        0
-    };
+    // The fallback differs in its fragment shader only, the dynamic state of the packed quads fits both
+    m_packedPipelineDesc = describePipeline(shaders.vertex, shaders.fragment, binding, attributes);
 
-    auto pipelineResult = m_logicalDevice.createGraphicsPipeline(nullptr, pipelineCreateInfo);
+    // Created right away, there's nothing to wait for and no fallback needed
+    if (m_shaderObjects)
+    {
+        m_shaderObjectRenderer.Prepare(m_packedPipelineDesc);
+        return;
+    }
 
-    resultCheck(pipelineResult.result, "Failed to create pipeline!");
+    m_packedFallbackPipeline = m_pipelineCache->RequestBlocking(describePipeline(shaders.vertex,
+                                                                                 FallbackFragmentShader, binding,
+                                                                                 attributes));
+    m_packedPipeline = m_pipelineCache->Request(m_packedPipelineDesc);
+}
+
+PipelineDesc BasicTriangleApplication::describePipeline(
+    std::string const& vertShaderFileName,
+    std::string const& fragShaderFileName,
+    vk::VertexInputBindingDescription const& binding,
+    std::span<vk::VertexInputAttributeDescription const> attributes
+) const
+{
+    PipelineDesc desc;
+    desc.vertexShader = vertShaderFileName;
+    desc.fragmentShader = fragShaderFileName;
+    desc.vertexBindings = { binding };
+    desc.vertexAttributes.assign(attributes.begin(), attributes.end());
+    desc.renderTargets.colorFormats = { m_swapChainImageFormat };
+    desc.layout = m_pipelineLayout;
+
+    return desc;
+}
 
-    m_pipeline = pipelineResult.value;
+std::vector<PipelineDesc> BasicTriangleApplication::describeMaterials() const
+{
+    std::vector<PipelineDesc> materials;
+    for (auto const cullMode : { vk::CullModeFlags{}, vk::CullModeFlags{ vk::CullModeFlagBits::eBack },
+                                 vk::CullModeFlags{ vk::CullModeFlagBits::eFront } })
+    {
+        for (auto const frontFace : { vk::FrontFace::eCounterClockwise, vk::FrontFace::eClockwise })
+        {
+            for (auto const topology : { vk::PrimitiveTopology::eTriangleList, vk::PrimitiveTopology::eTriangleStrip })
+            {
+                for (auto const depthTest : { false, true })
+                {
+                    for (auto const depthWrite : { false, true })
+                    {
+                        for (auto const blendEnable : { false, true })
+                        {
+                            auto material = m_mainPipelineDesc;
+                            material.cullMode = cullMode;
+                            material.frontFace = frontFace;
+                            material.topology = topology;
+                            material.depthTest = depthTest;
+                            material.depthWrite = depthWrite;
+                            material.blend.blendEnable = blendEnable;
+                            materials.push_back(material);
+                        }
+                    }
+                }
+            }
+        }
+    }
 
-    m_logicalDevice.destroyShaderModule(vertShaderModule);
-    m_logicalDevice.destroyShaderModule(fragShaderModule);
+    return materials;
 }
 
 void BasicTriangleApplication::createRenderPass()
@@ -559,7 +1446,7 @@ void BasicTriangleApplication::createRenderPass()
         }
     };
 
-    m_renderPass = m_logicalDevice.createRenderPass({ {}, colorAttachments, subpasses, dependencies });
+    m_renderPass = m_logicalDevice.createRenderPass({ {}, colorAttachments, subpasses, dependencies }, m_pAllocator);
 }
 
 void BasicTriangleApplication::createFrameBuffers()
@@ -580,7 +1467,7 @@ void BasicTriangleApplication::createFrameBuffers()
             1
         };
 
-        m_swapChainFrameBuffers.push_back(m_logicalDevice.createFramebuffer(frameBufferInfo));
+        m_swapChainFrameBuffers.push_back(m_logicalDevice.createFramebuffer(frameBufferInfo, m_pAllocator));
     }
 }
 
@@ -598,204 +1485,931 @@ void BasicTriangleApplication::createCommandPool()
         queueFamilyIndices.graphicsFamilyIndex.value()
     };
 
-    m_commandPool = m_logicalDevice.createCommandPool(poolInfo);
+    m_commandPool = m_logicalDevice.createCommandPool(poolInfo, m_pAllocator);
+}
+
+void BasicTriangleApplication::createTextureUploader()
+{
+    auto queueFamilyIndices = m_physicalDevice.GetQueueFamilyIndices(m_surface);
+
+    m_textureUploader = StreamingImageUploader(m_logicalDevice, m_memoryTracker, m_gfxQueue,
+                                               queueFamilyIndices.graphicsFamilyIndex.value(), TextureStagingSize,
+                                               m_pAllocator);
 }
 
 void BasicTriangleApplication::createTextureImage()
 {
-    int texWidth, texHeight, texChannels;
-    auto texName = "textures/cat.png";
-    stbi_uc* pixels = stbi_load(texName, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    auto const loadStart = std::chrono::steady_clock::now();
+    auto const uploadStatsBefore = m_textureUploader.GetStats();
+    auto textureName = TextureFileName;
 
-    vk::DeviceSize imageSize = texWidth * texHeight * 4;
+    if (std::filesystem::exists(CompressedTextureFileName))
+    {
+        try
+        {
+            createCompressedTextureImage();
+            textureName = CompressedTextureFileName;
+        }
+        catch (std::exception const& e)
+        {
+            std::cout << std::format("Falling back to {}: {}\n", TextureFileName, e.what());
+        }
+    }
 
-    if (!pixels)
+    if (!m_textureImage)
     {
-        throw std::runtime_error(std::format("failed to load texture: {}", texName));
+        createPngTextureImage();
     }
 
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
+    auto const loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+
+    constexpr double MiB = 1024.0 * 1024.0;
+    auto const imageBytes = m_logicalDevice.getImageMemoryRequirements(m_textureImage).size;
+    auto const rgbaBytes = GetMipChainSize(m_textureExtent.width, m_textureExtent.height, m_textureMipLevels);
+    auto const& uploadStats = m_textureUploader.GetStats();
+
+    std::cout << std::format("Texture {}: {} {}x{} with {} mip levels loaded in {:.1f} ms, {:.2f} MiB of VRAM "
+                             "({:.2f} MiB saved against RGBA8)\n",
+                             textureName, vk::to_string(m_textureFormat), m_textureExtent.width,
+                             m_textureExtent.height, m_textureMipLevels, loadMs, static_cast<double>(imageBytes) / MiB,
+                             (static_cast<double>(rgbaBytes) - static_cast<double>(imageBytes)) / MiB);
+
+    std::cout << std::format("{:.2f} MiB streamed through {:.0f} MiB of staging in {} copies and {} submits, "
+                             "{:.1f} ms waiting for staging\n",
+                             static_cast<double>(uploadStats.bytesUploaded - uploadStatsBefore.bytesUploaded) / MiB,
+                             static_cast<double>(m_textureUploader.GetStagingSize()) / MiB,
+                             uploadStats.copyCount - uploadStatsBefore.copyCount,
+                             uploadStats.submitCount - uploadStatsBefore.submitCount,
+                             uploadStats.stallMs - uploadStatsBefore.stallMs);
+}
+
+void BasicTriangleApplication::createCompressedTextureImage()
+{
+    auto const texture = LoadKtx2Texture(CompressedTextureFileName, m_physicalDevice.GetPDevice());
+
+    m_textureFormat = texture.format;
+    m_textureMipLevels = static_cast<uint32_t>(texture.levels.size());
+    m_textureExtent = vk::Extent2D{ texture.width, texture.height };
+
+    // Compressed formats can't be blitted or written by shaders, every level comes from the file
+    auto usage = vk::ImageUsageFlagBits::eSampled;
+    bool const hostCopy = canCopyTextureOnHost(m_textureFormat, usage, vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    usage |= hostCopy ? vk::ImageUsageFlagBits::eHostTransferEXT : vk::ImageUsageFlagBits::eTransferDst;
+
+    std::tie(m_textureImage, m_textureImageMemory) = createTexture(texture.width,
+                                                                   texture.height,
+                                                                   m_textureMipLevels,
+                                                                   m_textureFormat,
+                                                                   vk::ImageTiling::eOptimal,
+                                                                   usage,
+                                                                   vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    if (hostCopy)
+    {
+        TransitionImageOnHost(m_logicalDevice, m_textureImage, vk::ImageLayout::eUndefined,
+                              vk::ImageLayout::eShaderReadOnlyOptimal, m_textureMipLevels);
+
+        for (uint32_t level = 0; level < m_textureMipLevels; level++)
+        {
+            auto const& layout = texture.levels[level];
+            CopyToImageOnHost(m_logicalDevice, m_textureImage, vk::ImageLayout::eShaderReadOnlyOptimal, level,
+                              layout.width, layout.height, texture.data.data() + layout.offset);
+        }
+    }
+    else
+    {
+        m_textureUploader.RecordCommands([this](vk::CommandBuffer commandBuffer)
+        {
+            recordTextureToTransferDst(commandBuffer, m_textureImage, m_textureMipLevels);
+        });
+
+        // Levels are stored as tightly packed block rows, the same layout the uploader asks for
+        for (uint32_t level = 0; level < m_textureMipLevels; level++)
+        {
+            auto const& layout = texture.levels[level];
+            auto const* pLevel = texture.data.data() + layout.offset;
+
+            m_textureUploader.UploadLevel(m_textureImage, m_textureFormat, level, layout.width, layout.height,
+                                          [pLevel](uint8_t* pDst, uint32_t firstRow, uint32_t rowCount, size_t rowPitch)
+                                          {
+                                              memcpy(pDst, pLevel + firstRow * rowPitch, rowCount * rowPitch);
+                                          });
+        }
+
+        m_textureUploader.RecordCommands([this](vk::CommandBuffer commandBuffer)
+        {
+            recordTextureToShaderRead(commandBuffer, m_textureImage, m_textureMipLevels);
+        });
+
+        m_textureUploader.Flush();
+    }
+
+    std::cout << std::format("{} {}, {}\n", CompressedTextureFileName,
+                             texture.transcoded ? "transcoded from Basis Universal" : "uploaded as stored",
+                             hostCopy ? "copied on the host" : "copied through staging");
+}
+
+void BasicTriangleApplication::recordTextureToTransferDst(vk::CommandBuffer commandBuffer, vk::Image image,
+                                                          uint32_t mipLevels) const
+{
+    // Every level is transitioned at once, levels that aren't uploaded are generated afterwards
+    std::vector toTransferDst = {
+        MakeMipBarrier(image, {}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined,
+                       vk::ImageLayout::eTransferDstOptimal, 0, mipLevels)
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
+                                  toTransferDst);
+}
+
+void BasicTriangleApplication::recordTextureToShaderRead(vk::CommandBuffer commandBuffer, vk::Image image,
+                                                         uint32_t mipLevels) const
+{
+    std::vector toShaderRead = {
+        MakeMipBarrier(image, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                       vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, 0, mipLevels)
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                  {}, {}, {}, toShaderRead);
+}
+
+void BasicTriangleApplication::createPngTextureImage()
+{
+    auto const physicalDevice = m_physicalDevice.GetPDevice();
+    PngStreamDecoder decoder(TextureFileName, physicalDevice.getProperties().limits.maxImageDimension2D);
+
+    auto const width = decoder.GetWidth();
+    auto const height = decoder.GetHeight();
+
+    m_textureFormat = vk::Format::eB8G8R8A8Srgb;
+    m_textureExtent = vk::Extent2D{ width, height };
+
+    m_textureMipLevels = GetMipLevelCount(width, height);
+
+    bool const blitMipmaps = SupportsLinearBlit(physicalDevice, m_textureFormat);
+    bool const computeMipmaps = !blitMipmaps && m_storageImageWriteWithoutFormat &&
+                                SupportsComputeMipmaps(physicalDevice, m_textureFormat);
+    // Without either GPU path every level is filtered on the CPU and uploaded with level 0
+    bool const cpuMipmaps = !blitMipmaps && !computeMipmaps;
+
+    // Rows are decoded straight into the mapped staging memory, stb only decodes the whole image up front when the
+    // streaming decoder can't handle the PNG or every level has to be filtered on the CPU from it anyway
+    bool const streamRows = decoder.IsStreamable() && !cpuMipmaps;
+    stbi_uc* pixels = nullptr;
+
+    if (!streamRows)
+    {
+        int texWidth, texHeight, texChannels;
+        pixels = stbi_load(TextureFileName, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+        if (!pixels)
+        {
+            throw std::runtime_error(std::format("failed to load texture: {}", TextureFileName));
+        }
+    }
+
+    auto usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    vk::ImageCreateFlags flags;
+
+    if (blitMipmaps)
+    {
+        usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+    else if (computeMipmaps)
+    {
+        usage |= vk::ImageUsageFlagBits::eStorage;
+
+        // sRGB formats can't be storage images, the shader writes through a UNORM view instead
+        if (GetStorageCompatibleFormat(m_textureFormat) != m_textureFormat)
+        {
+            flags |= vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage;
+        }
+
+        if (!m_computeMipmapGenerator)
+        {
+            m_computeMipmapGenerator.emplace(m_logicalDevice, MipmapShaderFileName, m_pAllocator);
+        }
+    }
+
+    // A fully decoded image skips staging when the device can copy from the host. The GPU mip paths expect level 0 in
+    // transfer dst layout, with CPU mips every level is final as soon as it's copied.
+    auto const hostCopyLayout = cpuMipmaps ? vk::ImageLayout::eShaderReadOnlyOptimal
+                                           : vk::ImageLayout::eTransferDstOptimal;
+    bool const hostCopy = !streamRows && canCopyTextureOnHost(m_textureFormat, usage, hostCopyLayout);
+
+    if (hostCopy)
+    {
+        usage |= vk::ImageUsageFlagBits::eHostTransferEXT;
+    }
+
+    std::tie(m_textureImage, m_textureImageMemory) = createTexture(width,
+                                                                   height,
+                                                                   m_textureMipLevels,
+                                                                   m_textureFormat,
+                                                                   vk::ImageTiling::eOptimal,
+                                                                   usage,
+                                                                   vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                                   flags);
+
+    if (hostCopy)
+    {
+        TransitionImageOnHost(m_logicalDevice, m_textureImage, vk::ImageLayout::eUndefined, hostCopyLayout,
+                              m_textureMipLevels);
+    }
+    else
+    {
+        m_textureUploader.RecordCommands([this](vk::CommandBuffer commandBuffer)
+        {
+            recordTextureToTransferDst(commandBuffer, m_textureImage, m_textureMipLevels);
+        });
+    }
+
+    if (streamRows)
+    {
+        m_textureUploader.UploadLevel(m_textureImage, m_textureFormat, 0, width, height,
+                                      [&decoder](uint8_t* pDst, uint32_t, uint32_t rowCount, size_t rowPitch)
+                                      {
+                                          decoder.ReadRows(pDst, rowCount, rowPitch, true);
+                                      });
+    }
+    else
+    {
+        // stb decodes to RGBA, the swizzle to the image's BGRA order writes straight into the staging memory, or into
+        // a scratch level the host copies from
+        std::vector<uint8_t> bgra;
+        auto const uploadRgbaLevel = [&](uint8_t const* pRgba, uint32_t level, uint32_t levelWidth,
+                                         uint32_t levelHeight)
+        {
+            if (hostCopy)
+            {
+                auto const pixelCount = static_cast<size_t>(levelWidth) * levelHeight;
+                bgra.resize(pixelCount * 4);
+                SwizzleRgbaToBgra(pRgba, bgra.data(), pixelCount);
+                CopyToImageOnHost(m_logicalDevice, m_textureImage, hostCopyLayout, level, levelWidth, levelHeight,
+                                  bgra.data());
+                return;
+            }
+
+            m_textureUploader.UploadLevel(m_textureImage, m_textureFormat, level, levelWidth, levelHeight,
+                                          [=](uint8_t* pDst, uint32_t firstRow, uint32_t rowCount, size_t rowPitch)
+                                          {
+                                              SwizzleRgbaToBgra(pRgba + firstRow * rowPitch, pDst,
+                                                                static_cast<size_t>(levelWidth) * rowCount);
+                                          });
+        };
+
+        uploadRgbaLevel(pixels, 0, width, height);
+
+        if (cpuMipmaps)
+        {
+            // Each level is filtered from the one before it, only two levels are held at a time
+            auto const levelLayouts = GetMipChainLayout(width, height, m_textureMipLevels);
+            std::vector<uint8_t> previous;
+            std::vector<uint8_t> current;
+            uint8_t const* pSource = pixels;
 
-    createBuffer(imageSize,
-                 vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                 stagingBuffer,
-                 stagingBufferMemory);
+            for (uint32_t level = 1; level < m_textureMipLevels; level++)
+            {
+                auto const& source = levelLayouts[level - 1];
+                auto const& target = levelLayouts[level];
+
+                current.resize(static_cast<size_t>(target.width) * target.height * 4);
+                DownsampleSrgb(pSource, source.width, source.height, current.data(), MipFilter::eKaiser);
+                uploadRgbaLevel(current.data(), level, target.width, target.height);
+
+                std::swap(previous, current);
+                pSource = previous.data();
+            }
+        }
+    }
+
+    // Host copied CPU mips are already in their final layout, there is nothing left for the GPU to do
+    if (!hostCopy || !cpuMipmaps)
+    {
+        m_textureUploader.RecordCommands([&](vk::CommandBuffer commandBuffer)
+        {
+            if (blitMipmaps)
+            {
+                RecordBlitMipmaps(commandBuffer, m_textureImage, width, height, m_textureMipLevels);
+            }
+            else if (computeMipmaps)
+            {
+                m_computeMipmapGenerator->Record(commandBuffer, m_textureImage, m_textureFormat, width, height,
+                                                 m_textureMipLevels);
+            }
+            else
+            {
+                recordTextureToShaderRead(commandBuffer, m_textureImage, m_textureMipLevels);
+            }
+        });
+    }
+
+    m_textureUploader.Flush();
 
-    auto data = m_logicalDevice.mapMemory(stagingBufferMemory, 0, imageSize, {});
-    memcpy(data, pixels, imageSize);
-    m_logicalDevice.unmapMemory(stagingBufferMemory);
     stbi_image_free(pixels);
 
+    if (m_computeMipmapGenerator)
+    {
+        m_computeMipmapGenerator->ReleaseTransientResources();
+    }
 
-    vk::ImageCreateInfo imageInfo
+    std::cout << std::format("{} {}, mip levels generated by {}\n", TextureFileName,
+                             streamRows ? "decoded row by row into staging"
+                                        : hostCopy ? "decoded whole and copied on the host" : "decoded whole",
+                             blitMipmaps ? "blits" : computeMipmaps ? "compute" : "the CPU");
+}
+
+void BasicTriangleApplication::createSceneTextures()
+{
+    if (!std::filesystem::is_directory(SceneTextureDirectory))
     {
-        {},
-        vk::ImageType::e2D,
-        vk::Format::eB8G8R8A8Srgb,
-        vk::Extent3D
+        return;
+    }
+
+    std::vector<std::string> fileNames;
+    for (auto const& entry : std::filesystem::directory_iterator(SceneTextureDirectory))
+    {
+        if (entry.path().extension() == ".png")
         {
-            static_cast<uint32_t>(texWidth),
-            static_cast<uint32_t>(texHeight),
-            1
-        },
-        1,
-        1,
-        vk::SampleCountFlagBits::e1,
-        vk::ImageTiling::eOptimal,
-        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-        vk::SharingMode::eExclusive
+            fileNames.push_back(entry.path().string());
+        }
+    }
+
+    if (fileNames.empty())
+    {
+        return;
+    }
+
+    std::ranges::sort(fileNames);
+
+    auto const loadStart = std::chrono::steady_clock::now();
+
+    m_texturePacker = TexturePacker(m_logicalDevice, m_physicalDevice.GetPDevice(), m_memoryTracker, m_textureUploader,
+                                    SceneAtlasSize, SceneAtlasMaxEntrySize,
+                                    [this](vk::Format format, vk::ImageUsageFlags usage, vk::ImageLayout layout)
+                                    {
+                                        return canCopyTextureOnHost(format, usage, layout);
+                                    },
+                                    m_pAllocator);
+
+    // Only the headers are read up front, the textures have to be placed before any of them can be uploaded
+    std::vector<std::string> packedFileNames;
+    std::vector<PackedTextureId> packedIds;
+    auto const maxDimension = m_physicalDevice.GetPDevice().getProperties().limits.maxImageDimension2D;
+    for (auto const& fileName : fileNames)
+    {
+        try
+        {
+            PngStreamDecoder const header(fileName, maxDimension);
+            packedIds.push_back(m_texturePacker.Add(header.GetWidth(), header.GetHeight(), vk::Format::eB8G8R8A8Srgb));
+            packedFileNames.push_back(fileName);
+        }
+        catch (std::exception const& e)
+        {
+            std::cout << std::format("Skipping {}: {}\n", fileName, e.what());
+        }
+    }
+
+    if (packedFileNames.empty())
+    {
+        return;
+    }
+
+    m_texturePacker.Build();
+
+    // The main thread records uploads while every other core decodes
+    auto const threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    BatchImageDecoder decoder(packedFileNames, threadCount, SceneTextureBytesInFlight, decodeRgbaWithStb);
+
+    while (auto image = decoder.Next())
+    {
+        if (!image->error.empty())
+        {
+            // The texture keeps its place, it just stays undefined
+            std::cout << std::format("Failed to decode {}: {}\n", image->fileName, image->error);
+            continue;
+        }
+
+        m_texturePacker.Upload(packedIds[image->index], image->pixels.data());
+
+        // The rows are already in the array or in staging, so the decoded bytes go back to the budget before the GPU
+        // work even runs
+        decoder.Release(std::move(*image));
+    }
+
+    m_texturePacker.Finish();
+    m_textureUploader.Flush();
+
+    auto const loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    auto const stats = decoder.GetStats();
+    auto const packerStats = m_texturePacker.GetStats();
+
+    std::cout << std::format("{} scene textures decoded on {} threads and uploaded in {:.1f} ms, {:.1f} MB/s, "
+                             "{:.1f} textures/s, at most {:.1f} MiB decoded at once\n",
+                             stats.imagesDecoded, threadCount, loadMs,
+                             static_cast<double>(stats.bytesDecoded) / (1024.0 * 1024.0) / (loadMs / 1000.0),
+                             static_cast<double>(stats.imagesDecoded) / (loadMs / 1000.0),
+                             static_cast<double>(stats.peakBytesInFlight) / (1024.0 * 1024.0));
+
+    std::cout << std::format("Packed into {} arrays with {} layers, {} textures on {} atlas pages at {:.0f}% "
+                             "occupancy\n",
+                             packerStats.arrayCount, packerStats.arrayLayers, packerStats.atlasTextures,
+                             packerStats.atlasPages, packerStats.atlasOccupancy * 100.0f);
+}
+
+std::vector<uint8_t> BasicTriangleApplication::decodeRgbaWithStb(std::string const& fileName)
+{
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(fileName.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+    if (!pixels)
+    {
+        throw std::runtime_error(std::format("failed to load texture: {}", fileName));
+    }
+
+    std::vector<uint8_t> rgba(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    return rgba;
+}
+
+void BasicTriangleApplication::enableResidencyScene(uint32_t textureCount, vk::DeviceSize budget)
+{
+    m_residencySceneTextureCount = textureCount;
+    m_residencyBudget = budget;
+}
+
+void BasicTriangleApplication::enableBindless()
+{
+    m_bindlessRequested = true;
+}
+
+void BasicTriangleApplication::enableDynamicState()
+{
+    m_dynamicStateRequested = true;
+}
+
+void BasicTriangleApplication::enableShaderObjects()
+{
+    m_shaderObjectsRequested = true;
+}
+
+void BasicTriangleApplication::createResidencyScene()
+{
+    if (m_residencySceneTextureCount == 0)
+    {
+        return;
+    }
+
+    m_textureResidency.emplace(m_logicalDevice, m_memoryTracker, m_textureUploader,
+                               [this](uint32_t width, uint32_t height, uint32_t mipLevels, vk::Format format,
+                                      vk::ImageUsageFlags usage)
+                               {
+                                   return createTexture(width, height, mipLevels, format, vk::ImageTiling::eOptimal,
+                                                        usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+                               },
+                               m_residencyBudget, ResidencyUploadBytesPerFrame, m_pAllocator);
+
+    for (uint32_t i = 0; i < m_residencySceneTextureCount; i++)
+    {
+        // 256, 512 and 1024 texels square in turn
+        auto const size = 256u << (i % 3);
+        m_residentTextureSizes.push_back(size);
+
+        m_textureResidency->AddTexture(size, size, vk::Format::eB8G8R8A8Srgb,
+                                       [i, size](uint32_t mipLevel, uint8_t* pDst, uint32_t firstRow,
+                                                 uint32_t rowCount, size_t rowPitch)
+                                       {
+                                           writeSyntheticTextureRows(i, size, mipLevel, pDst, firstRow, rowCount,
+                                                                     rowPitch);
+                                       });
+    }
+
+    m_textureUploader.Flush();
+
+    auto const stats = m_textureResidency->GetStats();
+    std::cout << std::format("Residency scene: {} textures, mip tails take {:.2f} of {:.2f} MiB budget\n",
+                             stats.textureCount, static_cast<double>(stats.residentBytes) / (1024.0 * 1024.0),
+                             static_cast<double>(stats.budget) / (1024.0 * 1024.0));
+}
+
+vk::ImageView BasicTriangleApplication::updateResidencyScene()
+{
+    auto const frameNumber = static_cast<uint64_t>(m_framesDrawn);
+    // Every frame slot's fence has been waited on at least once in the last m_maxFramesInFlight frames
+    auto const completedFrameCount = frameNumber + 1 > m_maxFramesInFlight ? frameNumber + 1 - m_maxFramesInFlight : 0;
+
+    // Driven by the frame count rather than the clock so runs on slow software renderers see the same scene
+    auto const time = static_cast<float>(frameNumber) / 60.0f;
+    auto const gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(m_residencySceneTextureCount))));
+    auto const gridCenter = static_cast<float>(gridSize) / 2.0f;
+
+    glm::vec2 const camera{
+        gridCenter + gridCenter * 0.8f * std::cos(time * 0.3f),
+        gridCenter + gridCenter * 0.8f * std::sin(time * 0.2f)
     };
+    auto const cameraHeight = 2.5f + 2.0f * std::sin(time * 0.5f);
+    auto const visibleRadius = cameraHeight * 1.5f;
+    auto const focalPixels = static_cast<float>(m_swapChainExtent.height) / (2.0f * std::tan(ResidencyCameraFov / 2.0f));
+
+    // Screen-space usage: a tile's projected size picks the mip level that would be sampled for it
+    for (uint32_t i = 0; i < m_residencySceneTextureCount; i++)
+    {
+        glm::vec2 const tileCenter{ static_cast<float>(i % gridSize) + 0.5f, static_cast<float>(i / gridSize) + 0.5f };
+        auto const offset = tileCenter - camera;
+        auto const planarDistanceSquared = glm::dot(offset, offset);
 
-    std::tie(m_textureImage, m_textureImageMemory) = createTexture(texWidth, 
-                                                         texHeight, 
-                                                         vk::Format::eB8G8R8A8Srgb, 
-                                                         vk::ImageTiling::eOptimal, 
-                                                         vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, 
-                                                         vk::MemoryPropertyFlagBits::eDeviceLocal);
+        if (planarDistanceSquared > visibleRadius * visibleRadius)
+        {
+            continue;
+        }
+
+        auto const projectedPixels = focalPixels / std::sqrt(planarDistanceSquared + cameraHeight * cameraHeight);
+        auto const texelsPerPixel = static_cast<float>(m_residentTextureSizes[i]) / projectedPixels;
+        m_textureResidency->RequestLevel(i, static_cast<uint32_t>(std::max(std::log2(texelsPerPixel), 0.0f)));
+    }
+
+    m_textureResidency->Update(frameNumber, completedFrameCount);
+
+    // The displayed quad shows the tile under the camera
+    auto const focusTexture = std::min(static_cast<uint32_t>(camera.y) * gridSize + static_cast<uint32_t>(camera.x),
+                                       m_residencySceneTextureCount - 1);
+
+    return m_textureResidency->GetView(focusTexture);
+}
+
+void BasicTriangleApplication::logResidencyStats() const
+{
+    constexpr double MiB = 1024.0 * 1024.0;
+    auto const stats = m_textureResidency->GetStats();
+
+    std::cout << std::format("Residency: {:.2f}/{:.2f} MiB resident, {:.2f} MiB retired, {}/{} requested textures "
+                             "at their level, {} levels loaded, {} evicted, {} view swaps, {:.2f} MiB uploaded, "
+                             "{:.1f} ms waiting for staging\n",
+                             static_cast<double>(stats.residentBytes) / MiB, static_cast<double>(stats.budget) / MiB,
+                             static_cast<double>(stats.retiredBytes) / MiB, stats.texturesSatisfied,
+                             stats.texturesRequested, stats.levelsLoaded, stats.levelsEvicted, stats.viewSwaps,
+                             static_cast<double>(stats.bytesUploaded) / MiB, m_textureUploader.GetStats().stallMs);
+}
+
+void BasicTriangleApplication::createTextureImageView()
+{
+    // The image may carry storage usage for the compute mip path, which sRGB views can't support
+    m_textureImageView = m_imageViewCache.Acquire({
+        m_textureImage,
+        vk::ImageViewType::e2D,
+        m_textureFormat,
+        vk::ComponentMapping(),
+        vk::ImageSubresourceRange(
+            vk::ImageAspectFlagBits::eColor,
+            0,
+            m_textureMipLevels,
+            0,
+            1
+        ),
+        vk::ImageUsageFlagBits::eSampled
+    });
+}
+
+void BasicTriangleApplication::createTextureSampler()
+{
+    m_textureSampler = m_samplerCache.Acquire(getTextureSamplerInfo());
+}
+
+vk::SamplerCreateInfo BasicTriangleApplication::getTextureSamplerInfo() const
+{
+    auto const& limits = m_physicalDevice.GetPDevice().getProperties().limits;
+
+    // Views bound the mip levels, so textures with different chain lengths all share this sampler
+    return vk::SamplerCreateInfo{
+        {},
+        vk::Filter::eLinear,
+        vk::Filter::eLinear,
+        vk::SamplerMipmapMode::eLinear,
+        vk::SamplerAddressMode::eRepeat,
+        vk::SamplerAddressMode::eRepeat,
+        vk::SamplerAddressMode::eRepeat,
+        0.0f,
+        m_samplerAnisotropy,
+        m_samplerAnisotropy ? limits.maxSamplerAnisotropy : 1.0f,
+        false,
+        vk::CompareOp::eAlways,
+        0.0f,
+        VK_LOD_CLAMP_NONE,
+        vk::BorderColor::eIntOpaqueBlack,
+        false
+    };
 }
 
 void BasicTriangleApplication::createVertexBuffer()
 {
     vk::DeviceSize bufferSize = sizeof(m_vertices[0]) * m_vertices.size();
-    auto stagingBufferUsage = vk::BufferUsageFlagBits::eTransferSrc;
-    auto stagingMemoryUsage = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
 
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingBufferMemory;
+    createDeviceLocalBuffer(m_vertices.data(), bufferSize, vk::BufferUsageFlagBits::eVertexBuffer, m_vertexBuffer,
+                            m_vertexBufferMemory, MemoryUsage::eVertex, "Vertex buffer");
+}
+
+void BasicTriangleApplication::createIndexBuffer()
+{
+    vk::DeviceSize bufferSize = sizeof(m_indices[0]) * m_indices.size();
+
+    createDeviceLocalBuffer(m_indices.data(), bufferSize, vk::BufferUsageFlagBits::eIndexBuffer, m_indexBuffer,
+                            m_indexBufferMemory, MemoryUsage::eIndex, "Index buffer");
+}
+
+void BasicTriangleApplication::createPackedQuads()
+{
+    auto const textureCount = m_texturePacker.GetStats().textureCount;
+    if (textureCount == 0)
+    {
+        return;
+    }
+
+    if (!m_bindless && !m_sampledImageArrayDynamicIndexing)
+    {
+        std::cout << "Packed textures aren't drawn, the device can't index sampler arrays dynamically\n";
+        return;
+    }
+
+    // Sorted by array so each array's quads are one contiguous index range
+    std::vector<PackedTextureId> ids(textureCount);
+    std::iota(ids.begin(), ids.end(), PackedTextureId{ 0 });
+    std::ranges::stable_sort(ids, {}, [this](PackedTextureId id) { return m_texturePacker.Get(id).arrayIndex; });
+
+    // Bindless quads look up their array's table slot by quad index, so a single draw covers every array
+    std::vector<BindlessIndex> arraySlots;
+    std::vector<BindlessIndex> quadTextures;
+    if (m_bindless)
+    {
+        for (auto const& array : m_texturePacker.GetArrays())
+        {
+            arraySlots.push_back(m_bindlessTable.AddTexture(array.view, m_textureSampler));
+        }
+    }
+
+    std::vector<PackedVertex> vertices;
+    std::vector<uint32_t> indices;
+
+    for (uint32_t i = 0; i < textureCount; i++)
+    {
+        auto const& packed = m_texturePacker.Get(ids[i]);
+        if (!m_bindless && packed.arrayIndex >= MaxPackedTextureArrays)
+        {
+            std::cout << std::format("Only the first {} packed texture arrays are drawn\n", MaxPackedTextureArrays);
+            break;
+        }
+
+        // Laid out in the order the files were added, below the main quad
+        auto const column = ids[i] % PackedQuadColumns;
+        auto const row = ids[i] / PackedQuadColumns;
+        auto const x0 = (static_cast<float>(column) - PackedQuadColumns / 2.0f) * PackedQuadSize * 1.1f;
+        auto const y0 = 0.6f + static_cast<float>(row) * PackedQuadSize * 1.1f;
+        auto const x1 = x0 + PackedQuadSize;
+        auto const y1 = y0 + PackedQuadSize;
+        auto const& uv = packed.uvRect;
+
+        // Same orientation as the main quad
+        auto const firstVertex = static_cast<uint32_t>(vertices.size());
+        vertices.push_back({ { x0, y0 }, { uv.u1, uv.v0 }, packed.layer });
+        vertices.push_back({ { x1, y0 }, { uv.u0, uv.v0 }, packed.layer });
+        vertices.push_back({ { x1, y1 }, { uv.u0, uv.v1 }, packed.layer });
+        vertices.push_back({ { x0, y1 }, { uv.u1, uv.v1 }, packed.layer });
+
+        if (m_bindless)
+        {
+            quadTextures.push_back(arraySlots[packed.arrayIndex]);
+        }
 
-    createBuffer(bufferSize, stagingBufferUsage, stagingMemoryUsage, stagingBuffer, stagingBufferMemory);
+        if (m_packedDraws.empty() || m_packedDraws.back().arrayIndex != packed.arrayIndex)
+        {
+            m_packedDraws.push_back({ packed.arrayIndex, static_cast<uint32_t>(indices.size()), 0 });
+        }
 
-    { // Scoping raw pointer
-        auto data = m_logicalDevice.mapMemory(stagingBufferMemory, 0, bufferSize);
-        memcpy(data, m_vertices.data(), bufferSize);
-        m_logicalDevice.unmapMemory(stagingBufferMemory);
+        for (auto const index : m_indices)
+        {
+            indices.push_back(firstVertex + index);
+        }
+        m_packedDraws.back().indexCount += static_cast<uint32_t>(m_indices.size());
     }
 
-    auto vertexBufferUsage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer;
-    auto vertexMemoryUsage = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    createDeviceLocalBuffer(vertices.data(), sizeof(vertices[0]) * vertices.size(),
+                            vk::BufferUsageFlagBits::eVertexBuffer, m_packedVertexBuffer, m_packedVertexBufferMemory,
+                            MemoryUsage::eVertex, "Packed quad vertex buffer");
+    createDeviceLocalBuffer(indices.data(), sizeof(indices[0]) * indices.size(), vk::BufferUsageFlagBits::eIndexBuffer,
+                            m_packedIndexBuffer, m_packedIndexBufferMemory, MemoryUsage::eIndex,
+                            "Packed quad index buffer");
 
-    createBuffer(bufferSize, vertexBufferUsage, vertexMemoryUsage, m_vertexBuffer, m_vertexBufferMemory);
-
-    copyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
+    if (m_bindless)
+    {
+        createDeviceLocalBuffer(quadTextures.data(), sizeof(quadTextures[0]) * quadTextures.size(),
+                                vk::BufferUsageFlagBits::eStorageBuffer, m_packedQuadTextureBuffer,
+                                m_packedQuadTextureBufferMemory, MemoryUsage::eOther, "Packed quad texture buffer");
+        m_packedQuadTexturesIndex = m_bindlessTable.AddStorageBuffer(m_packedQuadTextureBuffer);
+
+        auto const stats = m_bindlessTable.GetStats();
+        std::cout << std::format("Bindless table holds {} of {} textures and {} of {} storage buffers\n",
+                                 stats.textureCount, stats.textureCapacity, stats.storageBufferCount,
+                                 stats.storageBufferCapacity);
+    }
 
-    m_logicalDevice.destroyBuffer(stagingBuffer);
-    m_logicalDevice.freeMemory(stagingBufferMemory);
+    std::cout << std::format("{} scene texture quads drawn with {} draws and no descriptor set changes\n",
+                             vertices.size() / 4, m_bindless ? 1 : m_packedDraws.size());
 }
 
-void BasicTriangleApplication::createIndexBuffer()
+void BasicTriangleApplication::createDeviceLocalBuffer(
+    void const* pData,
+    vk::DeviceSize size,
+    vk::BufferUsageFlags usage,
+    vk::Buffer& buffer,
+    vk::DeviceMemory& bufferMemory,
+    MemoryUsage memoryUsage,
+    std::string_view name
+)
 {
-    vk::DeviceSize bufferSize = sizeof(m_indices[0]) * m_indices.size();
+    auto const preferredProperties = m_directDeviceWrites
+                                         ? DirectWriteMemoryProperties
+                                         : vk::MemoryPropertyFlags(vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    // Transfer dst is kept so the buffer can still be staged if this buffer can't use the host visible type
+    auto const memoryProperties = createBuffer(size, usage | vk::BufferUsageFlagBits::eTransferDst, preferredProperties,
+                                               buffer, bufferMemory, memoryUsage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    if (memoryProperties & vk::MemoryPropertyFlagBits::eHostVisible)
+    {
+        { // Scoping raw pointer
+            auto data = m_logicalDevice.mapMemory(bufferMemory, 0, size);
+            memcpy(data, pData, size);
+            m_logicalDevice.unmapMemory(bufferMemory);
+        }
+
+        m_stagingBytesSaved += size;
+        std::cout << std::format("{}: {} bytes written directly to device local memory ({} staging bytes saved so far)\n",
+                                 name, size, m_stagingBytesSaved);
+        return;
+    }
+
     auto stagingBufferUsage = vk::BufferUsageFlagBits::eTransferSrc;
     auto stagingMemoryUsage = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
 
     vk::Buffer stagingBuffer;
     vk::DeviceMemory stagingBufferMemory;
 
-    createBuffer(bufferSize, stagingBufferUsage, stagingMemoryUsage, stagingBuffer, stagingBufferMemory);
+    createBuffer(size, stagingBufferUsage, stagingMemoryUsage, stagingBuffer, stagingBufferMemory, MemoryUsage::eStaging);
 
     { // Scoping raw pointer
-        auto data = m_logicalDevice.mapMemory(stagingBufferMemory, 0, bufferSize);
-        memcpy(data, m_indices.data(), bufferSize);
+        auto data = m_logicalDevice.mapMemory(stagingBufferMemory, 0, size);
+        memcpy(data, pData, size);
         m_logicalDevice.unmapMemory(stagingBufferMemory);
     }
 
-    auto indexBufferUsage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer;
-    auto indexMemoryUsage = vk::MemoryPropertyFlagBits::eDeviceLocal;
-
-    createBuffer(bufferSize, indexBufferUsage, indexMemoryUsage, m_indexBuffer, m_indexBufferMemory);
+    copyBuffer(stagingBuffer, buffer, size);
 
-    copyBuffer(stagingBuffer, m_indexBuffer, bufferSize);
+    m_logicalDevice.destroyBuffer(stagingBuffer, m_pAllocator);
+    m_memoryTracker.Free(stagingBufferMemory);
 
-    m_logicalDevice.destroyBuffer(stagingBuffer);
-    m_logicalDevice.freeMemory(stagingBufferMemory);
+    std::cout << std::format("{}: {} bytes uploaded through a staging buffer\n", name, size);
 }
 
-void BasicTriangleApplication::createUniformBuffers()
+void BasicTriangleApplication::createUniformBuffer(size_t frame)
 {
     vk::DeviceSize bufferSize = sizeof(UniformBufferObject);
 
-    m_uniformBuffers.resize(m_maxFramesInFlight);
-    m_uniformBuffersMemory.resize(m_maxFramesInFlight);
-    m_uniformBuffersMapped.resize(m_maxFramesInFlight);
+    auto const cachedProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached;
+
+    // Uniforms are read by the GPU every frame, so keep them device local whenever the CPU can write there directly.
+    // Otherwise prefer host cached memory, which is often non-coherent and needs explicit flushes.
+    auto const memoryProperties = createBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer,
+                                               m_directDeviceWrites ? DirectWriteMemoryProperties : cachedProperties,
+                                               m_uniformBuffers[frame],
+                                               m_uniformBuffersMemory[frame],
+                                               MemoryUsage::eUniform,
+                                               vk::MemoryPropertyFlagBits::eHostVisible);
+
+    m_uniformBuffersMapped[frame] = m_logicalDevice.mapMemory(m_uniformBuffersMemory[frame], 0, vk::WholeSize);
+
+    m_uniformWriters[frame] = MappedMemoryWriter(
+        m_logicalDevice,
+        m_uniformBuffersMemory[frame],
+        m_uniformBuffersMapped[frame],
+        bufferSize,
+        m_logicalDevice.getBufferMemoryRequirements(m_uniformBuffers[frame]).size,
+        m_physicalDevice.GetPDevice().getProperties().limits.nonCoherentAtomSize,
+        static_cast<bool>(memoryProperties & vk::MemoryPropertyFlagBits::eHostCoherent)
+    );
+}
 
-    for (size_t i = 0; i < m_maxFramesInFlight; i++)
+void BasicTriangleApplication::createDescriptorAllocators()
+{
+    for (auto& allocator : m_frameDescriptorAllocators)
     {
-        createBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer,
-                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                     m_uniformBuffers[i],
-                     m_uniformBuffersMemory[i]);
-
-        m_uniformBuffersMapped[i] = m_logicalDevice.mapMemory(m_uniformBuffersMemory[i], 0, bufferSize);
+        allocator = DescriptorAllocator(m_logicalDevice, getFrameDescriptorRatios(), FrameDescriptorSetsPerPool,
+                                        MaxDescriptorSetsPerPool, m_pAllocator);
     }
 }
 
-void BasicTriangleApplication::createDescriptorPool()
+void BasicTriangleApplication::createDescriptorSet(size_t frame, vk::ImageView textureView)
 {
-    std::vector poolSizes = {
-        vk::DescriptorPoolSize
-        {
-            vk::DescriptorType::eUniformBuffer,
-            static_cast<uint32_t>(m_maxFramesInFlight)
-        }
+    m_descriptorSets[frame] = m_frameDescriptorAllocators[frame].Allocate(m_descriptorSetLayout);
+
+    writeDescriptorSet(m_descriptorSets[frame], frame, textureView, true);
+}
+
+void BasicTriangleApplication::createDescriptorUpdateTemplate()
+{
+    std::vector entries = {
+        MakeDescriptorTemplateEntry(0, vk::DescriptorType::eUniformBuffer, offsetof(FrameDescriptors, uniformBuffer)),
+        MakeDescriptorTemplateEntry(1, vk::DescriptorType::eCombinedImageSampler, offsetof(FrameDescriptors, texture))
     };
 
-    vk::DescriptorPoolCreateInfo poolInfo
+    if (bindsPackedArrays())
     {
-        {},
-        static_cast<uint32_t>(m_maxFramesInFlight),
-        poolSizes
-    };
+        entries.push_back(MakeDescriptorTemplateEntry(2, vk::DescriptorType::eCombinedImageSampler,
+                                                      offsetof(FrameDescriptors, packedArrays),
+                                                      MaxPackedTextureArrays));
+    }
 
-    m_descriptorPool = m_logicalDevice.createDescriptorPool(poolInfo);
+    m_frameDescriptorTemplate = CreateDescriptorUpdateTemplate(m_logicalDevice, m_descriptorSetLayout, entries,
+                                                               m_pAllocator);
 }
 
-void BasicTriangleApplication::createDescriptorSets()
+bool BasicTriangleApplication::bindsPackedArrays() const
 {
-    std::vector descriptorSetLayouts(m_maxFramesInFlight, m_descriptorSetLayout);
-    vk::DescriptorSetAllocateInfo allocInfo
-    {
-        m_descriptorPool,
-        descriptorSetLayouts
+    return !m_bindless && !m_texturePacker.GetArrays().empty();
+}
+
+void BasicTriangleApplication::writeDescriptorSet(vk::DescriptorSet set, size_t frame, vk::ImageView textureView,
+                                                  bool useTemplate) const
+{
+    FrameDescriptors descriptors{
+        { m_uniformBuffers[frame], 0, sizeof(UniformBufferObject) },
+        { m_textureSampler, textureView, vk::ImageLayout::eShaderReadOnlyOptimal }
     };
 
-    m_descriptorSets = m_logicalDevice.allocateDescriptorSets(allocInfo);
+    // Slots past the last array repeat the first, the packed pipeline reaches every slot through a dynamic index
+    auto const& packedArrays = m_texturePacker.GetArrays();
+    if (bindsPackedArrays())
+    {
+        for (uint32_t i = 0; i < MaxPackedTextureArrays; i++)
+        {
+            descriptors.packedArrays[i] = {
+                m_textureSampler,
+                packedArrays[i < packedArrays.size() ? i : 0].view,
+                vk::ImageLayout::eShaderReadOnlyOptimal
+            };
+        }
+    }
 
-    for (size_t i = 0; i < m_maxFramesInFlight; i++)
+    if (useTemplate)
     {
-        std::vector bufferInfos = {
-            vk::DescriptorBufferInfo
-            {
-                m_uniformBuffers[i],
-                0,
-                sizeof(UniformBufferObject)
-            }
-        };
+        m_logicalDevice.updateDescriptorSetWithTemplate(set, m_frameDescriptorTemplate, &descriptors);
+        return;
+    }
 
-        std::vector descriptorWrites = {
-            vk::WriteDescriptorSet
-            {
-                m_descriptorSets[i],
-                0,
-                0,
-                vk::DescriptorType::eUniformBuffer,
-                {},
-                bufferInfos
-            }
-        };
+    std::vector descriptorWrites = {
+        vk::WriteDescriptorSet
+        {
+            set,
+            0,
+            0,
+            vk::DescriptorType::eUniformBuffer,
+            {},
+            descriptors.uniformBuffer
+        },
+        vk::WriteDescriptorSet
+        {
+            set,
+            1,
+            0,
+            vk::DescriptorType::eCombinedImageSampler,
+            descriptors.texture
+        }
+    };
 
-        m_logicalDevice.updateDescriptorSets(descriptorWrites, {});
+    if (bindsPackedArrays())
+    {
+        descriptorWrites.push_back(vk::WriteDescriptorSet{
+            set,
+            2,
+            0,
+            vk::DescriptorType::eCombinedImageSampler,
+            descriptors.packedArrays
+        });
     }
+
+    m_logicalDevice.updateDescriptorSets(descriptorWrites, {});
 }
 
-void BasicTriangleApplication::createBuffer(
+vk::MemoryPropertyFlags BasicTriangleApplication::createBuffer(
     vk::DeviceSize size,
     vk::BufferUsageFlags usage,
     vk::MemoryPropertyFlags properties,
     vk::Buffer& buffer,
-    vk::DeviceMemory& bufferMemory
-) const
+    vk::DeviceMemory& bufferMemory,
+    MemoryUsage memoryUsage,
+    std::optional<vk::MemoryPropertyFlags> fallbackProperties /*= std::nullopt*/
+)
 {
     vk::BufferCreateInfo bufferInfo{
         {},
@@ -804,33 +2418,48 @@ void BasicTriangleApplication::createBuffer(
         vk::SharingMode::eExclusive
     };
 
-    buffer = m_logicalDevice.createBuffer(bufferInfo);
+    buffer = m_logicalDevice.createBuffer(bufferInfo, m_pAllocator);
 
     auto memoryRequirements = m_logicalDevice.getBufferMemoryRequirements(buffer);
 
+    auto memoryTypeIndex = tryFindMemoryType(memoryRequirements.memoryTypeBits, properties, memoryRequirements.size);
+    if (!memoryTypeIndex && fallbackProperties)
+    {
+        memoryTypeIndex = tryFindMemoryType(memoryRequirements.memoryTypeBits, *fallbackProperties,
+                                            memoryRequirements.size);
+    }
+
+    if (!memoryTypeIndex)
+    {
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
     vk::MemoryAllocateInfo allocInfo{
         memoryRequirements.size,
-        findMemoryType(memoryRequirements.memoryTypeBits, properties)
+        *memoryTypeIndex
     };
 
-    bufferMemory = m_logicalDevice.allocateMemory(allocInfo);
+    bufferMemory = m_memoryTracker.Allocate(allocInfo, memoryUsage);
 
     m_logicalDevice.bindBufferMemory(buffer, bufferMemory, 0);
+
+    return m_memoryTracker.GetMemoryProperties().memoryTypes[*memoryTypeIndex].propertyFlags;
 }
 
 std::pair<vk::Image, vk::DeviceMemory> BasicTriangleApplication::createTexture(
     uint32_t width,
     uint32_t height,
+    uint32_t mipLevels,
     vk::Format format,
-
     vk::ImageTiling tiling,
     vk::ImageUsageFlags usage,
-    vk::MemoryPropertyFlags properties
+    vk::MemoryPropertyFlags properties,
+    vk::ImageCreateFlags flags /*= {}*/
 )
 {
     vk::ImageCreateInfo imageInfo
     {
-        {},
+        flags,
         vk::ImageType::e2D,
         format,
         vk::Extent3D
@@ -839,7 +2468,7 @@ std::pair<vk::Image, vk::DeviceMemory> BasicTriangleApplication::createTexture(
             height,
             1
         },
-        1,
+        mipLevels,
         1,
         vk::SampleCountFlagBits::e1,
         tiling,
@@ -847,22 +2476,24 @@ std::pair<vk::Image, vk::DeviceMemory> BasicTriangleApplication::createTexture(
         vk::SharingMode::eExclusive
     };
 
-    auto textureImage = m_logicalDevice.createImage(imageInfo);
+    auto textureImage = m_logicalDevice.createImage(imageInfo, m_pAllocator);
 
     auto memoryRequirements = m_logicalDevice.getImageMemoryRequirements(textureImage);
 
     vk::MemoryAllocateInfo allocInfo
     {
         memoryRequirements.size,
-        findMemoryType(memoryRequirements.memoryTypeBits, properties)
+        findMemoryType(memoryRequirements.memoryTypeBits, properties, memoryRequirements.size)
     };
 
-    auto textureImageMemory = m_logicalDevice.allocateMemory(allocInfo);
+    auto textureImageMemory = m_memoryTracker.Allocate(allocInfo, MemoryUsage::eTexture);
+
+    m_logicalDevice.bindImageMemory(textureImage, textureImageMemory, 0);
 
     return std::make_pair(textureImage, textureImageMemory);
 }
 
-void BasicTriangleApplication::copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size) const
+vk::CommandBuffer BasicTriangleApplication::beginSingleTimeCommands() const
 {
     vk::CommandBufferAllocateInfo allocInfo{
         m_commandPool,
@@ -870,95 +2501,134 @@ void BasicTriangleApplication::copyBuffer(vk::Buffer src, vk::Buffer dst, vk::De
         1
     };
 
-    auto copyBuffers = m_logicalDevice.allocateCommandBuffers(allocInfo);
-
-    auto& copyBuffer = copyBuffers.front();
+    auto const commandBuffer = m_logicalDevice.allocateCommandBuffers(allocInfo).front();
 
     vk::CommandBufferBeginInfo beginInfo{
         vk::CommandBufferUsageFlagBits::eOneTimeSubmit
     };
 
-    copyBuffer.begin(beginInfo);
-
-    std::vector copyRegions{
-        vk::BufferCopy { 0, 0, size }
-    };
+    commandBuffer.begin(beginInfo);
 
-    copyBuffer.copyBuffer(src, dst, copyRegions);
+    return commandBuffer;
+}
 
-    copyBuffer.end();
+void BasicTriangleApplication::endSingleTimeCommands(vk::CommandBuffer commandBuffer) const
+{
+    commandBuffer.end();
 
     vk::SubmitInfo submitInfo{
         {},
         {},
-        copyBuffers
+        commandBuffer
     };
 
     m_gfxQueue.submit(submitInfo);
     m_gfxQueue.waitIdle();
 
-    m_logicalDevice.freeCommandBuffers(m_commandPool, copyBuffers);
+    m_logicalDevice.freeCommandBuffers(m_commandPool, commandBuffer);
 }
 
-uint32_t BasicTriangleApplication::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const
+void BasicTriangleApplication::copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size) const
 {
-    auto memoryProperties = m_physicalDevice.GetPDevice().getMemoryProperties();
+    auto const commandBuffer = beginSingleTimeCommands();
 
-    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    std::vector copyRegions{
+        vk::BufferCopy { 0, 0, size }
+    };
+
+    commandBuffer.copyBuffer(src, dst, copyRegions);
+
+    endSingleTimeCommands(commandBuffer);
+}
+
+uint32_t BasicTriangleApplication::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties,
+                                                  vk::DeviceSize size) const
+{
+    if (auto const memoryTypeIndex = tryFindMemoryType(typeFilter, properties, size))
     {
-        if (typeFilter & 1 << i && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
-        }
+        return *memoryTypeIndex;
     }
 
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-void BasicTriangleApplication::createCommandBuffer()
+std::optional<uint32_t> BasicTriangleApplication::tryFindMemoryType(uint32_t typeFilter,
+                                                                    vk::MemoryPropertyFlags properties,
+                                                                    vk::DeviceSize size) const
+{
+    return m_memoryTracker.FindMemoryType(typeFilter, properties, size);
+}
+
+void BasicTriangleApplication::createCommandBuffer(size_t frame)
 {
     vk::CommandBufferAllocateInfo bufferAllocInfo{
         m_commandPool,
         vk::CommandBufferLevel::ePrimary,
-        static_cast<uint32_t>(m_maxFramesInFlight)
+        1
     };
 
-    m_commandBuffer = m_logicalDevice.allocateCommandBuffers(bufferAllocInfo);
+    m_commandBuffer[frame] = m_logicalDevice.allocateCommandBuffers(bufferAllocInfo).front();
 }
 
 void BasicTriangleApplication::createSyncObjects()
 {
-    for (size_t i = 0; i <= m_maxFramesInFlight; i++)
+    // Sync objects are created for every possible frame up front. They are cheap, and a retired frame's
+    // render finished semaphore may still be pending on the present queue, so it can't be destroyed early.
+    for (size_t i = 0; i < m_maxFramesInFlight; i++)
     {
-        m_imageAvailable.push_back(m_logicalDevice.createSemaphore({}));
-        m_renderFinished.push_back(m_logicalDevice.createSemaphore({}));
-        m_inFlight.push_back(m_logicalDevice.createFence({ vk::FenceCreateFlagBits::eSignaled }));
+        m_imageAvailable.push_back(m_logicalDevice.createSemaphore({}, m_pAllocator));
+        m_renderFinished.push_back(m_logicalDevice.createSemaphore({}, m_pAllocator));
+        m_inFlight.push_back(m_logicalDevice.createFence({ vk::FenceCreateFlagBits::eSignaled }, m_pAllocator));
     }
 }
 
-void BasicTriangleApplication::recordCommandBuffer(vk::CommandBuffer buffer, uint32_t imageIndex /*TODO: Potential refactor */)
+void BasicTriangleApplication::createFrameResources(size_t frame)
 {
-    vk::CommandBufferBeginInfo beginInfo{};
+    createCommandBuffer(frame);
+    createUniformBuffer(frame);
+}
 
-    buffer.begin(beginInfo);
+void BasicTriangleApplication::destroyFrameResources(size_t frame)
+{
+    m_frameDescriptorAllocators[frame].Reset();
+    m_descriptorSets[frame] = nullptr;
 
-    std::vector clearColors = {
-        vk::ClearValue {
-            std::array {0.0f,0.0f,0.0f,1.0f}
-        }
-    };
+    m_logicalDevice.destroyBuffer(m_uniformBuffers[frame], m_pAllocator);
+    m_uniformBuffers[frame] = nullptr;
+    m_uniformBuffersMapped[frame] = nullptr;
+    m_uniformWriters[frame] = {};
+    m_memoryTracker.Free(m_uniformBuffersMemory[frame]);
+    m_uniformBuffersMemory[frame] = nullptr;
 
-    vk::RenderPassBeginInfo renderPassInfo{
-        m_renderPass,
-        m_swapChainFrameBuffers[imageIndex],
-        vk::Rect2D {{0,0}, m_swapChainExtent},
-        clearColors
-    };
+    m_logicalDevice.freeCommandBuffers(m_commandPool, m_commandBuffer[frame]);
+    m_commandBuffer[frame] = nullptr;
+
+    m_frameInputTimes[frame].reset();
+}
+
+void BasicTriangleApplication::setFramesInFlight(size_t framesInFlight)
+{
+    framesInFlight = std::clamp<size_t>(framesInFlight, 1, m_maxFramesInFlight);
+
+    // New frames have nothing in flight yet, so their resources can be created while the others are still executing
+    for (size_t frame = m_framesInFlight; frame < framesInFlight; frame++)
+    {
+        createFrameResources(frame);
+    }
 
-    buffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+    // Retired frames only need their own last submission to finish, there's no need to drain the whole device
+    for (size_t frame = framesInFlight; frame < m_framesInFlight; frame++)
+    {
+        std::ignore = m_logicalDevice.waitForFences(m_inFlight[frame], vk::True, UINT64_MAX);
+        destroyFrameResources(frame);
+    }
 
-    buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipeline);
+    m_framesInFlight = framesInFlight;
+    m_currentFrame %= m_framesInFlight;
+}
 
+void BasicTriangleApplication::setViewportAndScissor(vk::CommandBuffer buffer) const
+{
     std::vector viewports = {
         vk::Viewport {
             0.0f,
@@ -980,6 +2650,110 @@ void BasicTriangleApplication::recordCommandBuffer(vk::CommandBuffer buffer, uin
     };
 
     buffer.setScissor(0, scissors);
+}
+
+void BasicTriangleApplication::beginSwapChainRendering(vk::CommandBuffer buffer, uint32_t imageIndex,
+                                                       bool dynamicRendering) const
+{
+    vk::ClearValue const clearColor{ std::array{ 0.0f, 0.0f, 0.0f, 1.0f } };
+    vk::Rect2D const renderArea{ { 0, 0 }, m_swapChainExtent };
+
+    if (!dynamicRendering)
+    {
+        vk::RenderPassBeginInfo const renderPassInfo{
+            m_renderPass,
+            m_swapChainFrameBuffers[imageIndex],
+            renderArea,
+            clearColor
+        };
+
+        buffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+        return;
+    }
+
+    // What the render pass's initial layout and external dependency do, the acquire semaphore is waited for at color
+    // attachment output
+    vk::ImageMemoryBarrier const toAttachment{
+        {},
+        vk::AccessFlagBits::eColorAttachmentWrite,
+        vk::ImageLayout::eUndefined,
+        vk::ImageLayout::eColorAttachmentOptimal,
+        vk::QueueFamilyIgnored,
+        vk::QueueFamilyIgnored,
+        m_swapChainImages[imageIndex],
+        { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 }
+    };
+    buffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                           vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, {}, {}, toAttachment);
+
+    vk::RenderingAttachmentInfo const colorAttachment{
+        m_swapChainImageViews[imageIndex],
+        vk::ImageLayout::eColorAttachmentOptimal,
+        vk::ResolveModeFlagBits::eNone,
+        {},
+        vk::ImageLayout::eUndefined,
+        vk::AttachmentLoadOp::eClear,
+        vk::AttachmentStoreOp::eStore,
+        clearColor
+    };
+    vk::RenderingInfo const renderingInfo{
+        {},
+        renderArea,
+        1,
+        0,
+        colorAttachment
+    };
+
+    buffer.beginRenderingKHR(renderingInfo);
+}
+
+void BasicTriangleApplication::endSwapChainRendering(vk::CommandBuffer buffer, uint32_t imageIndex,
+                                                     bool dynamicRendering) const
+{
+    if (!dynamicRendering)
+    {
+        buffer.endRenderPass();
+        return;
+    }
+
+    buffer.endRenderingKHR();
+
+    // Presenting waits on the render finished semaphore, the barrier only has to change the layout
+    vk::ImageMemoryBarrier const toPresent{
+        vk::AccessFlagBits::eColorAttachmentWrite,
+        {},
+        vk::ImageLayout::eColorAttachmentOptimal,
+        vk::ImageLayout::ePresentSrcKHR,
+        vk::QueueFamilyIgnored,
+        vk::QueueFamilyIgnored,
+        m_swapChainImages[imageIndex],
+        { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 }
+    };
+    buffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                           vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, toPresent);
+}
+
+void BasicTriangleApplication::recordCommandBuffer(vk::CommandBuffer buffer, uint32_t imageIndex /*TODO: Potential refactor */)
+{
+    vk::CommandBufferBeginInfo beginInfo{};
+
+    buffer.begin(beginInfo);
+
+    beginSwapChainRendering(buffer, imageIndex, m_shaderObjects);
+
+    if (m_shaderObjects)
+    {
+        m_shaderObjectRenderer.Begin(buffer, m_swapChainExtent);
+        m_shaderObjectRenderer.Apply(m_mainPipelineDesc);
+    }
+    else
+    {
+        buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelineCache->Get(m_pipeline));
+        m_stateRecorder.Begin(buffer);
+        m_stateRecorder.Apply(m_mainPipelineDesc);
+
+        setViewportAndScissor(buffer);
+    }
 
     std::vector vBuffers = { m_vertexBuffer };
     std::vector<vk::DeviceSize> vOffsets = { 0 };
@@ -989,29 +2763,145 @@ void BasicTriangleApplication::recordCommandBuffer(vk::CommandBuffer buffer, uin
     buffer.bindIndexBuffer(m_indexBuffer, 0, vk::IndexType::eUint16);
 
     std::vector currentDescriptorSets = { m_descriptorSets[m_currentFrame] };
+    if (m_bindless)
+    {
+        currentDescriptorSets.push_back(m_bindlessTable.GetSet());
+    }
 
     buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pipelineLayout, 0, currentDescriptorSets, {});
 
     buffer.drawIndexed(static_cast<uint32_t>(m_indices.size()), 1, 0, 0, 0);
 
-    buffer.endRenderPass();
+    // Every scene texture is drawn with the descriptor set bound above, only the array index changes between draws
+    if (m_shaderObjects && !m_packedDraws.empty())
+    {
+        m_shaderObjectRenderer.Apply(m_packedPipelineDesc);
+    }
+    else if (m_packedPipeline)
+    {
+        buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                            m_pipelineCache->Get(*m_packedPipeline, m_pipelineCache->Get(m_packedFallbackPipeline)));
+        m_stateRecorder.Apply(m_packedPipelineDesc);
+    }
+
+    if (!m_packedDraws.empty())
+    {
+        buffer.bindVertexBuffers(0, m_packedVertexBuffer, vk::DeviceSize{ 0 });
+        buffer.bindIndexBuffer(m_packedIndexBuffer, 0, vk::IndexType::eUint32);
+
+        if (m_bindless)
+        {
+            buffer.pushConstants<uint32_t>(m_pipelineLayout, m_pushConstantStages, 0, m_packedQuadTexturesIndex);
+            buffer.drawIndexed(m_packedDraws.back().firstIndex + m_packedDraws.back().indexCount, 1, 0, 0, 0);
+        }
+        else
+        {
+            for (auto const& draw : m_packedDraws)
+            {
+                buffer.pushConstants<uint32_t>(m_pipelineLayout, m_pushConstantStages, 0, draw.arrayIndex);
+                buffer.drawIndexed(draw.indexCount, 1, draw.firstIndex, 0, 0);
+            }
+        }
+    }
+
+    endSwapChainRendering(buffer, imageIndex, m_shaderObjects);
 
     buffer.end();
 }
 
 void BasicTriangleApplication::mainLoop()
 {
+    m_lastFrameStart = std::chrono::steady_clock::now();
+    m_lastMemoryLog = m_lastFrameStart;
+
+    m_memoryTracker.LogStats(std::cout);
+    m_hostAllocator.LogStats(std::cout);
+
     while (!glfwWindowShouldClose(m_window))
     {
         glfwPollEvents();
         drawFrame();
+
+        if (auto const now = std::chrono::steady_clock::now(); now - m_lastMemoryLog > MemoryLogInterval)
+        {
+            m_memoryTracker.PollBudget();
+            m_memoryTracker.LogStats(std::cout);
+            m_hostAllocator.LogStats(std::cout);
+            if (m_textureResidency)
+            {
+                logResidencyStats();
+            }
+            m_lastMemoryLog = now;
+        }
     }
 
     m_logicalDevice.waitIdle();
+
+    if (m_framesDrawn > 0)
+    {
+        std::cout << std::format("Uniform uploads: {:.1f} bytes written and {:.1f} bytes flushed per frame\n",
+                                 static_cast<double>(m_uniformBytesWritten) / static_cast<double>(m_framesDrawn),
+                                 static_cast<double>(m_uniformBytesFlushed) / static_cast<double>(m_framesDrawn));
+    }
+
+    DescriptorAllocatorStats descriptorStats;
+    for (auto const& allocator : m_frameDescriptorAllocators)
+    {
+        auto const stats = allocator.GetStats();
+        descriptorStats.poolCount += stats.poolCount;
+        descriptorStats.setCapacity += stats.setCapacity;
+        descriptorStats.peakSetsPerReset = std::max(descriptorStats.peakSetsPerReset, stats.peakSetsPerReset);
+        descriptorStats.setsAllocated += stats.setsAllocated;
+        descriptorStats.resets += stats.resets;
+    }
+
+    std::cout << std::format("Descriptor sets: {} allocated over {} pool resets, {} pools holding {} sets, at most {} "
+                             "sets in one frame\n",
+                             descriptorStats.setsAllocated, descriptorStats.resets, descriptorStats.poolCount,
+                             descriptorStats.setCapacity, descriptorStats.peakSetsPerReset);
+
+    auto const pipelineStats = m_pipelineCache->GetStats();
+    std::cout << std::format("Pipelines: {} compiled and {} failed in {:.1f} ms, at most {:.1f} ms for one, {} of {} "
+                             "requests hit the cache and {} binds fell back while compiling\n",
+                             pipelineStats.pipelines, pipelineStats.failed, pipelineStats.compileMs,
+                             pipelineStats.maxCompileMs, pipelineStats.hits, pipelineStats.requests,
+                             pipelineStats.fallbacks);
+    if (m_pipelineLibraries)
+    {
+        std::cout << std::format("Pipeline libraries: {} parts, {} fast links in {:.2f} ms, {} optimized in the "
+                                 "background in {:.1f} ms\n",
+                                 pipelineStats.libraries, pipelineStats.fastLinks, pipelineStats.fastLinkMs,
+                                 pipelineStats.optimizedLinks, pipelineStats.optimizeMs);
+    }
+    if (pipelineStats.warmed > 0)
+    {
+        std::cout << std::format("Pipeline warm-up: {} compiled from the manifest while loading, {} runtime compiles "
+                                 "avoided, {} compiled on request\n",
+                                 pipelineStats.warmed, pipelineStats.compilesAvoided,
+                                 pipelineStats.compilesOnRequest);
+    }
+    if (m_dynamicState.extendedDynamicState || m_dynamicState.colorBlendEnable)
+    {
+        auto const stateStats = m_stateRecorder.GetStats();
+        std::cout << std::format("Dynamic state: {} sets recorded, {} redundant ones skipped\n",
+                                 stateStats.setsRecorded, stateStats.setsSkipped);
+    }
+    if (m_shaderObjects)
+    {
+        auto const shaderStats = m_shaderObjectRenderer.GetStats();
+        std::cout << std::format("Shader objects: {} created in {:.1f} ms, {} binds and {} skipped, {} state sets "
+                                 "and {} skipped\n", shaderStats.shaders, shaderStats.createMs, shaderStats.binds,
+                                 shaderStats.bindsSkipped, shaderStats.setsRecorded, shaderStats.setsSkipped);
+    }
+
+    writePipelineManifest();
 }
 
 void BasicTriangleApplication::drawFrame()
 {
+    // Events were just polled, so this is when the input for this frame was sampled
+    auto const frameStart = std::chrono::steady_clock::now();
+
     auto& currentCommandBuffer = m_commandBuffer[m_currentFrame];
     auto& currentImageAvailable = m_imageAvailable[m_currentFrame];
     auto& currentRenderFinished = m_renderFinished[m_currentFrame];
@@ -1021,6 +2911,18 @@ void BasicTriangleApplication::drawFrame()
 
     std::ignore = m_logicalDevice.waitForFences(inFlightFences, vk::True, UINT64_MAX);
 
+    auto const fenceSignalled = std::chrono::steady_clock::now();
+
+    // Catches this slot's previous frame if the poll after the last present missed it, a wait that blocked returns
+    // right as the frame completes
+    pollFrameCompletions();
+
+    m_framesInFlightController.RecordFrame(
+        std::chrono::duration<double, std::milli>(fenceSignalled - frameStart).count(),
+        std::chrono::duration<double, std::milli>(frameStart - m_lastFrameStart).count()
+    );
+    m_lastFrameStart = frameStart;
+
     unsigned int nextImage;
     try
     {
@@ -1039,6 +2941,17 @@ void BasicTriangleApplication::drawFrame()
 
     m_logicalDevice.resetFences(inFlightFences);
 
+    // The residency scene swaps views as levels stream in, the slot is idle so its set can point at the newest one
+    auto textureView = m_textureImageView;
+    if (m_textureResidency)
+    {
+        textureView = updateResidencyScene();
+    }
+
+    // Nothing reads the slot's descriptor sets any more, they're all returned at once and written again
+    m_frameDescriptorAllocators[m_currentFrame].Reset();
+    createDescriptorSet(m_currentFrame, textureView);
+
     currentCommandBuffer.reset();
 
     recordCommandBuffer(currentCommandBuffer, nextImage);
@@ -1060,6 +2973,7 @@ void BasicTriangleApplication::drawFrame()
     };
 
     m_gfxQueue.submit(submitInfos, currentInFlight);
+    m_frameInputTimes[m_currentFrame] = frameStart;
 
     std::vector swapchains = { m_swapChain };
     std::vector imageIndices = { nextImage };
@@ -1086,7 +3000,36 @@ void BasicTriangleApplication::drawFrame()
         recreateSwapChain();
     }
 
-    m_currentFrame = (m_currentFrame + 1) % m_maxFramesInFlight;
+    pollFrameCompletions();
+
+    m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+
+    auto const stats = m_framesInFlightController.GetStats();
+    if (auto const framesInFlight = m_framesInFlightController.Evaluate())
+    {
+        std::cout << std::format("Frames in flight {} -> {} (fence wait {:.2f}ms, frame {:.2f}ms, latency {:.2f}ms)\n",
+                                 m_framesInFlight, *framesInFlight, stats.averageFenceWaitMs,
+                                 stats.averageFrameTimeMs, stats.averageLatencyMs);
+        setFramesInFlight(*framesInFlight);
+    }
+}
+
+void BasicTriangleApplication::pollFrameCompletions()
+{
+    // A frame is seen at most one CPU frame after it completes however many are in flight, waiting on its fence
+    // instead would add the time spent on the frames queued after it
+    for (size_t frame = 0; frame < m_framesInFlight; frame++)
+    {
+        auto& inputTime = m_frameInputTimes[frame];
+        if (!inputTime || m_logicalDevice.getFenceStatus(m_inFlight[frame]) != vk::Result::eSuccess)
+        {
+            continue;
+        }
+
+        auto const latency = std::chrono::steady_clock::now() - *inputTime;
+        m_framesInFlightController.RecordLatency(std::chrono::duration<double, std::milli>(latency).count());
+        inputTime.reset();
+    }
 }
 
 void BasicTriangleApplication::updateUniformBuffer(size_t currentFrame)
@@ -1106,24 +3049,28 @@ void BasicTriangleApplication::updateUniformBuffer(size_t currentFrame)
 
     ubo.proj[1][1] *= -1;
 
-    memcpy(m_uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+    // View and projection only change on resize, so usually just the model matrix block is written and flushed
+    auto& writer = m_uniformWriters[currentFrame];
+    m_uniformBytesWritten += writer.Write(0, &ubo, sizeof(ubo));
+    m_uniformBytesFlushed += writer.Flush();
+    m_framesDrawn++;
 }
 
 void BasicTriangleApplication::cleanupSwapChain()
 {
     for (auto frameBuffer : m_swapChainFrameBuffers)
     {
-        m_logicalDevice.destroyFramebuffer(frameBuffer);
+        m_logicalDevice.destroyFramebuffer(frameBuffer, m_pAllocator);
     }
     m_swapChainFrameBuffers.clear();
 
     for (auto const& imageView : m_swapChainImageViews)
     {
-        m_logicalDevice.destroyImageView(imageView);
+        m_logicalDevice.destroyImageView(imageView, m_pAllocator);
     }
     m_swapChainImageViews.clear();
 
-    m_logicalDevice.destroySwapchainKHR(m_swapChain);
+    m_logicalDevice.destroySwapchainKHR(m_swapChain, m_pAllocator);
 }
 
 void BasicTriangleApplication::recreateSwapChain()
@@ -1150,54 +3097,95 @@ void BasicTriangleApplication::cleanup()
 {
     for (auto const& sem : m_imageAvailable)
     {
-        m_logicalDevice.destroySemaphore(sem);
+        m_logicalDevice.destroySemaphore(sem, m_pAllocator);
     }
     for (auto const& sem : m_renderFinished)
     {
-        m_logicalDevice.destroySemaphore(sem);
+        m_logicalDevice.destroySemaphore(sem, m_pAllocator);
     }
     for (auto const& fence : m_inFlight)
     {
-        m_logicalDevice.destroyFence(fence);
+        m_logicalDevice.destroyFence(fence, m_pAllocator);
+    }
+
+    for (size_t frame = 0; frame < m_framesInFlight; frame++)
+    {
+        destroyFrameResources(frame);
+    }
+
+    m_logicalDevice.destroyCommandPool(m_commandPool, m_pAllocator);
+
+    m_logicalDevice.destroyBuffer(m_indexBuffer, m_pAllocator);
+    m_memoryTracker.Free(m_indexBufferMemory);
+
+    m_samplerCache.Release(m_textureSampler);
+    m_imageViewCache.Release(m_textureImageView);
+    m_logicalDevice.destroyImage(m_textureImage, m_pAllocator);
+    m_memoryTracker.Free(m_textureImageMemory);
+
+    m_texturePacker.Destroy();
+
+    m_logicalDevice.destroyBuffer(m_packedIndexBuffer, m_pAllocator);
+    m_memoryTracker.Free(m_packedIndexBufferMemory);
+    m_logicalDevice.destroyBuffer(m_packedVertexBuffer, m_pAllocator);
+    m_memoryTracker.Free(m_packedVertexBufferMemory);
+    m_logicalDevice.destroyBuffer(m_packedQuadTextureBuffer, m_pAllocator);
+    m_memoryTracker.Free(m_packedQuadTextureBufferMemory);
+
+    if (m_textureResidency)
+    {
+        m_textureResidency->Destroy();
     }
 
-    m_logicalDevice.destroyCommandPool(m_commandPool);
+    m_textureUploader.Destroy();
+
+    if (m_computeMipmapGenerator)
+    {
+        m_computeMipmapGenerator->Destroy();
+    }
 
-    m_logicalDevice.destroyBuffer(m_indexBuffer);
-    m_logicalDevice.freeMemory(m_indexBufferMemory);
+    // Anything still referenced at this point goes with the caches
+    m_imageViewCache.Destroy();
+    m_samplerCache.Destroy();
 
-    m_logicalDevice.destroyBuffer(m_vertexBuffer);
-    m_logicalDevice.freeMemory(m_vertexBufferMemory);
+    m_logicalDevice.destroyBuffer(m_vertexBuffer, m_pAllocator);
+    m_memoryTracker.Free(m_vertexBufferMemory);
 
     cleanupSwapChain();
 
-    for (size_t i = 0; i < m_maxFramesInFlight; i++)
+    for (auto& allocator : m_frameDescriptorAllocators)
     {
-        m_logicalDevice.destroyBuffer(m_uniformBuffers[i]);
-        m_uniformBuffersMapped[i] = nullptr;
-        m_logicalDevice.freeMemory(m_uniformBuffersMemory[i]);
+        allocator.Destroy();
     }
 
-    m_logicalDevice.destroyDescriptorPool(m_descriptorPool);
+    m_logicalDevice.destroyDescriptorUpdateTemplate(m_frameDescriptorTemplate, m_pAllocator);
 
-    m_logicalDevice.destroyDescriptorSetLayout(m_descriptorSetLayout);
+    if (m_bindless)
+    {
+        m_bindlessTable.Destroy();
+    }
 
-    m_logicalDevice.destroyPipeline(m_pipeline);
+    // Waits for compiles still running, then takes every pipeline with it
+    m_pipelineCache->Destroy();
+    m_shaderObjectRenderer.Destroy();
 
-    m_logicalDevice.destroyPipelineLayout(m_pipelineLayout);
+    // Takes the frame's set layout and the pipeline layout with it
+    m_layoutCache.Destroy();
 
-    m_logicalDevice.destroyRenderPass(m_renderPass);
+    m_logicalDevice.destroyRenderPass(m_renderPass, m_pAllocator);
 
-    m_logicalDevice.destroy();
+    m_logicalDevice.destroy(m_pAllocator);
 
     if (EnableValidationLayers)
     {
-        m_instance.destroyDebugUtilsMessengerEXT(m_debugMessenger);
+        m_instance.destroyDebugUtilsMessengerEXT(m_debugMessenger, m_pAllocator);
     }
 
-    m_instance.destroySurfaceKHR(m_surface);
+    m_instance.destroySurfaceKHR(m_surface, m_pAllocator);
+
+    m_instance.destroy(m_pAllocator);
 
-    m_instance.destroy();
+    m_hostAllocator.LogStats(std::cout);
 
     glfwDestroyWindow(m_window);
     m_window = nullptr;
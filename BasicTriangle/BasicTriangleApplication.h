@@ -1,5 +1,21 @@
 #pragma once
 #include "VulkanHelpers/PhysicalDeviceHelpers.h"
+#include "VulkanHelpers/FramesInFlightController.h"
+#include "VulkanHelpers/MappedMemoryWriter.h"
+#include "VulkanHelpers/MemoryTracker.h"
+#include "VulkanHelpers/HostAllocator.h"
+#include "VulkanHelpers/TextureHelpers.h"
+#include "VulkanHelpers/ImageIngestHelpers.h"
+#include "VulkanHelpers/StreamingImageUploader.h"
+#include "VulkanHelpers/TextureResidencyManager.h"
+#include "VulkanHelpers/ObjectCaches.h"
+#include "VulkanHelpers/TexturePacker.h"
+#include "VulkanHelpers/BindlessDescriptors.h"
+#include "VulkanHelpers/DescriptorAllocator.h"
+#include "VulkanHelpers/DescriptorUpdateTemplates.h"
+#include "VulkanHelpers/PipelineCache.h"
+#include "VulkanHelpers/ShaderObjects.h"
+#include "VulkanHelpers/VertexLayout.h"
 
 constexpr int32_t Width = 800;
 constexpr int32_t Height = 600;
@@ -12,6 +28,11 @@ const std::vector DeviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Enabled when the device supports them, features relying on these check isDeviceExtensionEnabled
+const std::vector OptionalDeviceExtensions = {
+    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+};
+
 #ifdef NDEBUG
 constexpr bool EnableValidationLayers = false;
 #else
@@ -22,37 +43,48 @@ struct Vertex
 {
     glm::vec2 position;
     glm::vec3 color;
+    glm::vec2 texCoord;
+
+    static constexpr vk::VertexInputBindingDescription getBindingDescription()
+    {
+        return GetVertexBinding<Vertex>();
+    }
+
+    static constexpr auto getAttributeDescriptions()
+    {
+        return GetVertexAttributes(0, 0, VERTEX_ATTRIBUTE(Vertex, position), VERTEX_ATTRIBUTE(Vertex, color),
+                                   VERTEX_ATTRIBUTE(Vertex, texCoord));
+    }
+};
+
+// Quads textured from the packed texture arrays, which array is chosen per draw by a push constant
+struct PackedVertex
+{
+    glm::vec2 position;
+    glm::vec2 texCoord;
+    uint32_t layer;
 
-    static vk::VertexInputBindingDescription getBindingDescription()
+    static constexpr vk::VertexInputBindingDescription getBindingDescription()
     {
-        return {
-            0,
-            sizeof(Vertex),
-            vk::VertexInputRate::eVertex
-        };
+        return GetVertexBinding<PackedVertex>();
     }
 
-    static std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescriptions()
+    static constexpr auto getAttributeDescriptions()
     {
-        std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions{};
-
-        return  {
-            vk::VertexInputAttributeDescription {
-                0,
-                0,
-                vk::Format::eR32G32Sfloat,
-                offsetof(Vertex, position)
-            },
-            vk::VertexInputAttributeDescription {
-                1,
-                0,
-                vk::Format::eR32G32B32Sfloat,
-                offsetof(Vertex, color)
-            }
-        };
+        return GetVertexAttributes(0, 0, VERTEX_ATTRIBUTE(PackedVertex, position),
+                                   VERTEX_ATTRIBUTE(PackedVertex, texCoord), VERTEX_ATTRIBUTE(PackedVertex, layer));
     }
 };
 
+// The quads of one array, drawn back to back without touching the bound descriptor set. Bindless draws cover every
+// array at once.
+struct PackedDraw
+{
+    uint32_t arrayIndex;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
 struct UniformBufferObject
 {
     alignas(16) glm::mat4 model;
@@ -63,43 +95,149 @@ struct UniformBufferObject
 class BasicTriangleApplication
 {
 public:
-    BasicTriangleApplication(size_t maxFramesInFlight)
-        : m_window(nullptr), m_maxFramesInFlight(maxFramesInFlight), m_currentFrame(0)
+    BasicTriangleApplication(size_t maxFramesInFlight, size_t initialFramesInFlight,
+                             FramePacingTarget pacingTarget = FramePacingTarget::eLatency, double targetLatencyMs = 50.0)
+        : m_window(nullptr),
+          m_maxFramesInFlight(maxFramesInFlight),
+          m_framesInFlight(std::clamp<size_t>(initialFramesInFlight, 1, maxFramesInFlight)),
+          m_currentFrame(0),
+          m_framesInFlightController(maxFramesInFlight, initialFramesInFlight, pacingTarget, targetLatencyMs),
+          m_commandBuffer(maxFramesInFlight),
+          m_uniformBuffers(maxFramesInFlight),
+          m_uniformBuffersMemory(maxFramesInFlight),
+          m_uniformBuffersMapped(maxFramesInFlight),
+          m_uniformWriters(maxFramesInFlight),
+          m_frameDescriptorAllocators(maxFramesInFlight),
+          m_descriptorSets(maxFramesInFlight),
+          m_frameInputTimes(maxFramesInFlight)
     {
     }
     void run();
+
+    // Replaces the displayed texture with a synthetic scene of many textures streamed under the given VRAM budget
+    void enableResidencyScene(uint32_t textureCount, vk::DeviceSize budget);
+
+    // Draws the scene textures through one bindless descriptor table instead of fixed bindings, when supported
+    void enableBindless();
+
+    // Sets cull mode, front face, topology, depth and blend enable while recording instead of baking them into
+    // pipelines, when supported
+    void enableDynamicState();
+
+    // Draws with shader objects and all state set while recording instead of with pipelines, when supported
+    void enableShaderObjects();
+
+    // Full image decode for PNGs the streaming decoder can't handle
+    static std::vector<uint8_t> decodeRgbaWithStb(std::string const& fileName);
 private:
+    // The benchmarks set the device up without showing any frames and return the process exit code, RunBenchmark
+    // picks one by name
+    friend int RunBenchmark(std::string_view name);
+
+    // Times texture uploads through staging against host image copy
+    int runUploadBenchmark();
+
+    // Compares descriptor set writes through WriteDescriptorSets against an update template
+    int runDescriptorUpdateBenchmark();
+
+    // Creates pipelines for a scene of many materials with static state against dynamic state
+    int runPipelineStateBenchmark();
+
+    // Records frames of draws that keep changing state with static pipelines, dynamic state pipelines and shader
+    // objects
+    int runShaderObjectBenchmark();
+
+    // Compiles every specialization constant variant of the main shaders through the pipeline cache
+    int runShaderVariantBenchmark();
+
     void initWindow();
     void initVulcan();
     void createInstance();
     void setupDebugMessenger();
     void createSurface();
     void pickPhysicalDevice();
+    void detectDirectDeviceWrites();
     void createLogicalDevice();
+    bool isDeviceExtensionEnabled(std::string_view extension) const;
+    // Whether an image with the usage can be filled from host memory in the layout, usage excludes host transfer
+    bool canCopyTextureOnHost(vk::Format format, vk::ImageUsageFlags usage, vk::ImageLayout layout) const;
     void createSwapChain(bool recreate = false);
     void createImageViews();
-    void createDescriptorSetLayout();
+    // Reflected from every shader that binds the frame's set
+    void createPipelineLayout();
     void createGraphicsPipeline();
+    void createPackedPipeline();
+    // Queues the pipelines of the last run's manifest on the cache's workers, they compile while the rest loads
+    void warmPipelines();
+    // Before the first frame, so none of the warmed pipelines falls back
+    void finishPipelineWarmUp();
+    void writePipelineManifest() const;
+    // The fixed function state every pipeline of the app shares, drawing to the swap chain with the frame's layout
+    PipelineDesc describePipeline(std::string const& vertShaderFileName, std::string const& fragShaderFileName,
+                                  vk::VertexInputBindingDescription const& binding,
+                                  std::span<vk::VertexInputAttributeDescription const> attributes) const;
+    // The main pipeline in every combination of the state that can be dynamic
+    std::vector<PipelineDesc> describeMaterials() const;
     void createRenderPass();
     void createFrameBuffers();
     void createCommandPool();
+    void createTextureUploader();
     void createTextureImage();
+    void createCompressedTextureImage();
+    void createPngTextureImage();
+    void createSceneTextures();
+    void createPackedQuads();
+    void createResidencyScene();
+    // Requests this frame's levels and returns the view of the texture to display
+    vk::ImageView updateResidencyScene();
+    void logResidencyStats() const;
+    // Best latency of uploading a size by size BGRA8 texture until it could be sampled
+    double measureTextureUploadMs(uint8_t const* pPixels, uint32_t size, bool hostCopy);
+    void recordTextureToTransferDst(vk::CommandBuffer commandBuffer, vk::Image image, uint32_t mipLevels) const;
+    void recordTextureToShaderRead(vk::CommandBuffer commandBuffer, vk::Image image, uint32_t mipLevels) const;
+    void createTextureImageView();
+    void createTextureSampler();
+    vk::SamplerCreateInfo getTextureSamplerInfo() const;
     void createVertexBuffer();
     void createIndexBuffer();
-    void createUniformBuffers();
-    void createDescriptorPool();
-    void createDescriptorSets();
-    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buffer, vk::
-                      DeviceMemory& bufferMemory) const;
-    std::pair<vk::Image, vk::DeviceMemory> createTexture(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling,
-                                                         vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties);
+    void createUniformBuffer(size_t frame);
+    void createDescriptorAllocators();
+    void createDescriptorSet(size_t frame, vk::ImageView textureView);
+    void createDescriptorUpdateTemplate();
+    // Whether binding 2 holds the packed texture arrays, the bindless table replaces it
+    bool bindsPackedArrays() const;
+    void writeDescriptorSet(vk::DescriptorSet set, size_t frame, vk::ImageView textureView, bool useTemplate) const;
+    vk::MemoryPropertyFlags createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                                         vk::Buffer& buffer, vk::DeviceMemory& bufferMemory, MemoryUsage memoryUsage,
+                                         std::optional<vk::MemoryPropertyFlags> fallbackProperties = std::nullopt);
+    void createDeviceLocalBuffer(void const* pData, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::Buffer& buffer,
+                                 vk::DeviceMemory& bufferMemory, MemoryUsage memoryUsage, std::string_view name);
+    std::pair<vk::Image, vk::DeviceMemory> createTexture(uint32_t width, uint32_t height, uint32_t mipLevels, vk::Format format,
+                                                         vk::ImageTiling tiling, vk::ImageUsageFlags usage,
+                                                         vk::MemoryPropertyFlags properties, vk::ImageCreateFlags flags = {});
+    vk::CommandBuffer beginSingleTimeCommands() const;
+    void endSingleTimeCommands(vk::CommandBuffer commandBuffer) const;
     void copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size) const;
-    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
-    void createCommandBuffer();
+    // Size is the allocation's, types in heaps with budget left for it come first
+    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::DeviceSize size) const;
+    std::optional<uint32_t> tryFindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties,
+                                              vk::DeviceSize size) const;
+    void createCommandBuffer(size_t frame);
     void createSyncObjects();
+    void createFrameResources(size_t frame);
+    void destroyFrameResources(size_t frame);
+    void setFramesInFlight(size_t framesInFlight);
+    // For pipelines, shader objects set them with their count
+    void setViewportAndScissor(vk::CommandBuffer buffer) const;
+    // Clears the swap chain image and leaves it ready to present. Pipelines draw inside the render pass they were
+    // built for, shader objects only inside dynamic rendering.
+    void beginSwapChainRendering(vk::CommandBuffer buffer, uint32_t imageIndex, bool dynamicRendering) const;
+    void endSwapChainRendering(vk::CommandBuffer buffer, uint32_t imageIndex, bool dynamicRendering) const;
     void recordCommandBuffer(vk::CommandBuffer buffer, uint32_t imageIndex);
     void mainLoop();
     void drawFrame();
+    // Records the latency of every submitted frame whose fence is now signalled
+    void pollFrameCompletions();
     void updateUniformBuffer(size_t currentFrame);
     void cleanupSwapChain();
     void recreateSwapChain();
@@ -116,14 +254,26 @@ private:
 
     GLFWwindow* m_window;
 
+    // Declared ahead of every Vulkan handle, the driver calls back into it until the instance is destroyed
+    HostAllocator m_hostAllocator;
+    vk::AllocationCallbacks const* m_pAllocator = &m_hostAllocator.GetCallbacks();
+
     size_t m_maxFramesInFlight;
+    size_t m_framesInFlight;
     size_t m_currentFrame;
 
+    FramesInFlightController m_framesInFlightController;
+
     vk::Instance m_instance;
     vk::DebugUtilsMessengerEXT m_debugMessenger;
     vk::SurfaceKHR m_surface;
     PhysicalDevice m_physicalDevice;
     vk::Device m_logicalDevice;
+    std::vector<const char*> m_enabledDeviceExtensions;
+    // Layouts textures can be copied into from the host, empty without VK_EXT_host_image_copy
+    std::vector<vk::ImageLayout> m_hostCopyDstLayouts;
+    MemoryTracker m_memoryTracker;
+    std::chrono::steady_clock::time_point m_lastMemoryLog;
     vk::Queue m_gfxQueue;
     vk::Queue m_presentQueue;
     vk::SwapchainKHR m_swapChain;
@@ -133,9 +283,13 @@ private:
     std::vector<vk::ImageView> m_swapChainImageViews;
     std::vector<vk::Framebuffer> m_swapChainFrameBuffers;
     vk::RenderPass m_renderPass;
+    // Both owned by the layout cache, shared by every pipeline drawing with the frame's set
     vk::DescriptorSetLayout m_descriptorSetLayout;
     vk::PipelineLayout m_pipelineLayout;
-    vk::Pipeline m_pipeline;
+    vk::ShaderStageFlags m_pushConstantStages;
+    std::vector<vk::PushConstantRange> m_pushConstantRanges;
+    // Looked up in the pipeline cache for every command buffer, optimized pipelines replace fast linked ones
+    PipelineId m_pipeline = 0;
     vk::CommandPool m_commandPool;
     std::vector<vk::CommandBuffer> m_commandBuffer;
     vk::Buffer m_vertexBuffer;
@@ -145,12 +299,64 @@ private:
 
     vk::Image m_textureImage;
     vk::DeviceMemory m_textureImageMemory;
+    vk::ImageView m_textureImageView;
+    vk::Sampler m_textureSampler;
+    SamplerCache m_samplerCache;
+    ImageViewCache m_imageViewCache;
+    LayoutCache m_layoutCache;
+    std::optional<GraphicsPipelineCache> m_pipelineCache;
+    vk::Format m_textureFormat = vk::Format::eB8G8R8A8Srgb;
+    vk::Extent2D m_textureExtent;
+    uint32_t m_textureMipLevels = 1;
+    // Persistently mapped, every texture upload decodes or copies its rows straight into it
+    StreamingImageUploader m_textureUploader;
+    // Scene textures, reachable through binding 2 of the frame's descriptor set or through the bindless table
+    TexturePacker m_texturePacker;
+    // Compiled in the background, the packed quads are drawn with the fallback until it's ready
+    std::optional<PipelineId> m_packedPipeline;
+    PipelineId m_packedFallbackPipeline = 0;
+    vk::Buffer m_packedVertexBuffer;
+    vk::DeviceMemory m_packedVertexBufferMemory;
+    vk::Buffer m_packedIndexBuffer;
+    vk::DeviceMemory m_packedIndexBufferMemory;
+    std::vector<PackedDraw> m_packedDraws;
+    bool m_bindlessRequested = false;
+    bool m_bindless = false;
+    bool m_pipelineLibraries = false;
+    bool m_dynamicStateRequested = false;
+    DynamicStateSupport m_dynamicState;
+    // Sets the dynamic part of each draw's description, redundant sets are left out
+    DynamicStateRecorder m_stateRecorder;
+    PipelineDesc m_mainPipelineDesc;
+    PipelineDesc m_packedPipelineDesc;
+    bool m_shaderObjectsRequested = false;
+    bool m_shaderObjects = false;
+    // Replaces the pipelines when shader objects are enabled
+    ShaderObjectRenderer m_shaderObjectRenderer;
+    BindlessDescriptorTable m_bindlessTable;
+    // With bindless descriptors every packed quad finds its array's table slot in this buffer
+    vk::Buffer m_packedQuadTextureBuffer;
+    vk::DeviceMemory m_packedQuadTextureBufferMemory;
+    BindlessIndex m_packedQuadTexturesIndex = 0;
+    uint32_t m_residencySceneTextureCount = 0;
+    vk::DeviceSize m_residencyBudget = 0;
+    std::optional<TextureResidencyManager> m_textureResidency;
+    std::vector<uint32_t> m_residentTextureSizes;
+    // Only created when a texture format can't be linearly blitted
+    std::optional<ComputeMipmapGenerator> m_computeMipmapGenerator;
 
     std::vector<vk::Buffer> m_uniformBuffers;
     std::vector<vk::DeviceMemory> m_uniformBuffersMemory;
     std::vector<void*> m_uniformBuffersMapped;
+    std::vector<MappedMemoryWriter> m_uniformWriters;
+    vk::DeviceSize m_uniformBytesWritten = 0;
+    vk::DeviceSize m_uniformBytesFlushed = 0;
+    size_t m_framesDrawn = 0;
 
-    vk::DescriptorPool m_descriptorPool;
+    // One per frame slot, reset and refilled once the slot's fence has signalled
+    std::vector<DescriptorAllocator> m_frameDescriptorAllocators;
+    // Writes a whole frame set from one FrameDescriptors struct
+    vk::DescriptorUpdateTemplate m_frameDescriptorTemplate;
     std::vector<vk::DescriptorSet> m_descriptorSets;
 
     std::vector<vk::Semaphore> m_imageAvailable;
@@ -159,11 +365,23 @@ private:
 
     bool m_frameBufferResized = false;
 
+    bool m_samplerAnisotropy = false;
+    bool m_storageImageWriteWithoutFormat = false;
+    bool m_sampledImageArrayDynamicIndexing = false;
+
+    // Set when device local memory in the main heap is also host visible (UMA or resizable BAR)
+    bool m_directDeviceWrites = false;
+    vk::DeviceSize m_stagingBytesSaved = 0;
+
+    // Input sample time of the frame last submitted from each slot, until the frame is seen completing
+    std::vector<std::optional<std::chrono::steady_clock::time_point>> m_frameInputTimes;
+    std::chrono::steady_clock::time_point m_lastFrameStart;
+
     const std::vector<Vertex> m_vertices = {
-        {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-        {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-        {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-        {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
+        {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+        {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
+        {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
+        {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}}
     };
 
     const std::vector<uint16_t> m_indices = {
@@ -0,0 +1,610 @@
+#include "pch.h"
+#include "Benchmarks.h"
+
+#include "BasicTriangleApplication.h"
+#include "VulkanHelpers/ImageIngestHelpers.h"
+#include "VulkanHelpers/BatchImageDecoder.h"
+#include "VulkanHelpers/PngStreamDecoder.h"
+#include "VulkanHelpers/ShaderHelpers.h"
+
+namespace
+{
+    constexpr uint32_t IngestWidth = 3840;
+    constexpr uint32_t IngestHeight = 2160;
+    constexpr int IngestIterations = 10;
+
+    constexpr auto BatchTextureDirectory = "textures";
+    // Files are repeated until the batch is at least this long so scaling is visible with few test images
+    constexpr size_t BatchMinimumTextures = 64;
+    constexpr size_t BatchBytesInFlight = 256 * 1024 * 1024;
+
+    constexpr int PngDecodeIterations = 5;
+
+    constexpr auto ShaderDirectory = "shaders";
+    constexpr int ReflectionIterations = 100;
+    // Each copy has one word past the header replaced or is cut short there. A changed word can still leave a valid
+    // module, so the copies only have to be reflected or rejected without crashing.
+    constexpr int ReflectionCorruptCopies = 10000;
+
+    // Best of several runs, the first run also warms caches and lookup tables
+    template <typename Fn>
+    double measureBestMs(int iterations, Fn&& fn)
+    {
+        auto best = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < iterations; i++)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            fn();
+            auto const end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        return best;
+    }
+
+    double toMegabytesPerSecond(size_t bytes, double ms)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0) / (ms / 1000.0);
+    }
+
+    std::vector<SimdLevel> getSupportedSimdLevels()
+    {
+        std::vector<SimdLevel> levels;
+        for (auto const level : { SimdLevel::eScalar, SimdLevel::eSse41, SimdLevel::eAvx2, SimdLevel::eNeon })
+        {
+            if (IsSimdLevelSupported(level))
+            {
+                levels.push_back(level);
+            }
+        }
+
+        return levels;
+    }
+
+    int ingestBenchmark()
+    {
+        constexpr size_t PixelCount = static_cast<size_t>(IngestWidth) * IngestHeight;
+        constexpr size_t ImageBytes = PixelCount * 4;
+
+        // Random colour with a mix of opaque, transparent and partial alpha
+        std::vector<uint8_t> source(ImageBytes);
+        std::mt19937 random(42);
+        std::uniform_int_distribution<uint32_t> byteDistribution(0, 255);
+        std::ranges::generate(source, [&] { return static_cast<uint8_t>(byteDistribution(random)); });
+
+        std::vector<uint8_t> reference(ImageBytes);
+        std::vector<uint8_t> output(ImageBytes);
+        bool mismatch = false;
+
+        std::cout << std::format("Texture ingest benchmark, {}x{} RGBA8, best of {} runs, best SIMD level {}\n",
+                                 IngestWidth, IngestHeight, IngestIterations, ToString(GetSimdLevel()));
+
+        for (bool const premultiply : { false, true })
+        {
+            SwizzleRgbaToBgra(source.data(), reference.data(), PixelCount, premultiply, SimdLevel::eScalar);
+
+            double scalarMs = 0.0;
+            for (auto const level : getSupportedSimdLevels())
+            {
+                auto const ms = measureBestMs(IngestIterations, [&]
+                {
+                    SwizzleRgbaToBgra(source.data(), output.data(), PixelCount, premultiply, level);
+                });
+
+                if (level == SimdLevel::eScalar)
+                {
+                    scalarMs = ms;
+                }
+
+                bool const matches = output == reference;
+                mismatch |= !matches;
+
+                std::cout << std::format("  swizzle{} {:>7}: {:8.2f} ms {:9.1f} MB/s {:6.2f}x scalar{}\n",
+                                         premultiply ? "+premultiply" : "            ", ToString(level), ms,
+                                         toMegabytesPerSecond(ImageBytes, ms), scalarMs / ms,
+                                         matches ? "" : " OUTPUT MISMATCH");
+            }
+        }
+
+        constexpr size_t HalfBytes = static_cast<size_t>(IngestWidth / 2) * (IngestHeight / 2) * 4;
+        std::vector<uint8_t> scalarHalf(HalfBytes);
+        std::vector<uint8_t> simdHalf(HalfBytes);
+
+        for (auto const filter : { MipFilter::eBox, MipFilter::eKaiser })
+        {
+            auto const scalarMs = measureBestMs(IngestIterations, [&]
+            {
+                DownsampleSrgb(source.data(), IngestWidth, IngestHeight, scalarHalf.data(), filter, SimdLevel::eScalar);
+            });
+
+            auto const simdMs = measureBestMs(IngestIterations, [&]
+            {
+                DownsampleSrgb(source.data(), IngestWidth, IngestHeight, simdHalf.data(), filter, GetSimdLevel());
+            });
+
+            // Float results may differ by a rounding step if the compiler contracts the scalar path differently
+            int maxDifference = 0;
+            for (size_t i = 0; i < HalfBytes; i++)
+            {
+                maxDifference = std::max(maxDifference, std::abs(scalarHalf[i] - simdHalf[i]));
+            }
+
+            std::cout << std::format("  downsample {:>6}: scalar {:8.2f} ms, {} {:8.2f} ms, {:5.2f}x, "
+                                     "max difference {}\n",
+                                     ToString(filter), scalarMs, ToString(GetSimdLevel()), simdMs, scalarMs / simdMs,
+                                     maxDifference);
+        }
+
+        auto const mipLevels = static_cast<uint32_t>(std::bit_width(std::max(IngestWidth, IngestHeight)));
+        std::vector<uint8_t> chain(GetMipChainSize(IngestWidth, IngestHeight, mipLevels));
+
+        for (auto const filter : { MipFilter::eBox, MipFilter::eKaiser })
+        {
+            auto const chainMs = measureBestMs(IngestIterations, [&]
+            {
+                WriteBgraMipChain(source.data(), IngestWidth, IngestHeight, mipLevels, filter, chain.data());
+            });
+
+            std::cout << std::format("  {} level {} mip chain into staging: {:.2f} ms\n", ToString(filter), mipLevels,
+                                     chainMs);
+        }
+
+        return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    std::vector<std::string> findPngFiles(char const* directory)
+    {
+        std::vector<std::string> fileNames;
+        if (std::filesystem::is_directory(directory))
+        {
+            for (auto const& entry : std::filesystem::recursive_directory_iterator(directory))
+            {
+                if (entry.path().extension() == ".png")
+                {
+                    fileNames.push_back(entry.path().string());
+                }
+            }
+        }
+
+        return fileNames;
+    }
+
+    int batchDecodeBenchmark()
+    {
+        auto const sourceFiles = findPngFiles(BatchTextureDirectory);
+        if (sourceFiles.empty())
+        {
+            std::cerr << std::format("No PNG files found in {}\n", BatchTextureDirectory);
+            return EXIT_FAILURE;
+        }
+
+        std::vector<std::string> fileNames;
+        while (fileNames.size() < BatchMinimumTextures)
+        {
+            fileNames.insert(fileNames.end(), sourceFiles.begin(), sourceFiles.end());
+        }
+
+        auto const maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<uint32_t> threadCounts;
+        for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+        {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(maxThreads);
+
+        std::cout << std::format("Batch decode benchmark, {} textures from {} files, {} MiB in flight at most\n",
+                                 fileNames.size(), sourceFiles.size(), BatchBytesInFlight / (1024 * 1024));
+
+        double singleThreadMs = 0.0;
+        bool failed = false;
+
+        for (auto const threads : threadCounts)
+        {
+            BatchDecodeStats stats;
+
+            // The consumer releases each image as soon as it arrives, so only decoding is measured
+            auto const ms = measureBestMs(3, [&]
+            {
+                BatchImageDecoder decoder(fileNames, threads, BatchBytesInFlight,
+                                          BasicTriangleApplication::decodeRgbaWithStb);
+
+                while (auto image = decoder.Next())
+                {
+                    if (!image->error.empty())
+                    {
+                        std::cerr << std::format("{}: {}\n", image->fileName, image->error);
+                        failed = true;
+                    }
+                    decoder.Release(std::move(*image));
+                }
+
+                stats = decoder.GetStats();
+            });
+
+            if (threads == 1)
+            {
+                singleThreadMs = ms;
+            }
+
+            std::cout << std::format("  {:>3} threads: {:8.1f} ms {:9.1f} MB/s {:8.1f} textures/s {:5.2f}x, "
+                                     "peak {:6.1f} MiB decoded, {:7.1f} ms waiting for budget\n",
+                                     threads, ms, toMegabytesPerSecond(stats.bytesDecoded, ms),
+                                     static_cast<double>(stats.imagesDecoded) / (ms / 1000.0), singleThreadMs / ms,
+                                     static_cast<double>(stats.peakBytesInFlight) / (1024.0 * 1024.0),
+                                     stats.budgetWaitMs);
+        }
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    std::vector<uint8_t> decodePngStreaming(std::string const& fileName)
+    {
+        PngStreamDecoder decoder(fileName);
+
+        std::vector<uint8_t> rgba(static_cast<size_t>(decoder.GetWidth()) * decoder.GetHeight() * 4);
+        decoder.ReadRows(rgba.data(), decoder.GetHeight(), static_cast<size_t>(decoder.GetWidth()) * 4, false);
+
+        return rgba;
+    }
+
+    // Flips a bit in the middle of the first image data chunk of a copy, which its CRC or the stream has to catch
+    bool isCorruptCopyRejected(std::string const& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        std::vector<char> data{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+        constexpr std::string_view ImageData = "IDAT";
+        auto const chunk = std::ranges::search(data, ImageData);
+        if (chunk.empty() || chunk.begin() - data.begin() < 4)
+        {
+            return false;
+        }
+
+        auto const* pLength = reinterpret_cast<uint8_t const*>(&*chunk.begin() - 4);
+        auto const length = uint32_t{ pLength[0] } << 24 | uint32_t{ pLength[1] } << 16 | uint32_t{ pLength[2] } << 8 |
+                            pLength[3];
+        auto const offset = static_cast<size_t>(chunk.end() - data.begin()) + length / 2;
+        if (length == 0 || offset >= data.size())
+        {
+            return false;
+        }
+        data[offset] ^= 0x10;
+
+        auto const copyName = (std::filesystem::temp_directory_path() / "png-decode-benchmark.png").string();
+        std::ofstream(copyName, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+
+        bool rejected = false;
+        try
+        {
+            decodePngStreaming(copyName);
+        }
+        catch (std::exception const&)
+        {
+            rejected = true;
+        }
+
+        std::filesystem::remove(copyName);
+        return rejected;
+    }
+
+    int pngDecodeBenchmark()
+    {
+        auto const fileNames = findPngFiles(BatchTextureDirectory);
+        if (fileNames.empty())
+        {
+            std::cerr << std::format("No PNG files found in {}\n", BatchTextureDirectory);
+            return EXIT_FAILURE;
+        }
+
+        std::cout << std::format("PNG decode benchmark, streaming decoder against stb_image, best of {} runs, every "
+                                 "image checked pixel for pixel and with a corrupted copy\n", PngDecodeIterations);
+
+        bool failed = false;
+        for (auto const& fileName : fileNames)
+        {
+            try
+            {
+                if (!PngStreamDecoder(fileName).IsStreamable())
+                {
+                    std::cout << std::format("  {}: not streamable, left to stb_image\n", fileName);
+                    continue;
+                }
+
+                std::vector<uint8_t> streamed;
+                auto const streamMs = measureBestMs(PngDecodeIterations, [&]
+                {
+                    streamed = decodePngStreaming(fileName);
+                });
+
+                std::vector<uint8_t> reference;
+                auto const stbMs = measureBestMs(PngDecodeIterations, [&]
+                {
+                    reference = BasicTriangleApplication::decodeRgbaWithStb(fileName);
+                });
+
+                bool const match = streamed == reference;
+                bool const corruptRejected = isCorruptCopyRejected(fileName);
+                failed |= !match || !corruptRejected;
+
+                std::cout << std::format("  {}: streaming {:8.2f} ms, stb_image {:8.2f} ms, {:5.2f}x, {}, {}\n",
+                                         fileName, streamMs, stbMs, stbMs / streamMs,
+                                         match ? "identical" : "MISMATCH",
+                                         corruptRejected ? "corruption rejected" : "CORRUPTION ACCEPTED");
+            }
+            catch (std::exception const& e)
+            {
+                std::cerr << std::format("  {}: {}\n", fileName, e.what());
+                failed = true;
+            }
+        }
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // Shaders whose interface is known here, reflection has to report exactly this for them
+    std::vector<std::pair<std::string_view, ShaderInterface>> getExpectedShaderInterfaces()
+    {
+        std::vector<ShaderVertexInput> vertexInputs;
+        for (auto const& attribute : Vertex::getAttributeDescriptions())
+        {
+            vertexInputs.push_back({ attribute.location, attribute.format });
+        }
+
+        return {
+            {
+                "shader.vert.spv",
+                {
+                    vk::ShaderStageFlagBits::eVertex,
+                    { { 0, 0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex } },
+                    {},
+                    vertexInputs
+                }
+            },
+            {
+                "shader.frag.spv",
+                {
+                    vk::ShaderStageFlagBits::eFragment,
+                    { { 0, 1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment } },
+                    {},
+                    {},
+                    {
+                        { 0, SpecializationConstantType::eBool },
+                        { 1, SpecializationConstantType::eBool },
+                        { 2, SpecializationConstantType::eInt },
+                        { 3, SpecializationConstantType::eInt }
+                    }
+                }
+            },
+            {
+                "packed.frag.spv",
+                {
+                    vk::ShaderStageFlagBits::eFragment,
+                    { { 0, 2, vk::DescriptorType::eCombinedImageSampler, 16, vk::ShaderStageFlagBits::eFragment } },
+                    { { vk::ShaderStageFlagBits::eFragment, 0, sizeof(uint32_t) } },
+                    {}
+                }
+            }
+        };
+    }
+
+    // One line per item, so two interfaces compare equal exactly when their descriptions do
+    std::vector<std::string> describeShaderInterface(ShaderInterface const& shaderInterface)
+    {
+        std::vector<std::string> lines = { std::format("stages {}", vk::to_string(shaderInterface.stages)) };
+
+        for (auto const& binding : shaderInterface.bindings)
+        {
+            lines.push_back(std::format("set {} binding {}: {} x{}, {}", binding.set, binding.binding,
+                                        vk::to_string(binding.type), binding.count, vk::to_string(binding.stages)));
+        }
+        for (auto const& range : shaderInterface.pushConstantRanges)
+        {
+            lines.push_back(std::format("push constants {}+{}, {}", range.offset, range.size,
+                                        vk::to_string(range.stageFlags)));
+        }
+        for (auto const& input : shaderInterface.vertexInputs)
+        {
+            lines.push_back(std::format("vertex input {}: {}", input.location, vk::to_string(input.format)));
+        }
+        for (auto const& constant : shaderInterface.specializationConstants)
+        {
+            lines.push_back(std::format("specialization constant {}: type {}", constant.id,
+                                        static_cast<int>(constant.type)));
+        }
+
+        return lines;
+    }
+
+    int reflectionBenchmark()
+    {
+        std::vector<std::string> fileNames;
+        if (std::filesystem::is_directory(ShaderDirectory))
+        {
+            for (auto const& entry : std::filesystem::directory_iterator(ShaderDirectory))
+            {
+                if (entry.path().extension() == ".spv")
+                {
+                    fileNames.push_back(entry.path().string());
+                }
+            }
+        }
+
+        if (fileNames.empty())
+        {
+            std::cerr << std::format("No SPIR-V files found in {}, build the shaders first\n", ShaderDirectory);
+            return EXIT_FAILURE;
+        }
+
+        std::cout << std::format("Shader reflection benchmark, best of {} runs, checked against the expected "
+                                 "interfaces, {} corrupted copies of every shader only checked for not crashing\n",
+                                 ReflectionIterations, ReflectionCorruptCopies);
+
+        // Seeded so every run corrupts the same words
+        std::mt19937 random(1);
+        bool failed = false;
+
+        auto const expectedInterfaces = getExpectedShaderInterfaces();
+        for (auto const& [expectedFileName, expected] : expectedInterfaces)
+        {
+            if (std::ranges::none_of(fileNames, [&](std::string const& fileName)
+            {
+                return std::filesystem::path(fileName).filename() == expectedFileName;
+            }))
+            {
+                std::cerr << std::format("  {} is missing from {}\n", expectedFileName, ShaderDirectory);
+                failed = true;
+            }
+        }
+
+        for (auto const& fileName : fileNames)
+        {
+            try
+            {
+                auto const code = ReadShaderFile(fileName);
+
+                ShaderInterface shaderInterface;
+                auto const ms = measureBestMs(ReflectionIterations, [&] { shaderInterface = ReflectShader(code); });
+
+                auto const expected = std::ranges::find(expectedInterfaces,
+                                                        std::filesystem::path(fileName).filename().string(),
+                                                        [](auto const& entry) { return std::string(entry.first); });
+                if (expected != expectedInterfaces.end())
+                {
+                    auto const expectedLines = describeShaderInterface(expected->second);
+                    auto const actualLines = describeShaderInterface(shaderInterface);
+
+                    if (actualLines != expectedLines)
+                    {
+                        std::cerr << std::format("  {}: reflected interface doesn't match, expected\n", fileName);
+                        for (auto const& line : expectedLines)
+                        {
+                            std::cerr << std::format("    {}\n", line);
+                        }
+                        std::cerr << "  got\n";
+                        for (auto const& line : actualLines)
+                        {
+                            std::cerr << std::format("    {}\n", line);
+                        }
+                        failed = true;
+                    }
+                }
+
+                uint32_t rejected = 0;
+                for (int copy = 0; copy < ReflectionCorruptCopies; copy++)
+                {
+                    auto corrupt = code;
+                    auto const word = 5 + random() % (corrupt.size() - 5);
+                    switch (random() % 3)
+                    {
+                    case 0:
+                        corrupt.resize(word);
+                        break;
+                    case 1:
+                        corrupt[word] = random() % 64;
+                        break;
+                    default:
+                        corrupt[word] = static_cast<uint32_t>(random());
+                        break;
+                    }
+
+                    try
+                    {
+                        ReflectShader(corrupt);
+                    }
+                    catch (std::exception const&)
+                    {
+                        rejected++;
+                    }
+                }
+
+                // Copies that weren't rejected still formed modules the parser could read
+                std::cout << std::format("  {}: {:6.3f} ms, {} bindings, {} push constant ranges, {} vertex inputs, {} "
+                                         "specialization constants, {}, {} of {} corrupted copies rejected\n",
+                                         fileName, ms, shaderInterface.bindings.size(),
+                                         shaderInterface.pushConstantRanges.size(),
+                                         shaderInterface.vertexInputs.size(),
+                                         shaderInterface.specializationConstants.size(),
+                                         expected != expectedInterfaces.end() ? "checked" : "unchecked", rejected,
+                                         ReflectionCorruptCopies);
+            }
+            catch (std::exception const& e)
+            {
+                std::cerr << std::format("  {}: {}\n", fileName, e.what());
+                failed = true;
+            }
+        }
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // Benchmarks that need a Vulkan device run on an app of their own, which sets the device up without showing any
+    // frames
+    std::function<int()> onApp(int (BasicTriangleApplication::*benchmark)())
+    {
+        return [benchmark]
+        {
+            BasicTriangleApplication app(3, 2);
+            return (app.*benchmark)();
+        };
+    }
+
+    struct Benchmark
+    {
+        std::string_view name;
+        std::string_view description;
+        std::function<int()> run;
+    };
+
+    // Returns the process exit code
+    int runBenchmark(std::string_view name, std::function<int()> const& fn)
+    {
+        try
+        {
+            return fn();
+        }
+        catch (std::exception const& e)
+        {
+            std::cerr << std::format("The {} benchmark failed: {}", name, e.what()) << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+}
+
+int RunBenchmark(std::string_view name)
+{
+    // Built in here, the app's benchmark members are only visible to this function
+    std::array const benchmarks = {
+        Benchmark{ "ingest", "Scalar against SIMD texture ingest kernels on a 4K image", ingestBenchmark },
+        Benchmark{ "batch-decode", "Decode throughput of the batch texture loader as worker threads are added",
+                   batchDecodeBenchmark },
+        Benchmark{ "png-decode", "Streaming PNG decoder against stb_image, checking the output and corruption handling",
+                   pngDecodeBenchmark },
+        Benchmark{ "reflection", "SPIR-V reflection of every built shader, checking the main and packed shaders' "
+                   "interfaces and that corrupted copies don't crash it", reflectionBenchmark },
+        Benchmark{ "upload", "Texture upload latency through the staging buffer against VK_EXT_host_image_copy",
+                   onApp(&BasicTriangleApplication::runUploadBenchmark) },
+        Benchmark{ "descriptor-update", "Descriptor set writes per second through WriteDescriptorSets against an "
+                   "update template", onApp(&BasicTriangleApplication::runDescriptorUpdateBenchmark) },
+        Benchmark{ "pipeline-state", "Pipeline count and creation time of a many-material scene with static against "
+                   "extended dynamic state", onApp(&BasicTriangleApplication::runPipelineStateBenchmark) },
+        Benchmark{ "shader-objects", "Recording and frame time of draws that keep changing state with pipelines "
+                   "against VK_EXT_shader_object", onApp(&BasicTriangleApplication::runShaderObjectBenchmark) },
+        Benchmark{ "shader-variants", "Compile time of every specialization constant variant of the main shaders "
+                   "through the pipeline cache", onApp(&BasicTriangleApplication::runShaderVariantBenchmark) }
+    };
+
+    if (auto const benchmark = std::ranges::find(benchmarks, name, &Benchmark::name); benchmark != benchmarks.end())
+    {
+        return runBenchmark(benchmark->name, benchmark->run);
+    }
+
+    std::cerr << std::format("Unknown benchmark '{}', available benchmarks:\n", name);
+    for (auto const& benchmark : benchmarks)
+    {
+        std::cerr << std::format("  {:<18} {}\n", benchmark.name, benchmark.description);
+    }
+
+    return EXIT_FAILURE;
+}
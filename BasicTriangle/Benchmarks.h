@@ -0,0 +1,4 @@
+#pragma once
+
+// Runs the named benchmark and returns the process exit code, unknown names list the available benchmarks
+int RunBenchmark(std::string_view name);
@@ -0,0 +1,37 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform UniformBufferObject
+{
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// Every storage buffer of the bindless table, only the quad texture indices are read here
+layout(set = 1, binding = 1) readonly buffer QuadTextures
+{
+    uint textureIndices[];
+} storageBuffers[];
+
+layout(push_constant) uniform PushConstants
+{
+    uint quadTexturesIndex;
+} pushConstants;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in uint inLayer;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) flat out uint fragLayer;
+layout(location = 2) flat out uint fragTextureIndex;
+
+void main() 
+{
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    fragTexCoord = inTexCoord;
+    fragLayer = inLayer;
+    // Four vertices per quad
+    fragTextureIndex = storageBuffers[pushConstants.quadTexturesIndex].textureIndices[gl_VertexIndex / 4];
+}
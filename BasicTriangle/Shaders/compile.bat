@@ -1,3 +1,9 @@
-C:\VulkanSDK\1.3.261.1\Bin\glslc.exe shader.vert -o vert.spv
-C:\VulkanSDK\1.3.261.1\Bin\glslc.exe shader.frag -o frag.spv
-pause
\ No newline at end of file
+C:\VulkanSDK\1.3.261.1\Bin\glslc.exe shader.vert -o shader.vert.spv
+C:\VulkanSDK\1.3.261.1\Bin\glslc.exe shader.frag -o shader.frag.spv
+C:\VulkanSDK\1.3.261.1\Bin\glslc.exe mipmap.comp -o mipmap.comp.spv
+C:\VulkanSDK\1.3.261.1\Bin\glslc.exe packed.vert -o packed.vert.spv
+C:\VulkanSDK\1.3.261.1\Bin\glslc.exe packed.frag -o packed.frag.spv
+C:\VulkanSDK\1.3.261.1\Bin\glslc.exe bindless.vert -o bindless.vert.spv
+C:\VulkanSDK\1.3.261.1\Bin\glslc.exe bindless.frag -o bindless.frag.spv
+C:\VulkanSDK\1.3.261.1\Bin\glslc.exe fallback.frag -o fallback.frag.spv
+pause
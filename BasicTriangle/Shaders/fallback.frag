@@ -0,0 +1,12 @@
+#version 450
+
+// Stands in for materials whose pipeline is still compiling. Pairs with packed.vert and bindless.vert, which write
+// texture coordinates to location 0, shader.vert writes its color there instead.
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    bool light = (int(floor(fragTexCoord.x * 8.0)) + int(floor(fragTexCoord.y * 8.0))) % 2 == 0;
+    outColor = vec4(vec3(light ? 0.6 : 0.4), 1.0);
+}
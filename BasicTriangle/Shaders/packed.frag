@@ -0,0 +1,17 @@
+#version 450
+
+layout(binding = 2) uniform sampler2DArray textures[16];
+
+layout(push_constant) uniform PushConstants
+{
+    uint arrayIndex;
+} pushConstants;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) flat in uint fragLayer;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(textures[pushConstants.arrayIndex], vec3(fragTexCoord, fragLayer));
+}
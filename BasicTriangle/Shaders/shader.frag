@@ -1,9 +1,58 @@
 #version 450
 
+// Variants, set through MainShaderConstants in the app. Code the values turn off is removed when the pipeline is built.
+layout(constant_id = 0) const bool UseTexture = true;
+layout(constant_id = 1) const bool UseVertexColor = false;
+// 0 unlit, 1 Lambert, 2 half Lambert
+layout(constant_id = 2) const int LightingModel = 0;
+// Width of the box filter over the texture in texels, 1 samples once
+layout(constant_id = 3) const int FilterTaps = 1;
+
+const vec3 LightPosition = vec3(0.0, 0.0, 1.5);
+
+layout(binding = 1) uniform sampler2D texSampler;
+
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragWorldPosition;
+layout(location = 3) in vec3 fragNormal;
 
 layout(location = 0) out vec4 outColor;
 
+vec4 sampleTexture()
+{
+    if (FilterTaps <= 1)
+    {
+        return texture(texSampler, fragTexCoord);
+    }
+
+    vec2 texelSize = 1.0 / vec2(textureSize(texSampler, 0));
+    vec4 sum = vec4(0.0);
+    for (int y = 0; y < FilterTaps; y++)
+    {
+        for (int x = 0; x < FilterTaps; x++)
+        {
+            vec2 offset = vec2(x, y) - 0.5 * float(FilterTaps - 1);
+            sum += texture(texSampler, fragTexCoord + offset * texelSize);
+        }
+    }
+
+    return sum / float(FilterTaps * FilterTaps);
+}
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec4 color = UseTexture ? sampleTexture() : vec4(1.0);
+
+    if (UseVertexColor)
+    {
+        color.rgb *= fragColor;
+    }
+
+    if (LightingModel != 0)
+    {
+        float nDotL = dot(normalize(fragNormal), normalize(LightPosition - fragWorldPosition));
+        color.rgb *= LightingModel == 1 ? max(nDotL, 0.0) : nDotL * 0.5 + 0.5;
+    }
+
+    outColor = color;
 }
\ No newline at end of file
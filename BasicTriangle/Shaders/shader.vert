@@ -9,11 +9,21 @@ layout(binding = 0) uniform UniformBufferObject
 
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragWorldPosition;
+layout(location = 3) out vec3 fragNormal;
 
 void main() 
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    vec4 worldPosition = ubo.model * vec4(inPosition, 0.0, 1.0);
+
+    gl_Position = ubo.proj * ubo.view * worldPosition;
     fragColor = inColor;
+    fragTexCoord = inTexCoord;
+    fragWorldPosition = worldPosition.xyz;
+    // The quad lies in its xy plane
+    fragNormal = mat3(ubo.model) * vec3(0.0, 0.0, 1.0);
 }
\ No newline at end of file
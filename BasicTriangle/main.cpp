@@ -2,10 +2,65 @@
 
 #include <iostream>
 #include "BasicTriangleApplication.h"
+#include "Benchmarks.h"
 
-int main()
+int main(int argc, char* argv[])
 {
-    BasicTriangleApplication app(2);
+    std::vector<std::string_view> const args(argv + 1, argv + argc);
+
+    if (auto const benchmark = std::ranges::find(args, "--benchmark"); benchmark != args.end())
+    {
+        if (std::next(benchmark) == args.end())
+        {
+            std::cerr << "Usage: --benchmark <name>" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return RunBenchmark(*std::next(benchmark));
+    }
+
+    BasicTriangleApplication app(3, 2);
+
+    // --residency-scene [texture count] [--texture-budget-mib <MiB>], small budgets force constant eviction
+    if (auto const residencyScene = std::ranges::find(args, "--residency-scene"); residencyScene != args.end())
+    {
+        uint32_t textureCount = 256;
+        uint32_t budgetMiB = 32;
+
+        auto const parseNumber = [](std::string_view text, uint32_t& value)
+        {
+            return std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc{};
+        };
+
+        if (std::next(residencyScene) != args.end())
+        {
+            parseNumber(*std::next(residencyScene), textureCount);
+        }
+
+        if (auto const budget = std::ranges::find(args, "--texture-budget-mib");
+            budget != args.end() && std::next(budget) != args.end() && !parseNumber(*std::next(budget), budgetMiB))
+        {
+            std::cerr << "Usage: --texture-budget-mib <MiB>" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        app.enableResidencyScene(std::max(textureCount, 1u), static_cast<vk::DeviceSize>(budgetMiB) * 1024 * 1024);
+    }
+
+    if (std::ranges::find(args, "--bindless") != args.end())
+    {
+        app.enableBindless();
+    }
+
+    if (std::ranges::find(args, "--dynamic-state") != args.end())
+    {
+        app.enableDynamicState();
+    }
+
+    if (std::ranges::find(args, "--shader-objects") != args.end())
+    {
+        app.enableShaderObjects();
+    }
 
     try
     {
@@ -17,5 +72,5 @@ int main()
         return EXIT_FAILURE;
     }
 
-    EXIT_SUCCESS;
+    return EXIT_SUCCESS;
 }
\ No newline at end of file
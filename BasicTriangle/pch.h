@@ -10,8 +10,21 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <chrono>
+#include <format>
+#include <random>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <charconv>
+#include <span>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <ranges>
 #include <optional>
 #include <functional>
-#include <set>
\ No newline at end of file
+#include <set>
+#include <numeric>
+#include <unordered_set>
\ No newline at end of file
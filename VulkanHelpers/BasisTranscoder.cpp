@@ -0,0 +1,10 @@
+#include "pch.h"
+
+// Compiles the Basis Universal transcoder used by Ktx2Helpers. Zstd supercompressed UASTC would need zstd as well, so
+// it is left out.
+#if !__has_include(<transcoder/basisu_transcoder.cpp>)
+#error "Basis Universal is missing, clone https://github.com/BinomialLLC/basis_universal into C:/Source/Libs/basis_universal"
+#endif
+
+#define BASISD_SUPPORT_KTX2_ZSTD 0
+#include <transcoder/basisu_transcoder.cpp>
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "BatchImageDecoder.h"
+#include "ImageIngestHelpers.h"
+#include "PngStreamDecoder.h"
+
+BatchImageDecoder::BatchImageDecoder(
+    std::vector<std::string> fileNames,
+    uint32_t threadCount,
+    size_t maxBytesInFlight,
+    FallbackDecoder fallbackDecoder /*= {}*/
+)
+    : m_fileNames(std::move(fileNames)),
+      m_maxBytesInFlight(maxBytesInFlight),
+      m_fallbackDecoder(std::move(fallbackDecoder))
+{
+    auto const workerCount = std::clamp<size_t>(threadCount, 1, std::max<size_t>(m_fileNames.size(), 1));
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back(&BatchImageDecoder::workerMain, this);
+    }
+}
+
+BatchImageDecoder::~BatchImageDecoder()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_budgetReleased.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+std::optional<DecodedImage> BatchImageDecoder::Next()
+{
+    std::unique_lock lock(m_mutex);
+
+    if (m_imagesHandedOut == m_fileNames.size())
+    {
+        return std::nullopt;
+    }
+
+    m_imageReady.wait(lock, [this] { return !m_readyImages.empty(); });
+
+    auto image = std::move(m_readyImages.front());
+    m_readyImages.pop_front();
+    m_imagesHandedOut++;
+
+    return image;
+}
+
+void BatchImageDecoder::Release(DecodedImage&& image)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_bytesInFlight -= image.pixels.size();
+    }
+    m_budgetReleased.notify_all();
+
+    image.pixels = {};
+}
+
+BatchDecodeStats BatchImageDecoder::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+void BatchImageDecoder::workerMain()
+{
+    for (auto index = m_nextIndex++; index < m_fileNames.size(); index = m_nextIndex++)
+    {
+        auto image = decode(index);
+
+        {
+            std::lock_guard lock(m_mutex);
+            if (image.error.empty())
+            {
+                m_stats.imagesDecoded++;
+                m_stats.bytesDecoded += image.pixels.size();
+            }
+            m_readyImages.push_back(std::move(image));
+        }
+        m_imageReady.notify_one();
+    }
+}
+
+DecodedImage BatchImageDecoder::decode(size_t index)
+{
+    DecodedImage image{ index, m_fileNames[index] };
+    size_t reservedBytes = 0;
+
+    try
+    {
+        // Only the header is read before the image's bytes are reserved
+        PngStreamDecoder decoder(image.fileName);
+        image.width = decoder.GetWidth();
+        image.height = decoder.GetHeight();
+
+        auto const pixelCount = static_cast<size_t>(image.width) * image.height;
+        auto const imageBytes = pixelCount * 4;
+
+        {
+            std::unique_lock lock(m_mutex);
+            auto const waitStart = std::chrono::steady_clock::now();
+
+            m_budgetReleased.wait(lock, [&]
+            {
+                return m_stopping || m_bytesInFlight == 0 || m_bytesInFlight + imageBytes <= m_maxBytesInFlight;
+            });
+
+            if (m_stopping)
+            {
+                throw std::runtime_error("Decoding cancelled");
+            }
+
+            m_bytesInFlight += imageBytes;
+            reservedBytes = imageBytes;
+            m_stats.peakBytesInFlight = std::max(m_stats.peakBytesInFlight, m_bytesInFlight);
+            m_stats.budgetWaitMs +=
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+        }
+
+        image.pixels.resize(imageBytes);
+
+        if (decoder.IsStreamable())
+        {
+            decoder.ReadRows(image.pixels.data(), image.height, static_cast<size_t>(image.width) * 4, true);
+        }
+        else if (m_fallbackDecoder)
+        {
+            auto const rgba = m_fallbackDecoder(image.fileName);
+            if (rgba.size() != imageBytes)
+            {
+                throw std::runtime_error("Fallback decoder returned the wrong size");
+            }
+            SwizzleRgbaToBgra(rgba.data(), image.pixels.data(), pixelCount);
+        }
+        else
+        {
+            throw std::runtime_error("PNG can't be streamed and there is no fallback decoder");
+        }
+    }
+    catch (std::exception const& e)
+    {
+        image.error = e.what();
+        image.pixels = {};
+
+        if (reservedBytes > 0)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_bytesInFlight -= reservedBytes;
+            }
+            m_budgetReleased.notify_all();
+        }
+    }
+
+    return image;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+struct DecodedImage
+{
+    // Position in the list of files given to the decoder
+    size_t index = 0;
+    std::string fileName;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // BGRA8, empty when decoding failed
+    std::vector<uint8_t> pixels;
+    std::string error;
+};
+
+struct BatchDecodeStats
+{
+    size_t imagesDecoded = 0;
+    size_t bytesDecoded = 0;
+    size_t peakBytesInFlight = 0;
+    // Time workers spent waiting for decoded bytes to be released before they could start an image
+    double budgetWaitMs = 0.0;
+};
+
+// Decodes a list of PNGs on a pool of worker threads, handing images out in the order they finish so uploads can start
+// while the rest still decode. Decoded bytes count against a budget from the moment a worker starts an image until the
+// consumer releases it, which bounds peak memory however many files are queued. An image larger than the whole
+// budget is still decoded, alone.
+class BatchImageDecoder
+{
+public:
+    // Decodes a PNG the built-in streaming decoder can't handle, returns RGBA8 of the size in its header
+    using FallbackDecoder = std::function<std::vector<uint8_t>(std::string const& fileName)>;
+
+    BatchImageDecoder(std::vector<std::string> fileNames, uint32_t threadCount, size_t maxBytesInFlight,
+                      FallbackDecoder fallbackDecoder = {});
+    ~BatchImageDecoder();
+
+    BatchImageDecoder(BatchImageDecoder const&) = delete;
+    BatchImageDecoder& operator=(BatchImageDecoder const&) = delete;
+
+    // Blocks until the next image has been decoded, returns nullopt once every image was handed out
+    std::optional<DecodedImage> Next();
+
+    // Returns the image's bytes to the budget, every image from Next has to be released once it's been consumed
+    void Release(DecodedImage&& image);
+
+    BatchDecodeStats GetStats() const;
+
+private:
+    void workerMain();
+    DecodedImage decode(size_t index);
+
+    std::vector<std::string> m_fileNames;
+    size_t m_maxBytesInFlight;
+    FallbackDecoder m_fallbackDecoder;
+
+    std::atomic<size_t> m_nextIndex = 0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_budgetReleased;
+    std::condition_variable m_imageReady;
+    std::deque<DecodedImage> m_readyImages;
+    size_t m_bytesInFlight = 0;
+    size_t m_imagesHandedOut = 0;
+    bool m_stopping = false;
+    BatchDecodeStats m_stats;
+
+    std::vector<std::thread> m_workers;
+};
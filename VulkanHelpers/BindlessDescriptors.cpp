@@ -0,0 +1,245 @@
+#include "pch.h"
+#include "BindlessDescriptors.h"
+
+vk::PhysicalDeviceDescriptorIndexingFeatures GetBindlessFeatures()
+{
+    vk::PhysicalDeviceDescriptorIndexingFeatures features;
+    // Textures differ between the quads of one draw, so the index isn't dynamically uniform
+    features.shaderSampledImageArrayNonUniformIndexing = true;
+    features.descriptorBindingSampledImageUpdateAfterBind = true;
+    features.descriptorBindingStorageBufferUpdateAfterBind = true;
+    features.descriptorBindingUpdateUnusedWhilePending = true;
+    features.descriptorBindingPartiallyBound = true;
+    features.runtimeDescriptorArray = true;
+
+    return features;
+}
+
+bool SupportsBindlessDescriptors(vk::PhysicalDevice const& device)
+{
+    vk::PhysicalDeviceDescriptorIndexingFeatures supported;
+    vk::PhysicalDeviceFeatures2 features{ {}, &supported };
+    device.getFeatures2(&features);
+
+    return features.features.shaderStorageBufferArrayDynamicIndexing &&
+           supported.shaderSampledImageArrayNonUniformIndexing &&
+           supported.descriptorBindingSampledImageUpdateAfterBind &&
+           supported.descriptorBindingStorageBufferUpdateAfterBind &&
+           supported.descriptorBindingUpdateUnusedWhilePending &&
+           supported.descriptorBindingPartiallyBound &&
+           supported.runtimeDescriptorArray;
+}
+
+BindlessDescriptorTable::BindlessDescriptorTable(
+    vk::Device const& device,
+    vk::PhysicalDevice const& physicalDevice,
+    uint32_t maxTextures,
+    uint32_t maxStorageBuffers,
+    vk::ShaderStageFlags stages,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_pAllocator(pAllocator)
+{
+    vk::PhysicalDeviceDescriptorIndexingProperties limits;
+    vk::PhysicalDeviceProperties2 properties{ {}, &limits };
+    physicalDevice.getProperties2(&properties);
+
+    // Combined image samplers count against both the sampler and the sampled image limits
+    auto const textureCapacity = std::min({
+        maxTextures,
+        limits.maxDescriptorSetUpdateAfterBindSampledImages,
+        limits.maxDescriptorSetUpdateAfterBindSamplers,
+        limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        limits.maxPerStageDescriptorUpdateAfterBindSamplers
+    });
+    auto const storageBufferCapacity = std::min({
+        maxStorageBuffers,
+        limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers
+    });
+
+    // Whatever the storage buffers leave of the per stage budget goes to textures
+    auto const resourceCapacity = std::min(limits.maxPerStageUpdateAfterBindResources,
+                                           limits.maxUpdateAfterBindDescriptorsInAllPools);
+    if (storageBufferCapacity >= resourceCapacity)
+    {
+        throw std::runtime_error("The device has no room for bindless textures next to the storage buffers");
+    }
+
+    m_textureSlots = SlotAllocator(std::min(textureCapacity, resourceCapacity - storageBufferCapacity));
+    m_storageBufferSlots = SlotAllocator(storageBufferCapacity);
+
+    std::vector bindings = {
+        vk::DescriptorSetLayoutBinding
+        {
+            TextureBinding,
+            vk::DescriptorType::eCombinedImageSampler,
+            m_textureSlots.GetCapacity(),
+            stages
+        },
+        vk::DescriptorSetLayoutBinding
+        {
+            StorageBufferBinding,
+            vk::DescriptorType::eStorageBuffer,
+            m_storageBufferSlots.GetCapacity(),
+            stages
+        }
+    };
+
+    constexpr auto bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                  vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                                  vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    std::vector<vk::DescriptorBindingFlags> const bindingFlagsPerBinding(bindings.size(), bindingFlags);
+
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo const bindingFlagsInfo{ bindingFlagsPerBinding };
+
+    vk::DescriptorSetLayoutCreateInfo const layoutInfo{
+        vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+        bindings,
+        &bindingFlagsInfo
+    };
+
+    m_layout = m_device.createDescriptorSetLayout(layoutInfo, m_pAllocator);
+
+    std::vector poolSizes = {
+        vk::DescriptorPoolSize
+        {
+            vk::DescriptorType::eCombinedImageSampler,
+            m_textureSlots.GetCapacity()
+        },
+        vk::DescriptorPoolSize
+        {
+            vk::DescriptorType::eStorageBuffer,
+            m_storageBufferSlots.GetCapacity()
+        }
+    };
+
+    // The one set lives as long as the table, it's never freed on its own
+    vk::DescriptorPoolCreateInfo const poolInfo{
+        vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+        1,
+        poolSizes
+    };
+
+    m_pool = m_device.createDescriptorPool(poolInfo, m_pAllocator);
+
+    std::vector descriptorSetLayouts = { m_layout };
+    m_set = m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(m_pool, descriptorSetLayouts)).front();
+}
+
+BindlessIndex BindlessDescriptorTable::AddTexture(
+    vk::ImageView view,
+    vk::Sampler sampler,
+    vk::ImageLayout layout /*= vk::ImageLayout::eShaderReadOnlyOptimal*/
+)
+{
+    auto const index = m_textureSlots.Acquire();
+
+    vk::DescriptorImageInfo const imageInfo{ sampler, view, layout };
+    m_device.updateDescriptorSets(vk::WriteDescriptorSet(m_set, TextureBinding, index,
+                                                         vk::DescriptorType::eCombinedImageSampler, imageInfo), {});
+
+    return index;
+}
+
+BindlessIndex BindlessDescriptorTable::AddStorageBuffer(
+    vk::Buffer buffer,
+    vk::DeviceSize offset /*= 0*/,
+    vk::DeviceSize range /*= VK_WHOLE_SIZE*/
+)
+{
+    auto const index = m_storageBufferSlots.Acquire();
+
+    vk::DescriptorBufferInfo const bufferInfo{ buffer, offset, range };
+    m_device.updateDescriptorSets(vk::WriteDescriptorSet(m_set, StorageBufferBinding, index,
+                                                         vk::DescriptorType::eStorageBuffer, {}, bufferInfo), {});
+
+    return index;
+}
+
+void BindlessDescriptorTable::RemoveTexture(BindlessIndex index)
+{
+    // Partially bound, the stale descriptor can stay until the slot is written again
+    m_textureSlots.Release(index);
+}
+
+void BindlessDescriptorTable::RemoveStorageBuffer(BindlessIndex index)
+{
+    m_storageBufferSlots.Release(index);
+}
+
+vk::DescriptorSetLayout BindlessDescriptorTable::GetLayout() const
+{
+    return m_layout;
+}
+
+vk::DescriptorSet BindlessDescriptorTable::GetSet() const
+{
+    return m_set;
+}
+
+BindlessStats BindlessDescriptorTable::GetStats() const
+{
+    return {
+        m_textureSlots.GetCount(),
+        m_textureSlots.GetCapacity(),
+        m_storageBufferSlots.GetCount(),
+        m_storageBufferSlots.GetCapacity()
+    };
+}
+
+void BindlessDescriptorTable::Destroy()
+{
+    // The set goes with its pool
+    m_device.destroyDescriptorPool(m_pool, m_pAllocator);
+    m_device.destroyDescriptorSetLayout(m_layout, m_pAllocator);
+
+    m_pool = nullptr;
+    m_layout = nullptr;
+    m_set = nullptr;
+    m_textureSlots = {};
+    m_storageBufferSlots = {};
+}
+
+BindlessDescriptorTable::SlotAllocator::SlotAllocator(uint32_t capacity)
+    : m_capacity(capacity)
+{
+}
+
+BindlessIndex BindlessDescriptorTable::SlotAllocator::Acquire()
+{
+    if (!m_freeSlots.empty())
+    {
+        auto const index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        return index;
+    }
+
+    if (m_next == m_capacity)
+    {
+        throw std::runtime_error(std::format("Every one of the {} bindless slots is taken", m_capacity));
+    }
+
+    return m_next++;
+}
+
+void BindlessDescriptorTable::SlotAllocator::Release(BindlessIndex index)
+{
+    if (index >= m_next || std::ranges::find(m_freeSlots, index) != m_freeSlots.end())
+    {
+        throw std::runtime_error(std::format("Bindless slot {} isn't in use", index));
+    }
+
+    m_freeSlots.push_back(index);
+}
+
+uint32_t BindlessDescriptorTable::SlotAllocator::GetCount() const
+{
+    return m_next - static_cast<uint32_t>(m_freeSlots.size());
+}
+
+uint32_t BindlessDescriptorTable::SlotAllocator::GetCapacity() const
+{
+    return m_capacity;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// VK_EXT_descriptor_indexing and its dependency before Vulkan 1.2
+inline const std::vector BindlessExtensions = {
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+    VK_KHR_MAINTENANCE_3_EXTENSION_NAME
+};
+
+// The descriptor indexing features a bindless table relies on, chain it into device creation. Storage buffer arrays
+// are indexed dynamically too, which is the core shaderStorageBufferArrayDynamicIndexing feature.
+vk::PhysicalDeviceDescriptorIndexingFeatures GetBindlessFeatures();
+
+// Only call when the bindless extensions are supported
+bool SupportsBindlessDescriptors(vk::PhysicalDevice const& device);
+
+using BindlessIndex = uint32_t;
+
+struct BindlessStats
+{
+    uint32_t textureCount = 0;
+    uint32_t textureCapacity = 0;
+    uint32_t storageBufferCount = 0;
+    uint32_t storageBufferCapacity = 0;
+};
+
+// One descriptor set holding every texture and storage buffer in two large arrays, allocated once and bound once per
+// command buffer. Shaders reach resources by the index they were added at, passed in push constants or storage
+// buffers, so draws never switch descriptor sets and materials never allocate any.
+//
+// Both bindings are partially bound and update after bind, so resources can be added while earlier frames are still
+// executing as long as those frames don't read the slots being written. Textures are sampled as sampler2DArray, add
+// array views only.
+class BindlessDescriptorTable
+{
+public:
+    static constexpr uint32_t TextureBinding = 0;
+    static constexpr uint32_t StorageBufferBinding = 1;
+
+    BindlessDescriptorTable() = default;
+    // The capacities are clamped to the device's update after bind limits
+    BindlessDescriptorTable(vk::Device const& device, vk::PhysicalDevice const& physicalDevice, uint32_t maxTextures,
+                            uint32_t maxStorageBuffers, vk::ShaderStageFlags stages,
+                            vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    BindlessIndex AddTexture(vk::ImageView view, vk::Sampler sampler,
+                             vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+    BindlessIndex AddStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+
+    // The slot is handed out again by the next add, no submitted work may still read it
+    void RemoveTexture(BindlessIndex index);
+    void RemoveStorageBuffer(BindlessIndex index);
+
+    vk::DescriptorSetLayout GetLayout() const;
+    vk::DescriptorSet GetSet() const;
+    BindlessStats GetStats() const;
+
+    void Destroy();
+
+private:
+    class SlotAllocator
+    {
+    public:
+        SlotAllocator() = default;
+        explicit SlotAllocator(uint32_t capacity);
+
+        BindlessIndex Acquire();
+        void Release(BindlessIndex index);
+
+        uint32_t GetCount() const;
+        uint32_t GetCapacity() const;
+
+    private:
+        uint32_t m_capacity = 0;
+        // Slots below this have been handed out at least once
+        uint32_t m_next = 0;
+        std::vector<BindlessIndex> m_freeSlots;
+    };
+
+    vk::Device m_device;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    vk::DescriptorSetLayout m_layout;
+    vk::DescriptorPool m_pool;
+    vk::DescriptorSet m_set;
+
+    SlotAllocator m_textureSlots;
+    SlotAllocator m_storageBufferSlots;
+};
@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "DescriptorAllocator.h"
+
+DescriptorAllocator::DescriptorAllocator(
+    vk::Device const& device,
+    std::vector<DescriptorPoolRatio> ratios,
+    uint32_t initialSetsPerPool,
+    uint32_t maxSetsPerPool /*= 4096*/,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_ratios(std::move(ratios)),
+      m_setsPerPool(std::max(initialSetsPerPool, 1u)),
+      m_maxSetsPerPool(std::max(maxSetsPerPool, m_setsPerPool)),
+      m_pAllocator(pAllocator)
+{
+}
+
+vk::DescriptorSet DescriptorAllocator::Allocate(vk::DescriptorSetLayout layout)
+{
+    std::vector descriptorSetLayouts = { layout };
+
+    // A pool that's out of memory or too fragmented is done until the next reset, the set goes into a fresh one
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        try
+        {
+            auto const set = m_device.allocateDescriptorSets({ getPool(), descriptorSetLayouts }).front();
+            m_stats.setsSinceReset++;
+            m_stats.peakSetsPerReset = std::max(m_stats.peakSetsPerReset, m_stats.setsSinceReset);
+            m_stats.setsAllocated++;
+
+            return set;
+        }
+        catch (vk::OutOfPoolMemoryError const&)
+        {
+        }
+        catch (vk::FragmentedPoolError const&)
+        {
+        }
+
+        m_fullPools.push_back(m_readyPools.back());
+        m_readyPools.pop_back();
+        m_stats.fullPools++;
+    }
+
+    throw std::runtime_error("The descriptor set layout needs more descriptors than a whole pool holds");
+}
+
+void DescriptorAllocator::Reset()
+{
+    std::ranges::move(m_fullPools, std::back_inserter(m_readyPools));
+    m_fullPools.clear();
+
+    for (auto const pool : m_readyPools)
+    {
+        m_device.resetDescriptorPool(pool);
+    }
+
+    m_stats.fullPools = 0;
+    m_stats.setsSinceReset = 0;
+    m_stats.resets++;
+}
+
+DescriptorAllocatorStats DescriptorAllocator::GetStats() const
+{
+    return m_stats;
+}
+
+void DescriptorAllocator::Destroy()
+{
+    for (auto const pool : m_readyPools)
+    {
+        m_device.destroyDescriptorPool(pool, m_pAllocator);
+    }
+    for (auto const pool : m_fullPools)
+    {
+        m_device.destroyDescriptorPool(pool, m_pAllocator);
+    }
+
+    m_readyPools.clear();
+    m_fullPools.clear();
+    m_stats = {};
+}
+
+vk::DescriptorPool DescriptorAllocator::getPool()
+{
+    if (m_readyPools.empty())
+    {
+        m_readyPools.push_back(createPool(m_setsPerPool));
+        m_stats.poolCount++;
+        m_stats.setCapacity += m_setsPerPool;
+
+        // Allocators that needed one more pool are likely to need more
+        m_setsPerPool = std::min(m_setsPerPool + m_setsPerPool / 2 + 1, m_maxSetsPerPool);
+    }
+
+    return m_readyPools.back();
+}
+
+vk::DescriptorPool DescriptorAllocator::createPool(uint32_t setCount) const
+{
+    std::vector<vk::DescriptorPoolSize> poolSizes;
+    for (auto const& [type, descriptorsPerSet] : m_ratios)
+    {
+        poolSizes.emplace_back(type, static_cast<uint32_t>(std::ceil(descriptorsPerSet * static_cast<float>(setCount))));
+    }
+
+    // No free descriptor set flag, sets only ever go back with the whole pool
+    vk::DescriptorPoolCreateInfo const poolInfo{
+        {},
+        setCount,
+        poolSizes
+    };
+
+    return m_device.createDescriptorPool(poolInfo, m_pAllocator);
+}
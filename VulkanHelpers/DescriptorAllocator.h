@@ -0,0 +1,60 @@
+#pragma once
+
+// How many descriptors of a type each pool holds per set it's sized for
+struct DescriptorPoolRatio
+{
+    vk::DescriptorType type;
+    float descriptorsPerSet;
+};
+
+struct DescriptorAllocatorStats
+{
+    uint32_t poolCount = 0;
+    // Sets all pools together can hold
+    uint32_t setCapacity = 0;
+    // Pools that ran out since the last reset
+    uint32_t fullPools = 0;
+    uint32_t setsSinceReset = 0;
+    uint32_t peakSetsPerReset = 0;
+    uint64_t setsAllocated = 0;
+    uint64_t resets = 0;
+};
+
+// Allocates descriptor sets from a chain of pools, a new pool is created whenever the current one runs out so any mix
+// of layouts and set counts fits. Each new pool holds more sets than the last, up to maxSetsPerPool, and the pool
+// sizes follow the ratios.
+//
+// Sets are never freed on their own. Reset returns every set at once by resetting the pools, which costs the same no
+// matter how many sets were allocated, so one allocator per frame in flight can be reset as soon as its fence
+// signals. The pools are kept for the next frame.
+class DescriptorAllocator
+{
+public:
+    DescriptorAllocator() = default;
+    DescriptorAllocator(vk::Device const& device, std::vector<DescriptorPoolRatio> ratios, uint32_t initialSetsPerPool,
+                        uint32_t maxSetsPerPool = 4096, vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    vk::DescriptorSet Allocate(vk::DescriptorSetLayout layout);
+
+    // Every set allocated so far is invalid afterwards, none of them may be used by pending work
+    void Reset();
+
+    DescriptorAllocatorStats GetStats() const;
+
+    void Destroy();
+
+private:
+    vk::DescriptorPool getPool();
+    vk::DescriptorPool createPool(uint32_t setCount) const;
+
+    vk::Device m_device;
+    std::vector<DescriptorPoolRatio> m_ratios;
+    uint32_t m_setsPerPool = 0;
+    uint32_t m_maxSetsPerPool = 0;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    // The back of the ready pools is the one allocated from
+    std::vector<vk::DescriptorPool> m_readyPools;
+    std::vector<vk::DescriptorPool> m_fullPools;
+    DescriptorAllocatorStats m_stats;
+};
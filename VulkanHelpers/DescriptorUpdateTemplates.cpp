@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "DescriptorUpdateTemplates.h"
+
+namespace
+{
+    size_t getDescriptorInfoSize(vk::DescriptorType type)
+    {
+        switch (type)
+        {
+        case vk::DescriptorType::eSampler:
+        case vk::DescriptorType::eCombinedImageSampler:
+        case vk::DescriptorType::eSampledImage:
+        case vk::DescriptorType::eStorageImage:
+        case vk::DescriptorType::eInputAttachment:
+            return sizeof(vk::DescriptorImageInfo);
+        case vk::DescriptorType::eUniformBuffer:
+        case vk::DescriptorType::eStorageBuffer:
+        case vk::DescriptorType::eUniformBufferDynamic:
+        case vk::DescriptorType::eStorageBufferDynamic:
+            return sizeof(vk::DescriptorBufferInfo);
+        case vk::DescriptorType::eUniformTexelBuffer:
+        case vk::DescriptorType::eStorageTexelBuffer:
+            return sizeof(vk::BufferView);
+        default:
+            throw std::runtime_error(std::format("Descriptor type {} has no default template stride",
+                                                 vk::to_string(type)));
+        }
+    }
+}
+
+vk::DescriptorUpdateTemplateEntry MakeDescriptorTemplateEntry(
+    uint32_t binding,
+    vk::DescriptorType type,
+    size_t offset,
+    uint32_t count /*= 1*/,
+    size_t stride /*= 0*/
+)
+{
+    return {
+        binding,
+        0,
+        count,
+        type,
+        offset,
+        stride ? stride : getDescriptorInfoSize(type)
+    };
+}
+
+vk::DescriptorUpdateTemplate CreateDescriptorUpdateTemplate(
+    vk::Device const& device,
+    vk::DescriptorSetLayout layout,
+    std::vector<vk::DescriptorUpdateTemplateEntry> const& entries,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+{
+    vk::DescriptorUpdateTemplateCreateInfo const templateInfo{
+        {},
+        entries,
+        vk::DescriptorUpdateTemplateType::eDescriptorSet,
+        layout
+    };
+
+    return device.createDescriptorUpdateTemplate(templateInfo, pAllocator);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Template entry for count descriptors of one binding, read from offset into the struct handed to each update. The
+// stride between array elements defaults to the size of the descriptor info the type takes.
+vk::DescriptorUpdateTemplateEntry MakeDescriptorTemplateEntry(uint32_t binding, vk::DescriptorType type, size_t offset,
+                                                              uint32_t count = 1, size_t stride = 0);
+
+// Creates the template once per set layout, every update is then a single call reading the descriptors straight out
+// of a packed struct instead of building WriteDescriptorSets
+vk::DescriptorUpdateTemplate CreateDescriptorUpdateTemplate(vk::Device const& device,
+                                                            vk::DescriptorSetLayout layout,
+                                                            std::vector<vk::DescriptorUpdateTemplateEntry> const& entries,
+                                                            vk::AllocationCallbacks const* pAllocator = nullptr);
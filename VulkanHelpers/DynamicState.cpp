@@ -0,0 +1,361 @@
+#include "pch.h"
+#include "DynamicState.h"
+#include "ExtensionHelpers.h"
+#include "PipelineCache.h"
+
+namespace
+{
+    // Pipelines with a dynamic but restricted topology accept every topology of the class they were built with
+    vk::PrimitiveTopology getTopologyClass(vk::PrimitiveTopology topology)
+    {
+        switch (topology)
+        {
+        case vk::PrimitiveTopology::ePointList:
+            return vk::PrimitiveTopology::ePointList;
+        case vk::PrimitiveTopology::eLineList:
+        case vk::PrimitiveTopology::eLineStrip:
+        case vk::PrimitiveTopology::eLineListWithAdjacency:
+        case vk::PrimitiveTopology::eLineStripWithAdjacency:
+            return vk::PrimitiveTopology::eLineList;
+        case vk::PrimitiveTopology::ePatchList:
+            return vk::PrimitiveTopology::ePatchList;
+        default:
+            return vk::PrimitiveTopology::eTriangleList;
+        }
+    }
+
+    // Every sample of up to 64
+    constexpr std::array<vk::SampleMask, 2> AllSamples = { ~0u, ~0u };
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetCullModeEXT(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode)
+{
+    if (!FnVkCmdSetCullModeEXT)
+    {
+        throw std::runtime_error("vkCmdSetCullModeEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetCullModeEXT(commandBuffer, cullMode);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetFrontFaceEXT(VkCommandBuffer commandBuffer, VkFrontFace frontFace)
+{
+    if (!FnVkCmdSetFrontFaceEXT)
+    {
+        throw std::runtime_error("vkCmdSetFrontFaceEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetFrontFaceEXT(commandBuffer, frontFace);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetPrimitiveTopologyEXT(VkCommandBuffer commandBuffer,
+                                                        VkPrimitiveTopology primitiveTopology)
+{
+    if (!FnVkCmdSetPrimitiveTopologyEXT)
+    {
+        throw std::runtime_error("vkCmdSetPrimitiveTopologyEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetPrimitiveTopologyEXT(commandBuffer, primitiveTopology);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthTestEnableEXT(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable)
+{
+    if (!FnVkCmdSetDepthTestEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetDepthTestEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetDepthTestEnableEXT(commandBuffer, depthTestEnable);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthWriteEnableEXT(VkCommandBuffer commandBuffer, VkBool32 depthWriteEnable)
+{
+    if (!FnVkCmdSetDepthWriteEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetDepthWriteEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetDepthWriteEnableEXT(commandBuffer, depthWriteEnable);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthCompareOpEXT(VkCommandBuffer commandBuffer, VkCompareOp depthCompareOp)
+{
+    if (!FnVkCmdSetDepthCompareOpEXT)
+    {
+        throw std::runtime_error("vkCmdSetDepthCompareOpEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetDepthCompareOpEXT(commandBuffer, depthCompareOp);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetColorBlendEnableEXT(VkCommandBuffer commandBuffer, uint32_t firstAttachment,
+                                                       uint32_t attachmentCount, const VkBool32* pColorBlendEnables)
+{
+    if (!FnVkCmdSetColorBlendEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetColorBlendEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetColorBlendEnableEXT(commandBuffer, firstAttachment, attachmentCount, pColorBlendEnables);
+}
+
+DynamicStateSupport GetDynamicStateSupport(vk::PhysicalDevice const& device)
+{
+    DynamicStateSupport support;
+
+    if (GetSupportedDeviceExtensions(device, ExtendedDynamicStateExtensions).size() ==
+        ExtendedDynamicStateExtensions.size())
+    {
+        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT supported;
+        vk::PhysicalDeviceFeatures2 features{ {}, &supported };
+        device.getFeatures2(&features);
+
+        support.extendedDynamicState = supported.extendedDynamicState;
+    }
+
+    if (GetSupportedDeviceExtensions(device, ExtendedDynamicState3Extensions).size() ==
+        ExtendedDynamicState3Extensions.size())
+    {
+        vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT supported;
+        vk::PhysicalDeviceFeatures2 features{ {}, &supported };
+        device.getFeatures2(&features);
+
+        vk::PhysicalDeviceExtendedDynamicState3PropertiesEXT limits;
+        vk::PhysicalDeviceProperties2 properties{ {}, &limits };
+        device.getProperties2(&properties);
+
+        support.colorBlendEnable = supported.extendedDynamicState3ColorBlendEnable;
+        support.unrestrictedTopology = support.extendedDynamicState && limits.dynamicPrimitiveTopologyUnrestricted;
+    }
+
+    return support;
+}
+
+bool LoadDynamicStateFunctions(vk::Device const& device, DynamicStateSupport const& support)
+{
+    if (support.extendedDynamicState)
+    {
+        FnVkCmdSetCullModeEXT = reinterpret_cast<PFN_vkCmdSetCullModeEXT>(device.getProcAddr("vkCmdSetCullModeEXT"));
+        FnVkCmdSetFrontFaceEXT = reinterpret_cast<PFN_vkCmdSetFrontFaceEXT>(device.getProcAddr("vkCmdSetFrontFaceEXT"));
+        FnVkCmdSetPrimitiveTopologyEXT = reinterpret_cast<PFN_vkCmdSetPrimitiveTopologyEXT>(device.getProcAddr("vkCmdSetPrimitiveTopologyEXT"));
+        FnVkCmdSetDepthTestEnableEXT = reinterpret_cast<PFN_vkCmdSetDepthTestEnableEXT>(device.getProcAddr("vkCmdSetDepthTestEnableEXT"));
+        FnVkCmdSetDepthWriteEnableEXT = reinterpret_cast<PFN_vkCmdSetDepthWriteEnableEXT>(device.getProcAddr("vkCmdSetDepthWriteEnableEXT"));
+        FnVkCmdSetDepthCompareOpEXT = reinterpret_cast<PFN_vkCmdSetDepthCompareOpEXT>(device.getProcAddr("vkCmdSetDepthCompareOpEXT"));
+
+        if (!FnVkCmdSetCullModeEXT || !FnVkCmdSetFrontFaceEXT || !FnVkCmdSetPrimitiveTopologyEXT ||
+            !FnVkCmdSetDepthTestEnableEXT || !FnVkCmdSetDepthWriteEnableEXT || !FnVkCmdSetDepthCompareOpEXT)
+        {
+            return false;
+        }
+    }
+
+    if (support.colorBlendEnable)
+    {
+        FnVkCmdSetColorBlendEnableEXT = reinterpret_cast<PFN_vkCmdSetColorBlendEnableEXT>(device.getProcAddr("vkCmdSetColorBlendEnableEXT"));
+
+        if (!FnVkCmdSetColorBlendEnableEXT)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<vk::DynamicState> GetDynamicStates(DynamicStateSupport const& support)
+{
+    std::vector dynamicStates = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor
+    };
+
+    if (support.extendedDynamicState)
+    {
+        dynamicStates.insert(dynamicStates.end(), {
+            vk::DynamicState::eCullModeEXT,
+            vk::DynamicState::eFrontFaceEXT,
+            vk::DynamicState::ePrimitiveTopologyEXT,
+            vk::DynamicState::eDepthTestEnableEXT,
+            vk::DynamicState::eDepthWriteEnableEXT,
+            vk::DynamicState::eDepthCompareOpEXT
+        });
+    }
+    if (support.colorBlendEnable)
+    {
+        dynamicStates.push_back(vk::DynamicState::eColorBlendEnableEXT);
+    }
+
+    return dynamicStates;
+}
+
+PipelineDesc GetPipelineKey(PipelineDesc const& desc, DynamicStateSupport const& support)
+{
+    auto key = desc;
+    PipelineDesc const defaults;
+
+    if (support.extendedDynamicState)
+    {
+        key.cullMode = defaults.cullMode;
+        key.frontFace = defaults.frontFace;
+        key.topology = support.unrestrictedTopology ? defaults.topology : getTopologyClass(desc.topology);
+        key.depthTest = defaults.depthTest;
+        key.depthWrite = defaults.depthWrite;
+        key.depthCompareOp = defaults.depthCompareOp;
+    }
+    if (support.colorBlendEnable)
+    {
+        // The factors and ops still apply whenever blending gets enabled
+        key.blend.blendEnable = defaults.blend.blendEnable;
+    }
+
+    return key;
+}
+
+DynamicStateRecorder::DynamicStateRecorder(DynamicStateSupport const& support)
+    : m_support(support)
+{
+}
+
+void DynamicStateRecorder::Begin(vk::CommandBuffer commandBuffer)
+{
+    m_commandBuffer = commandBuffer;
+    m_cullMode.reset();
+    m_frontFace.reset();
+    m_topology.reset();
+    m_depthTest.reset();
+    m_depthWrite.reset();
+    m_depthCompareOp.reset();
+    m_blendEnable.reset();
+    m_vertexInput.reset();
+    m_polygonMode.reset();
+    m_samples.reset();
+    m_blendEquation.reset();
+    m_colorWriteMask.reset();
+}
+
+template <typename T, typename Set>
+void DynamicStateRecorder::set(std::optional<T>& current, T const& value, Set const& recordSet)
+{
+    if (current == value)
+    {
+        m_stats.setsSkipped++;
+        return;
+    }
+
+    recordSet(value);
+    current = value;
+    m_stats.setsRecorded++;
+}
+
+void DynamicStateRecorder::Apply(PipelineDesc const& desc)
+{
+    if (m_support.extendedDynamicState)
+    {
+        set(m_cullMode, desc.cullMode, [this](vk::CullModeFlags cullMode)
+        {
+            m_commandBuffer.setCullModeEXT(cullMode);
+        });
+        set(m_frontFace, desc.frontFace, [this](vk::FrontFace frontFace)
+        {
+            m_commandBuffer.setFrontFaceEXT(frontFace);
+        });
+        set(m_topology, desc.topology, [this](vk::PrimitiveTopology topology)
+        {
+            m_commandBuffer.setPrimitiveTopologyEXT(topology);
+        });
+        set(m_depthTest, desc.depthTest, [this](bool depthTest)
+        {
+            m_commandBuffer.setDepthTestEnableEXT(depthTest);
+        });
+        set(m_depthWrite, desc.depthWrite, [this](bool depthWrite)
+        {
+            m_commandBuffer.setDepthWriteEnableEXT(depthWrite);
+        });
+        set(m_depthCompareOp, desc.depthCompareOp, [this](vk::CompareOp compareOp)
+        {
+            m_commandBuffer.setDepthCompareOpEXT(compareOp);
+        });
+    }
+
+    if (m_support.colorBlendEnable)
+    {
+        auto const attachmentCount = static_cast<uint32_t>(desc.renderTargets.colorFormats.size());
+        set(m_blendEnable, std::pair(static_cast<bool>(desc.blend.blendEnable), attachmentCount),
+            [this](std::pair<bool, uint32_t> const& blendEnable)
+            {
+                std::vector const enables(blendEnable.second, static_cast<vk::Bool32>(blendEnable.first));
+                m_commandBuffer.setColorBlendEnableEXT(0, enables);
+            });
+    }
+
+    if (m_support.shaderObject)
+    {
+        applyShaderObjectState(desc);
+    }
+}
+
+void DynamicStateRecorder::applyShaderObjectState(PipelineDesc const& desc)
+{
+    // Compared in place, copying the layout into a value for set on every draw would allocate
+    if (!m_vertexInput || m_vertexInput->first != desc.vertexBindings || m_vertexInput->second != desc.vertexAttributes)
+    {
+        std::vector<vk::VertexInputBindingDescription2EXT> bindings;
+        for (auto const& binding : desc.vertexBindings)
+        {
+            bindings.emplace_back(binding.binding, binding.stride, binding.inputRate, 1);
+        }
+
+        std::vector<vk::VertexInputAttributeDescription2EXT> attributes;
+        for (auto const& attribute : desc.vertexAttributes)
+        {
+            attributes.emplace_back(attribute.location, attribute.binding, attribute.format, attribute.offset);
+        }
+
+        m_commandBuffer.setVertexInputEXT(bindings, attributes);
+        m_vertexInput.emplace(desc.vertexBindings, desc.vertexAttributes);
+        m_stats.setsRecorded++;
+    }
+    else
+    {
+        m_stats.setsSkipped++;
+    }
+
+    set(m_polygonMode, desc.polygonMode, [this](vk::PolygonMode polygonMode)
+    {
+        m_commandBuffer.setPolygonModeEXT(polygonMode);
+    });
+    set(m_samples, desc.renderTargets.samples, [this](vk::SampleCountFlagBits samples)
+    {
+        m_commandBuffer.setRasterizationSamplesEXT(samples);
+        m_commandBuffer.setSampleMaskEXT(samples, AllSamples.data());
+    });
+
+    // Only read for attachments with blending enabled, set anyway so toggling the enable needs nothing else
+    auto const attachmentCount = static_cast<uint32_t>(desc.renderTargets.colorFormats.size());
+    vk::ColorBlendEquationEXT const blendEquation{
+        desc.blend.srcColorBlendFactor,
+        desc.blend.dstColorBlendFactor,
+        desc.blend.colorBlendOp,
+        desc.blend.srcAlphaBlendFactor,
+        desc.blend.dstAlphaBlendFactor,
+        desc.blend.alphaBlendOp
+    };
+    set(m_blendEquation, std::pair(blendEquation, attachmentCount),
+        [this](std::pair<vk::ColorBlendEquationEXT, uint32_t> const& equation)
+        {
+            std::vector const equations(equation.second, equation.first);
+            m_commandBuffer.setColorBlendEquationEXT(0, equations);
+        });
+    set(m_colorWriteMask, std::pair(desc.blend.colorWriteMask, attachmentCount),
+        [this](std::pair<vk::ColorComponentFlags, uint32_t> const& writeMask)
+        {
+            std::vector const writeMasks(writeMask.second, writeMask.first);
+            m_commandBuffer.setColorWriteMaskEXT(0, writeMasks);
+        });
+}
+
+DynamicStateRecorderStats DynamicStateRecorder::GetStats() const
+{
+    return m_stats;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+struct PipelineDesc;
+
+// Cull mode, front face, topology and depth state
+inline const std::vector ExtendedDynamicStateExtensions = {
+    VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME
+};
+
+// Only its color blend enable is used
+inline const std::vector ExtendedDynamicState3Extensions = {
+    VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME
+};
+
+inline PFN_vkCmdSetCullModeEXT          FnVkCmdSetCullModeEXT = nullptr;
+inline PFN_vkCmdSetFrontFaceEXT         FnVkCmdSetFrontFaceEXT = nullptr;
+inline PFN_vkCmdSetPrimitiveTopologyEXT FnVkCmdSetPrimitiveTopologyEXT = nullptr;
+inline PFN_vkCmdSetDepthTestEnableEXT   FnVkCmdSetDepthTestEnableEXT = nullptr;
+inline PFN_vkCmdSetDepthWriteEnableEXT  FnVkCmdSetDepthWriteEnableEXT = nullptr;
+inline PFN_vkCmdSetDepthCompareOpEXT    FnVkCmdSetDepthCompareOpEXT = nullptr;
+inline PFN_vkCmdSetColorBlendEnableEXT  FnVkCmdSetColorBlendEnableEXT = nullptr;
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetCullModeEXT(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetFrontFaceEXT(VkCommandBuffer commandBuffer, VkFrontFace frontFace);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetPrimitiveTopologyEXT(VkCommandBuffer commandBuffer,
+                                                        VkPrimitiveTopology primitiveTopology);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthTestEnableEXT(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthWriteEnableEXT(VkCommandBuffer commandBuffer, VkBool32 depthWriteEnable);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthCompareOpEXT(VkCommandBuffer commandBuffer, VkCompareOp depthCompareOp);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetColorBlendEnableEXT(VkCommandBuffer commandBuffer, uint32_t firstAttachment,
+                                                       uint32_t attachmentCount,
+                                                       const VkBool32* pColorBlendEnables);
+
+// Which parts of a PipelineDesc are set while recording instead of being baked into the pipeline
+struct DynamicStateSupport
+{
+    // Cull mode, front face, topology within its class and depth test, write and compare op
+    bool extendedDynamicState = false;
+    bool colorBlendEnable = false;
+    // Any topology, not just ones of the class the pipeline was built with
+    bool unrestrictedTopology = false;
+    // Vertex input, polygon mode, samples, blend equation and write mask, which only shader objects can set
+    bool shaderObject = false;
+};
+
+// VK_EXT_shader_object brings every one of the above with it, none of the dynamic state extensions has to be enabled
+inline constexpr DynamicStateSupport ShaderObjectDynamicState = { true, true, true, true };
+
+// What the device supports of the above. Extended dynamic state 2 is left out, none of its state is in PipelineDesc.
+DynamicStateSupport GetDynamicStateSupport(vk::PhysicalDevice const& device);
+
+// Has to be called after creating a device with the extensions and features of the support. The shader object state
+// is loaded with the rest of the extension by LoadShaderObjectFunctions.
+bool LoadDynamicStateFunctions(vk::Device const& device, DynamicStateSupport const& support);
+
+// Viewport and scissor plus whatever the support adds, the shader object state excepted
+std::vector<vk::DynamicState> GetDynamicStates(DynamicStateSupport const& support);
+
+// The description with every dynamic field reset, descriptions differing only in those share a pipeline
+PipelineDesc GetPipelineKey(PipelineDesc const& desc, DynamicStateSupport const& support);
+
+struct DynamicStateRecorderStats
+{
+    uint64_t setsRecorded = 0;
+    // Sets that would have repeated the state already set
+    uint64_t setsSkipped = 0;
+};
+
+// Records the dynamic fields of descriptions into a command buffer, leaving out every set that wouldn't change the
+// state. Only valid while every bound pipeline takes the same states dynamically, binding one with any of them baked
+// in resets them, which holds for all pipelines of one GraphicsPipelineCache and for shader objects.
+class DynamicStateRecorder
+{
+public:
+    DynamicStateRecorder() = default;
+    explicit DynamicStateRecorder(DynamicStateSupport const& support);
+
+    // Nothing is known about the state of a new command buffer
+    void Begin(vk::CommandBuffer commandBuffer);
+
+    // Does nothing for fields that aren't dynamic
+    void Apply(PipelineDesc const& desc);
+
+    DynamicStateRecorderStats GetStats() const;
+
+private:
+    // Records the set only when the value differs from the last one
+    template <typename T, typename Set>
+    void set(std::optional<T>& current, T const& value, Set const& recordSet);
+    void applyShaderObjectState(PipelineDesc const& desc);
+
+    DynamicStateSupport m_support;
+    vk::CommandBuffer m_commandBuffer;
+
+    std::optional<vk::CullModeFlags> m_cullMode;
+    std::optional<vk::FrontFace> m_frontFace;
+    std::optional<vk::PrimitiveTopology> m_topology;
+    std::optional<bool> m_depthTest;
+    std::optional<bool> m_depthWrite;
+    std::optional<vk::CompareOp> m_depthCompareOp;
+    // Enable and attachment count
+    std::optional<std::pair<bool, uint32_t>> m_blendEnable;
+    std::optional<std::pair<std::vector<vk::VertexInputBindingDescription>,
+                            std::vector<vk::VertexInputAttributeDescription>>> m_vertexInput;
+    std::optional<vk::PolygonMode> m_polygonMode;
+    std::optional<vk::SampleCountFlagBits> m_samples;
+    // Blend equation and write mask with the attachment count
+    std::optional<std::pair<vk::ColorBlendEquationEXT, uint32_t>> m_blendEquation;
+    std::optional<std::pair<vk::ColorComponentFlags, uint32_t>> m_colorWriteMask;
+
+    DynamicStateRecorderStats m_stats;
+};
@@ -34,4 +34,27 @@ bool AreRequiredExtensionsSupported(std::vector<const char*> const& requiredExte
                 });
         }
     );
-}
\ No newline at end of file
+}
+
+std::vector<const char*> GetSupportedDeviceExtensions(vk::PhysicalDevice const& device, std::vector<const char*> const& extensions)
+{
+    auto const supportedExtensions = device.enumerateDeviceExtensionProperties();
+
+    std::vector<const char*> result;
+    std::ranges::copy_if(
+        extensions,
+        std::back_inserter(result),
+        [&supportedExtensions](auto const& pExtension)
+        {
+            std::string extension(pExtension);
+            return std::ranges::any_of(
+                supportedExtensions,
+                [&extension](vk::ExtensionProperties const& supportedExtension)
+                {
+                    return extension == supportedExtension.extensionName;
+                });
+        }
+    );
+
+    return result;
+}
@@ -1,4 +1,5 @@
 #pragma once
 
 std::vector<const char*> GetRequiredExtensions(bool enableValidationLayers);
-bool AreRequiredExtensionsSupported(std::vector<const char*> const& requiredExtensions);
\ No newline at end of file
+bool AreRequiredExtensionsSupported(std::vector<const char*> const& requiredExtensions);
+std::vector<const char*> GetSupportedDeviceExtensions(vk::PhysicalDevice const& device, std::vector<const char*> const& extensions);
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "FramesInFlightController.h"
+
+namespace
+{
+    // Fraction of the frame the CPU may spend blocked on a fence before another frame in flight is worth it
+    constexpr double StallFractionThreshold = 0.25;
+    // Latency must be this far under target before growing, so the controller doesn't oscillate around it
+    constexpr double LatencyHeadroom = 0.75;
+}
+
+FramesInFlightController::FramesInFlightController(
+    size_t maxFramesInFlight,
+    size_t initialFramesInFlight,
+    FramePacingTarget target,
+    double targetLatencyMs,
+    size_t evaluationWindow /*= 120*/
+)
+    : m_maxFramesInFlight(std::max<size_t>(maxFramesInFlight, 1)),
+      m_framesInFlight(std::clamp<size_t>(initialFramesInFlight, 1, std::max<size_t>(maxFramesInFlight, 1))),
+      m_target(target),
+      m_targetLatencyMs(targetLatencyMs),
+      m_evaluationWindow(std::max<size_t>(evaluationWindow, 1))
+{
+}
+
+void FramesInFlightController::RecordFrame(double fenceWaitMs, double frameTimeMs)
+{
+    m_totalFenceWaitMs += fenceWaitMs;
+    m_totalFrameTimeMs += frameTimeMs;
+    m_frameSamples++;
+}
+
+void FramesInFlightController::RecordLatency(double latencyMs)
+{
+    m_totalLatencyMs += latencyMs;
+    m_latencySamples++;
+}
+
+std::optional<size_t> FramesInFlightController::Evaluate()
+{
+    if (m_frameSamples < m_evaluationWindow)
+    {
+        return std::nullopt;
+    }
+
+    auto const stats = GetStats();
+    resetWindow();
+
+    auto const stallFraction = stats.averageFrameTimeMs > 0.0
+                                   ? stats.averageFenceWaitMs / stats.averageFrameTimeMs
+                                   : 0.0;
+    bool const hasLatencyTarget = m_targetLatencyMs > 0.0;
+    bool const overLatency = hasLatencyTarget && stats.averageLatencyMs > m_targetLatencyMs;
+    bool const latencyHeadroom = !hasLatencyTarget || stats.averageLatencyMs < m_targetLatencyMs * LatencyHeadroom;
+
+    auto newFramesInFlight = m_framesInFlight;
+
+    switch (m_target)
+    {
+    case FramePacingTarget::eLatency:
+        // Every extra frame queued adds roughly a frame time of latency, so shed them first
+        if (overLatency && m_framesInFlight > 1)
+        {
+            newFramesInFlight--;
+        }
+        else if (latencyHeadroom && stallFraction > StallFractionThreshold && m_framesInFlight < m_maxFramesInFlight)
+        {
+            newFramesInFlight++;
+        }
+        break;
+    case FramePacingTarget::eThroughput:
+        // The latency target acts as a cap here, it is only enforced once it is exceeded
+        if (overLatency && m_framesInFlight > 1)
+        {
+            newFramesInFlight--;
+        }
+        else if (!overLatency && stallFraction > StallFractionThreshold && m_framesInFlight < m_maxFramesInFlight)
+        {
+            newFramesInFlight++;
+        }
+        break;
+    }
+
+    if (newFramesInFlight == m_framesInFlight)
+    {
+        return std::nullopt;
+    }
+
+    m_framesInFlight = newFramesInFlight;
+    return m_framesInFlight;
+}
+
+size_t FramesInFlightController::GetFramesInFlight() const
+{
+    return m_framesInFlight;
+}
+
+FramePacingStats FramesInFlightController::GetStats() const
+{
+    if (m_frameSamples == 0)
+    {
+        return {};
+    }
+
+    return {
+        m_totalFenceWaitMs / static_cast<double>(m_frameSamples),
+        m_totalFrameTimeMs / static_cast<double>(m_frameSamples),
+        m_latencySamples > 0 ? m_totalLatencyMs / static_cast<double>(m_latencySamples) : 0.0,
+        m_frameSamples
+    };
+}
+
+void FramesInFlightController::resetWindow()
+{
+    m_frameSamples = 0;
+    m_latencySamples = 0;
+    m_totalFenceWaitMs = 0.0;
+    m_totalFrameTimeMs = 0.0;
+    m_totalLatencyMs = 0.0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+enum class FramePacingTarget
+{
+    eLatency,
+    eThroughput
+};
+
+struct FramePacingStats
+{
+    double averageFenceWaitMs = 0.0;
+    double averageFrameTimeMs = 0.0;
+    double averageLatencyMs = 0.0;
+    size_t sampleCount = 0;
+};
+
+// Decides how many frames should be in flight from measured fence waits and the latency from sampling input to the
+// GPU finishing the frame.
+// It never touches Vulkan objects itself, the owner applies the advised count at a frame boundary.
+class FramesInFlightController
+{
+public:
+    FramesInFlightController(size_t maxFramesInFlight, size_t initialFramesInFlight, FramePacingTarget target,
+                             double targetLatencyMs, size_t evaluationWindow = 120);
+
+    void RecordFrame(double fenceWaitMs, double frameTimeMs);
+    // Frames complete out of step with the ones being recorded, so their latencies come in on their own
+    void RecordLatency(double latencyMs);
+
+    // Returns the new frame count once per evaluation window if a change is advised
+    std::optional<size_t> Evaluate();
+
+    size_t GetFramesInFlight() const;
+    FramePacingStats GetStats() const;
+
+private:
+    void resetWindow();
+
+    size_t m_maxFramesInFlight;
+    size_t m_framesInFlight;
+    FramePacingTarget m_target;
+    double m_targetLatencyMs;
+    size_t m_evaluationWindow;
+
+    size_t m_frameSamples = 0;
+    size_t m_latencySamples = 0;
+    double m_totalFenceWaitMs = 0.0;
+    double m_totalFrameTimeMs = 0.0;
+    double m_totalLatencyMs = 0.0;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+// boost::hash_combine, for cache keys made of several fields
+template <typename T>
+void hashCombine(size_t& seed, T const& value)
+{
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+template <typename Enum>
+void hashEnum(size_t& seed, Enum value)
+{
+    hashCombine(seed, static_cast<std::underlying_type_t<Enum>>(value));
+}
+
+template <typename Bits>
+void hashFlags(size_t& seed, vk::Flags<Bits> flags)
+{
+    hashCombine(seed, static_cast<typename vk::Flags<Bits>::MaskType>(flags));
+}
@@ -0,0 +1,279 @@
+#include "pch.h"
+#include "HostAllocator.h"
+
+namespace
+{
+    struct AllocationHeader
+    {
+        void* pBlock;
+        size_t size;
+        uint32_t sizeClass;
+        VkSystemAllocationScope scope;
+    };
+
+    constexpr uint32_t NoSizeClass = std::numeric_limits<uint32_t>::max();
+    // Block sizes include the header and worst case alignment padding
+    constexpr std::array<size_t, 7> SizeClasses = { 64, 128, 256, 512, 1024, 2048, 4096 };
+    // Caps how much memory a thread can hold onto after a burst of command allocations
+    constexpr size_t MaxCachedBlocksPerClass = 256;
+
+    // Pooled blocks are plain malloc blocks, so one freed on a different thread can simply join that thread's cache
+    struct ThreadBlockCache
+    {
+        std::array<std::vector<void*>, SizeClasses.size()> freeBlocks;
+
+        ~ThreadBlockCache()
+        {
+            for (auto const& blocks : freeBlocks)
+            {
+                for (auto const pBlock : blocks)
+                {
+                    std::free(pBlock);
+                }
+            }
+        }
+    };
+
+    thread_local ThreadBlockCache t_blockCache;
+
+    std::optional<uint32_t> findSizeClass(size_t blockSize)
+    {
+        for (uint32_t i = 0; i < SizeClasses.size(); i++)
+        {
+            if (blockSize <= SizeClasses[i])
+            {
+                return i;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    AllocationHeader* getHeader(void* pMemory)
+    {
+        return reinterpret_cast<AllocationHeader*>(static_cast<std::byte*>(pMemory) - sizeof(AllocationHeader));
+    }
+
+    std::string_view scopeName(size_t scope)
+    {
+        switch (static_cast<VkSystemAllocationScope>(scope))
+        {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+            return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+            return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:
+            return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:
+            return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:
+            return "instance";
+        default:
+            return "unknown";
+        }
+    }
+}
+
+HostAllocator::HostAllocator()
+    : m_callbacks(
+        this,
+        &allocationCallback,
+        &reallocationCallback,
+        &freeCallback,
+        &internalAllocationCallback,
+        &internalFreeCallback
+    )
+{
+}
+
+vk::AllocationCallbacks const& HostAllocator::GetCallbacks() const
+{
+    return m_callbacks;
+}
+
+HostAllocationStats HostAllocator::GetStats() const
+{
+    HostAllocationStats stats;
+
+    for (size_t i = 0; i < AllocationScopeCount; i++)
+    {
+        stats.allocationCounts[i] = m_allocationCounts[i];
+        stats.liveBytes[i] = m_liveBytes[i];
+    }
+
+    stats.pooledAllocations = m_pooledAllocations;
+    stats.currentBytes = m_currentBytes;
+    stats.peakBytes = m_peakBytes;
+    stats.internalBytes = m_internalBytes;
+
+    return stats;
+}
+
+void HostAllocator::LogStats(std::ostream& stream) const
+{
+    constexpr double KiB = 1024.0;
+
+    auto const stats = GetStats();
+
+    stream << std::format("Driver host memory: {:.1f} KiB live, {:.1f} KiB peak, {:.1f} KiB internal, {} pooled command allocations\n",
+                          static_cast<double>(stats.currentBytes) / KiB, static_cast<double>(stats.peakBytes) / KiB,
+                          static_cast<double>(stats.internalBytes) / KiB, stats.pooledAllocations);
+
+    for (size_t i = 0; i < AllocationScopeCount; i++)
+    {
+        stream << std::format("  {}: {} allocations, {:.1f} KiB live\n", scopeName(i), stats.allocationCounts[i],
+                              static_cast<double>(stats.liveBytes[i]) / KiB);
+    }
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::allocationCallback(void* pUserData, size_t size, size_t alignment,
+                                                              VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator*>(pUserData)->allocate(size, alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::reallocationCallback(void* pUserData, void* pOriginal, size_t size,
+                                                                size_t alignment, VkSystemAllocationScope scope)
+{
+    return static_cast<HostAllocator*>(pUserData)->reallocate(pOriginal, size, alignment, scope);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::freeCallback(void* pUserData, void* pMemory)
+{
+    static_cast<HostAllocator*>(pUserData)->release(pMemory);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalAllocationCallback(void* pUserData, size_t size,
+                                                                     VkInternalAllocationType /*type*/,
+                                                                     VkSystemAllocationScope /*scope*/)
+{
+    static_cast<HostAllocator*>(pUserData)->m_internalBytes += size;
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalFreeCallback(void* pUserData, size_t size,
+                                                               VkInternalAllocationType /*type*/,
+                                                               VkSystemAllocationScope /*scope*/)
+{
+    static_cast<HostAllocator*>(pUserData)->m_internalBytes -= size;
+}
+
+void* HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (size == 0)
+    {
+        return nullptr;
+    }
+
+    alignment = std::max(alignment, alignof(AllocationHeader));
+    auto const blockSize = size + sizeof(AllocationHeader) + alignment - 1;
+
+    void* pBlock = nullptr;
+    auto sizeClass = NoSizeClass;
+
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+    {
+        if (auto const pooledClass = findSizeClass(blockSize))
+        {
+            sizeClass = *pooledClass;
+
+            if (auto& freeBlocks = t_blockCache.freeBlocks[sizeClass]; !freeBlocks.empty())
+            {
+                pBlock = freeBlocks.back();
+                freeBlocks.pop_back();
+            }
+            else
+            {
+                pBlock = std::malloc(SizeClasses[sizeClass]);
+            }
+
+            m_pooledAllocations++;
+        }
+    }
+
+    if (sizeClass == NoSizeClass)
+    {
+        pBlock = std::malloc(blockSize);
+    }
+
+    if (!pBlock)
+    {
+        return nullptr;
+    }
+
+    // Vulkan guarantees alignment is a power of two
+    auto const address = reinterpret_cast<uintptr_t>(pBlock) + sizeof(AllocationHeader);
+    auto const pMemory = reinterpret_cast<void*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+
+    *getHeader(pMemory) = { pBlock, size, sizeClass, scope };
+
+    m_allocationCounts[scope]++;
+    m_liveBytes[scope] += size;
+    addBytes(size);
+
+    return pMemory;
+}
+
+void* HostAllocator::reallocate(void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    // The spec defines both edge cases: no original block is a plain allocation, and a size of zero frees the
+    // original block like pfnFree would and returns null. Returning it untouched would leak it, the driver drops
+    // the pointer either way.
+    if (!pOriginal)
+    {
+        return allocate(size, alignment, scope);
+    }
+
+    if (size == 0)
+    {
+        release(pOriginal);
+        return nullptr;
+    }
+
+    auto const originalSize = getHeader(pOriginal)->size;
+
+    // On failure the original allocation must be left untouched
+    auto const pMemory = allocate(size, alignment, scope);
+    if (!pMemory)
+    {
+        return nullptr;
+    }
+
+    memcpy(pMemory, pOriginal, std::min(originalSize, size));
+    release(pOriginal);
+
+    return pMemory;
+}
+
+void HostAllocator::release(void* pMemory)
+{
+    if (!pMemory)
+    {
+        return;
+    }
+
+    auto const header = *getHeader(pMemory);
+
+    m_liveBytes[header.scope] -= header.size;
+    m_currentBytes -= header.size;
+
+    if (header.sizeClass != NoSizeClass)
+    {
+        if (auto& freeBlocks = t_blockCache.freeBlocks[header.sizeClass]; freeBlocks.size() < MaxCachedBlocksPerClass)
+        {
+            freeBlocks.push_back(header.pBlock);
+            return;
+        }
+    }
+
+    std::free(header.pBlock);
+}
+
+void HostAllocator::addBytes(uint64_t size)
+{
+    auto const current = m_currentBytes += size;
+
+    auto peak = m_peakBytes.load();
+    while (current > peak && !m_peakBytes.compare_exchange_weak(peak, current))
+    {
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+constexpr size_t AllocationScopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+struct HostAllocationStats
+{
+    std::array<uint64_t, AllocationScopeCount> allocationCounts{};
+    std::array<uint64_t, AllocationScopeCount> liveBytes{};
+    uint64_t pooledAllocations = 0;
+    uint64_t currentBytes = 0;
+    uint64_t peakBytes = 0;
+    uint64_t internalBytes = 0;
+};
+
+// Host allocator handed to the driver through VkAllocationCallbacks, so its allocations can be counted.
+// Command scope allocations are short lived and frequent, so they are served from thread local size class pools.
+// The callbacks point back at this object, so it must outlive every Vulkan object created with them.
+class HostAllocator
+{
+public:
+    HostAllocator();
+    HostAllocator(HostAllocator const&) = delete;
+    HostAllocator& operator=(HostAllocator const&) = delete;
+
+    vk::AllocationCallbacks const& GetCallbacks() const;
+    HostAllocationStats GetStats() const;
+    void LogStats(std::ostream& stream) const;
+
+private:
+    static VKAPI_ATTR void* VKAPI_CALL allocationCallback(void* pUserData, size_t size, size_t alignment,
+                                                           VkSystemAllocationScope scope);
+    static VKAPI_ATTR void* VKAPI_CALL reallocationCallback(void* pUserData, void* pOriginal, size_t size,
+                                                             size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL freeCallback(void* pUserData, void* pMemory);
+    static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void* pUserData, size_t size,
+                                                                  VkInternalAllocationType type,
+                                                                  VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void* pUserData, size_t size, VkInternalAllocationType type,
+                                                           VkSystemAllocationScope scope);
+
+    void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void* reallocate(void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void release(void* pMemory);
+
+    void addBytes(uint64_t size);
+
+    vk::AllocationCallbacks m_callbacks;
+
+    std::array<std::atomic<uint64_t>, AllocationScopeCount> m_allocationCounts{};
+    std::array<std::atomic<uint64_t>, AllocationScopeCount> m_liveBytes{};
+    std::atomic<uint64_t> m_pooledAllocations = 0;
+    std::atomic<uint64_t> m_currentBytes = 0;
+    std::atomic<uint64_t> m_peakBytes = 0;
+    std::atomic<uint64_t> m_internalBytes = 0;
+};
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "HostImageCopy.h"
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCopyMemoryToImageEXT(VkDevice device,
+                                                      const VkCopyMemoryToImageInfoEXT* pCopyMemoryToImageInfo)
+{
+    if (!FnVkCopyMemoryToImageEXT)
+    {
+        throw std::runtime_error("vkCopyMemoryToImageEXT was called before it was loaded");
+    }
+
+    return FnVkCopyMemoryToImageEXT(device, pCopyMemoryToImageInfo);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkTransitionImageLayoutEXT(VkDevice device, uint32_t transitionCount,
+                                                          const VkHostImageLayoutTransitionInfoEXT* pTransitions)
+{
+    if (!FnVkTransitionImageLayoutEXT)
+    {
+        throw std::runtime_error("vkTransitionImageLayoutEXT was called before it was loaded");
+    }
+
+    return FnVkTransitionImageLayoutEXT(device, transitionCount, pTransitions);
+}
+
+bool LoadHostImageCopyFunctions(vk::Device const& device)
+{
+    FnVkCopyMemoryToImageEXT = reinterpret_cast<PFN_vkCopyMemoryToImageEXT>(device.getProcAddr("vkCopyMemoryToImageEXT"));
+    FnVkTransitionImageLayoutEXT = reinterpret_cast<PFN_vkTransitionImageLayoutEXT>(device.getProcAddr("vkTransitionImageLayoutEXT"));
+
+    return FnVkCopyMemoryToImageEXT && FnVkTransitionImageLayoutEXT;
+}
+
+std::vector<vk::ImageLayout> GetHostImageCopyDstLayouts(vk::PhysicalDevice const& device)
+{
+    vk::PhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeatures;
+    vk::PhysicalDeviceFeatures2 features{ {}, &hostImageCopyFeatures };
+    device.getFeatures2(&features);
+
+    if (!hostImageCopyFeatures.hostImageCopy)
+    {
+        return {};
+    }
+
+    // The first query only fills in the count
+    vk::PhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProperties;
+    vk::PhysicalDeviceProperties2 properties{ {}, &hostImageCopyProperties };
+    device.getProperties2(&properties);
+
+    std::vector<vk::ImageLayout> layouts(hostImageCopyProperties.copyDstLayoutCount);
+    hostImageCopyProperties.pCopyDstLayouts = layouts.data();
+    device.getProperties2(&properties);
+
+    layouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+    return layouts;
+}
+
+bool SupportsHostImageCopy(vk::PhysicalDevice const& device, vk::Format format, vk::ImageUsageFlags usage)
+{
+    vk::PhysicalDeviceImageFormatInfo2 const formatInfo{
+        format,
+        vk::ImageType::e2D,
+        vk::ImageTiling::eOptimal,
+        usage | vk::ImageUsageFlagBits::eHostTransferEXT
+    };
+
+    try
+    {
+        auto const properties = device.getImageFormatProperties2<vk::ImageFormatProperties2,
+                                                                 vk::HostImageCopyDevicePerformanceQueryEXT>(formatInfo);
+
+        // Some devices give up compression for images the host can write, rendering from those would cost more than
+        // the staging copy saves
+        return properties.get<vk::HostImageCopyDevicePerformanceQueryEXT>().optimalDeviceAccess;
+    }
+    catch (vk::FormatNotSupportedError const&)
+    {
+        return false;
+    }
+}
+
+void TransitionImageOnHost(vk::Device const& device, vk::Image image, vk::ImageLayout oldLayout,
+                           vk::ImageLayout newLayout, uint32_t mipLevels, uint32_t layerCount /*= 1*/)
+{
+    vk::HostImageLayoutTransitionInfoEXT const transition{
+        image,
+        oldLayout,
+        newLayout,
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, layerCount)
+    };
+
+    device.transitionImageLayoutEXT(transition);
+}
+
+void CopyToImageOnHost(vk::Device const& device, vk::Image image, vk::ImageLayout layout, uint32_t mipLevel,
+                       uint32_t width, uint32_t height, void const* pTexels, uint32_t arrayLayer /*= 0*/,
+                       vk::Offset2D offset /*= {}*/)
+{
+    // Zero row length and image height mean tightly packed
+    vk::MemoryToImageCopyEXT const region{
+        pTexels,
+        0,
+        0,
+        vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mipLevel, arrayLayer, 1),
+        vk::Offset3D(offset.x, offset.y, 0),
+        vk::Extent3D(width, height, 1)
+    };
+
+    device.copyMemoryToImageEXT(vk::CopyMemoryToImageInfoEXT({}, image, layout, region));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+inline PFN_vkCopyMemoryToImageEXT     FnVkCopyMemoryToImageEXT = nullptr;
+inline PFN_vkTransitionImageLayoutEXT FnVkTransitionImageLayoutEXT = nullptr;
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCopyMemoryToImageEXT(VkDevice device,
+                                                      const VkCopyMemoryToImageInfoEXT* pCopyMemoryToImageInfo);
+
+VKAPI_ATTR VkResult VKAPI_CALL vkTransitionImageLayoutEXT(VkDevice device, uint32_t transitionCount,
+                                                          const VkHostImageLayoutTransitionInfoEXT* pTransitions);
+
+// VK_EXT_host_image_copy and the extensions it depends on before Vulkan 1.3
+inline const std::vector HostImageCopyExtensions = {
+    VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME,
+    VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME,
+    VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME
+};
+
+bool LoadHostImageCopyFunctions(vk::Device const& device);
+
+// The layouts images can be in while the host copies into them, empty when the device has no host image copy.
+// Only call when VK_EXT_host_image_copy is supported.
+std::vector<vk::ImageLayout> GetHostImageCopyDstLayouts(vk::PhysicalDevice const& device);
+
+// True when optimally tiled images of the format can take the host transfer usage alongside the given usage without
+// the device having to access them any slower
+bool SupportsHostImageCopy(vk::PhysicalDevice const& device, vk::Format format, vk::ImageUsageFlags usage);
+
+// Host side layout transition of every level and layer, nothing is recorded or submitted. The image must not be in use.
+void TransitionImageOnHost(vk::Device const& device, vk::Image image, vk::ImageLayout oldLayout,
+                           vk::ImageLayout newLayout, uint32_t mipLevels, uint32_t layerCount = 1);
+
+// Copies tightly packed texels, or block rows for compressed formats, straight into a rectangle of one level and
+// layer. The level has to be in layout already, and the next queue submission sees the copy without any barrier.
+void CopyToImageOnHost(vk::Device const& device, vk::Image image, vk::ImageLayout layout, uint32_t mipLevel,
+                       uint32_t width, uint32_t height, void const* pTexels, uint32_t arrayLayer = 0,
+                       vk::Offset2D offset = {});
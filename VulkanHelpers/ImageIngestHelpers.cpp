@@ -0,0 +1,731 @@
+#include "pch.h"
+#include "ImageIngestHelpers.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define INGEST_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define INGEST_NEON 1
+#include <arm_neon.h>
+#endif
+
+// MSVC allows any intrinsic in any function, GCC and Clang need the instruction set enabled per function
+#if defined(INGEST_X86) && !defined(_MSC_VER)
+#define INGEST_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define INGEST_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define INGEST_TARGET_SSE41
+#define INGEST_TARGET_AVX2
+#endif
+
+namespace
+{
+    // Rows of the horizontally filtered image kept while filtering vertically, must exceed the longest kernel
+    constexpr size_t RowCacheSize = 8;
+    constexpr size_t LinearToSrgbTableSize = 4096;
+    constexpr float LinearToSrgbScale = LinearToSrgbTableSize - 1;
+    // Below this the filtered texel is treated as fully transparent and its colour as black
+    constexpr float MinAlpha = 1e-6f;
+
+    // Taps of a destination texel when halving an even size. Halving an odd size steps 2 + 1 / (size / 2) source
+    // texels per destination texel, which takes one more.
+    constexpr size_t BoxTapCount = 2;
+    constexpr size_t KaiserTapCount = 6;
+
+    // Windowed sinc cut off at the destination's Nyquist frequency, with a Kaiser window of radius 1.5 destination
+    // texels. x is in destination texels.
+    double kaiserWeight(double x)
+    {
+        constexpr double Pi = 3.14159265358979323846;
+        constexpr double Beta = 4.0;
+        constexpr double Radius = 1.5;
+
+        auto const besselI0 = [](double value)
+        {
+            double sum = 1.0;
+            double term = 1.0;
+            for (int k = 1; k < 32; k++)
+            {
+                term *= (value / (2.0 * k)) * (value / (2.0 * k));
+                sum += term;
+            }
+            return sum;
+        };
+
+        auto const ratio = x / Radius;
+        if (ratio * ratio >= 1.0)
+        {
+            return 0.0;
+        }
+
+        auto const sinc = x == 0.0 ? 1.0 : std::sin(Pi * x) / (Pi * x);
+        return sinc * besselI0(Beta * std::sqrt(1.0 - ratio * ratio)) / besselI0(Beta);
+    }
+
+    // One axis of the filter, destination texel i reads tapCount source texels from firstTaps[i] on, clamped to the
+    // edge, weighted by the tapCount weights starting at weights[i * tapCount]
+    struct AxisFilter
+    {
+        std::vector<int64_t> firstTaps;
+        std::vector<float> weights;
+    };
+
+    // Each destination texel covers srcSize / dstSize source texels, so odd sizes keep their last texel and stay
+    // centred rather than dropping it and shifting by half a texel
+    AxisFilter getAxisFilter(MipFilter filter, uint32_t srcSize, uint32_t dstSize, size_t tapCount)
+    {
+        auto const scale = static_cast<double>(srcSize) / static_cast<double>(dstSize);
+
+        AxisFilter axisFilter{ std::vector<int64_t>(dstSize), std::vector<float>(dstSize * tapCount) };
+        std::vector<double> weights(tapCount);
+
+        for (uint32_t dst = 0; dst < dstSize; dst++)
+        {
+            // In source texel coordinates, where texel i is centred on i
+            auto const centre = (static_cast<double>(dst) + 0.5) * scale - 0.5;
+            // Centred on the nearest source texel, which for even sizes is the usual 2 * dst - tapCount / 2 + 1
+            auto const firstTap = static_cast<int64_t>(std::floor(centre + 0.5)) - static_cast<int64_t>(tapCount / 2);
+
+            double total = 0.0;
+            for (size_t tap = 0; tap < tapCount; tap++)
+            {
+                auto const srcCentre = static_cast<double>(firstTap + static_cast<int64_t>(tap));
+                if (filter == MipFilter::eBox)
+                {
+                    // The part of the source texel inside the destination texel's footprint
+                    auto const overlap = std::min(srcCentre + 0.5, centre + scale / 2.0) -
+                                         std::max(srcCentre - 0.5, centre - scale / 2.0);
+                    weights[tap] = std::max(overlap, 0.0);
+                }
+                else
+                {
+                    weights[tap] = kaiserWeight((srcCentre - centre) / scale);
+                }
+                total += weights[tap];
+            }
+
+            axisFilter.firstTaps[dst] = firstTap;
+            for (size_t tap = 0; tap < tapCount; tap++)
+            {
+                axisFilter.weights[dst * tapCount + tap] = static_cast<float>(weights[tap] / total);
+            }
+        }
+
+        return axisFilter;
+    }
+
+    std::array<float, 256> const& getSrgbToLinearTable()
+    {
+        static auto const Table = []
+        {
+            std::array<float, 256> table{};
+            for (size_t i = 0; i < table.size(); i++)
+            {
+                auto const srgb = static_cast<double>(i) / 255.0;
+                table[i] = static_cast<float>(srgb <= 0.04045 ? srgb / 12.92 : std::pow((srgb + 0.055) / 1.055, 2.4));
+            }
+            return table;
+        }();
+
+        return Table;
+    }
+
+    std::array<uint8_t, LinearToSrgbTableSize> const& getLinearToSrgbTable()
+    {
+        static auto const Table = []
+        {
+            std::array<uint8_t, LinearToSrgbTableSize> table{};
+            for (size_t i = 0; i < table.size(); i++)
+            {
+                auto const linear = static_cast<double>(i) / (LinearToSrgbTableSize - 1);
+                auto const srgb = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+                table[i] = static_cast<uint8_t>(std::clamp(srgb * 255.0 + 0.5, 0.0, 255.0));
+            }
+            return table;
+        }();
+
+        return Table;
+    }
+
+    // Negative lobes can push alpha outside [0, 1] around hard edges
+    uint8_t encodeAlpha(float alpha)
+    {
+        return static_cast<uint8_t>(std::clamp(alpha, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Shared by every path so all of them produce identical bytes
+    uint8_t mulDiv255(uint32_t value, uint32_t factor)
+    {
+        auto const product = value * factor + 128;
+        return static_cast<uint8_t>((product + (product >> 8)) >> 8);
+    }
+
+    void swizzleScalar(uint8_t const* pSrc, uint8_t* pDst, size_t pixelCount, bool premultiplyAlpha)
+    {
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            auto const* pPixel = pSrc + i * 4;
+            uint8_t r = pPixel[0];
+            uint8_t g = pPixel[1];
+            uint8_t b = pPixel[2];
+            uint8_t const a = pPixel[3];
+
+            if (premultiplyAlpha)
+            {
+                r = mulDiv255(r, a);
+                g = mulDiv255(g, a);
+                b = mulDiv255(b, a);
+            }
+
+            auto* pOut = pDst + i * 4;
+            pOut[0] = b;
+            pOut[1] = g;
+            pOut[2] = r;
+            pOut[3] = a;
+        }
+    }
+
+#ifdef INGEST_X86
+    INGEST_TARGET_SSE41 __m128i premultiplySse41(__m128i pixels16, __m128i alphaMask, __m128i alphaOne)
+    {
+        auto const factors = _mm_or_si128(_mm_shuffle_epi8(pixels16, alphaMask), alphaOne);
+        auto const product = _mm_add_epi16(_mm_mullo_epi16(pixels16, factors), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+    }
+
+    INGEST_TARGET_SSE41 size_t swizzleSse41(uint8_t const* pSrc, uint8_t* pDst, size_t pixelCount, bool premultiplyAlpha)
+    {
+        auto const swizzleMask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        // Broadcasts each pixel's 16 bit alpha over its colour channels, the alpha channel itself is scaled by 255
+        auto const alphaMask = _mm_setr_epi8(6, 7, 6, 7, 6, 7, -128, -128, 14, 15, 14, 15, 14, 15, -128, -128);
+        auto const alphaOne = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+
+        size_t i = 0;
+        for (; i + 4 <= pixelCount; i += 4)
+        {
+            auto pixels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pSrc + i * 4));
+
+            if (premultiplyAlpha)
+            {
+                auto const low = premultiplySse41(_mm_cvtepu8_epi16(pixels), alphaMask, alphaOne);
+                auto const high = premultiplySse41(_mm_cvtepu8_epi16(_mm_srli_si128(pixels, 8)), alphaMask, alphaOne);
+                pixels = _mm_packus_epi16(low, high);
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i * 4), _mm_shuffle_epi8(pixels, swizzleMask));
+        }
+
+        return i;
+    }
+
+    INGEST_TARGET_AVX2 __m256i premultiplyAvx2(__m256i pixels16, __m256i alphaMask, __m256i alphaOne)
+    {
+        auto const factors = _mm256_or_si256(_mm256_shuffle_epi8(pixels16, alphaMask), alphaOne);
+        auto const product = _mm256_add_epi16(_mm256_mullo_epi16(pixels16, factors), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+    }
+
+    INGEST_TARGET_AVX2 size_t swizzleAvx2(uint8_t const* pSrc, uint8_t* pDst, size_t pixelCount, bool premultiplyAlpha)
+    {
+        auto const swizzleMask = _mm256_setr_epi8(
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        auto const alphaMask = _mm256_setr_epi8(
+            6, 7, 6, 7, 6, 7, -128, -128, 14, 15, 14, 15, 14, 15, -128, -128,
+            6, 7, 6, 7, 6, 7, -128, -128, 14, 15, 14, 15, 14, 15, -128, -128);
+        auto const alphaOne = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+
+        size_t i = 0;
+        for (; i + 8 <= pixelCount; i += 8)
+        {
+            auto pixels = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(pSrc + i * 4));
+
+            if (premultiplyAlpha)
+            {
+                auto const low = premultiplyAvx2(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(pixels)), alphaMask, alphaOne);
+                auto const high = premultiplyAvx2(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(pixels, 1)), alphaMask, alphaOne);
+
+                // Packing works per 128 bit lane, which interleaves pairs of pixels from the two halves
+                pixels = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i * 4), _mm256_shuffle_epi8(pixels, swizzleMask));
+        }
+
+        return i;
+    }
+
+    SimdLevel detectSimdLevel()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        auto const maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool const sse41 = info[2] & (1 << 19);
+        bool const osXSave = info[2] & (1 << 27);
+        bool const avx = info[2] & (1 << 28);
+
+        bool avx2 = false;
+        // AVX registers are only usable when the OS saves them on context switches
+        if (maxLeaf >= 7 && osXSave && avx && (_xgetbv(0) & 0x6) == 0x6)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = info[1] & (1 << 5);
+        }
+#else
+        __builtin_cpu_init();
+        bool const sse41 = __builtin_cpu_supports("sse4.1");
+        bool const avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+        if (avx2)
+        {
+            return SimdLevel::eAvx2;
+        }
+
+        return sse41 ? SimdLevel::eSse41 : SimdLevel::eScalar;
+    }
+
+    // SSE2 is part of x64, so the float kernels need no dispatch
+    struct VectorOps
+    {
+        using Vec = __m128;
+
+        static Vec Zero() { return _mm_setzero_ps(); }
+        static Vec Load(float const* pValues) { return _mm_loadu_ps(pValues); }
+        static void Store(float* pValues, Vec value) { _mm_storeu_ps(pValues, value); }
+        static Vec MulAdd(Vec acc, Vec value, float weight) { return _mm_add_ps(acc, _mm_mul_ps(value, _mm_set1_ps(weight))); }
+
+        static Vec Decode(uint8_t const* pPixel, float const* pToLinear)
+        {
+            auto const colour = _mm_setr_ps(pToLinear[pPixel[0]], pToLinear[pPixel[1]], pToLinear[pPixel[2]], 1.0f);
+            return _mm_mul_ps(colour, _mm_set1_ps(pPixel[3] * (1.0f / 255.0f)));
+        }
+
+        static void Encode(Vec value, uint8_t* pPixel, uint8_t const* pToSrgb)
+        {
+            auto const alpha = _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3));
+            auto const colour = _mm_and_ps(_mm_div_ps(value, alpha), _mm_cmpgt_ps(alpha, _mm_set1_ps(MinAlpha)));
+            auto const clamped = _mm_min_ps(_mm_max_ps(colour, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+            auto const indices = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(LinearToSrgbScale)),
+                                                             _mm_set1_ps(0.5f)));
+
+            pPixel[0] = pToSrgb[_mm_cvtsi128_si32(indices)];
+            pPixel[1] = pToSrgb[_mm_extract_epi16(indices, 2)];
+            pPixel[2] = pToSrgb[_mm_extract_epi16(indices, 4)];
+            pPixel[3] = encodeAlpha(_mm_cvtss_f32(alpha));
+        }
+    };
+#elif defined(INGEST_NEON)
+    uint8x16_t mulDiv255Neon(uint8x16_t values, uint8x16_t factors)
+    {
+        auto const bias = vdupq_n_u16(128);
+        auto const low = vaddq_u16(vmull_u8(vget_low_u8(values), vget_low_u8(factors)), bias);
+        auto const high = vaddq_u16(vmull_high_u8(values, factors), bias);
+
+        return vcombine_u8(vshrn_n_u16(vaddq_u16(low, vshrq_n_u16(low, 8)), 8),
+                           vshrn_n_u16(vaddq_u16(high, vshrq_n_u16(high, 8)), 8));
+    }
+
+    size_t swizzleNeon(uint8_t const* pSrc, uint8_t* pDst, size_t pixelCount, bool premultiplyAlpha)
+    {
+        size_t i = 0;
+        for (; i + 16 <= pixelCount; i += 16)
+        {
+            // Deinterleaving loads split the channels into their own registers, so the swizzle is free
+            auto rgba = vld4q_u8(pSrc + i * 4);
+
+            if (premultiplyAlpha)
+            {
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    rgba.val[channel] = mulDiv255Neon(rgba.val[channel], rgba.val[3]);
+                }
+            }
+
+            uint8x16x4_t const bgra = { { rgba.val[2], rgba.val[1], rgba.val[0], rgba.val[3] } };
+            vst4q_u8(pDst + i * 4, bgra);
+        }
+
+        return i;
+    }
+
+    struct VectorOps
+    {
+        using Vec = float32x4_t;
+
+        static Vec Zero() { return vdupq_n_f32(0.0f); }
+        static Vec Load(float const* pValues) { return vld1q_f32(pValues); }
+        static void Store(float* pValues, Vec value) { vst1q_f32(pValues, value); }
+        static Vec MulAdd(Vec acc, Vec value, float weight) { return vmlaq_n_f32(acc, value, weight); }
+
+        static Vec Decode(uint8_t const* pPixel, float const* pToLinear)
+        {
+            float const colour[4] = { pToLinear[pPixel[0]], pToLinear[pPixel[1]], pToLinear[pPixel[2]], 1.0f };
+            return vmulq_n_f32(vld1q_f32(colour), pPixel[3] * (1.0f / 255.0f));
+        }
+
+        static void Encode(Vec value, uint8_t* pPixel, uint8_t const* pToSrgb)
+        {
+            auto const alpha = vgetq_lane_f32(value, 3);
+            auto const colour = alpha > MinAlpha ? vdivq_f32(value, vdupq_n_f32(alpha)) : vdupq_n_f32(0.0f);
+            auto const clamped = vminq_f32(vmaxq_f32(colour, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+            auto const indices = vcvtq_u32_f32(vmlaq_n_f32(vdupq_n_f32(0.5f), clamped, LinearToSrgbScale));
+
+            pPixel[0] = pToSrgb[vgetq_lane_u32(indices, 0)];
+            pPixel[1] = pToSrgb[vgetq_lane_u32(indices, 1)];
+            pPixel[2] = pToSrgb[vgetq_lane_u32(indices, 2)];
+            pPixel[3] = encodeAlpha(alpha);
+        }
+    };
+#endif
+
+    struct ScalarOps
+    {
+        struct Vec
+        {
+            float values[4];
+        };
+
+        static Vec Zero() { return {}; }
+
+        static Vec Load(float const* pValues)
+        {
+            return { { pValues[0], pValues[1], pValues[2], pValues[3] } };
+        }
+
+        static void Store(float* pValues, Vec value)
+        {
+            std::copy_n(value.values, 4, pValues);
+        }
+
+        static Vec MulAdd(Vec acc, Vec value, float weight)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                acc.values[i] += value.values[i] * weight;
+            }
+            return acc;
+        }
+
+        static Vec Decode(uint8_t const* pPixel, float const* pToLinear)
+        {
+            auto const alpha = pPixel[3] * (1.0f / 255.0f);
+            return { { pToLinear[pPixel[0]] * alpha, pToLinear[pPixel[1]] * alpha, pToLinear[pPixel[2]] * alpha, alpha } };
+        }
+
+        static void Encode(Vec value, uint8_t* pPixel, uint8_t const* pToSrgb)
+        {
+            auto const alpha = value.values[3];
+
+            for (int channel = 0; channel < 3; channel++)
+            {
+                auto const colour = alpha > MinAlpha ? value.values[channel] / alpha : 0.0f;
+                auto const linear = std::clamp(colour, 0.0f, 1.0f);
+                pPixel[channel] = pToSrgb[static_cast<size_t>(linear * LinearToSrgbScale + 0.5f)];
+            }
+            pPixel[3] = encodeAlpha(alpha);
+        }
+    };
+
+#if !defined(INGEST_X86) && !defined(INGEST_NEON)
+    using VectorOps = ScalarOps;
+#endif
+
+    uint32_t clampTap(int64_t index, uint32_t size)
+    {
+        return static_cast<uint32_t>(std::clamp<int64_t>(index, 0, static_cast<int64_t>(size) - 1));
+    }
+
+    // Separable filter: each needed source row is decoded to alpha weighted linear colour and filtered horizontally
+    // once into a small row cache, then each destination row combines cached rows vertically. The tap count is a
+    // template parameter so the inner loops unroll.
+    template <typename Ops, size_t TapCount>
+    void downsample(uint8_t const* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst, MipFilter filter)
+    {
+        static_assert(TapCount < RowCacheSize);
+
+        auto const dstWidth = std::max(srcWidth / 2, 1u);
+        auto const dstHeight = std::max(srcHeight / 2, 1u);
+        auto const* pToLinear = getSrgbToLinearTable().data();
+        auto const* pToSrgb = getLinearToSrgbTable().data();
+
+        auto const horizontal = getAxisFilter(filter, srcWidth, dstWidth, TapCount);
+        auto const vertical = getAxisFilter(filter, srcHeight, dstHeight, TapCount);
+
+        std::vector<float> decodedRow(static_cast<size_t>(srcWidth) * 4);
+        std::vector<float> rowCache(RowCacheSize * dstWidth * 4);
+        std::array<int64_t, RowCacheSize> cachedRows;
+        cachedRows.fill(-1);
+
+        auto const getFilteredRow = [&](uint32_t srcRow) -> float const*
+        {
+            auto* pRow = rowCache.data() + (srcRow % RowCacheSize) * dstWidth * 4;
+            if (cachedRows[srcRow % RowCacheSize] == srcRow)
+            {
+                return pRow;
+            }
+
+            auto const* pSrcRow = pSrc + static_cast<size_t>(srcRow) * srcWidth * 4;
+            for (uint32_t x = 0; x < srcWidth; x++)
+            {
+                Ops::Store(decodedRow.data() + x * 4, Ops::Decode(pSrcRow + x * 4, pToLinear));
+            }
+
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                auto acc = Ops::Zero();
+                auto const firstTap = horizontal.firstTaps[x];
+                auto const* pWeights = horizontal.weights.data() + x * TapCount;
+
+                for (size_t tap = 0; tap < TapCount; tap++)
+                {
+                    auto const srcX = clampTap(firstTap + static_cast<int64_t>(tap), srcWidth);
+                    acc = Ops::MulAdd(acc, Ops::Load(decodedRow.data() + srcX * 4), pWeights[tap]);
+                }
+
+                Ops::Store(pRow + x * 4, acc);
+            }
+
+            cachedRows[srcRow % RowCacheSize] = srcRow;
+            return pRow;
+        };
+
+        std::array<float const*, TapCount> tapRows;
+
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            auto const firstTap = vertical.firstTaps[y];
+            auto const* pWeights = vertical.weights.data() + y * TapCount;
+            for (size_t tap = 0; tap < TapCount; tap++)
+            {
+                tapRows[tap] = getFilteredRow(clampTap(firstTap + static_cast<int64_t>(tap), srcHeight));
+            }
+
+            auto* pDstRow = pDst + static_cast<size_t>(y) * dstWidth * 4;
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                auto acc = Ops::Zero();
+                for (size_t tap = 0; tap < TapCount; tap++)
+                {
+                    acc = Ops::MulAdd(acc, Ops::Load(tapRows[tap] + x * 4), pWeights[tap]);
+                }
+
+                Ops::Encode(acc, pDstRow + x * 4, pToSrgb);
+            }
+        }
+    }
+
+    template <typename Ops>
+    void downsample(uint8_t const* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst, MipFilter filter)
+    {
+        // Power of two sizes keep the shorter kernel, an even axis of an odd image just gets a zero weight tap
+        bool const odd = (srcWidth > 1 && srcWidth % 2 != 0) || (srcHeight > 1 && srcHeight % 2 != 0);
+
+        if (filter == MipFilter::eBox)
+        {
+            if (odd)
+            {
+                downsample<Ops, BoxTapCount + 1>(pSrc, srcWidth, srcHeight, pDst, filter);
+            }
+            else
+            {
+                downsample<Ops, BoxTapCount>(pSrc, srcWidth, srcHeight, pDst, filter);
+            }
+        }
+        else if (odd)
+        {
+            downsample<Ops, KaiserTapCount + 1>(pSrc, srcWidth, srcHeight, pDst, filter);
+        }
+        else
+        {
+            downsample<Ops, KaiserTapCount>(pSrc, srcWidth, srcHeight, pDst, filter);
+        }
+    }
+
+    void throwIfUnsupported(SimdLevel level)
+    {
+        if (!IsSimdLevelSupported(level))
+        {
+            throw std::runtime_error(std::format("{} is not supported by this CPU", ToString(level)));
+        }
+    }
+}
+
+std::string_view ToString(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::eScalar:
+        return "scalar";
+    case SimdLevel::eSse41:
+        return "SSE4.1";
+    case SimdLevel::eAvx2:
+        return "AVX2";
+    case SimdLevel::eNeon:
+        return "NEON";
+    }
+
+    return "unknown";
+}
+
+SimdLevel GetSimdLevel()
+{
+#ifdef INGEST_X86
+    static SimdLevel const Level = detectSimdLevel();
+    return Level;
+#elif defined(INGEST_NEON)
+    return SimdLevel::eNeon;
+#else
+    return SimdLevel::eScalar;
+#endif
+}
+
+bool IsSimdLevelSupported(SimdLevel level)
+{
+    auto const best = GetSimdLevel();
+
+    switch (level)
+    {
+    case SimdLevel::eScalar:
+        return true;
+    case SimdLevel::eSse41:
+    case SimdLevel::eAvx2:
+        return best != SimdLevel::eNeon && best >= level;
+    case SimdLevel::eNeon:
+        return best == SimdLevel::eNeon;
+    }
+
+    return false;
+}
+
+std::string_view ToString(MipFilter filter)
+{
+    switch (filter)
+    {
+    case MipFilter::eBox:
+        return "box";
+    case MipFilter::eKaiser:
+        return "Kaiser";
+    }
+
+    return "unknown";
+}
+
+std::vector<MipLevelLayout> GetMipChainLayout(uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+    std::vector<MipLevelLayout> levels;
+    size_t offset = 0;
+
+    for (uint32_t level = 0; level < mipLevels; level++)
+    {
+        levels.push_back({ offset, width, height });
+        offset += static_cast<size_t>(width) * height * 4;
+
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return levels;
+}
+
+size_t GetMipChainSize(uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+    auto const levels = GetMipChainLayout(width, height, mipLevels);
+    if (levels.empty())
+    {
+        return 0;
+    }
+
+    auto const& last = levels.back();
+    return last.offset + static_cast<size_t>(last.width) * last.height * 4;
+}
+
+void SwizzleRgbaToBgra(uint8_t const* pSrc, uint8_t* pDst, size_t pixelCount, bool premultiplyAlpha /*= false*/)
+{
+    SwizzleRgbaToBgra(pSrc, pDst, pixelCount, premultiplyAlpha, GetSimdLevel());
+}
+
+void SwizzleRgbaToBgra(uint8_t const* pSrc, uint8_t* pDst, size_t pixelCount, bool premultiplyAlpha, SimdLevel level)
+{
+    throwIfUnsupported(level);
+
+    size_t done = 0;
+
+    switch (level)
+    {
+#ifdef INGEST_X86
+    case SimdLevel::eAvx2:
+        done = swizzleAvx2(pSrc, pDst, pixelCount, premultiplyAlpha);
+        break;
+    case SimdLevel::eSse41:
+        done = swizzleSse41(pSrc, pDst, pixelCount, premultiplyAlpha);
+        break;
+#elif defined(INGEST_NEON)
+    case SimdLevel::eNeon:
+        done = swizzleNeon(pSrc, pDst, pixelCount, premultiplyAlpha);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    // Whatever doesn't fill a whole vector
+    swizzleScalar(pSrc + done * 4, pDst + done * 4, pixelCount - done, premultiplyAlpha);
+}
+
+void DownsampleSrgb(uint8_t const* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst, MipFilter filter)
+{
+    DownsampleSrgb(pSrc, srcWidth, srcHeight, pDst, filter, GetSimdLevel());
+}
+
+void DownsampleSrgb(uint8_t const* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst, MipFilter filter,
+                    SimdLevel level)
+{
+    throwIfUnsupported(level);
+
+    // The float kernels work on one RGBA texel per vector, which baseline SSE2 or NEON already covers
+    if (level == SimdLevel::eScalar)
+    {
+        downsample<ScalarOps>(pSrc, srcWidth, srcHeight, pDst, filter);
+    }
+    else
+    {
+        downsample<VectorOps>(pSrc, srcWidth, srcHeight, pDst, filter);
+    }
+}
+
+void WriteBgraMipChain(uint8_t const* pRgba, uint32_t width, uint32_t height, uint32_t mipLevels, MipFilter filter,
+                       uint8_t* pDst, bool premultiplyAlpha /*= false*/)
+{
+    auto const levels = GetMipChainLayout(width, height, mipLevels);
+    if (levels.empty())
+    {
+        return;
+    }
+
+    SwizzleRgbaToBgra(pRgba, pDst, static_cast<size_t>(width) * height, premultiplyAlpha);
+
+    std::vector<uint8_t> previous;
+    std::vector<uint8_t> current;
+    auto const* pSource = pRgba;
+
+    for (size_t level = 1; level < levels.size(); level++)
+    {
+        auto const& source = levels[level - 1];
+        auto const& target = levels[level];
+        auto const pixelCount = static_cast<size_t>(target.width) * target.height;
+
+        current.resize(pixelCount * 4);
+        DownsampleSrgb(pSource, source.width, source.height, current.data(), filter);
+        SwizzleRgbaToBgra(current.data(), pDst + target.offset, pixelCount, premultiplyAlpha);
+
+        std::swap(previous, current);
+        pSource = previous.data();
+    }
+}
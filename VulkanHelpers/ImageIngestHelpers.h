@@ -0,0 +1,51 @@
+#pragma once
+
+enum class SimdLevel
+{
+    eScalar,
+    eSse41,
+    eAvx2,
+    eNeon
+};
+
+std::string_view ToString(SimdLevel level);
+
+// Best instruction set the running CPU supports, detected once
+SimdLevel GetSimdLevel();
+bool IsSimdLevelSupported(SimdLevel level);
+
+enum class MipFilter
+{
+    eBox,
+    eKaiser
+};
+
+std::string_view ToString(MipFilter filter);
+
+struct MipLevelLayout
+{
+    size_t offset;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Every level of a 4 byte per texel mip chain packed one after another, the last entry's end is the chain size
+std::vector<MipLevelLayout> GetMipChainLayout(uint32_t width, uint32_t height, uint32_t mipLevels);
+size_t GetMipChainSize(uint32_t width, uint32_t height, uint32_t mipLevels);
+
+// Converts RGBA8 pixels to BGRA8, optionally premultiplying colour by alpha. The destination is only written
+// sequentially and never read, so it can be write-combined mapped memory.
+void SwizzleRgbaToBgra(uint8_t const* pSrc, uint8_t* pDst, size_t pixelCount, bool premultiplyAlpha = false);
+void SwizzleRgbaToBgra(uint8_t const* pSrc, uint8_t* pDst, size_t pixelCount, bool premultiplyAlpha, SimdLevel level);
+
+// Halves an sRGB image with 4 channels of 8 bits. Colour is filtered in linear space weighted by alpha so transparent
+// texels don't bleed, alpha is filtered as is. The destination is max(size / 2, 1) in each dimension, an odd size
+// is filtered over all of its texels with one more tap.
+void DownsampleSrgb(uint8_t const* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst, MipFilter filter);
+void DownsampleSrgb(uint8_t const* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst, MipFilter filter,
+                    SimdLevel level);
+
+// Writes level 0 and mipLevels - 1 downsampled levels as BGRA8 following GetMipChainLayout. Levels are filtered in
+// cached scratch memory and only the final swizzle touches pDst, so pDst can be mapped staging memory.
+void WriteBgraMipChain(uint8_t const* pRgba, uint32_t width, uint32_t height, uint32_t mipLevels, MipFilter filter,
+                       uint8_t* pDst, bool premultiplyAlpha = false);
@@ -0,0 +1,443 @@
+#include "pch.h"
+#include "Inflater.h"
+
+namespace
+{
+    constexpr uint32_t MaxCodeLength = 15;
+
+    constexpr uint32_t AdlerModulus = 65521;
+    // The most bytes the Adler-32 sums can take before they have to be reduced to stay within 32 bits
+    constexpr uint32_t AdlerMaxPending = 5552;
+
+    constexpr std::array<uint16_t, 29> LengthBase = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    constexpr std::array<uint8_t, 29> LengthExtraBits = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    constexpr std::array<uint16_t, 30> DistanceBase = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+        6145, 8193, 12289, 16385, 24577
+    };
+    constexpr std::array<uint8_t, 30> DistanceExtraBits = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+    constexpr std::array<uint8_t, 19> CodeLengthOrder = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+    };
+
+    uint32_t reverseBits(uint32_t code, uint32_t length)
+    {
+        uint32_t reversed = 0;
+        for (uint32_t i = 0; i < length; i++)
+        {
+            reversed = reversed << 1 | (code >> i & 1);
+        }
+        return reversed;
+    }
+
+    [[noreturn]] void throwCorrupt()
+    {
+        throw std::runtime_error("Deflate stream is corrupt");
+    }
+}
+
+void Inflater::HuffmanTable::Build(uint8_t const* pLengths, size_t count, bool allowIncomplete)
+{
+    fast.fill(0);
+    counts.fill(0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        counts[pLengths[i]]++;
+    }
+    counts[0] = 0;
+
+    // Bit patterns left unused at each length, below zero there are more codes than patterns for them. A complete
+    // code uses them all up. Zlib accepts incomplete literal and distance codes of no symbols or a single one bit
+    // code, so encoders write those, any other incomplete code is corrupt.
+    int32_t left = 1;
+    for (uint32_t length = 1; length <= MaxCodeLength; length++)
+    {
+        left = (left << 1) - counts[length];
+        if (left < 0)
+        {
+            throwCorrupt();
+        }
+    }
+
+    bool const singleCode = counts[1] <= 1 && std::all_of(counts.begin() + 2, counts.end(),
+                                                           [](uint16_t lengthCount) { return lengthCount == 0; });
+    if (left > 0 && !(allowIncomplete && singleCode))
+    {
+        throwCorrupt();
+    }
+
+    // Symbols sorted by code length then value, the order canonical codes are assigned in
+    std::array<uint16_t, MaxCodeLength + 2> offsets{};
+    for (uint32_t length = 1; length <= MaxCodeLength; length++)
+    {
+        offsets[length + 1] = offsets[length] + counts[length];
+    }
+
+    std::array<uint32_t, MaxCodeLength + 1> nextCode{};
+    uint32_t code = 0;
+    for (uint32_t length = 1; length <= MaxCodeLength; length++)
+    {
+        code = (code + counts[length - 1]) << 1;
+        nextCode[length] = code;
+    }
+
+    for (size_t symbol = 0; symbol < count; symbol++)
+    {
+        auto const length = pLengths[symbol];
+        if (length == 0)
+        {
+            continue;
+        }
+
+        symbols[offsets[length]++] = static_cast<uint16_t>(symbol);
+
+        auto const symbolCode = nextCode[length]++;
+        if (length > FastBits)
+        {
+            continue;
+        }
+
+        // Codes are stored most significant bit first, but the bit buffer is read from its low end
+        for (auto index = reverseBits(symbolCode, length); index < fast.size(); index += 1u << length)
+        {
+            fast[index] = static_cast<uint16_t>(length << 12 | symbol);
+        }
+    }
+}
+
+Inflater::Inflater(ChunkSource source)
+    : m_source(std::move(source)),
+      m_window(WindowSize)
+{
+}
+
+size_t Inflater::Read(uint8_t* pDst, size_t size)
+{
+    size_t written = 0;
+
+    auto const emit = [&](uint8_t value)
+    {
+        pDst[written++] = value;
+        m_window[m_windowPosition++ & (WindowSize - 1)] = value;
+
+        m_adlerA += value;
+        m_adlerB += m_adlerA;
+        if (++m_adlerPending == AdlerMaxPending)
+        {
+            m_adlerA %= AdlerModulus;
+            m_adlerB %= AdlerModulus;
+            m_adlerPending = 0;
+        }
+    };
+
+    while (written < size)
+    {
+        if (m_copyLength > 0)
+        {
+            auto const count = static_cast<uint32_t>(std::min<size_t>(m_copyLength, size - written));
+            for (uint32_t i = 0; i < count; i++)
+            {
+                emit(m_window[(m_windowPosition - m_copyDistance) & (WindowSize - 1)]);
+            }
+            m_copyLength -= count;
+            continue;
+        }
+
+        switch (m_state)
+        {
+        case State::eStreamHeader:
+        {
+            auto const method = readBits(8);
+            auto const flags = readBits(8);
+            if ((method & 0x0F) != 8 || (method << 8 | flags) % 31 != 0 || flags & 0x20)
+            {
+                throw std::runtime_error("Unsupported zlib stream");
+            }
+            m_state = State::eBlockHeader;
+            break;
+        }
+        case State::eBlockHeader:
+            if (m_finalBlock)
+            {
+                readChecksum();
+                m_state = State::eDone;
+                break;
+            }
+            readBlockHeader();
+            break;
+        case State::eStored:
+            if (m_storedRemaining == 0)
+            {
+                m_state = State::eBlockHeader;
+                break;
+            }
+            emit(static_cast<uint8_t>(readBits(8)));
+            m_storedRemaining--;
+            break;
+        case State::eCompressed:
+        {
+            auto const symbol = decodeSymbol(m_literalTable);
+            if (symbol < 256)
+            {
+                emit(static_cast<uint8_t>(symbol));
+                break;
+            }
+
+            if (symbol == 256)
+            {
+                m_state = State::eBlockHeader;
+                break;
+            }
+
+            auto const lengthIndex = symbol - 257;
+            if (lengthIndex >= LengthBase.size())
+            {
+                throwCorrupt();
+            }
+            m_copyLength = LengthBase[lengthIndex] + readBits(LengthExtraBits[lengthIndex]);
+
+            auto const distanceIndex = decodeSymbol(m_distanceTable);
+            if (distanceIndex >= DistanceBase.size())
+            {
+                throwCorrupt();
+            }
+            m_copyDistance = DistanceBase[distanceIndex] + readBits(DistanceExtraBits[distanceIndex]);
+
+            if (m_copyDistance > m_windowPosition)
+            {
+                throwCorrupt();
+            }
+            break;
+        }
+        case State::eDone:
+            return written;
+        }
+    }
+
+    return written;
+}
+
+void Inflater::Finish()
+{
+    std::array<uint8_t, 4096> discarded;
+    while (Read(discarded.data(), discarded.size()) == discarded.size())
+    {
+    }
+}
+
+void Inflater::refill()
+{
+    while (m_bitCount <= 56)
+    {
+        if (m_chunk.empty())
+        {
+            if (m_inputExhausted)
+            {
+                return;
+            }
+
+            m_chunk = m_source();
+            m_inputExhausted = m_chunk.empty();
+            continue;
+        }
+
+        m_bitBuffer |= static_cast<uint64_t>(m_chunk.front()) << m_bitCount;
+        m_bitCount += 8;
+        m_chunk = m_chunk.subspan(1);
+    }
+}
+
+uint32_t Inflater::peekBits(uint32_t count)
+{
+    if (m_bitCount < count)
+    {
+        refill();
+    }
+
+    // Past the end of the input the buffer reads as zeros, dropBits catches codes that actually use them
+    return static_cast<uint32_t>(m_bitBuffer & ((uint64_t{ 1 } << count) - 1));
+}
+
+void Inflater::dropBits(uint32_t count)
+{
+    if (count > m_bitCount)
+    {
+        throw std::runtime_error("Deflate stream is truncated");
+    }
+
+    m_bitBuffer >>= count;
+    m_bitCount -= count;
+}
+
+uint32_t Inflater::readBits(uint32_t count)
+{
+    auto const bits = peekBits(count);
+    dropBits(count);
+    return bits;
+}
+
+uint32_t Inflater::decodeSymbol(HuffmanTable const& table)
+{
+    if (auto const entry = table.fast[peekBits(FastBits)])
+    {
+        dropBits(entry >> 12);
+        return entry & 0xFFF;
+    }
+
+    // Longer codes are decoded canonically one bit at a time
+    auto const bits = peekBits(MaxCodeLength);
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+
+    for (uint32_t length = 1; length <= MaxCodeLength; length++)
+    {
+        code |= bits >> (length - 1) & 1;
+        int32_t const count = table.counts[length];
+
+        if (code - count < first)
+        {
+            dropBits(length);
+            return table.symbols[index + (code - first)];
+        }
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    throwCorrupt();
+}
+
+void Inflater::readBlockHeader()
+{
+    m_finalBlock = readBits(1);
+
+    switch (readBits(2))
+    {
+    case 0:
+    {
+        dropBits(m_bitCount % 8);
+        auto const length = readBits(16);
+        auto const inverseLength = readBits(16);
+        if ((length ^ 0xFFFF) != inverseLength)
+        {
+            throwCorrupt();
+        }
+
+        m_storedRemaining = length;
+        m_state = State::eStored;
+        break;
+    }
+    case 1:
+    {
+        std::array<uint8_t, 320> lengths{};
+        std::fill_n(lengths.begin(), 144, 8);
+        std::fill_n(lengths.begin() + 144, 112, 9);
+        std::fill_n(lengths.begin() + 256, 24, 7);
+        std::fill_n(lengths.begin() + 280, 8, 8);
+        std::fill_n(lengths.begin() + 288, 32, 5);
+
+        m_literalTable.Build(lengths.data(), 288, false);
+        m_distanceTable.Build(lengths.data() + 288, 32, false);
+        m_state = State::eCompressed;
+        break;
+    }
+    case 2:
+        readDynamicTables();
+        m_state = State::eCompressed;
+        break;
+    default:
+        throwCorrupt();
+    }
+}
+
+void Inflater::readDynamicTables()
+{
+    auto const literalCount = readBits(5) + 257;
+    auto const distanceCount = readBits(5) + 1;
+    auto const codeLengthCount = readBits(4) + 4;
+
+    std::array<uint8_t, CodeLengthOrder.size()> codeLengths{};
+    for (uint32_t i = 0; i < codeLengthCount; i++)
+    {
+        codeLengths[CodeLengthOrder[i]] = static_cast<uint8_t>(readBits(3));
+    }
+
+    HuffmanTable codeLengthTable;
+    codeLengthTable.Build(codeLengths.data(), codeLengths.size(), false);
+
+    std::array<uint8_t, 288 + 32> lengths{};
+    uint32_t count = 0;
+
+    while (count < literalCount + distanceCount)
+    {
+        auto const symbol = decodeSymbol(codeLengthTable);
+        if (symbol < 16)
+        {
+            lengths[count++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        uint8_t value = 0;
+        uint32_t repeat;
+
+        if (symbol == 16)
+        {
+            if (count == 0)
+            {
+                throwCorrupt();
+            }
+            value = lengths[count - 1];
+            repeat = 3 + readBits(2);
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + readBits(3);
+        }
+        else
+        {
+            repeat = 11 + readBits(7);
+        }
+
+        if (count + repeat > literalCount + distanceCount)
+        {
+            throwCorrupt();
+        }
+
+        std::fill_n(lengths.begin() + count, repeat, value);
+        count += repeat;
+    }
+
+    // Without an end of block code the block could never end
+    if (lengths[256] == 0)
+    {
+        throwCorrupt();
+    }
+
+    m_literalTable.Build(lengths.data(), literalCount, true);
+    m_distanceTable.Build(lengths.data() + literalCount, distanceCount, true);
+}
+
+void Inflater::readChecksum()
+{
+    // Big endian and byte aligned after the last block
+    dropBits(m_bitCount % 8);
+    uint32_t expected = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        expected = expected << 8 | readBits(8);
+    }
+
+    if (expected != ((m_adlerB % AdlerModulus) << 16 | (m_adlerA % AdlerModulus)))
+    {
+        throw std::runtime_error("Deflate stream fails its Adler-32 check");
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Streaming zlib/DEFLATE decoder. Compressed input is pulled from the source in whatever chunks it hands out and
+// output is produced on demand, so neither side ever has to be held in memory whole.
+class Inflater
+{
+public:
+    // Returns the next chunk of compressed input, an empty span once the input is exhausted
+    using ChunkSource = std::function<std::span<uint8_t const>()>;
+
+    explicit Inflater(ChunkSource source);
+
+    // Writes up to size bytes, fewer only when the stream ends, and returns how many were written. The stream's
+    // Adler-32 is checked once its last byte has been read.
+    size_t Read(uint8_t* pDst, size_t size);
+
+    // Reads on to the end of the stream so its checksum is checked, output nobody asked for is dropped
+    void Finish();
+
+private:
+    static constexpr uint32_t FastBits = 9;
+    static constexpr size_t WindowSize = 32768;
+
+    struct HuffmanTable
+    {
+        // Indexed by the next FastBits input bits, length << 12 | symbol, 0 when the code is longer
+        std::array<uint16_t, 1 << FastBits> fast{};
+        std::array<uint16_t, 16> counts{};
+        std::array<uint16_t, 288> symbols{};
+
+        // Throws on over-subscribed code lengths, and on incomplete ones unless incomplete is allowed
+        void Build(uint8_t const* pLengths, size_t count, bool allowIncomplete);
+    };
+
+    enum class State
+    {
+        eStreamHeader,
+        eBlockHeader,
+        eStored,
+        eCompressed,
+        eDone
+    };
+
+    void refill();
+    uint32_t peekBits(uint32_t count);
+    void dropBits(uint32_t count);
+    uint32_t readBits(uint32_t count);
+    uint32_t decodeSymbol(HuffmanTable const& table);
+
+    void readBlockHeader();
+    void readDynamicTables();
+    void readChecksum();
+
+    ChunkSource m_source;
+    std::span<uint8_t const> m_chunk;
+    bool m_inputExhausted = false;
+
+    uint64_t m_bitBuffer = 0;
+    uint32_t m_bitCount = 0;
+
+    State m_state = State::eStreamHeader;
+    bool m_finalBlock = false;
+    uint32_t m_storedRemaining = 0;
+
+    HuffmanTable m_literalTable;
+    HuffmanTable m_distanceTable;
+
+    // A back reference that didn't fit in the last read
+    uint32_t m_copyLength = 0;
+    uint32_t m_copyDistance = 0;
+
+    std::vector<uint8_t> m_window;
+    size_t m_windowPosition = 0;
+
+    // Adler-32 of the output so far, the sums are only reduced every so many bytes
+    uint32_t m_adlerA = 1;
+    uint32_t m_adlerB = 0;
+    uint32_t m_adlerPending = 0;
+};
@@ -0,0 +1,351 @@
+#include "pch.h"
+#include "Ktx2Helpers.h"
+#include "TextureHelpers.h"
+
+// Compiled by BasisTranscoder.cpp, which explains where the sources go when they're missing
+#define BASISD_SUPPORT_KTX2_ZSTD 0
+#include <transcoder/basisu_transcoder.h>
+
+namespace
+{
+    constexpr std::array<uint8_t, 12> Ktx2Identifier = {
+        0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+    };
+
+    enum class SupercompressionScheme : uint32_t
+    {
+        eNone = 0,
+        eBasisLz = 1,
+        eZstd = 2,
+        eZlib = 3
+    };
+
+    // Data format descriptor values from the Khronos Data Format specification
+    constexpr uint32_t DfdColorModelEtc1s = 163;
+    constexpr uint32_t DfdColorModelUastc = 166;
+    constexpr uint32_t DfdTransferSrgb = 2;
+
+    // The 64 bit supercompression global data fields sit at a 4 byte aligned offset in the file
+#pragma pack(push, 4)
+    struct Ktx2Header
+    {
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(Ktx2Header) == 68, "KTX2 header must match the file layout");
+
+    struct Ktx2LevelIndex
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    template <typename T>
+    T readValue(std::vector<uint8_t> const& fileData, size_t offset, std::string const& fileName)
+    {
+        if (offset + sizeof(T) > fileData.size())
+        {
+            throw std::runtime_error(std::format("KTX2 file {} is truncated", fileName));
+        }
+
+        T value;
+        memcpy(&value, fileData.data() + offset, sizeof(T));
+        return value;
+    }
+
+    std::vector<uint8_t> readFile(std::string const& fileName)
+    {
+        std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+
+        if (!file.is_open())
+        {
+            throw std::runtime_error(std::format("failed to open file: {}", fileName));
+        }
+
+        std::vector<uint8_t> fileData(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+
+        return fileData;
+    }
+
+    uint32_t getColorModel(std::vector<uint8_t> const& fileData, Ktx2Header const& header, std::string const& fileName)
+    {
+        if (header.dfdByteLength < 16)
+        {
+            return 0;
+        }
+
+        return readValue<uint32_t>(fileData, header.dfdByteOffset + 12, fileName) & 0xFF;
+    }
+
+    Ktx2Texture loadRawTexture(std::vector<uint8_t> const& fileData, Ktx2Header const& header,
+                               std::vector<Ktx2LevelIndex> const& levelIndices, vk::PhysicalDevice const& device,
+                               std::string const& fileName)
+    {
+        auto const format = static_cast<vk::Format>(header.vkFormat);
+
+        if (static_cast<SupercompressionScheme>(header.supercompressionScheme) != SupercompressionScheme::eNone)
+        {
+            throw std::runtime_error(std::format("KTX2 file {} uses unsupported supercompression scheme {}", fileName,
+                                                 header.supercompressionScheme));
+        }
+
+        if (!IsSampledTextureFormatSupported(device, format))
+        {
+            throw std::runtime_error(std::format("KTX2 file {} uses {}, which the device can't sample", fileName,
+                                                 vk::to_string(format)));
+        }
+
+        Ktx2Texture texture{ format, header.pixelWidth, header.pixelHeight };
+
+        auto const blockExtent = vk::blockExtent(format);
+        uint64_t const blockSize = vk::blockSize(format);
+
+        // Every level has to lie within the file before anything is sized from the lengths
+        uint64_t dataSize = 0;
+        for (uint32_t level = 0; level < levelIndices.size(); level++)
+        {
+            auto const& levelIndex = levelIndices[level];
+            if (levelIndex.byteOffset > fileData.size() || levelIndex.byteLength > fileData.size() - levelIndex.byteOffset)
+            {
+                throw std::runtime_error(std::format("KTX2 file {} is truncated", fileName));
+            }
+
+            // The upload reads a whole level's blocks, a shorter level would have it read past the data
+            auto const width = std::max(header.pixelWidth >> level, 1u);
+            auto const height = std::max(header.pixelHeight >> level, 1u);
+            auto const levelBytes = static_cast<uint64_t>((width + blockExtent[0] - 1) / blockExtent[0]) *
+                                    ((height + blockExtent[1] - 1) / blockExtent[1]) * blockSize;
+            if (levelIndex.byteLength < levelBytes)
+            {
+                throw std::runtime_error(std::format("KTX2 file {} level {} holds {} bytes, {} expected", fileName,
+                                                     level, levelIndex.byteLength, levelBytes));
+            }
+
+            dataSize += levelIndex.byteLength;
+        }
+        texture.data.reserve(static_cast<size_t>(dataSize));
+
+        for (uint32_t level = 0; level < levelIndices.size(); level++)
+        {
+            auto const& levelIndex = levelIndices[level];
+
+            texture.levels.push_back({
+                texture.data.size(),
+                std::max(header.pixelWidth >> level, 1u),
+                std::max(header.pixelHeight >> level, 1u)
+            });
+
+            auto const* pLevel = fileData.data() + levelIndex.byteOffset;
+            texture.data.insert(texture.data.end(), pLevel, pLevel + levelIndex.byteLength);
+        }
+
+        return texture;
+    }
+
+    bool isSrgbTransfer(std::vector<uint8_t> const& fileData, Ktx2Header const& header, std::string const& fileName)
+    {
+        if (header.dfdByteLength < 16)
+        {
+            return true;
+        }
+
+        // Total size, then the basic descriptor block: vendor/type, version/size, then model, primaries, transfer, flags
+        auto const modelWord = readValue<uint32_t>(fileData, header.dfdByteOffset + 12, fileName);
+        return (modelWord >> 16 & 0xFF) == DfdTransferSrgb;
+    }
+
+    struct TranscodeTarget
+    {
+        basist::transcoder_texture_format basisFormat;
+        vk::Format srgbFormat;
+        vk::Format unormFormat;
+    };
+
+    // Ordered by preference. ETC1S holds no more detail than 4 bits per texel formats can keep, so opaque ETC1S
+    // prefers those to halve the VRAM, while UASTC and textures with alpha go to BC7 or ASTC first.
+    std::vector<TranscodeTarget> getTranscodeTargets(bool etc1s, bool hasAlpha)
+    {
+        using basist::transcoder_texture_format;
+
+        TranscodeTarget const bc7 = { transcoder_texture_format::cTFBC7_RGBA, vk::Format::eBc7SrgbBlock, vk::Format::eBc7UnormBlock };
+        TranscodeTarget const astc = { transcoder_texture_format::cTFASTC_4x4_RGBA, vk::Format::eAstc4x4SrgbBlock, vk::Format::eAstc4x4UnormBlock };
+        TranscodeTarget const etc2 = { transcoder_texture_format::cTFETC2_RGBA, vk::Format::eEtc2R8G8B8A8SrgbBlock, vk::Format::eEtc2R8G8B8A8UnormBlock };
+        TranscodeTarget const etc1 = { transcoder_texture_format::cTFETC1_RGB, vk::Format::eEtc2R8G8B8SrgbBlock, vk::Format::eEtc2R8G8B8UnormBlock };
+        TranscodeTarget const bc3 = { transcoder_texture_format::cTFBC3_RGBA, vk::Format::eBc3SrgbBlock, vk::Format::eBc3UnormBlock };
+        TranscodeTarget const bc1 = { transcoder_texture_format::cTFBC1_RGB, vk::Format::eBc1RgbSrgbBlock, vk::Format::eBc1RgbUnormBlock };
+        TranscodeTarget const rgba = { transcoder_texture_format::cTFRGBA32, vk::Format::eR8G8B8A8Srgb, vk::Format::eR8G8B8A8Unorm };
+
+        if (etc1s && !hasAlpha)
+        {
+            return { bc1, etc1, bc7, astc, rgba };
+        }
+
+        if (hasAlpha)
+        {
+            return { bc7, astc, etc2, bc3, rgba };
+        }
+
+        return { bc7, astc, etc1, bc1, rgba };
+    }
+
+    Ktx2Texture transcodeBasisTexture(std::vector<uint8_t> const& fileData, Ktx2Header const& header,
+                                      vk::PhysicalDevice const& device, uint32_t workerCount, std::string const& fileName)
+    {
+        static std::once_flag initialised;
+        std::call_once(initialised, [] { basist::basisu_transcoder_init(); });
+
+        basist::ktx2_transcoder transcoder;
+        if (!transcoder.init(fileData.data(), static_cast<uint32_t>(fileData.size())) || !transcoder.start_transcoding())
+        {
+            throw std::runtime_error(std::format("failed to start transcoding KTX2 file {}", fileName));
+        }
+
+        bool const srgb = isSrgbTransfer(fileData, header, fileName);
+        auto const targets = getTranscodeTargets(transcoder.is_etc1s(), transcoder.get_has_alpha());
+
+        auto const target = std::ranges::find_if(targets, [&](TranscodeTarget const& candidate)
+        {
+            return IsSampledTextureFormatSupported(device, srgb ? candidate.srgbFormat : candidate.unormFormat);
+        });
+
+        if (target == targets.end())
+        {
+            throw std::runtime_error(std::format("no transcode target for KTX2 file {} is supported", fileName));
+        }
+
+        Ktx2Texture texture{ srgb ? target->srgbFormat : target->unormFormat, header.pixelWidth, header.pixelHeight };
+        texture.transcoded = true;
+
+        bool const uncompressed = basist::basis_transcoder_format_is_uncompressed(target->basisFormat);
+        auto const bytesPerUnit = basist::basis_get_bytes_per_block_or_pixel(target->basisFormat);
+
+        // Output sizes are known up front, so every level can be transcoded straight into its final place
+        std::vector<uint32_t> levelUnits;
+        for (uint32_t level = 0; level < transcoder.get_levels(); level++)
+        {
+            basist::ktx2_image_level_info levelInfo;
+            if (!transcoder.get_image_level_info(levelInfo, level, 0, 0))
+            {
+                throw std::runtime_error(std::format("failed to read level {} of KTX2 file {}", level, fileName));
+            }
+
+            auto const units = uncompressed ? levelInfo.m_orig_width * levelInfo.m_orig_height : levelInfo.m_total_blocks;
+
+            texture.levels.push_back({ texture.data.size(), levelInfo.m_orig_width, levelInfo.m_orig_height });
+            levelUnits.push_back(units);
+            texture.data.resize(texture.data.size() + static_cast<size_t>(units) * bytesPerUnit);
+        }
+
+        // Each worker needs its own transcoder state, the transcoder itself is shared read only
+        std::atomic<uint32_t> nextLevel = 0;
+        std::atomic<bool> failed = false;
+
+        auto const transcodeLevels = [&]
+        {
+            basist::ktx2_transcoder_state state;
+
+            for (auto level = nextLevel++; level < texture.levels.size(); level = nextLevel++)
+            {
+                if (!transcoder.transcode_image_level(level, 0, 0, texture.data.data() + texture.levels[level].offset,
+                                                      levelUnits[level], target->basisFormat, 0, 0, 0, -1, -1, &state))
+                {
+                    failed = true;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        auto const threadCount = std::clamp<uint32_t>(workerCount, 1, static_cast<uint32_t>(texture.levels.size()));
+        for (uint32_t i = 1; i < threadCount; i++)
+        {
+            workers.emplace_back(transcodeLevels);
+        }
+
+        transcodeLevels();
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        if (failed)
+        {
+            throw std::runtime_error(std::format("failed to transcode KTX2 file {}", fileName));
+        }
+
+        return texture;
+    }
+}
+
+bool IsSampledTextureFormatSupported(vk::PhysicalDevice const& device, vk::Format format)
+{
+    constexpr vk::FormatFeatureFlags requiredFeatures =
+        vk::FormatFeatureFlagBits::eSampledImage |
+        vk::FormatFeatureFlagBits::eSampledImageFilterLinear |
+        vk::FormatFeatureFlagBits::eTransferDst;
+
+    auto const features = device.getFormatProperties(format).optimalTilingFeatures;
+    return (features & requiredFeatures) == requiredFeatures;
+}
+
+Ktx2Texture LoadKtx2Texture(std::string const& fileName, vk::PhysicalDevice const& device,
+                            uint32_t workerCount /*= std::thread::hardware_concurrency()*/)
+{
+    auto const fileData = readFile(fileName);
+
+    if (fileData.size() < Ktx2Identifier.size() + sizeof(Ktx2Header) ||
+        !std::equal(Ktx2Identifier.begin(), Ktx2Identifier.end(), fileData.begin()))
+    {
+        throw std::runtime_error(std::format("{} is not a KTX2 file", fileName));
+    }
+
+    auto const header = readValue<Ktx2Header>(fileData, Ktx2Identifier.size(), fileName);
+
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.pixelHeight == 0)
+    {
+        throw std::runtime_error(std::format("KTX2 file {} is not a single 2D texture", fileName));
+    }
+
+    if (header.pixelWidth == 0 || header.levelCount > GetMipLevelCount(header.pixelWidth, header.pixelHeight))
+    {
+        throw std::runtime_error(std::format("KTX2 file {} has {} levels for a {}x{} texture", fileName,
+                                             header.levelCount, header.pixelWidth, header.pixelHeight));
+    }
+
+    // A level count of 0 asks the loader to generate mips, which block-compressed formats can't, so only level 0 is used
+    std::vector<Ktx2LevelIndex> levelIndices(std::max(header.levelCount, 1u));
+    for (size_t level = 0; level < levelIndices.size(); level++)
+    {
+        levelIndices[level] = readValue<Ktx2LevelIndex>(
+            fileData, Ktx2Identifier.size() + sizeof(Ktx2Header) + level * sizeof(Ktx2LevelIndex), fileName);
+    }
+
+    auto const colorModel = getColorModel(fileData, header, fileName);
+    bool const basisUniversal = header.vkFormat == static_cast<uint32_t>(vk::Format::eUndefined) &&
+                                (colorModel == DfdColorModelEtc1s || colorModel == DfdColorModelUastc);
+
+    if (!basisUniversal)
+    {
+        return loadRawTexture(fileData, header, levelIndices, device, fileName);
+    }
+
+    return transcodeBasisTexture(fileData, header, device, workerCount, fileName);
+}
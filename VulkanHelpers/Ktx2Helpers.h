@@ -0,0 +1,22 @@
+#pragma once
+#include "ImageIngestHelpers.h"
+
+// Level data packed level 0 first, ready to be copied into an image with one region per level
+struct Ktx2Texture
+{
+    vk::Format format = vk::Format::eUndefined;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<MipLevelLayout> levels;
+    std::vector<uint8_t> data;
+    // Set when the file held Basis Universal data, which was converted to format
+    bool transcoded = false;
+};
+
+bool IsSampledTextureFormatSupported(vk::PhysicalDevice const& device, vk::Format format);
+
+// Loads a 2D KTX2 texture. Block-compressed and other raw formats are used as is when the device can sample them.
+// Basis Universal payloads (ETC1S or UASTC) are transcoded to the best format the device supports, one mip level
+// per worker thread. Throws if the file can't be used on this device.
+Ktx2Texture LoadKtx2Texture(std::string const& fileName, vk::PhysicalDevice const& device,
+                            uint32_t workerCount = std::thread::hardware_concurrency());
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "MappedMemoryWriter.h"
+
+MappedMemoryWriter::MappedMemoryWriter(
+    vk::Device const& device,
+    vk::DeviceMemory memory,
+    void* pMapped,
+    vk::DeviceSize size,
+    vk::DeviceSize allocationSize,
+    vk::DeviceSize nonCoherentAtomSize,
+    bool coherent
+)
+    : m_device(device),
+      m_memory(memory),
+      m_pMapped(static_cast<std::byte*>(pMapped)),
+      m_allocationSize(allocationSize),
+      m_atomSize(std::max<vk::DeviceSize>(nonCoherentAtomSize, 1)),
+      m_coherent(coherent),
+      m_shadow(size),
+      m_validBlocks((size + BlockSize - 1) / BlockSize, false)
+{
+}
+
+vk::DeviceSize MappedMemoryWriter::Write(vk::DeviceSize offset, void const* pData, vk::DeviceSize size)
+{
+    if (offset + size > m_shadow.size())
+    {
+        throw std::runtime_error("Write is outside of the mapped range");
+    }
+
+    auto const pSource = static_cast<std::byte const*>(pData);
+    vk::DeviceSize bytesWritten = 0;
+
+    auto const end = offset + size;
+    for (auto blockStart = offset - offset % BlockSize; blockStart < end; blockStart += BlockSize)
+    {
+        auto const writeStart = std::max(blockStart, offset);
+        auto const writeEnd = std::min(blockStart + BlockSize, end);
+        auto const writeSize = writeEnd - writeStart;
+        auto const blockIndex = blockStart / BlockSize;
+
+        auto const pSourceBlock = pSource + (writeStart - offset);
+        auto const pShadowBlock = m_shadow.data() + writeStart;
+
+        if (m_validBlocks[blockIndex] && memcmp(pShadowBlock, pSourceBlock, writeSize) == 0)
+        {
+            continue;
+        }
+
+        memcpy(pShadowBlock, pSourceBlock, writeSize);
+        memcpy(m_pMapped + writeStart, pSourceBlock, writeSize);
+
+        // A partially written block is only valid if the rest of it was already known
+        if (writeSize == std::min(BlockSize, m_shadow.size() - blockStart))
+        {
+            m_validBlocks[blockIndex] = true;
+        }
+
+        markDirty(writeStart, writeSize);
+        bytesWritten += writeSize;
+    }
+
+    return bytesWritten;
+}
+
+vk::DeviceSize MappedMemoryWriter::Flush()
+{
+    if (m_coherent || m_dirtyRanges.empty())
+    {
+        m_dirtyRanges.clear();
+        return 0;
+    }
+
+    std::ranges::sort(m_dirtyRanges);
+
+    std::vector<vk::MappedMemoryRange> ranges;
+    vk::DeviceSize bytesFlushed = 0;
+
+    for (auto const& [offset, size] : m_dirtyRanges)
+    {
+        auto const alignedStart = offset - offset % m_atomSize;
+        auto alignedEnd = (offset + size + m_atomSize - 1) / m_atomSize * m_atomSize;
+
+        // Ranges may only run past the allocation when they are expressed as the rest of it
+        auto const toEnd = alignedEnd >= m_allocationSize;
+        alignedEnd = std::min(alignedEnd, m_allocationSize);
+
+        if (!ranges.empty())
+        {
+            auto& previous = ranges.back();
+
+            // Sorted, so a range already reaching the end of the allocation covers everything left
+            if (previous.size == vk::WholeSize)
+            {
+                break;
+            }
+
+            auto const previousEnd = previous.offset + previous.size;
+            if (alignedStart <= previousEnd)
+            {
+                auto const mergedEnd = std::max(previousEnd, alignedEnd);
+                bytesFlushed += mergedEnd - previousEnd;
+                previous.size = toEnd ? vk::WholeSize : mergedEnd - previous.offset;
+                continue;
+            }
+        }
+
+        bytesFlushed += alignedEnd - alignedStart;
+        ranges.emplace_back(m_memory, alignedStart, toEnd ? vk::WholeSize : alignedEnd - alignedStart);
+    }
+
+    m_device.flushMappedMemoryRanges(ranges);
+    m_dirtyRanges.clear();
+
+    return bytesFlushed;
+}
+
+bool MappedMemoryWriter::IsCoherent() const
+{
+    return m_coherent;
+}
+
+void MappedMemoryWriter::markDirty(vk::DeviceSize offset, vk::DeviceSize size)
+{
+    if (!m_dirtyRanges.empty())
+    {
+        auto& [lastOffset, lastSize] = m_dirtyRanges.back();
+        if (lastOffset + lastSize == offset)
+        {
+            lastSize += size;
+            return;
+        }
+    }
+
+    m_dirtyRanges.emplace_back(offset, size);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Writes into persistently mapped memory through a shadow copy, so only blocks whose contents changed are copied.
+// For non-coherent memory the written ranges are flushed, aligned to nonCoherentAtomSize.
+class MappedMemoryWriter
+{
+public:
+    MappedMemoryWriter() = default;
+    MappedMemoryWriter(vk::Device const& device, vk::DeviceMemory memory, void* pMapped, vk::DeviceSize size,
+                       vk::DeviceSize allocationSize, vk::DeviceSize nonCoherentAtomSize, bool coherent);
+
+    // Copies the blocks of [offset, offset + size) that differ from what was last written, returns the bytes copied
+    vk::DeviceSize Write(vk::DeviceSize offset, void const* pData, vk::DeviceSize size);
+
+    // Flushes everything written since the last flush, returns the bytes flushed
+    vk::DeviceSize Flush();
+
+    bool IsCoherent() const;
+
+private:
+    void markDirty(vk::DeviceSize offset, vk::DeviceSize size);
+
+    static constexpr vk::DeviceSize BlockSize = 64;
+
+    vk::Device m_device;
+    vk::DeviceMemory m_memory;
+    std::byte* m_pMapped = nullptr;
+    vk::DeviceSize m_allocationSize = 0;
+    vk::DeviceSize m_atomSize = 1;
+    bool m_coherent = true;
+
+    std::vector<std::byte> m_shadow;
+    // Blocks start invalid so the first write always reaches the mapped memory
+    std::vector<bool> m_validBlocks;
+    std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> m_dirtyRanges;
+};
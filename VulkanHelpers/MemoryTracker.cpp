@@ -0,0 +1,262 @@
+#include "pch.h"
+#include "MemoryTracker.h"
+
+namespace
+{
+    // Without VK_EXT_memory_budget, other processes and the driver are assumed to leave this much of each heap
+    constexpr double EstimatedBudgetFraction = 0.8;
+}
+
+std::string_view ToString(MemoryUsage usage)
+{
+    switch (usage)
+    {
+    case MemoryUsage::eVertex:
+        return "vertex";
+    case MemoryUsage::eIndex:
+        return "index";
+    case MemoryUsage::eTexture:
+        return "texture";
+    case MemoryUsage::eUniform:
+        return "uniform";
+    case MemoryUsage::eStaging:
+        return "staging";
+    case MemoryUsage::eOther:
+        return "other";
+    }
+
+    return "unknown";
+}
+
+MemoryTracker::MemoryTracker(
+    vk::PhysicalDevice const& physicalDevice,
+    vk::Device const& device,
+    bool memoryBudgetSupported,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_physicalDevice(physicalDevice),
+      m_device(device),
+      m_memoryBudgetSupported(memoryBudgetSupported),
+      m_pAllocator(pAllocator),
+      m_memoryProperties(physicalDevice.getMemoryProperties()),
+      m_heapBudgets(m_memoryProperties.memoryHeapCount),
+      m_heapUsages(m_memoryProperties.memoryHeapCount),
+      m_heapAllocatedBytes(m_memoryProperties.memoryHeapCount),
+      m_heapAllocationCounts(m_memoryProperties.memoryHeapCount)
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+    {
+        auto const& heap = m_memoryProperties.memoryHeaps[i];
+        if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal &&
+            (!m_largestDeviceLocalHeap || heap.size > m_memoryProperties.memoryHeaps[*m_largestDeviceLocalHeap].size))
+        {
+            m_largestDeviceLocalHeap = i;
+        }
+    }
+
+    PollBudget();
+}
+
+vk::PhysicalDeviceMemoryProperties const& MemoryTracker::GetMemoryProperties() const
+{
+    return m_memoryProperties;
+}
+
+std::optional<uint32_t> MemoryTracker::FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties,
+                                                      vk::DeviceSize size /*= 0*/) const
+{
+    // On ReBAR systems the first device local type can sit in the small BAR heap or a heap that's already full, so
+    // the first fit isn't good enough. Candidates are ranked by budget, then heap, the driver's order breaks ties.
+    auto const targetHeap = properties & vk::MemoryPropertyFlagBits::eDeviceLocal
+                                ? m_largestDeviceLocalHeap
+                                : std::nullopt;
+
+    std::optional<uint32_t> found;
+    int foundRank = -1;
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+        auto const& memoryType = m_memoryProperties.memoryTypes[i];
+        if (!(typeFilter & 1 << i) || (memoryType.propertyFlags & properties) != properties)
+        {
+            continue;
+        }
+
+        auto const rank = (GetRemainingBudget(memoryType.heapIndex) >= size ? 2 : 0) +
+                          (!targetHeap || memoryType.heapIndex == *targetHeap ? 1 : 0);
+        if (rank > foundRank)
+        {
+            found = i;
+            foundRank = rank;
+        }
+    }
+
+    return found;
+}
+
+std::optional<uint32_t> MemoryTracker::GetLargestDeviceLocalHeap() const
+{
+    return m_largestDeviceLocalHeap;
+}
+
+vk::DeviceSize MemoryTracker::GetRemainingBudget(uint32_t heapIndex) const
+{
+    // The budget extension's usage is as old as the last poll and misses the allocations since, the tracked bytes
+    // miss the driver's own. Whichever is larger is closer.
+    auto const usage = std::max(m_heapUsages[heapIndex].value_or(0), m_heapAllocatedBytes[heapIndex]);
+    auto const budget = m_heapBudgets[heapIndex];
+
+    return budget > usage ? budget - usage : 0;
+}
+
+vk::DeviceMemory MemoryTracker::Allocate(vk::MemoryAllocateInfo const& allocInfo, MemoryUsage usage)
+{
+    auto const memory = m_device.allocateMemory(allocInfo, m_pAllocator);
+
+    auto const heapIndex = m_memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+    m_allocations[memory] = { allocInfo.allocationSize, heapIndex, usage };
+
+    m_heapAllocatedBytes[heapIndex] += allocInfo.allocationSize;
+    m_heapAllocationCounts[heapIndex]++;
+
+    auto& usageStats = m_usages[static_cast<size_t>(usage)];
+    usageStats.allocatedBytes += allocInfo.allocationSize;
+    usageStats.allocationCount++;
+
+    return memory;
+}
+
+void MemoryTracker::Free(vk::DeviceMemory memory)
+{
+    if (!memory)
+    {
+        return;
+    }
+
+    if (auto const allocation = m_allocations.find(memory); allocation != m_allocations.end())
+    {
+        auto const& [size, heapIndex, usage] = allocation->second;
+
+        m_heapAllocatedBytes[heapIndex] -= size;
+        m_heapAllocationCounts[heapIndex]--;
+
+        auto& usageStats = m_usages[static_cast<size_t>(usage)];
+        usageStats.allocatedBytes -= size;
+        usageStats.allocationCount--;
+
+        m_allocations.erase(allocation);
+    }
+
+    m_device.freeMemory(memory, m_pAllocator);
+}
+
+void MemoryTracker::PollBudget()
+{
+    if (m_memoryBudgetSupported)
+    {
+        auto const memoryProperties = m_physicalDevice.getMemoryProperties2<
+            vk::PhysicalDeviceMemoryProperties2,
+            vk::PhysicalDeviceMemoryBudgetPropertiesEXT
+        >();
+        auto const& budgetProperties = memoryProperties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+
+        for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+        {
+            m_heapBudgets[i] = budgetProperties.heapBudget[i];
+            m_heapUsages[i] = budgetProperties.heapUsage[i];
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+        {
+            m_heapBudgets[i] = static_cast<vk::DeviceSize>(
+                static_cast<double>(m_memoryProperties.memoryHeaps[i].size) * EstimatedBudgetFraction);
+        }
+    }
+
+    if (m_overBudgetCallbacks.empty())
+    {
+        return;
+    }
+
+    auto const stats = GetStats();
+    for (uint32_t i = 0; i < stats.heaps.size(); i++)
+    {
+        auto const& heap = stats.heaps[i];
+        if (heap.processUsage.value_or(heap.allocatedBytes) <= heap.budget)
+        {
+            continue;
+        }
+
+        for (auto const& callback : m_overBudgetCallbacks)
+        {
+            callback(i, heap);
+        }
+    }
+}
+
+MemoryStats MemoryTracker::GetStats() const
+{
+    MemoryStats stats;
+    stats.budgetFromExtension = m_memoryBudgetSupported;
+    stats.usages = m_usages;
+
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+    {
+        auto const& heap = m_memoryProperties.memoryHeaps[i];
+
+        stats.heaps.push_back({
+            heap.size,
+            m_heapAllocatedBytes[i],
+            m_heapAllocationCounts[i],
+            m_heapBudgets[i],
+            m_heapUsages[i],
+            static_cast<bool>(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+        });
+    }
+
+    return stats;
+}
+
+void MemoryTracker::LogStats(std::ostream& stream) const
+{
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    auto const stats = GetStats();
+
+    stream << std::format("Device memory ({} budget):\n", stats.budgetFromExtension ? "VK_EXT_memory_budget" : "estimated");
+
+    for (size_t i = 0; i < stats.heaps.size(); i++)
+    {
+        auto const& heap = stats.heaps[i];
+
+        stream << std::format("  Heap {}{}: {:.2f} MiB in {} allocations, budget {:.2f} of {:.2f} MiB",
+                              i, heap.deviceLocal ? " (device local)" : "",
+                              static_cast<double>(heap.allocatedBytes) / MiB, heap.allocationCount,
+                              static_cast<double>(heap.budget) / MiB, static_cast<double>(heap.heapSize) / MiB);
+
+        if (heap.processUsage)
+        {
+            stream << std::format(", process usage {:.2f} MiB", static_cast<double>(*heap.processUsage) / MiB);
+        }
+
+        stream << '\n';
+    }
+
+    for (size_t i = 0; i < MemoryUsageCount; i++)
+    {
+        auto const& usage = stats.usages[i];
+        if (usage.allocationCount == 0)
+        {
+            continue;
+        }
+
+        stream << std::format("  {}: {:.2f} MiB in {} allocations\n", ToString(static_cast<MemoryUsage>(i)),
+                              static_cast<double>(usage.allocatedBytes) / MiB, usage.allocationCount);
+    }
+}
+
+void MemoryTracker::AddOverBudgetCallback(OverBudgetCallback callback)
+{
+    m_overBudgetCallbacks.push_back(std::move(callback));
+}
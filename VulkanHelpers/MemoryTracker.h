@@ -0,0 +1,101 @@
+#pragma once
+
+enum class MemoryUsage
+{
+    eVertex,
+    eIndex,
+    eTexture,
+    eUniform,
+    eStaging,
+    eOther
+};
+
+constexpr size_t MemoryUsageCount = static_cast<size_t>(MemoryUsage::eOther) + 1;
+
+std::string_view ToString(MemoryUsage usage);
+
+struct HeapStats
+{
+    vk::DeviceSize heapSize = 0;
+    vk::DeviceSize allocatedBytes = 0;
+    uint32_t allocationCount = 0;
+    // Reported by VK_EXT_memory_budget when available, otherwise the budget is estimated from the heap size
+    vk::DeviceSize budget = 0;
+    std::optional<vk::DeviceSize> processUsage;
+    bool deviceLocal = false;
+};
+
+struct UsageStats
+{
+    vk::DeviceSize allocatedBytes = 0;
+    uint32_t allocationCount = 0;
+};
+
+struct MemoryStats
+{
+    std::vector<HeapStats> heaps;
+    std::array<UsageStats, MemoryUsageCount> usages;
+    bool budgetFromExtension = false;
+};
+
+// Owns every device memory allocation made by the application so usage can be tracked per heap and per category.
+class MemoryTracker
+{
+public:
+    using OverBudgetCallback = std::function<void(uint32_t heapIndex, HeapStats const& heapStats)>;
+
+    MemoryTracker() = default;
+    MemoryTracker(vk::PhysicalDevice const& physicalDevice, vk::Device const& device, bool memoryBudgetSupported,
+                  vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    vk::PhysicalDeviceMemoryProperties const& GetMemoryProperties() const;
+
+    // The type with the properties, first among those whose heap has budget left for the size. Device local requests
+    // prefer the largest device local heap, otherwise the driver's order decides. Types past their budget are only
+    // returned when no other type fits, allocating there may still succeed but evicts or fails.
+    std::optional<uint32_t> FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties,
+                                           vk::DeviceSize size = 0) const;
+
+    // The main VRAM heap on discrete GPUs, all of memory on UMA devices. With resizable BAR it's host visible too,
+    // without it the host visible device local types live in a small heap of their own.
+    std::optional<uint32_t> GetLargestDeviceLocalHeap() const;
+
+    // What can still be allocated from the heap before it goes past its budget
+    vk::DeviceSize GetRemainingBudget(uint32_t heapIndex) const;
+
+    vk::DeviceMemory Allocate(vk::MemoryAllocateInfo const& allocInfo, MemoryUsage usage);
+    void Free(vk::DeviceMemory memory);
+
+    // Re-queries the budget and calls the over budget callbacks for every heap past it
+    void PollBudget();
+
+    MemoryStats GetStats() const;
+    void LogStats(std::ostream& stream) const;
+
+    void AddOverBudgetCallback(OverBudgetCallback callback);
+
+private:
+    struct Allocation
+    {
+        vk::DeviceSize size;
+        uint32_t heapIndex;
+        MemoryUsage usage;
+    };
+
+    vk::PhysicalDevice m_physicalDevice;
+    vk::Device m_device;
+    bool m_memoryBudgetSupported = false;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+    std::optional<uint32_t> m_largestDeviceLocalHeap;
+    std::vector<vk::DeviceSize> m_heapBudgets;
+    std::vector<std::optional<vk::DeviceSize>> m_heapUsages;
+
+    std::unordered_map<VkDeviceMemory, Allocation> m_allocations;
+    std::vector<vk::DeviceSize> m_heapAllocatedBytes;
+    std::vector<uint32_t> m_heapAllocationCounts;
+    std::array<UsageStats, MemoryUsageCount> m_usages{};
+
+    std::vector<OverBudgetCallback> m_overBudgetCallbacks;
+};
@@ -0,0 +1,282 @@
+#include "pch.h"
+#include "ObjectCaches.h"
+#include "HashHelpers.h"
+
+size_t SamplerKeyHash::operator()(vk::SamplerCreateInfo const& info) const
+{
+    size_t seed = 0;
+    hashFlags(seed, info.flags);
+    hashEnum(seed, info.magFilter);
+    hashEnum(seed, info.minFilter);
+    hashEnum(seed, info.mipmapMode);
+    hashEnum(seed, info.addressModeU);
+    hashEnum(seed, info.addressModeV);
+    hashEnum(seed, info.addressModeW);
+    hashCombine(seed, info.mipLodBias);
+    hashCombine(seed, info.anisotropyEnable);
+    hashCombine(seed, info.maxAnisotropy);
+    hashCombine(seed, info.compareEnable);
+    hashEnum(seed, info.compareOp);
+    hashCombine(seed, info.minLod);
+    hashCombine(seed, info.maxLod);
+    hashEnum(seed, info.borderColor);
+    hashCombine(seed, info.unnormalizedCoordinates);
+
+    return seed;
+}
+
+SamplerCache::SamplerCache(
+    vk::Device const& device,
+    uint32_t maxSamplerAllocationCount,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_maxSamplerAllocationCount(maxSamplerAllocationCount),
+      m_pAllocator(pAllocator)
+{
+}
+
+vk::Sampler SamplerCache::Acquire(vk::SamplerCreateInfo const& info)
+{
+    if (info.pNext)
+    {
+        throw std::runtime_error("Cached samplers can't have a pNext chain");
+    }
+
+    return acquire(info, [&]
+    {
+        if (GetStats().liveObjects >= m_maxSamplerAllocationCount)
+        {
+            throw std::runtime_error(std::format("Creating another sampler would exceed maxSamplerAllocationCount {}",
+                                                 m_maxSamplerAllocationCount));
+        }
+
+        return m_device.createSampler(info, m_pAllocator);
+    });
+}
+
+void SamplerCache::Release(vk::Sampler sampler)
+{
+    if (release(sampler))
+    {
+        m_device.destroySampler(sampler, m_pAllocator);
+    }
+}
+
+void SamplerCache::Destroy()
+{
+    for (auto const sampler : releaseAll())
+    {
+        m_device.destroySampler(sampler, m_pAllocator);
+    }
+}
+
+size_t ImageViewKeyHash::operator()(ImageViewKey const& key) const
+{
+    size_t seed = 0;
+    hashCombine(seed, static_cast<VkImage>(key.image));
+    hashEnum(seed, key.viewType);
+    hashEnum(seed, key.format);
+    hashEnum(seed, key.components.r);
+    hashEnum(seed, key.components.g);
+    hashEnum(seed, key.components.b);
+    hashEnum(seed, key.components.a);
+    hashFlags(seed, key.subresourceRange.aspectMask);
+    hashCombine(seed, key.subresourceRange.baseMipLevel);
+    hashCombine(seed, key.subresourceRange.levelCount);
+    hashCombine(seed, key.subresourceRange.baseArrayLayer);
+    hashCombine(seed, key.subresourceRange.layerCount);
+    hashFlags(seed, key.usage);
+
+    return seed;
+}
+
+ImageViewCache::ImageViewCache(
+    vk::Device const& device,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_pAllocator(pAllocator)
+{
+}
+
+vk::ImageView ImageViewCache::Acquire(ImageViewKey const& key)
+{
+    return acquire(key, [&]
+    {
+        vk::ImageViewUsageCreateInfo const viewUsage{ key.usage };
+
+        vk::ImageViewCreateInfo const viewInfo{
+            {},
+            key.image,
+            key.viewType,
+            key.format,
+            key.components,
+            key.subresourceRange,
+            key.usage ? &viewUsage : nullptr
+        };
+
+        return m_device.createImageView(viewInfo, m_pAllocator);
+    });
+}
+
+void ImageViewCache::Release(vk::ImageView view)
+{
+    if (release(view))
+    {
+        m_device.destroyImageView(view, m_pAllocator);
+    }
+}
+
+void ImageViewCache::Destroy()
+{
+    for (auto const view : releaseAll())
+    {
+        m_device.destroyImageView(view, m_pAllocator);
+    }
+}
+
+size_t SetLayoutKeyHash::operator()(SetLayoutKey const& key) const
+{
+    size_t seed = 0;
+    for (auto const& binding : key.bindings)
+    {
+        hashCombine(seed, binding.binding);
+        hashEnum(seed, binding.descriptorType);
+        hashCombine(seed, binding.descriptorCount);
+        hashFlags(seed, binding.stageFlags);
+    }
+
+    return seed;
+}
+
+size_t PipelineLayoutKeyHash::operator()(PipelineLayoutKey const& key) const
+{
+    // Set layouts are hash-consed, so their handles stand for their contents
+    size_t seed = 0;
+    for (auto const setLayout : key.setLayouts)
+    {
+        hashCombine(seed, static_cast<VkDescriptorSetLayout>(setLayout));
+    }
+    for (auto const& range : key.pushConstantRanges)
+    {
+        hashFlags(seed, range.stageFlags);
+        hashCombine(seed, range.offset);
+        hashCombine(seed, range.size);
+    }
+
+    return seed;
+}
+
+LayoutCache::LayoutCache(
+    vk::Device const& device,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_pAllocator(pAllocator)
+{
+}
+
+vk::DescriptorSetLayout LayoutCache::GetSetLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings)
+{
+    if (std::ranges::any_of(bindings, &vk::DescriptorSetLayoutBinding::pImmutableSamplers))
+    {
+        throw std::runtime_error("Cached set layouts can't have immutable samplers");
+    }
+
+    std::ranges::sort(bindings, {}, &vk::DescriptorSetLayoutBinding::binding);
+    SetLayoutKey key{ std::move(bindings) };
+
+    if (auto const found = m_setLayouts.find(key); found != m_setLayouts.end())
+    {
+        m_stats.setLayoutHits++;
+        return found->second;
+    }
+
+    auto const setLayout = m_device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo({}, key.bindings),
+                                                              m_pAllocator);
+    m_setLayouts.emplace(std::move(key), setLayout);
+    m_stats.setLayouts++;
+
+    return setLayout;
+}
+
+vk::PipelineLayout LayoutCache::GetPipelineLayout(PipelineLayoutKey const& key)
+{
+    if (auto const found = m_pipelineLayouts.find(key); found != m_pipelineLayouts.end())
+    {
+        m_stats.pipelineLayoutHits++;
+        return found->second;
+    }
+
+    auto const pipelineLayout = m_device.createPipelineLayout(
+        vk::PipelineLayoutCreateInfo({}, key.setLayouts, key.pushConstantRanges), m_pAllocator);
+    m_pipelineLayouts.emplace(key, pipelineLayout);
+    m_stats.pipelineLayouts++;
+
+    return pipelineLayout;
+}
+
+vk::DescriptorSetLayout LayoutCache::GetSetLayout(ShaderInterface const& shaderInterface, uint32_t set)
+{
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    for (auto const& binding : shaderInterface.bindings)
+    {
+        if (binding.set != set)
+        {
+            continue;
+        }
+
+        if (binding.count == 0)
+        {
+            throw std::runtime_error(std::format("Set {} binding {} is a runtime array, the set needs an external "
+                                                 "layout", binding.set, binding.binding));
+        }
+
+        bindings.emplace_back(binding.binding, binding.type, binding.count, binding.stages);
+    }
+
+    return GetSetLayout(std::move(bindings));
+}
+
+vk::PipelineLayout LayoutCache::GetPipelineLayout(
+    ShaderInterface const& shaderInterface,
+    std::vector<vk::DescriptorSetLayout> const& externalSetLayouts /*= {}*/
+)
+{
+    size_t setCount = externalSetLayouts.size();
+    for (auto const& binding : shaderInterface.bindings)
+    {
+        setCount = std::max<size_t>(setCount, binding.set + 1);
+    }
+
+    PipelineLayoutKey key{ {}, shaderInterface.pushConstantRanges };
+    for (uint32_t set = 0; set < setCount; set++)
+    {
+        auto const external = set < externalSetLayouts.size() ? externalSetLayouts[set] : vk::DescriptorSetLayout{};
+        key.setLayouts.push_back(external ? external : GetSetLayout(shaderInterface, set));
+    }
+
+    return GetPipelineLayout(key);
+}
+
+LayoutCacheStats LayoutCache::GetStats() const
+{
+    return m_stats;
+}
+
+void LayoutCache::Destroy()
+{
+    for (auto const pipelineLayout : m_pipelineLayouts | std::views::values)
+    {
+        m_device.destroyPipelineLayout(pipelineLayout, m_pAllocator);
+    }
+    for (auto const setLayout : m_setLayouts | std::views::values)
+    {
+        m_device.destroyDescriptorSetLayout(setLayout, m_pAllocator);
+    }
+
+    m_pipelineLayouts.clear();
+    m_setLayouts.clear();
+    m_stats = {};
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include "ShaderHelpers.h"
+
+struct ObjectCacheStats
+{
+    uint32_t liveObjects = 0;
+    uint64_t created = 0;
+    // Acquisitions handed an object that already existed
+    uint64_t reused = 0;
+};
+
+// Shared handles by creation parameters with reference counting, the object is destroyed when its last reference is
+// released. Handles are looked up by their C type like the other handle maps.
+template <typename Key, typename Handle, typename KeyHash>
+class RefCountedCache
+{
+public:
+    ObjectCacheStats GetStats() const
+    {
+        return m_stats;
+    }
+
+protected:
+    template <typename Create>
+    Handle acquire(Key const& key, Create const& create)
+    {
+        if (auto const found = m_entries.find(key); found != m_entries.end())
+        {
+            found->second.references++;
+            m_stats.reused++;
+            return found->second.handle;
+        }
+
+        Handle const handle = create();
+        m_entries.emplace(key, Entry{ handle, 1 });
+        m_keys.emplace(static_cast<typename Handle::CType>(handle), key);
+        m_stats.liveObjects++;
+        m_stats.created++;
+
+        return handle;
+    }
+
+    // True when that was the last reference and the handle has to be destroyed
+    bool release(Handle handle)
+    {
+        auto const key = m_keys.find(static_cast<typename Handle::CType>(handle));
+        if (key == m_keys.end())
+        {
+            throw std::runtime_error("Released an object that didn't come from the cache");
+        }
+
+        auto const entry = m_entries.find(key->second);
+        if (--entry->second.references > 0)
+        {
+            return false;
+        }
+
+        m_entries.erase(entry);
+        m_keys.erase(key);
+        m_stats.liveObjects--;
+
+        return true;
+    }
+
+    // Forgets every entry whatever its references, the returned handles have to be destroyed
+    std::vector<Handle> releaseAll()
+    {
+        std::vector<Handle> handles;
+        for (auto const& entry : m_entries | std::views::values)
+        {
+            handles.push_back(entry.handle);
+        }
+
+        m_entries.clear();
+        m_keys.clear();
+        m_stats.liveObjects = 0;
+
+        return handles;
+    }
+
+private:
+    struct Entry
+    {
+        Handle handle;
+        uint32_t references;
+    };
+
+    std::unordered_map<Key, Entry, KeyHash> m_entries;
+    std::unordered_map<typename Handle::CType, Key> m_keys;
+    ObjectCacheStats m_stats;
+};
+
+struct SamplerKeyHash
+{
+    size_t operator()(vk::SamplerCreateInfo const& info) const;
+};
+
+// Every texture sampled the same way shares one sampler, which keeps scenes well under maxSamplerAllocationCount
+class SamplerCache : public RefCountedCache<vk::SamplerCreateInfo, vk::Sampler, SamplerKeyHash>
+{
+public:
+    SamplerCache() = default;
+    SamplerCache(vk::Device const& device, uint32_t maxSamplerAllocationCount,
+                 vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    // Keyed by every field of the create info, pNext chains aren't supported. Throws when a new sampler would go past
+    // the device's sampler limit.
+    vk::Sampler Acquire(vk::SamplerCreateInfo const& info);
+    void Release(vk::Sampler sampler);
+
+    void Destroy();
+
+private:
+    vk::Device m_device;
+    uint32_t m_maxSamplerAllocationCount = 0;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+};
+
+struct ImageViewKey
+{
+    vk::Image image;
+    vk::ImageViewType viewType = vk::ImageViewType::e2D;
+    vk::Format format = vk::Format::eUndefined;
+    vk::ComponentMapping components;
+    vk::ImageSubresourceRange subresourceRange;
+    // Narrows the view's usage below the image's, e.g. sampled only for sRGB views of storage images. Empty inherits.
+    vk::ImageUsageFlags usage;
+
+    bool operator==(ImageViewKey const&) const = default;
+};
+
+struct ImageViewKeyHash
+{
+    size_t operator()(ImageViewKey const& key) const;
+};
+
+// Views of the same image, subresources, format and swizzle are shared. Every view of an image has to be released
+// before the image is destroyed.
+class ImageViewCache : public RefCountedCache<ImageViewKey, vk::ImageView, ImageViewKeyHash>
+{
+public:
+    ImageViewCache() = default;
+    explicit ImageViewCache(vk::Device const& device, vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    vk::ImageView Acquire(ImageViewKey const& key);
+    void Release(vk::ImageView view);
+
+    void Destroy();
+
+private:
+    vk::Device m_device;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+};
+
+struct SetLayoutKey
+{
+    // Sorted by binding, immutable samplers aren't supported
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+
+    bool operator==(SetLayoutKey const&) const = default;
+};
+
+struct SetLayoutKeyHash
+{
+    size_t operator()(SetLayoutKey const& key) const;
+};
+
+struct PipelineLayoutKey
+{
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    std::vector<vk::PushConstantRange> pushConstantRanges;
+
+    bool operator==(PipelineLayoutKey const&) const = default;
+};
+
+struct PipelineLayoutKeyHash
+{
+    size_t operator()(PipelineLayoutKey const& key) const;
+};
+
+struct LayoutCacheStats
+{
+    uint32_t setLayouts = 0;
+    uint32_t pipelineLayouts = 0;
+    // Requests answered with a layout that already existed
+    uint64_t setLayoutHits = 0;
+    uint64_t pipelineLayoutHits = 0;
+};
+
+// Hash-consed descriptor set and pipeline layouts, equal descriptions always give back the same handle. Pipelines
+// whose shaders reflect to compatible interfaces end up with the same pipeline layout, so sets bound for one stay
+// bound for the next. Layouts are few and live until Destroy, nothing is reference counted.
+class LayoutCache
+{
+public:
+    LayoutCache() = default;
+    explicit LayoutCache(vk::Device const& device, vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    vk::DescriptorSetLayout GetSetLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings);
+    vk::PipelineLayout GetPipelineLayout(PipelineLayoutKey const& key);
+
+    // Layout of one set of a reflected interface, an empty layout when the interface uses nothing in it
+    vk::DescriptorSetLayout GetSetLayout(ShaderInterface const& shaderInterface, uint32_t set);
+
+    // Covers every set up to the highest one used. Non-null externalSetLayouts, indexed by set, stand in for the
+    // reflected ones, e.g. bindless tables whose runtime arrays have no size in the shader.
+    vk::PipelineLayout GetPipelineLayout(ShaderInterface const& shaderInterface,
+                                         std::vector<vk::DescriptorSetLayout> const& externalSetLayouts = {});
+
+    LayoutCacheStats GetStats() const;
+
+    void Destroy();
+
+private:
+    vk::Device m_device;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    std::unordered_map<SetLayoutKey, vk::DescriptorSetLayout, SetLayoutKeyHash> m_setLayouts;
+    std::unordered_map<PipelineLayoutKey, vk::PipelineLayout, PipelineLayoutKeyHash> m_pipelineLayouts;
+    LayoutCacheStats m_stats;
+};
@@ -0,0 +1,863 @@
+#include "pch.h"
+#include "PipelineCache.h"
+#include "HashHelpers.h"
+#include "ShaderHelpers.h"
+
+namespace
+{
+    // The fixed function state of a description, shared by monolithic pipelines and every library part
+    struct PipelineStates
+    {
+        PipelineStates(PipelineDesc const& desc, DynamicStateSupport const& dynamicState)
+            : dynamicStates(GetDynamicStates(dynamicState)),
+              colorBlendAttachments(desc.renderTargets.colorFormats.size(), desc.blend),
+              vertexInput{ {}, desc.vertexBindings, desc.vertexAttributes },
+              inputAssembly{ {}, desc.topology, false },
+              viewport{ {}, 1, nullptr, 1, nullptr },
+              rasterization{ {}, false, false, desc.polygonMode, desc.cullMode, desc.frontFace, false, 0.0f, 0.0f,
+                             0.0f, 1.0f },
+              multisample{ {}, desc.renderTargets.samples },
+              // Ignored when the render targets have no depth
+              depthStencil{ {}, desc.depthTest, desc.depthWrite, desc.depthCompareOp },
+              colorBlend{ {}, false, vk::LogicOp::eCopy, colorBlendAttachments },
+              dynamic{ {}, dynamicStates }
+        {
+        }
+
+        PipelineStates(PipelineStates const&) = delete;
+        PipelineStates& operator=(PipelineStates const&) = delete;
+
+        std::vector<vk::DynamicState> dynamicStates;
+        std::vector<vk::PipelineColorBlendAttachmentState> colorBlendAttachments;
+
+        vk::PipelineVertexInputStateCreateInfo vertexInput;
+        vk::PipelineInputAssemblyStateCreateInfo inputAssembly;
+        vk::PipelineViewportStateCreateInfo viewport;
+        vk::PipelineRasterizationStateCreateInfo rasterization;
+        vk::PipelineMultisampleStateCreateInfo multisample;
+        vk::PipelineDepthStencilStateCreateInfo depthStencil;
+        vk::PipelineColorBlendStateCreateInfo colorBlend;
+        vk::PipelineDynamicStateCreateInfo dynamic;
+    };
+
+    // Only the fields one library part is built from, everything else stays at its default
+    PipelineDesc getLibraryKey(PipelineDesc const& desc, vk::GraphicsPipelineLibraryFlagBitsEXT part)
+    {
+        PipelineDesc key;
+
+        switch (part)
+        {
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface:
+            key.vertexBindings = desc.vertexBindings;
+            key.vertexAttributes = desc.vertexAttributes;
+            key.topology = desc.topology;
+            break;
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders:
+            key.vertexShader = desc.vertexShader;
+            key.specialization = desc.specialization;
+            key.polygonMode = desc.polygonMode;
+            key.cullMode = desc.cullMode;
+            key.frontFace = desc.frontFace;
+            key.renderTargets = desc.renderTargets;
+            key.layout = desc.layout;
+            break;
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader:
+            key.fragmentShader = desc.fragmentShader;
+            key.specialization = desc.specialization;
+            key.depthTest = desc.depthTest;
+            key.depthWrite = desc.depthWrite;
+            key.depthCompareOp = desc.depthCompareOp;
+            key.renderTargets = desc.renderTargets;
+            key.layout = desc.layout;
+            break;
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface:
+            key.blend = desc.blend;
+            key.renderTargets = desc.renderTargets;
+            break;
+        }
+
+        return key;
+    }
+
+    // Shaders are checked against each vertex layout and specialization they're used with once
+    PipelineDesc getShaderCheckKey(PipelineDesc const& desc)
+    {
+        PipelineDesc key;
+        key.vertexShader = desc.vertexShader;
+        key.fragmentShader = desc.fragmentShader;
+        key.specialization = desc.specialization;
+        key.vertexAttributes = desc.vertexAttributes;
+
+        return key;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+bool SupportsGraphicsPipelineLibrary(vk::PhysicalDevice const& device)
+{
+    vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supported;
+    vk::PhysicalDeviceFeatures2 features{ {}, &supported };
+    device.getFeatures2(&features);
+
+    vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties;
+    vk::PhysicalDeviceProperties2 properties{ {}, &libraryProperties };
+    device.getProperties2(&properties);
+
+    return supported.graphicsPipelineLibrary && libraryProperties.graphicsPipelineLibraryFastLinking;
+}
+
+size_t RenderTargetFormatsHash::operator()(RenderTargetFormats const& formats) const
+{
+    size_t seed = 0;
+    for (auto const format : formats.colorFormats)
+    {
+        hashEnum(seed, format);
+    }
+    hashEnum(seed, formats.depthFormat);
+    hashEnum(seed, formats.samples);
+
+    return seed;
+}
+
+size_t PipelineDescHash::operator()(PipelineDesc const& desc) const
+{
+    size_t seed = 0;
+    hashCombine(seed, desc.vertexShader);
+    hashCombine(seed, desc.fragmentShader);
+    hashCombine(seed, ShaderVariantHash{}(desc.specialization));
+    for (auto const& binding : desc.vertexBindings)
+    {
+        hashCombine(seed, binding.binding);
+        hashCombine(seed, binding.stride);
+        hashEnum(seed, binding.inputRate);
+    }
+    for (auto const& attribute : desc.vertexAttributes)
+    {
+        hashCombine(seed, attribute.location);
+        hashCombine(seed, attribute.binding);
+        hashEnum(seed, attribute.format);
+        hashCombine(seed, attribute.offset);
+    }
+    hashEnum(seed, desc.topology);
+    hashEnum(seed, desc.polygonMode);
+    hashFlags(seed, desc.cullMode);
+    hashEnum(seed, desc.frontFace);
+    hashCombine(seed, desc.depthTest);
+    hashCombine(seed, desc.depthWrite);
+    hashEnum(seed, desc.depthCompareOp);
+    hashCombine(seed, desc.blend.blendEnable);
+    hashEnum(seed, desc.blend.srcColorBlendFactor);
+    hashEnum(seed, desc.blend.dstColorBlendFactor);
+    hashEnum(seed, desc.blend.colorBlendOp);
+    hashEnum(seed, desc.blend.srcAlphaBlendFactor);
+    hashEnum(seed, desc.blend.dstAlphaBlendFactor);
+    hashEnum(seed, desc.blend.alphaBlendOp);
+    hashFlags(seed, desc.blend.colorWriteMask);
+    hashCombine(seed, RenderTargetFormatsHash{}(desc.renderTargets));
+    hashCombine(seed, static_cast<VkPipelineLayout>(desc.layout));
+
+    return seed;
+}
+
+void CheckPipelineShaders(
+    PipelineDesc const& desc,
+    std::vector<uint32_t> const& vertShaderCode,
+    std::vector<uint32_t> const& fragShaderCode
+)
+{
+    auto const vertexInterface = ReflectShader(vertShaderCode);
+
+    // Attribute formats are hand-written next to the vertex structs, a mismatch would read garbage without any error
+    CheckVertexInputs(vertexInterface, desc.vertexAttributes);
+
+    std::array const interfaces = { vertexInterface, ReflectShader(fragShaderCode) };
+    CheckShaderVariant(MergeShaderInterfaces(interfaces), desc.specialization);
+}
+
+vk::Pipeline CreateGraphicsPipeline(
+    vk::Device const& device,
+    PipelineDesc const& desc,
+    vk::RenderPass renderPass,
+    DynamicStateSupport const& dynamicState /*= {}*/,
+    vk::PipelineCache pipelineCache /*= {}*/,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+{
+    auto const vertShaderCode = ReadShaderFile(desc.vertexShader);
+    auto const fragShaderCode = ReadShaderFile(desc.fragmentShader);
+
+    CheckPipelineShaders(desc, vertShaderCode, fragShaderCode);
+
+    auto const vertShaderModule = CreateShaderModule(device, vertShaderCode, pAllocator);
+    auto const fragShaderModule = CreateShaderModule(device, fragShaderCode, pAllocator);
+
+    // Both stages get every constant, the ones a stage doesn't declare are ignored
+    auto const specialization = desc.specialization.GetInfo();
+
+    std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
+        { {}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main", &specialization },
+        { {}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main", &specialization }
+    };
+
+    PipelineStates const states(desc, dynamicState);
+
+    vk::GraphicsPipelineCreateInfo const pipelineCreateInfo{
+        {},
+        shaderStages,
+        &states.vertexInput,
+        &states.inputAssembly,
+        {},
+        &states.viewport,
+        &states.rasterization,
+        &states.multisample,
+        &states.depthStencil,
+        &states.colorBlend,
+        &states.dynamic,
+        desc.layout,
+        renderPass,
+        0
+    };
+
+    auto pipelineResult = device.createGraphicsPipeline(pipelineCache, pipelineCreateInfo, pAllocator);
+
+    device.destroyShaderModule(vertShaderModule, pAllocator);
+    device.destroyShaderModule(fragShaderModule, pAllocator);
+
+    resultCheck(pipelineResult.result, "Failed to create pipeline!");
+
+    return pipelineResult.value;
+}
+
+GraphicsPipelineCache::GraphicsPipelineCache(
+    vk::Device const& device,
+    uint32_t threadCount,
+    bool usePipelineLibraries,
+    DynamicStateSupport const& dynamicState,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_usePipelineLibraries(usePipelineLibraries),
+      m_dynamicState(dynamicState),
+      m_pAllocator(pAllocator)
+{
+    // Internally synchronized, every worker compiles through it
+    m_pipelineCache = m_device.createPipelineCache({}, m_pAllocator);
+
+    for (uint32_t i = 0; i < std::max(threadCount, 1u); i++)
+    {
+        m_workers.emplace_back(&GraphicsPipelineCache::workerMain, this);
+    }
+}
+
+GraphicsPipelineCache::~GraphicsPipelineCache()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workQueued.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+PipelineId GraphicsPipelineCache::Request(PipelineDesc const& desc)
+{
+    std::unique_lock lock(m_mutex);
+
+    auto const [id, added] = findOrAdd(desc);
+    if (!added)
+    {
+        return id;
+    }
+
+    auto& entry = getEntry(id);
+
+    // Fast linking takes a fraction of a millisecond, no reason to leave the first frames to the fallback
+    if (m_usePipelineLibraries && m_checkedShaders.contains(getShaderCheckKey(entry.desc)) &&
+        std::ranges::all_of(findLibraries(entry.desc), [](vk::Pipeline library) { return !!library; }))
+    {
+        entry.state = State::Compiling;
+        lock.unlock();
+        compile(entry);
+
+        return id;
+    }
+
+    m_queue.push_back({ &entry, false });
+    lock.unlock();
+    m_workQueued.notify_one();
+
+    return id;
+}
+
+PipelineId GraphicsPipelineCache::RequestBlocking(PipelineDesc const& desc)
+{
+    std::unique_lock lock(m_mutex);
+
+    auto const id = findOrAdd(desc).first;
+    auto& entry = getEntry(id);
+    if (entry.state == State::Queued)
+    {
+        // A worker popping it later skips it
+        entry.state = State::Compiling;
+        lock.unlock();
+        compile(entry);
+        lock.lock();
+    }
+    else
+    {
+        m_compileFinished.wait(lock, [&entry]
+        {
+            return entry.state == State::Ready || entry.state == State::Failed;
+        });
+    }
+
+    if (entry.state == State::Failed)
+    {
+        throw std::runtime_error(std::format("Failed to compile the pipeline of {} and {}: {}", entry.desc.vertexShader,
+                                             entry.desc.fragmentShader, entry.error));
+    }
+
+    return id;
+}
+
+vk::Pipeline GraphicsPipelineCache::Get(PipelineId id) const
+{
+    return vk::Pipeline(getEntry(id).current.load(std::memory_order_acquire));
+}
+
+vk::Pipeline GraphicsPipelineCache::Get(PipelineId id, vk::Pipeline fallback)
+{
+    if (auto const pipeline = Get(id))
+    {
+        return pipeline;
+    }
+
+    m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+    return fallback;
+}
+
+uint32_t GraphicsPipelineCache::Warm(std::span<PipelineDesc const> descs)
+{
+    uint32_t queued = 0;
+
+    {
+        std::lock_guard lock(m_mutex);
+
+        for (auto const& desc : descs)
+        {
+            if (auto const [id, added] = findOrAdd(desc, true); added)
+            {
+                m_queue.push_back({ &getEntry(id), false });
+                queued++;
+            }
+        }
+    }
+    m_workQueued.notify_all();
+
+    return queued;
+}
+
+void GraphicsPipelineCache::WaitIdle()
+{
+    std::unique_lock lock(m_mutex);
+    m_compileFinished.wait(lock, [this] { return m_stats.pending == 0; });
+}
+
+std::vector<PipelineDesc> GraphicsPipelineCache::GetRequestedDescs() const
+{
+    std::lock_guard lock(m_mutex);
+
+    std::vector<PipelineDesc> descs;
+    for (PipelineId id = 0; id < m_entryCount; id++)
+    {
+        auto const& entry = getEntry(id);
+        if (entry.used && entry.state == State::Ready)
+        {
+            descs.push_back(entry.desc);
+        }
+    }
+
+    return descs;
+}
+
+PipelineCacheStats GraphicsPipelineCache::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+
+    auto stats = m_stats;
+    stats.fallbacks = m_fallbacks.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+void GraphicsPipelineCache::Destroy()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+        m_queue.clear();
+    }
+    m_workQueued.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+
+    for (PipelineId id = 0; id < m_entryCount; id++)
+    {
+        m_device.destroyPipeline(getEntry(id).pipeline, m_pAllocator);
+        m_device.destroyPipeline(getEntry(id).fastLinked, m_pAllocator);
+    }
+    for (auto& libraries : m_libraries)
+    {
+        for (auto const library : libraries | std::views::values)
+        {
+            m_device.destroyPipeline(library, m_pAllocator);
+        }
+        libraries.clear();
+    }
+    for (auto const renderPass : m_renderPasses | std::views::values)
+    {
+        m_device.destroyRenderPass(renderPass, m_pAllocator);
+    }
+    m_device.destroyPipelineCache(m_pipelineCache, m_pAllocator);
+
+    for (auto& chunk : m_entryChunks)
+    {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+    m_entryStorage.clear();
+    m_entryCount = 0;
+    m_ids.clear();
+    m_checkedShaders.clear();
+    m_renderPasses.clear();
+    m_pipelineCache = nullptr;
+    m_stats = {};
+}
+
+void GraphicsPipelineCache::compile(Entry& entry)
+{
+    auto const compileStart = std::chrono::steady_clock::now();
+
+    vk::Pipeline pipeline;
+    double fastLinkMs = 0.0;
+    bool optimizeQueued = false;
+    std::string error;
+    try
+    {
+        if (m_usePipelineLibraries)
+        {
+            checkShaders(entry.desc);
+            auto const libraries = getLibraries(entry);
+
+            auto const linkStart = std::chrono::steady_clock::now();
+            pipeline = linkLibraries(entry, libraries, false);
+            fastLinkMs = millisecondsSince(linkStart);
+        }
+        else
+        {
+            pipeline = CreateGraphicsPipeline(m_device, entry.desc, entry.renderPass, m_dynamicState, m_pipelineCache,
+                                              m_pAllocator);
+        }
+    }
+    catch (std::exception const& e)
+    {
+        error = e.what();
+    }
+
+    auto const compileMs = millisecondsSince(compileStart);
+
+    {
+        std::lock_guard lock(m_mutex);
+
+        m_stats.pending--;
+        m_stats.compileMs += compileMs;
+        m_stats.maxCompileMs = std::max(m_stats.maxCompileMs, compileMs);
+
+        if (error.empty())
+        {
+            if (m_usePipelineLibraries)
+            {
+                entry.fastLinked = pipeline;
+                m_stats.fastLinks++;
+                m_stats.fastLinkMs += fastLinkMs;
+                m_queue.push_back({ &entry, true });
+                optimizeQueued = true;
+            }
+            else
+            {
+                entry.pipeline = pipeline;
+            }
+
+            entry.state = State::Ready;
+            entry.current.store(static_cast<VkPipeline>(pipeline), std::memory_order_release);
+            m_stats.pipelines++;
+        }
+        else
+        {
+            entry.error = std::move(error);
+            entry.state = State::Failed;
+            m_stats.failed++;
+        }
+    }
+    m_compileFinished.notify_all();
+
+    if (optimizeQueued)
+    {
+        m_workQueued.notify_one();
+    }
+}
+
+void GraphicsPipelineCache::optimize(Entry& entry)
+{
+    auto const optimizeStart = std::chrono::steady_clock::now();
+
+    vk::Pipeline pipeline;
+    try
+    {
+        pipeline = linkLibraries(entry, getLibraries(entry), true);
+    }
+    catch (std::exception const&)
+    {
+        // The fast linked pipeline works just as well, only slower
+        return;
+    }
+
+    auto const optimizeMs = millisecondsSince(optimizeStart);
+
+    std::lock_guard lock(m_mutex);
+
+    // The fast linked pipeline may still be in use by pending command buffers, it's kept until the cache goes
+    entry.pipeline = pipeline;
+    entry.current.store(static_cast<VkPipeline>(pipeline), std::memory_order_release);
+    m_stats.optimizedLinks++;
+    m_stats.optimizeMs += optimizeMs;
+}
+
+void GraphicsPipelineCache::workerMain()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_workQueued.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+
+            if (m_stopping)
+            {
+                return;
+            }
+
+            job = m_queue.front();
+            m_queue.pop_front();
+
+            if (!job.optimize)
+            {
+                if (job.pEntry->state != State::Queued)
+                {
+                    continue;
+                }
+                job.pEntry->state = State::Compiling;
+            }
+        }
+
+        if (job.optimize)
+        {
+            optimize(*job.pEntry);
+        }
+        else
+        {
+            compile(*job.pEntry);
+        }
+    }
+}
+
+GraphicsPipelineCache::Entry& GraphicsPipelineCache::getEntry(PipelineId id) const
+{
+    // The chunk was published before the id was handed out
+    return m_entryChunks[id / EntryChunkSize].load(std::memory_order_acquire)[id % EntryChunkSize];
+}
+
+std::pair<PipelineId, bool> GraphicsPipelineCache::findOrAdd(PipelineDesc const& desc, bool warm /*= false*/)
+{
+    if (!warm)
+    {
+        m_stats.requests++;
+    }
+
+    auto key = GetPipelineKey(desc, m_dynamicState);
+    if (auto const found = m_ids.find(key); found != m_ids.end())
+    {
+        if (!warm)
+        {
+            // Still compiling counts as neither, the request may well have to wait for it
+            auto& entry = getEntry(found->second);
+            if (entry.warmed && !entry.used && entry.state == State::Ready)
+            {
+                m_stats.compilesAvoided++;
+            }
+            entry.used = true;
+            m_stats.hits++;
+        }
+
+        return { found->second, false };
+    }
+
+    auto const id = m_entryCount;
+    if (id % EntryChunkSize == 0)
+    {
+        if (id / EntryChunkSize == MaxEntryChunks)
+        {
+            throw std::runtime_error(std::format("The pipeline cache is full at {} pipelines", id));
+        }
+
+        auto const& chunk = m_entryStorage.emplace_back(std::make_unique<Entry[]>(EntryChunkSize));
+        m_entryChunks[id / EntryChunkSize].store(chunk.get(), std::memory_order_release);
+    }
+    m_entryCount++;
+
+    auto& entry = getEntry(id);
+    entry.desc = key;
+    entry.renderPass = getRenderPass(key.renderTargets);
+    entry.warmed = warm;
+    entry.used = !warm;
+    if (warm)
+    {
+        m_stats.warmed++;
+    }
+    else
+    {
+        m_stats.compilesOnRequest++;
+    }
+
+    m_ids.emplace(std::move(key), id);
+    m_stats.pending++;
+
+    return { id, true };
+}
+
+vk::RenderPass GraphicsPipelineCache::getRenderPass(RenderTargetFormats const& formats)
+{
+    if (auto const found = m_renderPasses.find(formats); found != m_renderPasses.end())
+    {
+        return found->second;
+    }
+
+    // Load and store ops and layouts don't matter for compatibility, only formats, sample counts and the subpass do
+    std::vector<vk::AttachmentDescription> attachments;
+    std::vector<vk::AttachmentReference> colorAttachmentRefs;
+    for (auto const format : formats.colorFormats)
+    {
+        colorAttachmentRefs.emplace_back(static_cast<uint32_t>(attachments.size()),
+                                         vk::ImageLayout::eColorAttachmentOptimal);
+        attachments.emplace_back(vk::AttachmentDescriptionFlags{}, format, formats.samples,
+                                 vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                                 vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                                 vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal);
+    }
+
+    vk::AttachmentReference const depthAttachmentRef{
+        static_cast<uint32_t>(attachments.size()),
+        vk::ImageLayout::eDepthStencilAttachmentOptimal
+    };
+    auto const hasDepth = formats.depthFormat != vk::Format::eUndefined;
+    if (hasDepth)
+    {
+        attachments.emplace_back(vk::AttachmentDescriptionFlags{}, formats.depthFormat, formats.samples,
+                                 vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                                 vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                                 vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+    }
+
+    vk::SubpassDescription const subpass{
+        {},
+        vk::PipelineBindPoint::eGraphics,
+        {},
+        colorAttachmentRefs,
+        {},
+        hasDepth ? &depthAttachmentRef : nullptr
+    };
+
+    vk::SubpassDependency const dependency{
+        vk::SubpassExternal,
+        0,
+        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        {},
+        vk::AccessFlagBits::eColorAttachmentWrite
+    };
+
+    auto const renderPass = m_device.createRenderPass({ {}, attachments, subpass, dependency }, m_pAllocator);
+    m_renderPasses.emplace(formats, renderPass);
+
+    return renderPass;
+}
+
+GraphicsPipelineCache::Libraries GraphicsPipelineCache::findLibraries(PipelineDesc const& desc) const
+{
+    Libraries libraries;
+    for (size_t part = 0; part < LibraryParts.size(); part++)
+    {
+        auto const found = m_libraries[part].find(getLibraryKey(desc, LibraryParts[part]));
+        if (found != m_libraries[part].end())
+        {
+            libraries[part] = found->second;
+        }
+    }
+
+    return libraries;
+}
+
+GraphicsPipelineCache::Libraries GraphicsPipelineCache::getLibraries(Entry const& entry)
+{
+    Libraries libraries;
+    {
+        std::lock_guard lock(m_mutex);
+        libraries = findLibraries(entry.desc);
+    }
+
+    for (size_t part = 0; part < LibraryParts.size(); part++)
+    {
+        if (libraries[part])
+        {
+            continue;
+        }
+
+        auto key = getLibraryKey(entry.desc, LibraryParts[part]);
+        auto const library = createLibrary(key, LibraryParts[part], entry.renderPass);
+
+        std::lock_guard lock(m_mutex);
+
+        // Another worker may have compiled the same part in the meantime
+        auto const [found, added] = m_libraries[part].emplace(std::move(key), library);
+        if (added)
+        {
+            m_stats.libraries++;
+        }
+        else
+        {
+            m_device.destroyPipeline(library, m_pAllocator);
+        }
+
+        libraries[part] = found->second;
+    }
+
+    return libraries;
+}
+
+vk::Pipeline GraphicsPipelineCache::createLibrary(
+    PipelineDesc const& key,
+    vk::GraphicsPipelineLibraryFlagBitsEXT part,
+    vk::RenderPass renderPass
+) const
+{
+    PipelineStates const states(key, m_dynamicState);
+
+    vk::ShaderModule shaderModule;
+    std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+    auto const specialization = key.specialization.GetInfo();
+
+    vk::GraphicsPipelineLibraryCreateInfoEXT const libraryInfo{ part };
+
+    // Retained so the libraries can be linked again with link time optimization
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo{
+        vk::PipelineCreateFlagBits::eLibraryKHR | vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT
+    };
+    pipelineCreateInfo.pNext = &libraryInfo;
+    // Each part only reads the dynamic states that belong to it
+    pipelineCreateInfo.pDynamicState = &states.dynamic;
+
+    switch (part)
+    {
+    case vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface:
+        pipelineCreateInfo.pVertexInputState = &states.vertexInput;
+        pipelineCreateInfo.pInputAssemblyState = &states.inputAssembly;
+        break;
+    case vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders:
+        shaderModule = CreateShaderModule(m_device, key.vertexShader, m_pAllocator);
+        shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags{}, vk::ShaderStageFlagBits::eVertex, shaderModule,
+                                  "main", &specialization);
+        pipelineCreateInfo.pViewportState = &states.viewport;
+        pipelineCreateInfo.pRasterizationState = &states.rasterization;
+        pipelineCreateInfo.layout = key.layout;
+        pipelineCreateInfo.renderPass = renderPass;
+        break;
+    case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader:
+        shaderModule = CreateShaderModule(m_device, key.fragmentShader, m_pAllocator);
+        shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags{}, vk::ShaderStageFlagBits::eFragment,
+                                  shaderModule, "main", &specialization);
+        pipelineCreateInfo.pDepthStencilState = &states.depthStencil;
+        pipelineCreateInfo.pMultisampleState = &states.multisample;
+        pipelineCreateInfo.layout = key.layout;
+        pipelineCreateInfo.renderPass = renderPass;
+        break;
+    case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface:
+        pipelineCreateInfo.pColorBlendState = &states.colorBlend;
+        pipelineCreateInfo.pMultisampleState = &states.multisample;
+        pipelineCreateInfo.renderPass = renderPass;
+        break;
+    }
+
+    pipelineCreateInfo.setStages(shaderStages);
+
+    auto pipelineResult = m_device.createGraphicsPipeline(m_pipelineCache, pipelineCreateInfo, m_pAllocator);
+
+    m_device.destroyShaderModule(shaderModule, m_pAllocator);
+
+    resultCheck(pipelineResult.result, "Failed to create pipeline library!");
+
+    return pipelineResult.value;
+}
+
+vk::Pipeline GraphicsPipelineCache::linkLibraries(
+    Entry const& entry,
+    Libraries const& libraries,
+    bool optimize
+) const
+{
+    vk::PipelineLibraryCreateInfoKHR const linkInfo{ libraries };
+
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo;
+    pipelineCreateInfo.pNext = &linkInfo;
+    if (optimize)
+    {
+        pipelineCreateInfo.flags = vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT;
+    }
+    pipelineCreateInfo.layout = entry.desc.layout;
+    pipelineCreateInfo.renderPass = entry.renderPass;
+
+    auto pipelineResult = m_device.createGraphicsPipeline(m_pipelineCache, pipelineCreateInfo, m_pAllocator);
+
+    resultCheck(pipelineResult.result, optimize ? "Failed to link optimized pipeline!" : "Failed to link pipeline!");
+
+    return pipelineResult.value;
+}
+
+void GraphicsPipelineCache::checkShaders(PipelineDesc const& desc)
+{
+    auto key = getShaderCheckKey(desc);
+
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_checkedShaders.contains(key))
+        {
+            return;
+        }
+    }
+
+    CheckPipelineShaders(desc, ReadShaderFile(desc.vertexShader), ReadShaderFile(desc.fragmentShader));
+
+    std::lock_guard lock(m_mutex);
+    m_checkedShaders.insert(std::move(key));
+}
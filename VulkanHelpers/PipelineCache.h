@@ -0,0 +1,265 @@
+#pragma once
+#include "DynamicState.h"
+#include "ShaderVariants.h"
+
+// VK_EXT_graphics_pipeline_library and its dependency
+inline const std::vector GraphicsPipelineLibraryExtensions = {
+    VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+    VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME
+};
+
+// The feature and fast linking, without it linking libraries can take as long as a monolithic compile. Only call when
+// the extensions are supported.
+bool SupportsGraphicsPipelineLibrary(vk::PhysicalDevice const& device);
+
+// Formats and sample count of the attachments a pipeline renders to, pipelines only depend on these and not on the
+// render pass they're used in
+struct RenderTargetFormats
+{
+    std::vector<vk::Format> colorFormats;
+    vk::Format depthFormat = vk::Format::eUndefined;
+    vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+
+    bool operator==(RenderTargetFormats const&) const = default;
+};
+
+// Everything a graphics pipeline is built from. Viewport and scissor are always dynamic.
+struct PipelineDesc
+{
+    // SPIR-V files
+    std::string vertexShader;
+    std::string fragmentShader;
+    // Specialization constants of both stages
+    ShaderVariant specialization;
+
+    std::vector<vk::VertexInputBindingDescription> vertexBindings;
+    std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+
+    vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eCounterClockwise;
+
+    bool depthTest = false;
+    bool depthWrite = false;
+    vk::CompareOp depthCompareOp = vk::CompareOp::eLess;
+
+    // Applied to every color target
+    vk::PipelineColorBlendAttachmentState blend{
+        false,
+        vk::BlendFactor::eSrcAlpha,
+        vk::BlendFactor::eOneMinusSrcAlpha,
+        vk::BlendOp::eAdd,
+        vk::BlendFactor::eOne,
+        vk::BlendFactor::eZero,
+        vk::BlendOp::eAdd,
+        vk::FlagTraits<vk::ColorComponentFlagBits>::allFlags
+    };
+
+    RenderTargetFormats renderTargets;
+    vk::PipelineLayout layout;
+
+    bool operator==(PipelineDesc const&) const = default;
+};
+
+struct RenderTargetFormatsHash
+{
+    size_t operator()(RenderTargetFormats const& formats) const;
+};
+
+struct PipelineDescHash
+{
+    size_t operator()(PipelineDesc const& desc) const;
+};
+
+// Throws when the vertex layout or the specialization of the description doesn't fit its shaders
+void CheckPipelineShaders(PipelineDesc const& desc, std::vector<uint32_t> const& vertShaderCode,
+                          std::vector<uint32_t> const& fragShaderCode);
+
+// Builds the pipeline on the calling thread, the render pass only has to be compatible with the ones it's used in. The
+// dynamic fields of the description are ignored, they're set while recording.
+vk::Pipeline CreateGraphicsPipeline(vk::Device const& device, PipelineDesc const& desc, vk::RenderPass renderPass,
+                                    DynamicStateSupport const& dynamicState = {},
+                                    vk::PipelineCache pipelineCache = {},
+                                    vk::AllocationCallbacks const* pAllocator = nullptr);
+
+// Index of a pipeline in the cache, stays valid until the cache is destroyed
+using PipelineId = uint32_t;
+
+struct PipelineCacheStats
+{
+    uint32_t pipelines = 0;
+    uint32_t pending = 0;
+    uint32_t failed = 0;
+    uint64_t requests = 0;
+    // Requests for a description the cache had already seen
+    uint64_t hits = 0;
+    // Gets answered with the fallback because the pipeline wasn't compiled yet
+    uint64_t fallbacks = 0;
+    // Summed over every compile until a pipeline was usable, whichever thread ran it
+    double compileMs = 0.0;
+    double maxCompileMs = 0.0;
+    // Pipeline library parts, each shared by every pipeline with the same state for it
+    uint32_t libraries = 0;
+    uint64_t fastLinks = 0;
+    double fastLinkMs = 0.0;
+    // Fast linked pipelines replaced by their link time optimized version
+    uint64_t optimizedLinks = 0;
+    double optimizeMs = 0.0;
+    // Pipelines compiled ahead by Warm, and how many of them were ready by the time they were first requested
+    uint32_t warmed = 0;
+    uint32_t compilesAvoided = 0;
+    // Pipelines whose first request found nothing and had to compile
+    uint32_t compilesOnRequest = 0;
+};
+
+// Graphics pipelines by description. A description seen before gets its pipeline back straight away, a new one is
+// compiled on a pool of worker threads while the caller keeps drawing with a fallback it compiled up front, typically
+// one cheap pipeline per vertex layout. New materials then never stall a frame on the driver's shader compiler.
+//
+// With pipeline libraries the vertex input, pre-rasterization, fragment shader and fragment output parts are compiled
+// on their own and shared, a pipeline whose parts all exist is fast linked right in Request. Every fast linked
+// pipeline is then linked again with link time optimization in the background and replaces itself once that's done.
+//
+// With dynamic state, descriptions that only differ in their dynamic fields share one pipeline and the recorder sets
+// those fields from the description of each draw, see DynamicStateRecorder.
+//
+// Request and Get are meant for the threads recording frames, Get never takes the lock so it stays cheap while other
+// threads add pipelines. Workers only ever see the pipelines they compile. The pipelines are built against render
+// passes of the cache's own that are compatible with any single subpass render pass of the same formats. Everything
+// is destroyed with the cache.
+class GraphicsPipelineCache
+{
+public:
+    // usePipelineLibraries and the dynamic state need their extensions and features enabled
+    GraphicsPipelineCache(vk::Device const& device, uint32_t threadCount, bool usePipelineLibraries,
+                          DynamicStateSupport const& dynamicState, vk::AllocationCallbacks const* pAllocator = nullptr);
+    ~GraphicsPipelineCache();
+
+    GraphicsPipelineCache(GraphicsPipelineCache const&) = delete;
+    GraphicsPipelineCache& operator=(GraphicsPipelineCache const&) = delete;
+
+    // Queues the compile when the description is new, never waits for one. Fast links on the spot when every library
+    // part is there already.
+    PipelineId Request(PipelineDesc const& desc);
+
+    // Compiles on the calling thread unless a worker already started, throws when the pipeline can't be built. For
+    // fallbacks and whatever has to be there for the first frame.
+    PipelineId RequestBlocking(PipelineDesc const& desc);
+
+    // Queues the compiles of the descriptions that are new without counting them as requests, for pipelines known to
+    // be needed soon such as the ones of a manifest from an earlier run. Returns how many were queued.
+    uint32_t Warm(std::span<PipelineDesc const> descs);
+
+    // Waits until every compile queued so far is done, the optimized versions of fast linked pipelines excepted
+    void WaitIdle();
+
+    // The descriptions of every pipeline requested so far that compiled, with the dynamic fields reset. Those still
+    // compiling are left out along with the failed ones, only pipelines known to build are worth warming.
+    std::vector<PipelineDesc> GetRequestedDescs() const;
+
+    // The pipeline once it's compiled, a null handle until then. Look it up again for every command buffer, it
+    // changes when the optimized version is ready.
+    vk::Pipeline Get(PipelineId id) const;
+
+    // The fallback instead of a null handle, also when compiling failed
+    vk::Pipeline Get(PipelineId id, vk::Pipeline fallback);
+
+    PipelineCacheStats GetStats() const;
+
+    // Waits for the compiles in progress, the queued ones are dropped
+    void Destroy();
+
+private:
+    enum class State
+    {
+        Queued,
+        Compiling,
+        Ready,
+        Failed
+    };
+
+    struct Entry
+    {
+        // Dynamic fields reset
+        PipelineDesc desc;
+        vk::RenderPass renderPass;
+        State state = State::Queued;
+        // Monolithic or link time optimized
+        vk::Pipeline pipeline;
+        vk::Pipeline fastLinked;
+        std::string error;
+        // Compiled by Warm, and whether it has been requested since
+        bool warmed = false;
+        bool used = false;
+        // The best pipeline so far, Get reads it without taking the lock
+        std::atomic<VkPipeline> current = VK_NULL_HANDLE;
+    };
+
+    struct Job
+    {
+        Entry* pEntry;
+        // Link the entry's libraries with link time optimization instead of compiling it
+        bool optimize;
+    };
+
+    static constexpr std::array LibraryParts = {
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+        vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface
+    };
+
+    using Libraries = std::array<vk::Pipeline, LibraryParts.size()>;
+
+    // Room for a million pipelines in a 32 KiB table
+    static constexpr PipelineId EntryChunkSize = 256;
+    static constexpr size_t MaxEntryChunks = 4096;
+
+    // The caller has to have moved the entry from queued to compiling
+    void compile(Entry& entry);
+    void optimize(Entry& entry);
+    void workerMain();
+    // Only ids handed out by findOrAdd, safe without the lock
+    Entry& getEntry(PipelineId id) const;
+    // Warming doesn't count as a request
+    std::pair<PipelineId, bool> findOrAdd(PipelineDesc const& desc, bool warm = false);
+    vk::RenderPass getRenderPass(RenderTargetFormats const& formats);
+
+    // Null handles for the parts that haven't been compiled yet, the caller holds the lock
+    Libraries findLibraries(PipelineDesc const& desc) const;
+    Libraries getLibraries(Entry const& entry);
+    vk::Pipeline createLibrary(PipelineDesc const& key, vk::GraphicsPipelineLibraryFlagBitsEXT part,
+                               vk::RenderPass renderPass) const;
+    vk::Pipeline linkLibraries(Entry const& entry, Libraries const& libraries, bool optimize) const;
+    // Reflects the shaders once per vertex layout and specialization, the libraries with shaders are shared across
+    // layouts
+    void checkShaders(PipelineDesc const& desc);
+
+    vk::Device m_device;
+    bool m_usePipelineLibraries = false;
+    DynamicStateSupport m_dynamicState;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+    vk::PipelineCache m_pipelineCache;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workQueued;
+    std::condition_variable m_compileFinished;
+    // Chunks never move or shrink, references stay valid while new entries are added. Owned by the storage and
+    // published in the chunk table, which Get reads without the lock.
+    std::vector<std::unique_ptr<Entry[]>> m_entryStorage;
+    std::array<std::atomic<Entry*>, MaxEntryChunks> m_entryChunks{};
+    PipelineId m_entryCount = 0;
+    std::unordered_map<PipelineDesc, PipelineId, PipelineDescHash> m_ids;
+    std::unordered_map<RenderTargetFormats, vk::RenderPass, RenderTargetFormatsHash> m_renderPasses;
+    // Keyed by the part of the description each library is built from
+    std::array<std::unordered_map<PipelineDesc, vk::Pipeline, PipelineDescHash>, LibraryParts.size()> m_libraries;
+    std::unordered_set<PipelineDesc, PipelineDescHash> m_checkedShaders;
+    std::deque<Job> m_queue;
+    bool m_stopping = false;
+    PipelineCacheStats m_stats;
+    // Counted by Get without the lock
+    std::atomic<uint64_t> m_fallbacks = 0;
+
+    std::vector<std::thread> m_workers;
+};
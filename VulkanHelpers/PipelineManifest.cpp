@@ -0,0 +1,275 @@
+#include "pch.h"
+#include "PipelineManifest.h"
+
+namespace
+{
+    constexpr uint32_t ManifestMagic = 0x464d4c50; // "PLMF"
+    // Bump whenever PipelineDesc or the layout below changes, older manifests are then ignored
+    constexpr uint32_t ManifestVersion = 1;
+
+    // Host byte order, manifests never leave the machine that wrote them
+    class ManifestWriter
+    {
+    public:
+        explicit ManifestWriter(std::string const& fileName)
+            : m_file(fileName, std::ios::binary | std::ios::trunc)
+        {
+            if (!m_file)
+            {
+                throw std::runtime_error(std::format("Can't write the pipeline manifest {}", fileName));
+            }
+        }
+
+        void Write(uint32_t value)
+        {
+            m_file.write(reinterpret_cast<char const*>(&value), sizeof(value));
+        }
+
+        template <typename Enum>
+            requires std::is_enum_v<Enum>
+        void Write(Enum value)
+        {
+            Write(static_cast<uint32_t>(value));
+        }
+
+        template <typename Bits>
+        void Write(vk::Flags<Bits> flags)
+        {
+            Write(static_cast<uint32_t>(static_cast<typename vk::Flags<Bits>::MaskType>(flags)));
+        }
+
+        void Write(std::string const& value)
+        {
+            Write(static_cast<uint32_t>(value.size()));
+            m_file.write(value.data(), static_cast<std::streamsize>(value.size()));
+        }
+
+        void Finish()
+        {
+            m_file.flush();
+            if (!m_file)
+            {
+                throw std::runtime_error("Failed to write the pipeline manifest");
+            }
+        }
+
+    private:
+        std::ofstream m_file;
+    };
+
+    class ManifestReader
+    {
+    public:
+        explicit ManifestReader(std::ifstream& file)
+            : m_file(file)
+        {
+        }
+
+        uint32_t ReadUint()
+        {
+            uint32_t value = 0;
+            if (!m_file.read(reinterpret_cast<char*>(&value), sizeof(value)))
+            {
+                throw std::runtime_error("Truncated pipeline manifest");
+            }
+
+            return value;
+        }
+
+        bool ReadBool()
+        {
+            return ReadUint() != 0;
+        }
+
+        template <typename T>
+        T Read()
+        {
+            return static_cast<T>(ReadUint());
+        }
+
+        // Guards the allocations below against a corrupt count
+        uint32_t ReadCount()
+        {
+            auto const count = ReadUint();
+            if (count > MaxCount)
+            {
+                throw std::runtime_error("Corrupt pipeline manifest");
+            }
+
+            return count;
+        }
+
+        std::string ReadString()
+        {
+            std::string value(ReadCount(), '\0');
+            if (!m_file.read(value.data(), static_cast<std::streamsize>(value.size())))
+            {
+                throw std::runtime_error("Truncated pipeline manifest");
+            }
+
+            return value;
+        }
+
+    private:
+        static constexpr uint32_t MaxCount = 1 << 16;
+
+        std::ifstream& m_file;
+    };
+
+    void writeDesc(ManifestWriter& writer, PipelineDesc const& desc)
+    {
+        writer.Write(desc.vertexShader);
+        writer.Write(desc.fragmentShader);
+
+        auto const entries = desc.specialization.GetEntries();
+        writer.Write(static_cast<uint32_t>(entries.size()));
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            writer.Write(entries[i].constantID);
+            writer.Write(desc.specialization.GetTypes()[i]);
+            writer.Write(desc.specialization.GetData()[i]);
+        }
+
+        writer.Write(static_cast<uint32_t>(desc.vertexBindings.size()));
+        for (auto const& binding : desc.vertexBindings)
+        {
+            writer.Write(binding.binding);
+            writer.Write(binding.stride);
+            writer.Write(binding.inputRate);
+        }
+
+        writer.Write(static_cast<uint32_t>(desc.vertexAttributes.size()));
+        for (auto const& attribute : desc.vertexAttributes)
+        {
+            writer.Write(attribute.location);
+            writer.Write(attribute.binding);
+            writer.Write(attribute.format);
+            writer.Write(attribute.offset);
+        }
+
+        writer.Write(desc.topology);
+        writer.Write(desc.polygonMode);
+        writer.Write(desc.cullMode);
+        writer.Write(desc.frontFace);
+        writer.Write(static_cast<uint32_t>(desc.depthTest));
+        writer.Write(static_cast<uint32_t>(desc.depthWrite));
+        writer.Write(desc.depthCompareOp);
+
+        writer.Write(desc.blend.blendEnable);
+        writer.Write(desc.blend.srcColorBlendFactor);
+        writer.Write(desc.blend.dstColorBlendFactor);
+        writer.Write(desc.blend.colorBlendOp);
+        writer.Write(desc.blend.srcAlphaBlendFactor);
+        writer.Write(desc.blend.dstAlphaBlendFactor);
+        writer.Write(desc.blend.alphaBlendOp);
+        writer.Write(desc.blend.colorWriteMask);
+
+        writer.Write(static_cast<uint32_t>(desc.renderTargets.colorFormats.size()));
+        for (auto const format : desc.renderTargets.colorFormats)
+        {
+            writer.Write(format);
+        }
+        writer.Write(desc.renderTargets.depthFormat);
+        writer.Write(desc.renderTargets.samples);
+    }
+
+    PipelineDesc readDesc(ManifestReader& reader)
+    {
+        PipelineDesc desc;
+        desc.vertexShader = reader.ReadString();
+        desc.fragmentShader = reader.ReadString();
+
+        for (auto i = reader.ReadCount(); i > 0; i--)
+        {
+            auto const id = reader.ReadUint();
+            auto const type = reader.Read<SpecializationConstantType>();
+            desc.specialization.SetBits(id, type, reader.ReadUint());
+        }
+
+        for (auto i = reader.ReadCount(); i > 0; i--)
+        {
+            auto& binding = desc.vertexBindings.emplace_back();
+            binding.binding = reader.ReadUint();
+            binding.stride = reader.ReadUint();
+            binding.inputRate = reader.Read<vk::VertexInputRate>();
+        }
+
+        for (auto i = reader.ReadCount(); i > 0; i--)
+        {
+            auto& attribute = desc.vertexAttributes.emplace_back();
+            attribute.location = reader.ReadUint();
+            attribute.binding = reader.ReadUint();
+            attribute.format = reader.Read<vk::Format>();
+            attribute.offset = reader.ReadUint();
+        }
+
+        desc.topology = reader.Read<vk::PrimitiveTopology>();
+        desc.polygonMode = reader.Read<vk::PolygonMode>();
+        desc.cullMode = vk::CullModeFlags(reader.ReadUint());
+        desc.frontFace = reader.Read<vk::FrontFace>();
+        desc.depthTest = reader.ReadBool();
+        desc.depthWrite = reader.ReadBool();
+        desc.depthCompareOp = reader.Read<vk::CompareOp>();
+
+        desc.blend.blendEnable = reader.ReadUint();
+        desc.blend.srcColorBlendFactor = reader.Read<vk::BlendFactor>();
+        desc.blend.dstColorBlendFactor = reader.Read<vk::BlendFactor>();
+        desc.blend.colorBlendOp = reader.Read<vk::BlendOp>();
+        desc.blend.srcAlphaBlendFactor = reader.Read<vk::BlendFactor>();
+        desc.blend.dstAlphaBlendFactor = reader.Read<vk::BlendFactor>();
+        desc.blend.alphaBlendOp = reader.Read<vk::BlendOp>();
+        desc.blend.colorWriteMask = vk::ColorComponentFlags(reader.ReadUint());
+
+        for (auto i = reader.ReadCount(); i > 0; i--)
+        {
+            desc.renderTargets.colorFormats.push_back(reader.Read<vk::Format>());
+        }
+        desc.renderTargets.depthFormat = reader.Read<vk::Format>();
+        desc.renderTargets.samples = reader.Read<vk::SampleCountFlagBits>();
+
+        return desc;
+    }
+}
+
+void WritePipelineManifest(std::string const& fileName, std::span<PipelineDesc const> descs)
+{
+    ManifestWriter writer(fileName);
+    writer.Write(ManifestMagic);
+    writer.Write(ManifestVersion);
+    writer.Write(static_cast<uint32_t>(descs.size()));
+
+    for (auto const& desc : descs)
+    {
+        writeDesc(writer, desc);
+    }
+
+    writer.Finish();
+}
+
+std::vector<PipelineDesc> ReadPipelineManifest(std::string const& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+    {
+        return {};
+    }
+
+    ManifestReader reader(file);
+    if (reader.ReadUint() != ManifestMagic)
+    {
+        throw std::runtime_error(std::format("{} isn't a pipeline manifest", fileName));
+    }
+    if (auto const version = reader.ReadUint(); version != ManifestVersion)
+    {
+        throw std::runtime_error(std::format("{} is a version {} pipeline manifest, expected version {}", fileName,
+                                             version, ManifestVersion));
+    }
+
+    std::vector<PipelineDesc> descs(reader.ReadCount());
+    for (auto& desc : descs)
+    {
+        desc = readDesc(reader);
+    }
+
+    return descs;
+}
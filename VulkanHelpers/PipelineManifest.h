@@ -0,0 +1,9 @@
+#pragma once
+#include "PipelineCache.h"
+
+// The descriptions a session used, so the next one can compile them while loading instead of when they're first drawn.
+// Layouts are handles and aren't written, the descriptions come back with a null layout for the caller to fill in.
+void WritePipelineManifest(std::string const& fileName, std::span<PipelineDesc const> descs);
+
+// Nothing when the file doesn't exist, throws when it isn't a manifest of this version
+std::vector<PipelineDesc> ReadPipelineManifest(std::string const& fileName);
@@ -0,0 +1,425 @@
+#include "pch.h"
+#include "PngStreamDecoder.h"
+#include "ImageIngestHelpers.h"
+
+namespace
+{
+    constexpr std::array<uint8_t, 8> Signature = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    constexpr size_t ReadBufferSize = 64 * 1024;
+
+    enum ColorType : uint8_t
+    {
+        eGray = 0,
+        eRgb = 2,
+        ePalette = 3,
+        eGrayAlpha = 4,
+        eRgba = 6
+    };
+
+    constexpr auto CrcTable = []
+    {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < table.size(); i++)
+        {
+            auto value = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                value = value & 1 ? 0xEDB88320 ^ value >> 1 : value >> 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+
+    // Chunk CRCs cover the type and the data, start from the header's and finish with checkCrc
+    uint32_t updateCrc(uint32_t crc, uint8_t const* pData, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = CrcTable[(crc ^ pData[i]) & 0xFF] ^ crc >> 8;
+        }
+        return crc;
+    }
+
+    struct ChunkHeader
+    {
+        uint32_t length;
+        std::array<char, 4> type;
+        // Running CRC of the type, before the data
+        uint32_t crc;
+
+        std::string_view Name() const
+        {
+            return { type.data(), type.size() };
+        }
+
+        bool Is(std::string_view name) const
+        {
+            return Name() == name;
+        }
+    };
+
+    uint32_t readBigEndian(uint8_t const* pData)
+    {
+        return uint32_t{ pData[0] } << 24 | uint32_t{ pData[1] } << 16 | uint32_t{ pData[2] } << 8 | pData[3];
+    }
+
+    void readExact(std::ifstream& file, void* pDst, size_t size)
+    {
+        if (!file.read(static_cast<char*>(pDst), static_cast<std::streamsize>(size)))
+        {
+            throw std::runtime_error("PNG file is truncated");
+        }
+    }
+
+    ChunkHeader readChunkHeader(std::ifstream& file)
+    {
+        std::array<uint8_t, 8> bytes;
+        readExact(file, bytes.data(), bytes.size());
+
+        ChunkHeader header{ readBigEndian(bytes.data()) };
+        std::copy_n(bytes.begin() + 4, 4, header.type.begin());
+        header.crc = updateCrc(0xFFFFFFFF, bytes.data() + 4, 4);
+        return header;
+    }
+
+    void checkCrc(std::ifstream& file, uint32_t crc, std::string_view chunkName)
+    {
+        std::array<uint8_t, 4> bytes;
+        readExact(file, bytes.data(), bytes.size());
+
+        if (readBigEndian(bytes.data()) != (crc ^ 0xFFFFFFFF))
+        {
+            throw std::runtime_error(std::format("PNG {} chunk fails its CRC check", chunkName));
+        }
+    }
+
+    // Reads the data of a chunk the decoder uses and checks it against the chunk's CRC
+    std::vector<uint8_t> readChunkData(std::ifstream& file, ChunkHeader const& chunk)
+    {
+        std::vector<uint8_t> data(chunk.length);
+        readExact(file, data.data(), data.size());
+        checkCrc(file, updateCrc(chunk.crc, data.data(), data.size()), chunk.Name());
+        return data;
+    }
+
+    uint32_t getChannelCount(uint8_t colorType)
+    {
+        switch (colorType)
+        {
+        case eGray:
+        case ePalette:
+            return 1;
+        case eGrayAlpha:
+            return 2;
+        case eRgb:
+            return 3;
+        case eRgba:
+            return 4;
+        default:
+            throw std::runtime_error(std::format("Invalid PNG colour type {}", colorType));
+        }
+    }
+
+    uint8_t paethPredictor(int32_t left, int32_t above, int32_t upperLeft)
+    {
+        auto const estimate = left + above - upperLeft;
+        auto const leftDistance = std::abs(estimate - left);
+        auto const aboveDistance = std::abs(estimate - above);
+        auto const upperLeftDistance = std::abs(estimate - upperLeft);
+
+        if (leftDistance <= aboveDistance && leftDistance <= upperLeftDistance)
+        {
+            return static_cast<uint8_t>(left);
+        }
+        return static_cast<uint8_t>(aboveDistance <= upperLeftDistance ? above : upperLeft);
+    }
+}
+
+PngStreamDecoder::PngStreamDecoder(std::string const& fileName, uint32_t maxDimension /*= DefaultMaxDimension*/)
+    : m_file(fileName, std::ios::binary),
+      m_readBuffer(ReadBufferSize),
+      m_inflater([this] { return nextImageData(); })
+{
+    if (!m_file.is_open())
+    {
+        throw std::runtime_error(std::format("failed to open file: {}", fileName));
+    }
+
+    std::array<uint8_t, Signature.size()> signature;
+    readExact(m_file, signature.data(), signature.size());
+    if (signature != Signature)
+    {
+        throw std::runtime_error(std::format("{} is not a PNG file", fileName));
+    }
+
+    // Everything needed to decode comes before the first IDAT chunk, which is left for the inflater to read. Chunks
+    // the decoder has no use for are skipped unread, so only the CRCs of the others are checked.
+    bool hasImageData = false;
+    for (;;)
+    {
+        auto const chunk = readChunkHeader(m_file);
+
+        // May be empty, the inflater moves on to the next IDAT chunk once this one runs out
+        if (chunk.Is("IDAT"))
+        {
+            m_imageDataRemaining = chunk.length;
+            m_imageDataCrc = chunk.crc;
+            hasImageData = true;
+            break;
+        }
+
+        if (chunk.Is("IHDR"))
+        {
+            auto const header = readChunkData(m_file, chunk);
+            if (header.size() != 13)
+            {
+                throw std::runtime_error(std::format("{} has an invalid image header", fileName));
+            }
+
+            m_width = readBigEndian(header.data());
+            m_height = readBigEndian(header.data() + 4);
+            m_bitDepth = header[8];
+            m_colorType = header[9];
+            m_interlaced = header[12] != 0;
+            m_channels = getChannelCount(m_colorType);
+        }
+        else if (chunk.Is("PLTE"))
+        {
+            auto const palette = readChunkData(m_file, chunk);
+            m_palette.resize(palette.size() / 3);
+            for (size_t i = 0; i < m_palette.size(); i++)
+            {
+                m_palette[i] = { palette[i * 3], palette[i * 3 + 1], palette[i * 3 + 2], 0xFF };
+            }
+        }
+        else if (chunk.Is("tRNS"))
+        {
+            auto const alpha = readChunkData(m_file, chunk);
+            if (m_colorType == ePalette)
+            {
+                for (size_t i = 0; i < std::min(alpha.size(), m_palette.size()); i++)
+                {
+                    m_palette[i][3] = alpha[i];
+                }
+            }
+            else
+            {
+                m_hasColorKey = true;
+            }
+        }
+        else if (chunk.Is("IEND"))
+        {
+            break;
+        }
+        else
+        {
+            // The data and the CRC
+            m_file.seekg(static_cast<std::streamoff>(chunk.length) + 4, std::ios::cur);
+        }
+    }
+
+    if (m_width == 0 || m_height == 0)
+    {
+        throw std::runtime_error(std::format("{} has no image header", fileName));
+    }
+
+    if (m_width > maxDimension || m_height > maxDimension)
+    {
+        throw std::runtime_error(std::format("{} is {}x{}, larger than the {} texels allowed", fileName, m_width,
+                                             m_height, maxDimension));
+    }
+
+    if (!hasImageData)
+    {
+        throw std::runtime_error(std::format("{} has no image data", fileName));
+    }
+
+    // Both rows start zeroed, which is what the first row's filters expect above it
+    auto const rowBytes = static_cast<size_t>(m_width) * m_channels;
+    m_row.resize(rowBytes + 1);
+    m_previousRow.resize(rowBytes + 1);
+    m_rgbaRow.resize(static_cast<size_t>(m_width) * 4);
+}
+
+uint32_t PngStreamDecoder::GetWidth() const
+{
+    return m_width;
+}
+
+uint32_t PngStreamDecoder::GetHeight() const
+{
+    return m_height;
+}
+
+bool PngStreamDecoder::IsStreamable() const
+{
+    // A colour key needs a comparison against the 16 bit key per texel, left to the full decoder with the rest
+    return m_bitDepth == 8 && !m_interlaced && !m_hasColorKey && (m_colorType != ePalette || !m_palette.empty());
+}
+
+void PngStreamDecoder::ReadRows(uint8_t* pDst, uint32_t rowCount, size_t rowPitch, bool bgra)
+{
+    if (!IsStreamable())
+    {
+        throw std::runtime_error("PNG can't be decoded row by row");
+    }
+
+    if (m_rowsDecoded + rowCount > m_height)
+    {
+        throw std::runtime_error("Read past the last PNG row");
+    }
+
+    for (uint32_t row = 0; row < rowCount; row++, pDst += rowPitch)
+    {
+        std::swap(m_row, m_previousRow);
+        if (m_inflater.Read(m_row.data(), m_row.size()) != m_row.size())
+        {
+            throw std::runtime_error("PNG image data is truncated");
+        }
+
+        unfilterRow();
+
+        // RGBA rows are swizzled straight from the unfiltered data, other layouts are expanded to RGBA first
+        auto const* pRgba = m_row.data() + 1;
+        if (m_colorType != eRgba)
+        {
+            expandRow(m_rgbaRow.data());
+            pRgba = m_rgbaRow.data();
+        }
+
+        if (bgra)
+        {
+            SwizzleRgbaToBgra(pRgba, pDst, m_width);
+        }
+        else
+        {
+            memcpy(pDst, pRgba, m_rgbaRow.size());
+        }
+    }
+
+    m_rowsDecoded += rowCount;
+
+    // The rest of the image data only holds the checksums, reading it checks them before the last rows are used
+    if (m_rowsDecoded == m_height)
+    {
+        m_inflater.Finish();
+        while (!nextImageData().empty())
+        {
+        }
+    }
+}
+
+std::span<uint8_t const> PngStreamDecoder::nextImageData()
+{
+    // The image data may be split across any number of consecutive IDAT chunks
+    while (m_imageDataRemaining == 0)
+    {
+        if (m_imageDataDone)
+        {
+            return {};
+        }
+
+        checkCrc(m_file, m_imageDataCrc, "IDAT");
+
+        auto const chunk = readChunkHeader(m_file);
+        if (!chunk.Is("IDAT"))
+        {
+            m_imageDataDone = true;
+            return {};
+        }
+        m_imageDataRemaining = chunk.length;
+        m_imageDataCrc = chunk.crc;
+    }
+
+    auto const size = std::min<size_t>(m_imageDataRemaining, m_readBuffer.size());
+    readExact(m_file, m_readBuffer.data(), size);
+    m_imageDataRemaining -= static_cast<uint32_t>(size);
+    m_imageDataCrc = updateCrc(m_imageDataCrc, m_readBuffer.data(), size);
+
+    return { m_readBuffer.data(), size };
+}
+
+void PngStreamDecoder::unfilterRow()
+{
+    auto* pRow = m_row.data() + 1;
+    auto const* pAbove = m_previousRow.data() + 1;
+    auto const size = m_row.size() - 1;
+    auto const bpp = m_channels;
+
+    switch (m_row[0])
+    {
+    case 0:
+        break;
+    case 1:
+        for (size_t i = bpp; i < size; i++)
+        {
+            pRow[i] += pRow[i - bpp];
+        }
+        break;
+    case 2:
+        for (size_t i = 0; i < size; i++)
+        {
+            pRow[i] += pAbove[i];
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < bpp; i++)
+        {
+            pRow[i] += pAbove[i] / 2;
+        }
+        for (size_t i = bpp; i < size; i++)
+        {
+            pRow[i] += static_cast<uint8_t>((pRow[i - bpp] + pAbove[i]) / 2);
+        }
+        break;
+    case 4:
+        for (size_t i = 0; i < bpp; i++)
+        {
+            pRow[i] += pAbove[i];
+        }
+        for (size_t i = bpp; i < size; i++)
+        {
+            pRow[i] += paethPredictor(pRow[i - bpp], pAbove[i], pAbove[i - bpp]);
+        }
+        break;
+    default:
+        throw std::runtime_error(std::format("Invalid PNG filter type {}", m_row[0]));
+    }
+}
+
+void PngStreamDecoder::expandRow(uint8_t* pRgba) const
+{
+    auto const* pRow = m_row.data() + 1;
+
+    for (uint32_t x = 0; x < m_width; x++, pRgba += 4)
+    {
+        switch (m_colorType)
+        {
+        case eGray:
+            pRgba[0] = pRgba[1] = pRgba[2] = pRow[x];
+            pRgba[3] = 0xFF;
+            break;
+        case eGrayAlpha:
+            pRgba[0] = pRgba[1] = pRgba[2] = pRow[x * 2];
+            pRgba[3] = pRow[x * 2 + 1];
+            break;
+        case eRgb:
+            std::copy_n(pRow + x * 3, 3, pRgba);
+            pRgba[3] = 0xFF;
+            break;
+        case ePalette:
+        {
+            auto const index = pRow[x];
+            if (index >= m_palette.size())
+            {
+                throw std::runtime_error("PNG palette index out of range");
+            }
+            std::copy_n(m_palette[index].begin(), 4, pRgba);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "Inflater.h"
+
+// Decodes a PNG a few rows at a time, reading the file as the rows are asked for, so the whole image is never held
+// in memory. Only 8 bit non interlaced images are streamable, anything else has to go through a full decoder.
+class PngStreamDecoder
+{
+public:
+    // Larger than most devices can sample, still small enough for a row and the image size to fit any size_t math
+    static constexpr uint32_t DefaultMaxDimension = 16384;
+
+    // Reads the header chunks, throws if the file isn't a PNG or is wider or taller than maxDimension, typically the
+    // device's maxImageDimension2D, so nothing is allocated for a corrupt or hostile header
+    explicit PngStreamDecoder(std::string const& fileName, uint32_t maxDimension = DefaultMaxDimension);
+
+    PngStreamDecoder(PngStreamDecoder const&) = delete;
+    PngStreamDecoder& operator=(PngStreamDecoder const&) = delete;
+
+    uint32_t GetWidth() const;
+    uint32_t GetHeight() const;
+
+    bool IsStreamable() const;
+
+    // Decodes the next rowCount rows as RGBA8, or BGRA8 when bgra is set, into rows rowPitch bytes apart. Throws when
+    // the file is corrupt, the checksums of the image data are checked along with the last rows.
+    void ReadRows(uint8_t* pDst, uint32_t rowCount, size_t rowPitch, bool bgra);
+
+private:
+    std::span<uint8_t const> nextImageData();
+    void unfilterRow();
+    void expandRow(uint8_t* pRgba) const;
+
+    std::ifstream m_file;
+    std::vector<uint8_t> m_readBuffer;
+    // Bytes of the current IDAT chunk not read yet
+    uint32_t m_imageDataRemaining = 0;
+    // CRC of the current IDAT chunk up to the bytes read so far
+    uint32_t m_imageDataCrc = 0;
+    bool m_imageDataDone = false;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint8_t m_bitDepth = 0;
+    uint8_t m_colorType = 0;
+    bool m_interlaced = false;
+    bool m_hasColorKey = false;
+    uint32_t m_channels = 0;
+    std::vector<std::array<uint8_t, 4>> m_palette;
+
+    Inflater m_inflater;
+    uint32_t m_rowsDecoded = 0;
+    // The filter type byte followed by the row's channels, unfiltered rows are reconstructed against the previous one
+    std::vector<uint8_t> m_row;
+    std::vector<uint8_t> m_previousRow;
+    std::vector<uint8_t> m_rgbaRow;
+};
@@ -21,6 +21,583 @@ namespace
 
         return newVec;
     }
+
+    constexpr uint32_t SpirvMagic = 0x07230203;
+    constexpr size_t SpirvHeaderWords = 5;
+    // Universal limits of the SPIR-V specification, anything past them is a corrupt module
+    constexpr uint32_t SpirvMaxIdBound = 4194303;
+    constexpr uint32_t SpirvMaxStructMembers = 16383;
+
+    // The few SPIR-V enumerants reflection needs, values from the SPIR-V specification
+    enum SpirvOp : uint32_t
+    {
+        OpEntryPoint = 15,
+        OpTypeBool = 20,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpSpecConstantTrue = 48,
+        OpSpecConstantFalse = 49,
+        OpSpecConstant = 50,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+        OpTypeAccelerationStructureKHR = 5341
+    };
+
+    enum SpirvDecoration : uint32_t
+    {
+        DecorationSpecId = 1,
+        DecorationBlock = 2,
+        DecorationBufferBlock = 3,
+        DecorationArrayStride = 6,
+        DecorationMatrixStride = 7,
+        DecorationBuiltIn = 11,
+        DecorationLocation = 30,
+        DecorationBinding = 33,
+        DecorationDescriptorSet = 34,
+        DecorationOffset = 35
+    };
+
+    enum SpirvStorageClass : uint32_t
+    {
+        StorageClassUniformConstant = 0,
+        StorageClassInput = 1,
+        StorageClassUniform = 2,
+        StorageClassPushConstant = 9,
+        StorageClassStorageBuffer = 12
+    };
+
+    enum SpirvDim : uint32_t
+    {
+        DimBuffer = 5,
+        DimSubpassData = 6
+    };
+
+    struct SpirvId
+    {
+        uint32_t opcode = 0;
+        // Words after the result id, and after the result type for values
+        std::vector<uint32_t> operands;
+        uint32_t typeId = 0;
+        std::optional<uint32_t> set;
+        std::optional<uint32_t> binding;
+        std::optional<uint32_t> location;
+        std::optional<uint32_t> arrayStride;
+        std::optional<uint32_t> specId;
+        bool builtIn = false;
+        bool bufferBlock = false;
+        std::vector<uint32_t> memberOffsets;
+        std::vector<uint32_t> memberMatrixStrides;
+    };
+
+    void setMemberDecoration(std::vector<uint32_t>& values, uint32_t member, uint32_t value)
+    {
+        if (member >= SpirvMaxStructMembers)
+        {
+            throw std::runtime_error(std::format("SPIR-V struct member {} is out of bounds", member));
+        }
+
+        if (values.size() <= member)
+        {
+            values.resize(member + 1);
+        }
+
+        values[member] = value;
+    }
+
+    vk::ShaderStageFlagBits toShaderStage(uint32_t executionModel)
+    {
+        switch (executionModel)
+        {
+        case 0: return vk::ShaderStageFlagBits::eVertex;
+        case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+        case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+        case 3: return vk::ShaderStageFlagBits::eGeometry;
+        case 4: return vk::ShaderStageFlagBits::eFragment;
+        case 5: return vk::ShaderStageFlagBits::eCompute;
+        default:
+            throw std::runtime_error(std::format("Unsupported SPIR-V execution model {}", executionModel));
+        }
+    }
+
+    class SpirvModule
+    {
+    public:
+        explicit SpirvModule(std::vector<uint32_t> const& code)
+        {
+            if (code.size() < SpirvHeaderWords || code[0] != SpirvMagic)
+            {
+                throw std::runtime_error("Not a SPIR-V module");
+            }
+
+            // Every id is below the bound
+            if (code[3] > SpirvMaxIdBound)
+            {
+                throw std::runtime_error(std::format("SPIR-V id bound {} is out of bounds", code[3]));
+            }
+            m_ids.resize(code[3]);
+
+            for (size_t i = SpirvHeaderWords; i < code.size();)
+            {
+                auto const wordCount = code[i] >> 16;
+                auto const opcode = code[i] & 0xffff;
+
+                if (wordCount == 0 || i + wordCount > code.size())
+                {
+                    throw std::runtime_error("Truncated SPIR-V instruction");
+                }
+
+                parseInstruction(opcode, std::span(code.data() + i + 1, wordCount - 1));
+                i += wordCount;
+            }
+
+            if (!m_stage)
+            {
+                throw std::runtime_error("SPIR-V module has no entry point");
+            }
+        }
+
+        ShaderInterface Reflect() const
+        {
+            ShaderInterface shaderInterface{ *m_stage };
+
+            for (auto const& variable : m_ids)
+            {
+                // Constants computed from other specialization constants have no id of their own
+                if (isSpecConstant(variable.opcode) && variable.specId)
+                {
+                    shaderInterface.specializationConstants.push_back({ *variable.specId,
+                                                                        getSpecConstantType(get(variable.typeId)) });
+                    continue;
+                }
+
+                if (variable.opcode != OpVariable)
+                {
+                    continue;
+                }
+
+                auto const storageClass = operand(variable, 0);
+                auto const& pointee = get(operand(get(variable.typeId), 1));
+
+                switch (storageClass)
+                {
+                case StorageClassUniformConstant:
+                case StorageClassUniform:
+                case StorageClassStorageBuffer:
+                    shaderInterface.bindings.push_back(getBinding(variable, pointee, storageClass));
+                    break;
+                case StorageClassPushConstant:
+                    shaderInterface.pushConstantRanges.push_back(getPushConstantRange(pointee));
+                    break;
+                case StorageClassInput:
+                    if (*m_stage == vk::ShaderStageFlagBits::eVertex && !variable.builtIn)
+                    {
+                        if (!variable.location)
+                        {
+                            throw std::runtime_error("Vertex input without a location");
+                        }
+
+                        shaderInterface.vertexInputs.push_back({ *variable.location, getVertexInputFormat(pointee) });
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            std::ranges::sort(shaderInterface.bindings, {}, [](ShaderBinding const& binding)
+            {
+                return std::pair(binding.set, binding.binding);
+            });
+            std::ranges::sort(shaderInterface.vertexInputs, {}, &ShaderVertexInput::location);
+            std::ranges::sort(shaderInterface.specializationConstants, {}, &ShaderSpecializationConstant::id);
+
+            return shaderInterface;
+        }
+
+    private:
+        SpirvId const& get(uint32_t id) const
+        {
+            if (id >= m_ids.size() || m_ids[id].opcode == 0)
+            {
+                throw std::runtime_error(std::format("SPIR-V id {} is used but never defined", id));
+            }
+
+            return m_ids[id];
+        }
+
+        // Malformed modules can have fewer operands than their opcode calls for, or use a type where another kind
+        // belongs, so operands are never indexed unchecked
+        static uint32_t operand(SpirvId const& id, size_t index)
+        {
+            if (index >= id.operands.size())
+            {
+                throw std::runtime_error(std::format("SPIR-V instruction {} is missing operands", id.opcode));
+            }
+
+            return id.operands[index];
+        }
+
+        // Types can only refer to types defined before them, except through pointers. Checking that keeps a corrupt
+        // module from sending the walks over nested types round in circles.
+        void checkTypeOperands(uint32_t opcode, std::span<uint32_t const> operands) const
+        {
+            size_t typeOperandCount = 0;
+            switch (opcode)
+            {
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeImage:
+            case OpTypeSampledImage:
+            case OpTypeRuntimeArray:
+                typeOperandCount = 1;
+                break;
+            case OpTypeArray:
+                // The element type and the length constant
+                typeOperandCount = 2;
+                break;
+            case OpTypeStruct:
+                typeOperandCount = operands.size();
+                break;
+            default:
+                break;
+            }
+
+            for (auto const id : operands.first(std::min(typeOperandCount, operands.size())))
+            {
+                get(id);
+            }
+        }
+
+        void parseInstruction(uint32_t opcode, std::span<uint32_t const> words)
+        {
+            auto const define = [this, opcode](uint32_t id, std::span<uint32_t const> operands, uint32_t typeId = 0)
+            {
+                if (id >= m_ids.size())
+                {
+                    throw std::runtime_error(std::format("SPIR-V id {} is out of bounds", id));
+                }
+
+                if (m_ids[id].opcode != 0)
+                {
+                    throw std::runtime_error(std::format("SPIR-V id {} is defined twice", id));
+                }
+
+                checkTypeOperands(opcode, operands);
+
+                m_ids[id].opcode = opcode;
+                m_ids[id].operands.assign(operands.begin(), operands.end());
+                m_ids[id].typeId = typeId;
+            };
+
+            switch (opcode)
+            {
+            case OpEntryPoint:
+                // The first entry point decides the stage, modules here only ever have one
+                if (!m_stage && !words.empty())
+                {
+                    m_stage = toShaderStage(words[0]);
+                }
+                break;
+            case OpTypeBool:
+            case OpTypeInt:
+            case OpTypeFloat:
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeImage:
+            case OpTypeSampler:
+            case OpTypeSampledImage:
+            case OpTypeArray:
+            case OpTypeRuntimeArray:
+            case OpTypeStruct:
+            case OpTypePointer:
+            case OpTypeAccelerationStructureKHR:
+                if (!words.empty())
+                {
+                    define(words[0], words.subspan(1));
+                }
+                break;
+            case OpConstant:
+            case OpSpecConstantTrue:
+            case OpSpecConstantFalse:
+            case OpSpecConstant:
+            case OpVariable:
+                if (words.size() >= 2)
+                {
+                    define(words[1], words.subspan(2), words[0]);
+                }
+                break;
+            case OpDecorate:
+                if (words.size() >= 2)
+                {
+                    decorate(words[0], words[1], words.size() > 2 ? words[2] : 0);
+                }
+                break;
+            case OpMemberDecorate:
+                if (words.size() >= 4 && words[0] < m_ids.size())
+                {
+                    if (words[2] == DecorationOffset)
+                    {
+                        setMemberDecoration(m_ids[words[0]].memberOffsets, words[1], words[3]);
+                    }
+                    else if (words[2] == DecorationMatrixStride)
+                    {
+                        setMemberDecoration(m_ids[words[0]].memberMatrixStrides, words[1], words[3]);
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        void decorate(uint32_t id, uint32_t decoration, uint32_t value)
+        {
+            if (id >= m_ids.size())
+            {
+                throw std::runtime_error(std::format("SPIR-V id {} is out of bounds", id));
+            }
+
+            auto& target = m_ids[id];
+            switch (decoration)
+            {
+            case DecorationBufferBlock: target.bufferBlock = true; break;
+            case DecorationArrayStride: target.arrayStride = value; break;
+            case DecorationBuiltIn: target.builtIn = true; break;
+            case DecorationLocation: target.location = value; break;
+            case DecorationBinding: target.binding = value; break;
+            case DecorationDescriptorSet: target.set = value; break;
+            case DecorationSpecId: target.specId = value; break;
+            default: break;
+            }
+        }
+
+        ShaderBinding getBinding(SpirvId const& variable, SpirvId const& type, uint32_t storageClass) const
+        {
+            if (!variable.binding)
+            {
+                throw std::runtime_error("Shader resource without a binding");
+            }
+
+            // Arrays of resources become the descriptor count, arrays of arrays are flattened
+            uint32_t count = 1;
+            auto const* pElement = &type;
+            while (pElement->opcode == OpTypeArray || pElement->opcode == OpTypeRuntimeArray)
+            {
+                count = pElement->opcode == OpTypeArray ? count * getConstant(operand(*pElement, 1)) : 0;
+                pElement = &get(operand(*pElement, 0));
+            }
+
+            return {
+                variable.set.value_or(0),
+                *variable.binding,
+                getDescriptorType(*pElement, storageClass),
+                count,
+                *m_stage
+            };
+        }
+
+        vk::DescriptorType getDescriptorType(SpirvId const& type, uint32_t storageClass) const
+        {
+            if (storageClass == StorageClassStorageBuffer)
+            {
+                return vk::DescriptorType::eStorageBuffer;
+            }
+
+            if (storageClass == StorageClassUniform)
+            {
+                // Older SPIR-V marks storage buffers as buffer blocks in the uniform storage class
+                return type.bufferBlock ? vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eUniformBuffer;
+            }
+
+            switch (type.opcode)
+            {
+            case OpTypeSampler:
+                return vk::DescriptorType::eSampler;
+            case OpTypeSampledImage:
+                return operand(get(operand(type, 0)), 1) == DimBuffer ? vk::DescriptorType::eUniformTexelBuffer
+                                                                      : vk::DescriptorType::eCombinedImageSampler;
+            case OpTypeImage:
+            {
+                auto const dim = operand(type, 1);
+                // Sampled is 1 for images read through samplers and 2 for storage images
+                bool const storage = operand(type, 5) == 2;
+
+                if (dim == DimSubpassData)
+                {
+                    return vk::DescriptorType::eInputAttachment;
+                }
+                if (dim == DimBuffer)
+                {
+                    return storage ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+                }
+                return storage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+            }
+            case OpTypeAccelerationStructureKHR:
+                return vk::DescriptorType::eAccelerationStructureKHR;
+            default:
+                throw std::runtime_error(std::format("Unsupported SPIR-V resource type {}", type.opcode));
+            }
+        }
+
+        vk::PushConstantRange getPushConstantRange(SpirvId const& block) const
+        {
+            if (block.opcode != OpTypeStruct || block.operands.empty() ||
+                block.memberOffsets.size() < block.operands.size())
+            {
+                throw std::runtime_error("Push constant block without member offsets");
+            }
+
+            uint32_t begin = std::numeric_limits<uint32_t>::max();
+            uint32_t end = 0;
+            for (size_t member = 0; member < block.operands.size(); member++)
+            {
+                auto const offset = block.memberOffsets[member];
+                begin = std::min(begin, offset);
+                end = std::max(end, offset + getSize(operand(block, member), getMatrixStride(block, member)));
+            }
+
+            return { *m_stage, begin, end - begin };
+        }
+
+        uint32_t getSize(uint32_t typeId, uint32_t matrixStride = 0) const
+        {
+            auto const& type = get(typeId);
+
+            switch (type.opcode)
+            {
+            case OpTypeInt:
+            case OpTypeFloat:
+                return operand(type, 0) / 8;
+            case OpTypeVector:
+                return operand(type, 1) * getSize(operand(type, 0));
+            case OpTypeMatrix:
+                return operand(type, 1) * (matrixStride ? matrixStride : getSize(operand(type, 0)));
+            case OpTypeArray:
+                return getConstant(operand(type, 1)) * type.arrayStride.value_or(getSize(operand(type, 0)));
+            case OpTypeStruct:
+            {
+                uint32_t size = 0;
+                for (size_t member = 0; member < type.operands.size(); member++)
+                {
+                    auto const offset = member < type.memberOffsets.size() ? type.memberOffsets[member] : size;
+                    size = std::max(size, offset + getSize(operand(type, member), getMatrixStride(type, member)));
+                }
+                return size;
+            }
+            default:
+                throw std::runtime_error(std::format("SPIR-V type {} has no size", type.opcode));
+            }
+        }
+
+        static uint32_t getMatrixStride(SpirvId const& structType, size_t member)
+        {
+            return member < structType.memberMatrixStrides.size() ? structType.memberMatrixStrides[member] : 0;
+        }
+
+        uint32_t getConstant(uint32_t id) const
+        {
+            auto const& constant = get(id);
+            if (constant.opcode != OpConstant || constant.operands.empty())
+            {
+                throw std::runtime_error("Array length isn't a plain constant, specialized lengths aren't supported");
+            }
+
+            return operand(constant, 0);
+        }
+
+        static bool isSpecConstant(uint32_t opcode)
+        {
+            return opcode == OpSpecConstantTrue || opcode == OpSpecConstantFalse || opcode == OpSpecConstant;
+        }
+
+        static SpecializationConstantType getSpecConstantType(SpirvId const& type)
+        {
+            if (type.opcode == OpTypeBool)
+            {
+                return SpecializationConstantType::eBool;
+            }
+
+            if ((type.opcode != OpTypeInt && type.opcode != OpTypeFloat) || operand(type, 0) != 32)
+            {
+                throw std::runtime_error("Only bool and 32 bit specialization constants are supported");
+            }
+
+            if (type.opcode == OpTypeFloat)
+            {
+                return SpecializationConstantType::eFloat;
+            }
+            return operand(type, 1) ? SpecializationConstantType::eInt : SpecializationConstantType::eUint;
+        }
+
+        vk::Format getVertexInputFormat(SpirvId const& type) const
+        {
+            auto const& component = type.opcode == OpTypeVector ? get(operand(type, 0)) : type;
+            auto const componentCount = type.opcode == OpTypeVector ? operand(type, 1) : 1;
+
+            constexpr std::array floatFormats = {
+                vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat,
+                vk::Format::eR32G32B32A32Sfloat
+            };
+            constexpr std::array intFormats = {
+                vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint
+            };
+            constexpr std::array uintFormats = {
+                vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint
+            };
+
+            bool const supported = (component.opcode == OpTypeFloat || component.opcode == OpTypeInt) &&
+                                   operand(component, 0) == 32 && componentCount >= 1 && componentCount <= 4;
+            if (!supported)
+            {
+                throw std::runtime_error("Only 32 bit scalar and vector vertex inputs are supported");
+            }
+
+            if (component.opcode == OpTypeFloat)
+            {
+                return floatFormats[componentCount - 1];
+            }
+
+            // The second operand of an int type is its signedness
+            return operand(component, 1) ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+        }
+
+        std::vector<SpirvId> m_ids;
+        std::optional<vk::ShaderStageFlagBits> m_stage;
+    };
+
+    enum class NumericType
+    {
+        eFloat,
+        eSint,
+        eUint
+    };
+
+    // Normalized, scaled and float formats all read as floats in the shader
+    NumericType getNumericType(vk::Format format)
+    {
+        std::string_view const numericFormat = vk::componentNumericFormat(format, 0);
+
+        if (numericFormat == "SINT")
+        {
+            return NumericType::eSint;
+        }
+        if (numericFormat == "UINT")
+        {
+            return NumericType::eUint;
+        }
+        return NumericType::eFloat;
+    }
 }
 
 std::vector<uint32_t> ReadShaderFile(std::string const& fileName)
@@ -35,8 +612,118 @@ std::vector<uint32_t> ReadShaderFile(std::string const& fileName)
     return vectorCharToUInt32T(buffer);
 }
 
-vk::ShaderModule CreateShaderModule(vk::Device const& device, std::string const& fileName)
+vk::ShaderModule CreateShaderModule(vk::Device const& device, std::string const& fileName,
+                                    vk::AllocationCallbacks const* pAllocator /*= nullptr*/)
+{
+    return CreateShaderModule(device, ReadShaderFile(fileName), pAllocator);
+}
+
+vk::ShaderModule CreateShaderModule(vk::Device const& device, std::vector<uint32_t> const& code,
+                                    vk::AllocationCallbacks const* pAllocator /*= nullptr*/)
+{
+    return device.createShaderModule(vk::ShaderModuleCreateInfo{ {}, code }, pAllocator);
+}
+
+ShaderInterface ReflectShader(std::vector<uint32_t> const& code)
+{
+    return SpirvModule(code).Reflect();
+}
+
+ShaderInterface MergeShaderInterfaces(std::span<ShaderInterface const> interfaces)
 {
-    auto const shaderFile = ReadShaderFile(fileName);
-    return device.createShaderModule(vk::ShaderModuleCreateInfo{ {}, shaderFile });
+    ShaderInterface merged;
+
+    for (auto const& shaderInterface : interfaces)
+    {
+        merged.stages |= shaderInterface.stages;
+
+        for (auto const& binding : shaderInterface.bindings)
+        {
+            auto const existing = std::ranges::find_if(merged.bindings, [&binding](ShaderBinding const& other)
+            {
+                return other.set == binding.set && other.binding == binding.binding;
+            });
+
+            if (existing == merged.bindings.end())
+            {
+                merged.bindings.push_back(binding);
+            }
+            else if (existing->type == binding.type && existing->count == binding.count)
+            {
+                existing->stages |= binding.stages;
+            }
+            else
+            {
+                throw std::runtime_error(std::format("Shader stages disagree about set {} binding {}", binding.set,
+                                                     binding.binding));
+            }
+        }
+
+        // Stages reading the same bytes share a range
+        for (auto const& range : shaderInterface.pushConstantRanges)
+        {
+            auto const existing = std::ranges::find_if(merged.pushConstantRanges, [&range](auto const& other)
+            {
+                return other.offset == range.offset && other.size == range.size;
+            });
+
+            if (existing == merged.pushConstantRanges.end())
+            {
+                merged.pushConstantRanges.push_back(range);
+            }
+            else
+            {
+                existing->stageFlags |= range.stageFlags;
+            }
+        }
+
+        std::ranges::copy(shaderInterface.vertexInputs, std::back_inserter(merged.vertexInputs));
+
+        // Stages declaring the same constant get the same value
+        for (auto const& constant : shaderInterface.specializationConstants)
+        {
+            auto const existing = std::ranges::find(merged.specializationConstants, constant.id,
+                                                    &ShaderSpecializationConstant::id);
+
+            if (existing == merged.specializationConstants.end())
+            {
+                merged.specializationConstants.push_back(constant);
+            }
+            else if (existing->type != constant.type)
+            {
+                throw std::runtime_error(std::format("Shader stages disagree about the type of specialization "
+                                                     "constant {}", constant.id));
+            }
+        }
+    }
+
+    std::ranges::sort(merged.bindings, {}, [](ShaderBinding const& binding)
+    {
+        return std::pair(binding.set, binding.binding);
+    });
+    std::ranges::sort(merged.vertexInputs, {}, &ShaderVertexInput::location);
+    std::ranges::sort(merged.specializationConstants, {}, &ShaderSpecializationConstant::id);
+
+    return merged;
+}
+
+void CheckVertexInputs(ShaderInterface const& shaderInterface,
+                       std::span<vk::VertexInputAttributeDescription const> attributes)
+{
+    for (auto const& input : shaderInterface.vertexInputs)
+    {
+        auto const attribute = std::ranges::find(attributes, input.location,
+                                                 &vk::VertexInputAttributeDescription::location);
+        if (attribute == attributes.end())
+        {
+            throw std::runtime_error(std::format("No vertex attribute feeds shader input location {}",
+                                                 input.location));
+        }
+
+        if (getNumericType(attribute->format) != getNumericType(input.format))
+        {
+            throw std::runtime_error(std::format("Vertex attribute {} is {} but the shader reads {}", input.location,
+                                                 vk::to_string(attribute->format), vk::to_string(input.format)));
+        }
+    }
 }
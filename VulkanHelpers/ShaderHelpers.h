@@ -2,4 +2,64 @@
 
 std::vector<uint32_t> ReadShaderFile(std::string const& fileName);
 
-vk::ShaderModule CreateShaderModule(vk::Device const& device, std::string const& fileName);
\ No newline at end of file
+vk::ShaderModule CreateShaderModule(vk::Device const& device, std::string const& fileName,
+                                    vk::AllocationCallbacks const* pAllocator = nullptr);
+
+vk::ShaderModule CreateShaderModule(vk::Device const& device, std::vector<uint32_t> const& code,
+                                    vk::AllocationCallbacks const* pAllocator = nullptr);
+
+struct ShaderBinding
+{
+    uint32_t set;
+    uint32_t binding;
+    vk::DescriptorType type;
+    // Zero for runtime sized arrays
+    uint32_t count;
+    vk::ShaderStageFlags stages;
+};
+
+enum class SpecializationConstantType
+{
+    eBool,
+    eInt,
+    eUint,
+    eFloat
+};
+
+struct ShaderSpecializationConstant
+{
+    uint32_t id;
+    SpecializationConstantType type;
+};
+
+struct ShaderVertexInput
+{
+    uint32_t location;
+    // The 32 bit format of the input's type, attributes only have to match its numeric type
+    vk::Format format;
+};
+
+// What one or more shader stages expect the pipeline to provide
+struct ShaderInterface
+{
+    vk::ShaderStageFlags stages;
+    // Sorted by set, then binding
+    std::vector<ShaderBinding> bindings;
+    std::vector<vk::PushConstantRange> pushConstantRanges;
+    // Vertex stage only, sorted by location
+    std::vector<ShaderVertexInput> vertexInputs;
+    // Sorted by id
+    std::vector<ShaderSpecializationConstant> specializationConstants;
+};
+
+// Reads descriptor bindings, push constants, vertex inputs and specialization constants straight out of a SPIR-V
+// module. Every resource the module declares is listed whether or not the entry point uses it.
+ShaderInterface ReflectShader(std::vector<uint32_t> const& code);
+
+// The interface of the stages together, a binding used by several stages is visible to all of them. Throws when two
+// stages disagree about a binding or the type of a specialization constant.
+ShaderInterface MergeShaderInterfaces(std::span<ShaderInterface const> interfaces);
+
+// Throws unless every input of the vertex stage has an attribute of a matching numeric type
+void CheckVertexInputs(ShaderInterface const& shaderInterface,
+                       std::span<vk::VertexInputAttributeDescription const> attributes);
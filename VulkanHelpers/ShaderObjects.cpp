@@ -0,0 +1,393 @@
+#include "pch.h"
+#include "ShaderObjects.h"
+#include "PipelineCache.h"
+#include "ShaderHelpers.h"
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateShadersEXT(VkDevice device, uint32_t createInfoCount,
+                                                  const VkShaderCreateInfoEXT* pCreateInfos,
+                                                  const VkAllocationCallbacks* pAllocator, VkShaderEXT* pShaders)
+{
+    if (!FnVkCreateShadersEXT)
+    {
+        throw std::runtime_error("vkCreateShadersEXT was called before it was loaded");
+    }
+
+    return FnVkCreateShadersEXT(device, createInfoCount, pCreateInfos, pAllocator, pShaders);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyShaderEXT(VkDevice device, VkShaderEXT shader,
+                                              const VkAllocationCallbacks* pAllocator)
+{
+    if (!FnVkDestroyShaderEXT)
+    {
+        throw std::runtime_error("vkDestroyShaderEXT was called before it was loaded");
+    }
+
+    FnVkDestroyShaderEXT(device, shader, pAllocator);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBindShadersEXT(VkCommandBuffer commandBuffer, uint32_t stageCount,
+                                               const VkShaderStageFlagBits* pStages, const VkShaderEXT* pShaders)
+{
+    if (!FnVkCmdBindShadersEXT)
+    {
+        throw std::runtime_error("vkCmdBindShadersEXT was called before it was loaded");
+    }
+
+    FnVkCmdBindShadersEXT(commandBuffer, stageCount, pStages, pShaders);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetViewportWithCountEXT(VkCommandBuffer commandBuffer, uint32_t viewportCount,
+                                                        const VkViewport* pViewports)
+{
+    if (!FnVkCmdSetViewportWithCountEXT)
+    {
+        throw std::runtime_error("vkCmdSetViewportWithCountEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetViewportWithCountEXT(commandBuffer, viewportCount, pViewports);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetScissorWithCountEXT(VkCommandBuffer commandBuffer, uint32_t scissorCount,
+                                                       const VkRect2D* pScissors)
+{
+    if (!FnVkCmdSetScissorWithCountEXT)
+    {
+        throw std::runtime_error("vkCmdSetScissorWithCountEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetScissorWithCountEXT(commandBuffer, scissorCount, pScissors);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetVertexInputEXT(VkCommandBuffer commandBuffer, uint32_t vertexBindingDescriptionCount,
+                                                  const VkVertexInputBindingDescription2EXT* pVertexBindingDescriptions,
+                                                  uint32_t vertexAttributeDescriptionCount,
+                                                  const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions)
+{
+    if (!FnVkCmdSetVertexInputEXT)
+    {
+        throw std::runtime_error("vkCmdSetVertexInputEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetVertexInputEXT(commandBuffer, vertexBindingDescriptionCount, pVertexBindingDescriptions, vertexAttributeDescriptionCount, pVertexAttributeDescriptions);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetRasterizerDiscardEnableEXT(VkCommandBuffer commandBuffer,
+                                                              VkBool32 rasterizerDiscardEnable)
+{
+    if (!FnVkCmdSetRasterizerDiscardEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetRasterizerDiscardEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetRasterizerDiscardEnableEXT(commandBuffer, rasterizerDiscardEnable);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthBiasEnableEXT(VkCommandBuffer commandBuffer, VkBool32 depthBiasEnable)
+{
+    if (!FnVkCmdSetDepthBiasEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetDepthBiasEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetDepthBiasEnableEXT(commandBuffer, depthBiasEnable);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetPrimitiveRestartEnableEXT(VkCommandBuffer commandBuffer,
+                                                             VkBool32 primitiveRestartEnable)
+{
+    if (!FnVkCmdSetPrimitiveRestartEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetPrimitiveRestartEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetPrimitiveRestartEnableEXT(commandBuffer, primitiveRestartEnable);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthBoundsTestEnableEXT(VkCommandBuffer commandBuffer,
+                                                            VkBool32 depthBoundsTestEnable)
+{
+    if (!FnVkCmdSetDepthBoundsTestEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetDepthBoundsTestEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetDepthBoundsTestEnableEXT(commandBuffer, depthBoundsTestEnable);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetStencilTestEnableEXT(VkCommandBuffer commandBuffer, VkBool32 stencilTestEnable)
+{
+    if (!FnVkCmdSetStencilTestEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetStencilTestEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetStencilTestEnableEXT(commandBuffer, stencilTestEnable);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetPolygonModeEXT(VkCommandBuffer commandBuffer, VkPolygonMode polygonMode)
+{
+    if (!FnVkCmdSetPolygonModeEXT)
+    {
+        throw std::runtime_error("vkCmdSetPolygonModeEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetPolygonModeEXT(commandBuffer, polygonMode);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetRasterizationSamplesEXT(VkCommandBuffer commandBuffer,
+                                                           VkSampleCountFlagBits rasterizationSamples)
+{
+    if (!FnVkCmdSetRasterizationSamplesEXT)
+    {
+        throw std::runtime_error("vkCmdSetRasterizationSamplesEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetRasterizationSamplesEXT(commandBuffer, rasterizationSamples);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetSampleMaskEXT(VkCommandBuffer commandBuffer, VkSampleCountFlagBits samples,
+                                                 const VkSampleMask* pSampleMask)
+{
+    if (!FnVkCmdSetSampleMaskEXT)
+    {
+        throw std::runtime_error("vkCmdSetSampleMaskEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetSampleMaskEXT(commandBuffer, samples, pSampleMask);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetAlphaToCoverageEnableEXT(VkCommandBuffer commandBuffer,
+                                                            VkBool32 alphaToCoverageEnable)
+{
+    if (!FnVkCmdSetAlphaToCoverageEnableEXT)
+    {
+        throw std::runtime_error("vkCmdSetAlphaToCoverageEnableEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetAlphaToCoverageEnableEXT(commandBuffer, alphaToCoverageEnable);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetColorBlendEquationEXT(VkCommandBuffer commandBuffer, uint32_t firstAttachment,
+                                                         uint32_t attachmentCount,
+                                                         const VkColorBlendEquationEXT* pColorBlendEquations)
+{
+    if (!FnVkCmdSetColorBlendEquationEXT)
+    {
+        throw std::runtime_error("vkCmdSetColorBlendEquationEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetColorBlendEquationEXT(commandBuffer, firstAttachment, attachmentCount, pColorBlendEquations);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdSetColorWriteMaskEXT(VkCommandBuffer commandBuffer, uint32_t firstAttachment,
+                                                     uint32_t attachmentCount,
+                                                     const VkColorComponentFlags* pColorWriteMasks)
+{
+    if (!FnVkCmdSetColorWriteMaskEXT)
+    {
+        throw std::runtime_error("vkCmdSetColorWriteMaskEXT was called before it was loaded");
+    }
+
+    FnVkCmdSetColorWriteMaskEXT(commandBuffer, firstAttachment, attachmentCount, pColorWriteMasks);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderingKHR(VkCommandBuffer commandBuffer,
+                                                  const VkRenderingInfo* pRenderingInfo)
+{
+    if (!FnVkCmdBeginRenderingKHR)
+    {
+        throw std::runtime_error("vkCmdBeginRenderingKHR was called before it was loaded");
+    }
+
+    FnVkCmdBeginRenderingKHR(commandBuffer, pRenderingInfo);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderingKHR(VkCommandBuffer commandBuffer)
+{
+    if (!FnVkCmdEndRenderingKHR)
+    {
+        throw std::runtime_error("vkCmdEndRenderingKHR was called before it was loaded");
+    }
+
+    FnVkCmdEndRenderingKHR(commandBuffer);
+}
+
+bool SupportsShaderObject(vk::PhysicalDevice const& device)
+{
+    vk::PhysicalDeviceShaderObjectFeaturesEXT supported;
+    vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRendering{ {}, &supported };
+    vk::PhysicalDeviceFeatures2 features{ {}, &dynamicRendering };
+    device.getFeatures2(&features);
+
+    return supported.shaderObject && dynamicRendering.dynamicRendering;
+}
+
+bool LoadShaderObjectFunctions(vk::Device const& device)
+{
+    FnVkCreateShadersEXT = reinterpret_cast<PFN_vkCreateShadersEXT>(device.getProcAddr("vkCreateShadersEXT"));
+    FnVkDestroyShaderEXT = reinterpret_cast<PFN_vkDestroyShaderEXT>(device.getProcAddr("vkDestroyShaderEXT"));
+    FnVkCmdBindShadersEXT = reinterpret_cast<PFN_vkCmdBindShadersEXT>(device.getProcAddr("vkCmdBindShadersEXT"));
+    FnVkCmdSetViewportWithCountEXT = reinterpret_cast<PFN_vkCmdSetViewportWithCountEXT>(device.getProcAddr("vkCmdSetViewportWithCountEXT"));
+    FnVkCmdSetScissorWithCountEXT = reinterpret_cast<PFN_vkCmdSetScissorWithCountEXT>(device.getProcAddr("vkCmdSetScissorWithCountEXT"));
+    FnVkCmdSetVertexInputEXT = reinterpret_cast<PFN_vkCmdSetVertexInputEXT>(device.getProcAddr("vkCmdSetVertexInputEXT"));
+    FnVkCmdSetRasterizerDiscardEnableEXT = reinterpret_cast<PFN_vkCmdSetRasterizerDiscardEnableEXT>(device.getProcAddr("vkCmdSetRasterizerDiscardEnableEXT"));
+    FnVkCmdSetDepthBiasEnableEXT = reinterpret_cast<PFN_vkCmdSetDepthBiasEnableEXT>(device.getProcAddr("vkCmdSetDepthBiasEnableEXT"));
+    FnVkCmdSetPrimitiveRestartEnableEXT = reinterpret_cast<PFN_vkCmdSetPrimitiveRestartEnableEXT>(device.getProcAddr("vkCmdSetPrimitiveRestartEnableEXT"));
+    FnVkCmdSetDepthBoundsTestEnableEXT = reinterpret_cast<PFN_vkCmdSetDepthBoundsTestEnableEXT>(device.getProcAddr("vkCmdSetDepthBoundsTestEnableEXT"));
+    FnVkCmdSetStencilTestEnableEXT = reinterpret_cast<PFN_vkCmdSetStencilTestEnableEXT>(device.getProcAddr("vkCmdSetStencilTestEnableEXT"));
+    FnVkCmdSetPolygonModeEXT = reinterpret_cast<PFN_vkCmdSetPolygonModeEXT>(device.getProcAddr("vkCmdSetPolygonModeEXT"));
+    FnVkCmdSetRasterizationSamplesEXT = reinterpret_cast<PFN_vkCmdSetRasterizationSamplesEXT>(device.getProcAddr("vkCmdSetRasterizationSamplesEXT"));
+    FnVkCmdSetSampleMaskEXT = reinterpret_cast<PFN_vkCmdSetSampleMaskEXT>(device.getProcAddr("vkCmdSetSampleMaskEXT"));
+    FnVkCmdSetAlphaToCoverageEnableEXT = reinterpret_cast<PFN_vkCmdSetAlphaToCoverageEnableEXT>(device.getProcAddr("vkCmdSetAlphaToCoverageEnableEXT"));
+    FnVkCmdSetColorBlendEquationEXT = reinterpret_cast<PFN_vkCmdSetColorBlendEquationEXT>(device.getProcAddr("vkCmdSetColorBlendEquationEXT"));
+    FnVkCmdSetColorWriteMaskEXT = reinterpret_cast<PFN_vkCmdSetColorWriteMaskEXT>(device.getProcAddr("vkCmdSetColorWriteMaskEXT"));
+    FnVkCmdBeginRenderingKHR = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(device.getProcAddr("vkCmdBeginRenderingKHR"));
+    FnVkCmdEndRenderingKHR = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(device.getProcAddr("vkCmdEndRenderingKHR"));
+
+    if (!FnVkCreateShadersEXT || !FnVkDestroyShaderEXT || !FnVkCmdBindShadersEXT || !FnVkCmdSetViewportWithCountEXT ||
+        !FnVkCmdSetScissorWithCountEXT || !FnVkCmdSetVertexInputEXT || !FnVkCmdSetRasterizerDiscardEnableEXT ||
+        !FnVkCmdSetDepthBiasEnableEXT || !FnVkCmdSetPrimitiveRestartEnableEXT || !FnVkCmdSetDepthBoundsTestEnableEXT ||
+        !FnVkCmdSetStencilTestEnableEXT || !FnVkCmdSetPolygonModeEXT || !FnVkCmdSetRasterizationSamplesEXT ||
+        !FnVkCmdSetSampleMaskEXT || !FnVkCmdSetAlphaToCoverageEnableEXT || !FnVkCmdSetColorBlendEquationEXT ||
+        !FnVkCmdSetColorWriteMaskEXT || !FnVkCmdBeginRenderingKHR || !FnVkCmdEndRenderingKHR)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+ShaderObjectRenderer::ShaderObjectRenderer(
+    vk::Device const& device,
+    std::vector<vk::DescriptorSetLayout> setLayouts,
+    std::vector<vk::PushConstantRange> pushConstantRanges,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_setLayouts(std::move(setLayouts)),
+      m_pushConstantRanges(std::move(pushConstantRanges)),
+      m_pAllocator(pAllocator),
+      m_stateRecorder(ShaderObjectDynamicState)
+{
+}
+
+void ShaderObjectRenderer::Prepare(PipelineDesc const& desc)
+{
+    getShaders(desc);
+}
+
+void ShaderObjectRenderer::Begin(vk::CommandBuffer commandBuffer, vk::Extent2D extent)
+{
+    m_commandBuffer = commandBuffer;
+    m_stateRecorder.Begin(commandBuffer);
+    m_boundShaders.reset();
+
+    // Pipelines would have had these baked in, with shader objects nothing has a default
+    m_commandBuffer.setViewportWithCountEXT(vk::Viewport{ 0.0f, 0.0f, static_cast<float>(extent.width),
+                                                          static_cast<float>(extent.height), 0.0f, 1.0f });
+    m_commandBuffer.setScissorWithCountEXT(vk::Rect2D{ { 0, 0 }, extent });
+    m_commandBuffer.setRasterizerDiscardEnableEXT(false);
+    m_commandBuffer.setPrimitiveRestartEnableEXT(false);
+    m_commandBuffer.setDepthBiasEnableEXT(false);
+    m_commandBuffer.setDepthBoundsTestEnableEXT(false);
+    m_commandBuffer.setStencilTestEnableEXT(false);
+    m_commandBuffer.setAlphaToCoverageEnableEXT(false);
+    m_commandBuffer.setLineWidth(1.0f);
+}
+
+void ShaderObjectRenderer::Apply(PipelineDesc const& desc)
+{
+    auto const& shaders = getShaders(desc);
+    if (m_boundShaders && m_boundShaders->vertex == shaders.vertex && m_boundShaders->fragment == shaders.fragment)
+    {
+        m_stats.bindsSkipped++;
+    }
+    else
+    {
+        std::array const stages = { vk::ShaderStageFlagBits::eVertex, vk::ShaderStageFlagBits::eFragment };
+        std::array const stageShaders = { shaders.vertex, shaders.fragment };
+        m_commandBuffer.bindShadersEXT(stages, stageShaders);
+        m_boundShaders = shaders;
+        m_stats.binds++;
+    }
+
+    m_stateRecorder.Apply(desc);
+}
+
+ShaderObjectStats ShaderObjectRenderer::GetStats() const
+{
+    auto stats = m_stats;
+    auto const stateStats = m_stateRecorder.GetStats();
+    stats.setsRecorded += stateStats.setsRecorded;
+    stats.setsSkipped += stateStats.setsSkipped;
+
+    return stats;
+}
+
+void ShaderObjectRenderer::Destroy()
+{
+    for (auto const& shaders : m_shaders | std::views::values)
+    {
+        m_device.destroyShaderEXT(shaders.vertex, m_pAllocator);
+        m_device.destroyShaderEXT(shaders.fragment, m_pAllocator);
+    }
+
+    m_shaders.clear();
+    m_boundShaders.reset();
+}
+
+ShaderObjectRenderer::Shaders const& ShaderObjectRenderer::getShaders(PipelineDesc const& desc)
+{
+    PipelineDesc key;
+    key.vertexShader = desc.vertexShader;
+    key.fragmentShader = desc.fragmentShader;
+    key.specialization = desc.specialization;
+
+    if (auto const found = m_shaders.find(key); found != m_shaders.end())
+    {
+        return found->second;
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+
+    // The same SPIR-V files that pipelines load
+    auto const vertShaderCode = ReadShaderFile(desc.vertexShader);
+    auto const fragShaderCode = ReadShaderFile(desc.fragmentShader);
+
+    // Checked against the layout the shaders are first used with, like pipelines are
+    CheckPipelineShaders(desc, vertShaderCode, fragShaderCode);
+    auto const specialization = desc.specialization.GetInfo();
+
+    // Linked shaders let the driver optimize across the stages like it does for a pipeline
+    std::array const createInfos = {
+        vk::ShaderCreateInfoEXT{}
+            .setFlags(vk::ShaderCreateFlagBitsEXT::eLinkStage)
+            .setStage(vk::ShaderStageFlagBits::eVertex)
+            .setNextStage(vk::ShaderStageFlagBits::eFragment)
+            .setCodeType(vk::ShaderCodeTypeEXT::eSpirv)
+            .setCodeSize(vertShaderCode.size() * sizeof(uint32_t))
+            .setPCode(vertShaderCode.data())
+            .setPName("main")
+            .setSetLayouts(m_setLayouts)
+            .setPushConstantRanges(m_pushConstantRanges)
+            .setPSpecializationInfo(&specialization),
+        vk::ShaderCreateInfoEXT{}
+            .setFlags(vk::ShaderCreateFlagBitsEXT::eLinkStage)
+            .setStage(vk::ShaderStageFlagBits::eFragment)
+            .setCodeType(vk::ShaderCodeTypeEXT::eSpirv)
+            .setCodeSize(fragShaderCode.size() * sizeof(uint32_t))
+            .setPCode(fragShaderCode.data())
+            .setPName("main")
+            .setSetLayouts(m_setLayouts)
+            .setPushConstantRanges(m_pushConstantRanges)
+            .setPSpecializationInfo(&specialization)
+    };
+
+    auto const shaders = m_device.createShadersEXT(createInfos, m_pAllocator);
+
+    m_stats.shaders += static_cast<uint32_t>(shaders.size());
+    m_stats.createMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return m_shaders.emplace(key, Shaders{ shaders[0], shaders[1] }).first->second;
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include "DynamicState.h"
+
+// VK_EXT_shader_object and the extensions it depends on before Vulkan 1.3
+inline const std::vector ShaderObjectExtensions = {
+    VK_EXT_SHADER_OBJECT_EXTENSION_NAME,
+    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+    VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+    VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME
+};
+
+inline PFN_vkCreateShadersEXT                 FnVkCreateShadersEXT = nullptr;
+inline PFN_vkDestroyShaderEXT                 FnVkDestroyShaderEXT = nullptr;
+inline PFN_vkCmdBindShadersEXT                FnVkCmdBindShadersEXT = nullptr;
+inline PFN_vkCmdSetViewportWithCountEXT       FnVkCmdSetViewportWithCountEXT = nullptr;
+inline PFN_vkCmdSetScissorWithCountEXT        FnVkCmdSetScissorWithCountEXT = nullptr;
+inline PFN_vkCmdSetVertexInputEXT             FnVkCmdSetVertexInputEXT = nullptr;
+inline PFN_vkCmdSetRasterizerDiscardEnableEXT FnVkCmdSetRasterizerDiscardEnableEXT = nullptr;
+inline PFN_vkCmdSetDepthBiasEnableEXT         FnVkCmdSetDepthBiasEnableEXT = nullptr;
+inline PFN_vkCmdSetPrimitiveRestartEnableEXT  FnVkCmdSetPrimitiveRestartEnableEXT = nullptr;
+inline PFN_vkCmdSetDepthBoundsTestEnableEXT   FnVkCmdSetDepthBoundsTestEnableEXT = nullptr;
+inline PFN_vkCmdSetStencilTestEnableEXT       FnVkCmdSetStencilTestEnableEXT = nullptr;
+inline PFN_vkCmdSetPolygonModeEXT             FnVkCmdSetPolygonModeEXT = nullptr;
+inline PFN_vkCmdSetRasterizationSamplesEXT    FnVkCmdSetRasterizationSamplesEXT = nullptr;
+inline PFN_vkCmdSetSampleMaskEXT              FnVkCmdSetSampleMaskEXT = nullptr;
+inline PFN_vkCmdSetAlphaToCoverageEnableEXT   FnVkCmdSetAlphaToCoverageEnableEXT = nullptr;
+inline PFN_vkCmdSetColorBlendEquationEXT      FnVkCmdSetColorBlendEquationEXT = nullptr;
+inline PFN_vkCmdSetColorWriteMaskEXT          FnVkCmdSetColorWriteMaskEXT = nullptr;
+// Shader objects only draw inside dynamic rendering
+inline PFN_vkCmdBeginRenderingKHR             FnVkCmdBeginRenderingKHR = nullptr;
+inline PFN_vkCmdEndRenderingKHR               FnVkCmdEndRenderingKHR = nullptr;
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateShadersEXT(VkDevice device, uint32_t createInfoCount,
+                                                  const VkShaderCreateInfoEXT* pCreateInfos,
+                                                  const VkAllocationCallbacks* pAllocator, VkShaderEXT* pShaders);
+VKAPI_ATTR void VKAPI_CALL vkDestroyShaderEXT(VkDevice device, VkShaderEXT shader,
+                                              const VkAllocationCallbacks* pAllocator);
+VKAPI_ATTR void VKAPI_CALL vkCmdBindShadersEXT(VkCommandBuffer commandBuffer, uint32_t stageCount,
+                                               const VkShaderStageFlagBits* pStages, const VkShaderEXT* pShaders);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetViewportWithCountEXT(VkCommandBuffer commandBuffer, uint32_t viewportCount,
+                                                        const VkViewport* pViewports);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetScissorWithCountEXT(VkCommandBuffer commandBuffer, uint32_t scissorCount,
+                                                       const VkRect2D* pScissors);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetVertexInputEXT(VkCommandBuffer commandBuffer, uint32_t vertexBindingDescriptionCount,
+                                                  const VkVertexInputBindingDescription2EXT* pVertexBindingDescriptions,
+                                                  uint32_t vertexAttributeDescriptionCount,
+                                                  const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetRasterizerDiscardEnableEXT(VkCommandBuffer commandBuffer,
+                                                              VkBool32 rasterizerDiscardEnable);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthBiasEnableEXT(VkCommandBuffer commandBuffer, VkBool32 depthBiasEnable);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetPrimitiveRestartEnableEXT(VkCommandBuffer commandBuffer,
+                                                             VkBool32 primitiveRestartEnable);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetDepthBoundsTestEnableEXT(VkCommandBuffer commandBuffer,
+                                                            VkBool32 depthBoundsTestEnable);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetStencilTestEnableEXT(VkCommandBuffer commandBuffer, VkBool32 stencilTestEnable);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetPolygonModeEXT(VkCommandBuffer commandBuffer, VkPolygonMode polygonMode);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetRasterizationSamplesEXT(VkCommandBuffer commandBuffer,
+                                                           VkSampleCountFlagBits rasterizationSamples);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetSampleMaskEXT(VkCommandBuffer commandBuffer, VkSampleCountFlagBits samples,
+                                                 const VkSampleMask* pSampleMask);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetAlphaToCoverageEnableEXT(VkCommandBuffer commandBuffer,
+                                                            VkBool32 alphaToCoverageEnable);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetColorBlendEquationEXT(VkCommandBuffer commandBuffer, uint32_t firstAttachment,
+                                                         uint32_t attachmentCount,
+                                                         const VkColorBlendEquationEXT* pColorBlendEquations);
+VKAPI_ATTR void VKAPI_CALL vkCmdSetColorWriteMaskEXT(VkCommandBuffer commandBuffer, uint32_t firstAttachment,
+                                                     uint32_t attachmentCount,
+                                                     const VkColorComponentFlags* pColorWriteMasks);
+VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderingKHR(VkCommandBuffer commandBuffer,
+                                                  const VkRenderingInfo* pRenderingInfo);
+VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderingKHR(VkCommandBuffer commandBuffer);
+
+// Only call when the extensions are supported
+bool SupportsShaderObject(vk::PhysicalDevice const& device);
+
+// Has to be called after creating a device with the extensions and the shaderObject feature. The dynamic state
+// functions come from LoadDynamicStateFunctions with ShaderObjectDynamicState.
+bool LoadShaderObjectFunctions(vk::Device const& device);
+
+struct ShaderObjectStats
+{
+    uint32_t shaders = 0;
+    double createMs = 0.0;
+    uint64_t binds = 0;
+    // Binds of the shaders that were bound already
+    uint64_t bindsSkipped = 0;
+    uint64_t setsRecorded = 0;
+    uint64_t setsSkipped = 0;
+};
+
+// Draws descriptions without any pipeline: the vertex and fragment shader are shader objects linked to each other,
+// and everything else in the description is set while recording. Changing state costs a few commands instead of a
+// pipeline per combination, which suits views whose state keeps changing. Repeated binds and sets are left out.
+//
+// The shaders are created against the set layouts and push constant ranges given up front, the layout of a
+// description has to be made of those. Tessellation and geometry stages are never bound, the device must not have
+// those features enabled.
+class ShaderObjectRenderer
+{
+public:
+    ShaderObjectRenderer() = default;
+    ShaderObjectRenderer(vk::Device const& device, std::vector<vk::DescriptorSetLayout> setLayouts,
+                         std::vector<vk::PushConstantRange> pushConstantRanges,
+                         vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    // Creates the shaders of the description unless they exist, throws when the SPIR-V doesn't fit its vertex layout
+    // or the driver rejects it. Apply does the same for shaders it hasn't seen, this keeps that out of recording.
+    void Prepare(PipelineDesc const& desc);
+
+    // Sets the state descriptions don't cover, inside dynamic rendering of a single viewport covering the extent.
+    // Shader objects can't draw inside a render pass.
+    void Begin(vk::CommandBuffer commandBuffer, vk::Extent2D extent);
+
+    // Binds the shaders and sets the state of the next draws
+    void Apply(PipelineDesc const& desc);
+
+    ShaderObjectStats GetStats() const;
+
+    void Destroy();
+
+private:
+    struct Shaders
+    {
+        vk::ShaderEXT vertex;
+        vk::ShaderEXT fragment;
+    };
+
+    Shaders const& getShaders(PipelineDesc const& desc);
+
+    vk::Device m_device;
+    std::vector<vk::DescriptorSetLayout> m_setLayouts;
+    std::vector<vk::PushConstantRange> m_pushConstantRanges;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    // Keyed by the shader files and their specialization
+    std::unordered_map<PipelineDesc, Shaders, PipelineDescHash> m_shaders;
+
+    vk::CommandBuffer m_commandBuffer;
+    // Every piece of state a description holds
+    DynamicStateRecorder m_stateRecorder;
+    std::optional<Shaders> m_boundShaders;
+
+    ShaderObjectStats m_stats;
+};
@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "ShaderVariants.h"
+#include "HashHelpers.h"
+
+vk::SpecializationInfo ShaderVariant::GetInfo() const
+{
+    return {
+        static_cast<uint32_t>(m_entries.size()),
+        m_entries.data(),
+        m_data.size() * sizeof(uint32_t),
+        m_data.data()
+    };
+}
+
+std::span<vk::SpecializationMapEntry const> ShaderVariant::GetEntries() const
+{
+    return m_entries;
+}
+
+std::span<uint32_t const> ShaderVariant::GetData() const
+{
+    return m_data;
+}
+
+std::span<SpecializationConstantType const> ShaderVariant::GetTypes() const
+{
+    return m_types;
+}
+
+ShaderVariant& ShaderVariant::SetBits(uint32_t id, SpecializationConstantType type, uint32_t bits)
+{
+    auto const entry = std::ranges::lower_bound(m_entries, id, {}, &vk::SpecializationMapEntry::constantID);
+    auto const index = static_cast<size_t>(entry - m_entries.begin());
+
+    if (entry != m_entries.end() && entry->constantID == id)
+    {
+        m_types[index] = type;
+        m_data[index] = bits;
+        return *this;
+    }
+
+    // Kept sorted so variants setting the same values in any order compare equal
+    m_entries.insert(entry, vk::SpecializationMapEntry{ id, 0, sizeof(uint32_t) });
+    m_types.insert(m_types.begin() + index, type);
+    m_data.insert(m_data.begin() + index, bits);
+
+    for (size_t i = index; i < m_entries.size(); i++)
+    {
+        m_entries[i].offset = static_cast<uint32_t>(i * sizeof(uint32_t));
+    }
+
+    return *this;
+}
+
+size_t ShaderVariantHash::operator()(ShaderVariant const& variant) const
+{
+    size_t seed = 0;
+    for (auto const& entry : variant.GetEntries())
+    {
+        hashCombine(seed, entry.constantID);
+    }
+    for (auto const value : variant.GetData())
+    {
+        hashCombine(seed, value);
+    }
+
+    return seed;
+}
+
+void CheckShaderVariant(ShaderInterface const& shaderInterface, ShaderVariant const& variant)
+{
+    auto const entries = variant.GetEntries();
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        auto const id = entries[i].constantID;
+        auto const constant = std::ranges::find(shaderInterface.specializationConstants, id,
+                                                &ShaderSpecializationConstant::id);
+        if (constant == shaderInterface.specializationConstants.end())
+        {
+            // Mostly SPIR-V compiled before the constant was added to the GLSL
+            throw std::runtime_error(std::format("The shaders have no specialization constant {}, rebuild their "
+                                                 "SPIR-V if the GLSL declares it", id));
+        }
+
+        if (constant->type != variant.GetTypes()[i])
+        {
+            throw std::runtime_error(std::format("Specialization constant {} is set with another type than the "
+                                                 "shaders declare", id));
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "ShaderHelpers.h"
+
+// C++ binding of one specialization constant, declared next to the code that sets it with the constant_id and GLSL
+// type of the shader: bool, int, uint or float, or an enum of 32 bit underlying type standing in for an int
+template <typename T>
+struct SpecializationConstant
+{
+    static_assert(std::is_same_v<T, bool> || ((std::is_arithmetic_v<T> || std::is_enum_v<T>) && sizeof(T) == 4),
+                  "Specialization constants are bool or 32 bit scalars");
+
+    static constexpr SpecializationConstantType Type = []
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            return SpecializationConstantType::eBool;
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            return SpecializationConstantType::eFloat;
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            return std::is_signed_v<std::underlying_type_t<T>> ? SpecializationConstantType::eInt
+                                                               : SpecializationConstantType::eUint;
+        }
+        else
+        {
+            return std::is_signed_v<T> ? SpecializationConstantType::eInt : SpecializationConstantType::eUint;
+        }
+    }();
+
+    uint32_t id;
+};
+
+// Values for the specialization constants of a pair of shaders, the ones left out keep the default of the GLSL. Each
+// variant compiles into a pipeline of its own with the code the values disable removed by the driver, where
+// permutations of the GLSL would each need their own SPIR-V file.
+class ShaderVariant
+{
+public:
+    template <typename T>
+    ShaderVariant& Set(SpecializationConstant<T> constant, T value)
+    {
+        uint32_t bits;
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            bits = value ? VK_TRUE : VK_FALSE;
+        }
+        else
+        {
+            bits = std::bit_cast<uint32_t>(value);
+        }
+
+        SetBits(constant.id, SpecializationConstant<T>::Type, bits);
+        return *this;
+    }
+
+    // The raw 32 bits of a constant, for variants read back from a file. Set is the typed way.
+    ShaderVariant& SetBits(uint32_t id, SpecializationConstantType type, uint32_t bits);
+
+    // Points into the variant, which has to outlive the info
+    vk::SpecializationInfo GetInfo() const;
+
+    // Sorted by constant id, every value takes 4 bytes of the data
+    std::span<vk::SpecializationMapEntry const> GetEntries() const;
+    std::span<uint32_t const> GetData() const;
+    std::span<SpecializationConstantType const> GetTypes() const;
+
+    bool operator==(ShaderVariant const&) const = default;
+
+private:
+    std::vector<vk::SpecializationMapEntry> m_entries;
+    std::vector<SpecializationConstantType> m_types;
+    std::vector<uint32_t> m_data;
+};
+
+struct ShaderVariantHash
+{
+    size_t operator()(ShaderVariant const& variant) const;
+};
+
+// Throws unless the shaders declare every constant of the variant with the type it's set with. Without the check a
+// wrong id would be ignored and a wrong type reinterpreted without any error.
+void CheckShaderVariant(ShaderInterface const& shaderInterface, ShaderVariant const& variant);
@@ -0,0 +1,226 @@
+#include "pch.h"
+#include "StreamingImageUploader.h"
+
+StreamingImageUploader::StreamingImageUploader(
+    vk::Device const& device,
+    MemoryTracker& memoryTracker,
+    vk::Queue queue,
+    uint32_t queueFamilyIndex,
+    vk::DeviceSize stagingSize,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_pMemoryTracker(&memoryTracker),
+      m_queue(queue),
+      m_pAllocator(pAllocator),
+      // Slices start 16 byte aligned so every block size can be copied from their start
+      m_sliceSize(stagingSize / 2 & ~vk::DeviceSize{ 15 })
+{
+    vk::BufferCreateInfo const bufferInfo{
+        {},
+        m_sliceSize * 2,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::SharingMode::eExclusive
+    };
+
+    m_stagingBuffer = m_device.createBuffer(bufferInfo, m_pAllocator);
+
+    auto const memoryRequirements = m_device.getBufferMemoryRequirements(m_stagingBuffer);
+
+    // Rows are only ever written sequentially, so uncached write-combined memory is as fast as any
+    auto const memoryTypeIndex = memoryTracker.FindMemoryType(memoryRequirements.memoryTypeBits,
+                                                              vk::MemoryPropertyFlagBits::eHostVisible |
+                                                              vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                              memoryRequirements.size);
+    if (!memoryTypeIndex)
+    {
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    m_stagingMemory = memoryTracker.Allocate({ memoryRequirements.size, *memoryTypeIndex }, MemoryUsage::eStaging);
+    m_device.bindBufferMemory(m_stagingBuffer, m_stagingMemory, 0);
+    m_pMapped = static_cast<uint8_t*>(m_device.mapMemory(m_stagingMemory, 0, VK_WHOLE_SIZE, {}));
+
+    vk::CommandPoolCreateInfo const poolInfo{
+        vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        queueFamilyIndex
+    };
+
+    m_commandPool = m_device.createCommandPool(poolInfo, m_pAllocator);
+
+    vk::CommandBufferAllocateInfo const allocInfo{
+        m_commandPool,
+        vk::CommandBufferLevel::ePrimary,
+        static_cast<uint32_t>(m_slices.size())
+    };
+
+    auto const commandBuffers = m_device.allocateCommandBuffers(allocInfo);
+    for (size_t i = 0; i < m_slices.size(); i++)
+    {
+        m_slices[i].commandBuffer = commandBuffers[i];
+        m_slices[i].fence = m_device.createFence({}, m_pAllocator);
+    }
+}
+
+void StreamingImageUploader::RecordCommands(std::function<void(vk::CommandBuffer)> const& record)
+{
+    record(beginSlice().commandBuffer);
+}
+
+void StreamingImageUploader::UploadLevel(vk::Image image, vk::Format format, uint32_t mipLevel, uint32_t width,
+                                         uint32_t height, RowWriter const& writeRows)
+{
+    UploadRegion(image, format, mipLevel, 0, {}, width, height, writeRows);
+}
+
+void StreamingImageUploader::UploadRegion(vk::Image image, vk::Format format, uint32_t mipLevel, uint32_t arrayLayer,
+                                          vk::Offset2D offset, uint32_t width, uint32_t height,
+                                          RowWriter const& writeRows)
+{
+    auto const blockExtent = vk::blockExtent(format);
+    vk::DeviceSize const blockSize = vk::blockSize(format);
+
+    auto const rowPitch = static_cast<size_t>((width + blockExtent[0] - 1) / blockExtent[0]) * blockSize;
+    auto const rowCount = (height + blockExtent[1] - 1) / blockExtent[1];
+    // Copies have to start on a multiple of both the block size and 4
+    auto const alignment = std::lcm(blockSize, vk::DeviceSize{ 4 });
+
+    if (rowPitch > m_sliceSize)
+    {
+        throw std::runtime_error(std::format("{} byte rows don't fit in a {} byte staging slice", rowPitch,
+                                             m_sliceSize));
+    }
+
+    for (uint32_t firstRow = 0; firstRow < rowCount;)
+    {
+        auto& slice = beginSlice();
+
+        auto const offset = (m_sliceOffset + alignment - 1) / alignment * alignment;
+        auto const rowsFitting = offset < m_sliceSize ? (m_sliceSize - offset) / rowPitch : 0;
+        if (rowsFitting == 0)
+        {
+            Submit();
+            continue;
+        }
+
+        auto const rows = static_cast<uint32_t>(std::min<vk::DeviceSize>(rowsFitting, rowCount - firstRow));
+        auto const bufferOffset = m_currentSlice * m_sliceSize + offset;
+
+        writeRows(m_pMapped + bufferOffset, firstRow, rows, rowPitch);
+
+        // The last slice of a level may end on a partial block, copies are clamped to the level's extent
+        auto const y = firstRow * blockExtent[1];
+        vk::BufferImageCopy const region{
+            bufferOffset,
+            0,
+            0,
+            { vk::ImageAspectFlagBits::eColor, mipLevel, arrayLayer, 1 },
+            { offset.x, offset.y + static_cast<int32_t>(y), 0 },
+            { width, std::min(rows * blockExtent[1], height - y), 1 }
+        };
+
+        slice.commandBuffer.copyBufferToImage(m_stagingBuffer, image, vk::ImageLayout::eTransferDstOptimal, region);
+
+        m_sliceOffset = offset + rows * rowPitch;
+        firstRow += rows;
+
+        m_stats.bytesUploaded += rows * rowPitch;
+        m_stats.copyCount++;
+    }
+}
+
+void StreamingImageUploader::Submit()
+{
+    auto& slice = m_slices[m_currentSlice];
+    if (!slice.recording)
+    {
+        return;
+    }
+
+    slice.commandBuffer.end();
+
+    // Host writes to coherent memory are made visible to the device by the submission itself
+    vk::SubmitInfo const submitInfo{
+        {},
+        {},
+        slice.commandBuffer
+    };
+
+    m_queue.submit(submitInfo, slice.fence);
+
+    slice.recording = false;
+    slice.pending = true;
+    m_stats.submitCount++;
+
+    m_currentSlice = (m_currentSlice + 1) % m_slices.size();
+    m_sliceOffset = 0;
+}
+
+void StreamingImageUploader::Flush()
+{
+    Submit();
+
+    for (auto& slice : m_slices)
+    {
+        waitForSlice(slice);
+    }
+}
+
+vk::DeviceSize StreamingImageUploader::GetStagingSize() const
+{
+    return m_sliceSize * 2;
+}
+
+StreamingUploadStats const& StreamingImageUploader::GetStats() const
+{
+    return m_stats;
+}
+
+void StreamingImageUploader::Destroy()
+{
+    Flush();
+
+    for (auto const& slice : m_slices)
+    {
+        m_device.destroyFence(slice.fence, m_pAllocator);
+    }
+    m_device.destroyCommandPool(m_commandPool, m_pAllocator);
+
+    m_device.unmapMemory(m_stagingMemory);
+    m_device.destroyBuffer(m_stagingBuffer, m_pAllocator);
+    m_pMemoryTracker->Free(m_stagingMemory);
+}
+
+StreamingImageUploader::Slice& StreamingImageUploader::beginSlice()
+{
+    auto& slice = m_slices[m_currentSlice];
+    if (slice.recording)
+    {
+        return slice;
+    }
+
+    // The slice's staging memory may still be read by its last submission
+    waitForSlice(slice);
+
+    slice.commandBuffer.reset();
+    slice.commandBuffer.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+    slice.recording = true;
+
+    return slice;
+}
+
+void StreamingImageUploader::waitForSlice(Slice& slice)
+{
+    if (!slice.pending)
+    {
+        return;
+    }
+
+    auto const waitStart = std::chrono::steady_clock::now();
+
+    std::ignore = m_device.waitForFences(slice.fence, vk::True, UINT64_MAX);
+    m_device.resetFences(slice.fence);
+    slice.pending = false;
+
+    m_stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "MemoryTracker.h"
+
+struct StreamingUploadStats
+{
+    vk::DeviceSize bytesUploaded = 0;
+    uint32_t copyCount = 0;
+    uint32_t submitCount = 0;
+    // Time spent waiting for a staging slice to be copied out before it could be refilled
+    double stallMs = 0.0;
+};
+
+// Uploads images through a fixed size, persistently mapped staging buffer. Callers decode rows straight into the
+// mapped memory and the rows are copied out in slices, so images larger than the buffer stream through it. The buffer
+// is split in two halves that alternate, one filling on the CPU while the other is copied on the GPU.
+class StreamingImageUploader
+{
+public:
+    // Fills rowCount rows starting at firstRow, rowPitch bytes apart. Rows are block rows for compressed formats.
+    using RowWriter = std::function<void(uint8_t* pDst, uint32_t firstRow, uint32_t rowCount, size_t rowPitch)>;
+
+    StreamingImageUploader() = default;
+    StreamingImageUploader(vk::Device const& device, MemoryTracker& memoryTracker, vk::Queue queue,
+                           uint32_t queueFamilyIndex, vk::DeviceSize stagingSize,
+                           vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    // Records into the command buffer the next copies go to, e.g. the layout transitions around them
+    void RecordCommands(std::function<void(vk::CommandBuffer)> const& record);
+
+    // Expects the level in transfer dst layout. Throws if a single row doesn't fit in half the staging buffer.
+    void UploadLevel(vk::Image image, vk::Format format, uint32_t mipLevel, uint32_t width, uint32_t height,
+                     RowWriter const& writeRows);
+
+    // Same as UploadLevel for a block aligned rectangle of one layer, rows are the rectangle's rows
+    void UploadRegion(vk::Image image, vk::Format format, uint32_t mipLevel, uint32_t arrayLayer, vk::Offset2D offset,
+                      uint32_t width, uint32_t height, RowWriter const& writeRows);
+
+    // Submits whatever is recorded without waiting, later submissions to the queue are ordered after it
+    void Submit();
+
+    // Submits whatever is recorded and waits until every copy has completed
+    void Flush();
+
+    vk::DeviceSize GetStagingSize() const;
+    StreamingUploadStats const& GetStats() const;
+
+    void Destroy();
+
+private:
+    struct Slice
+    {
+        vk::CommandBuffer commandBuffer;
+        vk::Fence fence;
+        bool recording = false;
+        bool pending = false;
+    };
+
+    Slice& beginSlice();
+    void waitForSlice(Slice& slice);
+
+    vk::Device m_device;
+    MemoryTracker* m_pMemoryTracker = nullptr;
+    vk::Queue m_queue;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    vk::Buffer m_stagingBuffer;
+    vk::DeviceMemory m_stagingMemory;
+    uint8_t* m_pMapped = nullptr;
+    vk::DeviceSize m_sliceSize = 0;
+
+    vk::CommandPool m_commandPool;
+    std::array<Slice, 2> m_slices;
+    size_t m_currentSlice = 0;
+    // Bytes of the current slice already holding rows waiting to be copied
+    vk::DeviceSize m_sliceOffset = 0;
+
+    StreamingUploadStats m_stats;
+};
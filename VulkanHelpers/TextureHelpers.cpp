@@ -0,0 +1,350 @@
+#include "pch.h"
+#include "TextureHelpers.h"
+
+#include "ShaderHelpers.h"
+
+namespace
+{
+    constexpr uint32_t MipmapWorkgroupSize = 8;
+
+    vk::ImageSubresourceLayers colorLayers(uint32_t mipLevel, uint32_t layerCount = 1)
+    {
+        return { vk::ImageAspectFlagBits::eColor, mipLevel, 0, layerCount };
+    }
+
+    vk::ImageSubresourceRange colorRange(uint32_t baseMipLevel, uint32_t levelCount, uint32_t layerCount = 1)
+    {
+        return { vk::ImageAspectFlagBits::eColor, baseMipLevel, levelCount, 0, layerCount };
+    }
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    for (auto size = std::max(width, height); size > 1; size >>= 1)
+    {
+        levels++;
+    }
+
+    return levels;
+}
+
+bool IsSrgbFormat(vk::Format format)
+{
+    switch (format)
+    {
+    case vk::Format::eR8G8B8A8Srgb:
+    case vk::Format::eB8G8R8A8Srgb:
+    case vk::Format::eR8G8B8Srgb:
+    case vk::Format::eB8G8R8Srgb:
+    case vk::Format::eA8B8G8R8SrgbPack32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+vk::Format GetStorageCompatibleFormat(vk::Format format)
+{
+    switch (format)
+    {
+    case vk::Format::eR8G8B8A8Srgb:
+        return vk::Format::eR8G8B8A8Unorm;
+    case vk::Format::eB8G8R8A8Srgb:
+        return vk::Format::eB8G8R8A8Unorm;
+    case vk::Format::eR8G8B8Srgb:
+        return vk::Format::eR8G8B8Unorm;
+    case vk::Format::eB8G8R8Srgb:
+        return vk::Format::eB8G8R8Unorm;
+    case vk::Format::eA8B8G8R8SrgbPack32:
+        return vk::Format::eA8B8G8R8UnormPack32;
+    default:
+        return format;
+    }
+}
+
+bool SupportsLinearBlit(vk::PhysicalDevice const& device, vk::Format format)
+{
+    constexpr vk::FormatFeatureFlags requiredFeatures =
+        vk::FormatFeatureFlagBits::eBlitSrc |
+        vk::FormatFeatureFlagBits::eBlitDst |
+        vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+
+    auto const features = device.getFormatProperties(format).optimalTilingFeatures;
+    return (features & requiredFeatures) == requiredFeatures;
+}
+
+bool SupportsComputeMipmaps(vk::PhysicalDevice const& device, vk::Format format)
+{
+    auto const sampledFeatures = device.getFormatProperties(format).optimalTilingFeatures;
+    auto const storageFeatures = device.getFormatProperties(GetStorageCompatibleFormat(format)).optimalTilingFeatures;
+
+    return static_cast<bool>(sampledFeatures & vk::FormatFeatureFlagBits::eSampledImage) &&
+           static_cast<bool>(storageFeatures & vk::FormatFeatureFlagBits::eStorageImage);
+}
+
+vk::ImageMemoryBarrier MakeMipBarrier(
+    vk::Image image,
+    vk::AccessFlags srcAccess,
+    vk::AccessFlags dstAccess,
+    vk::ImageLayout oldLayout,
+    vk::ImageLayout newLayout,
+    uint32_t baseMipLevel,
+    uint32_t levelCount,
+    uint32_t layerCount /*= 1*/
+)
+{
+    return {
+        srcAccess,
+        dstAccess,
+        oldLayout,
+        newLayout,
+        vk::QueueFamilyIgnored,
+        vk::QueueFamilyIgnored,
+        image,
+        colorRange(baseMipLevel, levelCount, layerCount)
+    };
+}
+
+void RecordBlitMipmaps(vk::CommandBuffer commandBuffer, vk::Image image, uint32_t width, uint32_t height,
+                       uint32_t mipLevels, uint32_t layerCount /*= 1*/)
+{
+    auto mipWidth = static_cast<int32_t>(width);
+    auto mipHeight = static_cast<int32_t>(height);
+
+    for (uint32_t level = 1; level < mipLevels; level++)
+    {
+        std::vector toSource = {
+            MakeMipBarrier(image, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead,
+                           vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal, level - 1, 1,
+                           layerCount)
+        };
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {},
+                                      {}, {}, toSource);
+
+        auto const nextWidth = std::max(mipWidth / 2, 1);
+        auto const nextHeight = std::max(mipHeight / 2, 1);
+
+        std::vector blits = {
+            vk::ImageBlit {
+                colorLayers(level - 1, layerCount),
+                std::array { vk::Offset3D { 0, 0, 0 }, vk::Offset3D { mipWidth, mipHeight, 1 } },
+                colorLayers(level, layerCount),
+                std::array { vk::Offset3D { 0, 0, 0 }, vk::Offset3D { nextWidth, nextHeight, 1 } }
+            }
+        };
+
+        commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal,
+                                blits, vk::Filter::eLinear);
+
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+    }
+
+    // Every level but the last ended up as a blit source, both groups are moved to shader reads in one barrier
+    std::vector<vk::ImageMemoryBarrier> toShaderRead;
+    if (mipLevels > 1)
+    {
+        toShaderRead.push_back(
+            MakeMipBarrier(image, vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead,
+                           vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, 0, mipLevels - 1,
+                           layerCount));
+    }
+    toShaderRead.push_back(
+        MakeMipBarrier(image, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                       vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, mipLevels - 1, 1,
+                       layerCount));
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {},
+                                  {}, {}, toShaderRead);
+}
+
+ComputeMipmapGenerator::ComputeMipmapGenerator(
+    vk::Device const& device,
+    std::string const& shaderFileName,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device), m_pAllocator(pAllocator)
+{
+    std::vector bindings = {
+        vk::DescriptorSetLayoutBinding
+        {
+            0,
+            vk::DescriptorType::eCombinedImageSampler,
+            1,
+            vk::ShaderStageFlagBits::eCompute
+        },
+        vk::DescriptorSetLayoutBinding
+        {
+            1,
+            vk::DescriptorType::eStorageImage,
+            1,
+            vk::ShaderStageFlagBits::eCompute
+        }
+    };
+
+    m_descriptorSetLayout = m_device.createDescriptorSetLayout({ {}, bindings }, m_pAllocator);
+
+    std::vector setLayouts = { m_descriptorSetLayout };
+    std::vector pushConstantRanges = {
+        vk::PushConstantRange { vk::ShaderStageFlagBits::eCompute, 0, sizeof(PushConstants) }
+    };
+
+    m_pipelineLayout = m_device.createPipelineLayout({ {}, setLayouts, pushConstantRanges }, m_pAllocator);
+
+    auto const shaderModule = CreateShaderModule(m_device, shaderFileName, m_pAllocator);
+
+    vk::ComputePipelineCreateInfo const pipelineCreateInfo{
+        {},
+        { {}, vk::ShaderStageFlagBits::eCompute, shaderModule, "main" },
+        m_pipelineLayout
+    };
+
+    auto pipelineResult = m_device.createComputePipeline(nullptr, pipelineCreateInfo, m_pAllocator);
+    m_device.destroyShaderModule(shaderModule, m_pAllocator);
+
+    resultCheck(pipelineResult.result, "Failed to create mipmap pipeline!");
+    m_pipeline = pipelineResult.value;
+
+    // The shader only uses texelFetch, so filtering never applies
+    vk::SamplerCreateInfo samplerInfo{};
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+
+    m_sampler = m_device.createSampler(samplerInfo, m_pAllocator);
+}
+
+void ComputeMipmapGenerator::Record(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format, uint32_t width,
+                                    uint32_t height, uint32_t mipLevels)
+{
+    if (mipLevels < 2)
+    {
+        std::vector toShaderRead = {
+            MakeMipBarrier(image, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                           vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, 0, 1)
+        };
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                      {}, {}, {}, toShaderRead);
+        return;
+    }
+
+    auto const dispatchCount = mipLevels - 1;
+
+    std::vector poolSizes = {
+        vk::DescriptorPoolSize { vk::DescriptorType::eCombinedImageSampler, dispatchCount },
+        vk::DescriptorPoolSize { vk::DescriptorType::eStorageImage, dispatchCount }
+    };
+
+    auto const descriptorPool = m_device.createDescriptorPool({ {}, dispatchCount, poolSizes }, m_pAllocator);
+    m_transientPools.push_back(descriptorPool);
+
+    std::vector setLayouts(dispatchCount, m_descriptorSetLayout);
+    auto const descriptorSets = m_device.allocateDescriptorSets({ descriptorPool, setLayouts });
+
+    // Level 0 becomes the first source, the rest are written by the shader before being read in turn
+    std::vector initialBarriers = {
+        MakeMipBarrier(image, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                       vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, 0, 1),
+        MakeMipBarrier(image, {}, vk::AccessFlagBits::eShaderWrite,
+                       vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eGeneral, 1, dispatchCount)
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {},
+                                  {}, {}, initialBarriers);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipeline);
+
+    auto const storageFormat = GetStorageCompatibleFormat(format);
+    bool const encodeSrgb = IsSrgbFormat(format);
+
+    for (uint32_t level = 1; level < mipLevels; level++)
+    {
+        // The sRGB view decodes to linear on fetch, the storage view needs the UNORM alias so the shader encodes
+        vk::ImageViewUsageCreateInfo sampledUsage{ vk::ImageUsageFlagBits::eSampled };
+        auto const srcView = m_device.createImageView(
+            { {}, image, vk::ImageViewType::e2D, format, {}, colorRange(level - 1, 1), &sampledUsage },
+            m_pAllocator);
+
+        vk::ImageViewUsageCreateInfo storageUsage{ vk::ImageUsageFlagBits::eStorage };
+        auto const dstView = m_device.createImageView(
+            { {}, image, vk::ImageViewType::e2D, storageFormat, {}, colorRange(level, 1), &storageUsage },
+            m_pAllocator);
+
+        m_transientViews.push_back(srcView);
+        m_transientViews.push_back(dstView);
+
+        auto const& descriptorSet = descriptorSets[level - 1];
+
+        std::vector srcInfos = {
+            vk::DescriptorImageInfo { m_sampler, srcView, vk::ImageLayout::eShaderReadOnlyOptimal }
+        };
+        std::vector dstInfos = {
+            vk::DescriptorImageInfo { nullptr, dstView, vk::ImageLayout::eGeneral }
+        };
+
+        std::vector descriptorWrites = {
+            vk::WriteDescriptorSet { descriptorSet, 0, 0, vk::DescriptorType::eCombinedImageSampler, srcInfos },
+            vk::WriteDescriptorSet { descriptorSet, 1, 0, vk::DescriptorType::eStorageImage, dstInfos }
+        };
+
+        m_device.updateDescriptorSets(descriptorWrites, {});
+
+        PushConstants const pushConstants{
+            static_cast<int32_t>(std::max(width >> level, 1u)),
+            static_cast<int32_t>(std::max(height >> level, 1u)),
+            encodeSrgb ? 1u : 0u
+        };
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pipelineLayout, 0, descriptorSet, {});
+        commandBuffer.pushConstants(m_pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PushConstants),
+                                    &pushConstants);
+        commandBuffer.dispatch(
+            (pushConstants.dstWidth + MipmapWorkgroupSize - 1) / MipmapWorkgroupSize,
+            (pushConstants.dstHeight + MipmapWorkgroupSize - 1) / MipmapWorkgroupSize,
+            1
+        );
+
+        std::vector toSource = {
+            MakeMipBarrier(image, vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+                           vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal, level, 1)
+        };
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                      {}, {}, {}, toSource);
+    }
+
+    std::vector toFragment = {
+        vk::MemoryBarrier { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead }
+    };
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader,
+                                  {}, toFragment, {}, {});
+}
+
+void ComputeMipmapGenerator::ReleaseTransientResources()
+{
+    for (auto const& view : m_transientViews)
+    {
+        m_device.destroyImageView(view, m_pAllocator);
+    }
+    m_transientViews.clear();
+
+    // Destroying the pools frees their sets
+    for (auto const& pool : m_transientPools)
+    {
+        m_device.destroyDescriptorPool(pool, m_pAllocator);
+    }
+    m_transientPools.clear();
+}
+
+void ComputeMipmapGenerator::Destroy()
+{
+    ReleaseTransientResources();
+
+    m_device.destroySampler(m_sampler, m_pAllocator);
+    m_device.destroyPipeline(m_pipeline, m_pAllocator);
+    m_device.destroyPipelineLayout(m_pipelineLayout, m_pAllocator);
+    m_device.destroyDescriptorSetLayout(m_descriptorSetLayout, m_pAllocator);
+}
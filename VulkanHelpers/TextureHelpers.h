@@ -0,0 +1,56 @@
+#pragma once
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+bool IsSrgbFormat(vk::Format format);
+// The UNORM format sharing the sRGB format's layout, storage images can't be sRGB
+vk::Format GetStorageCompatibleFormat(vk::Format format);
+
+bool SupportsLinearBlit(vk::PhysicalDevice const& device, vk::Format format);
+bool SupportsComputeMipmaps(vk::PhysicalDevice const& device, vk::Format format);
+
+vk::ImageMemoryBarrier MakeMipBarrier(vk::Image image, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess,
+                                      vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+                                      uint32_t baseMipLevel, uint32_t levelCount, uint32_t layerCount = 1);
+
+// Expects every level in transfer dst layout with level 0 filled, leaves them all shader read only.
+// Every layer of an array is filtered by the same blits.
+void RecordBlitMipmaps(vk::CommandBuffer commandBuffer, vk::Image image, uint32_t width, uint32_t height,
+                       uint32_t mipLevels, uint32_t layerCount = 1);
+
+// Generates mip chains with a compute shader for formats that can't be linearly blitted.
+// Images need the storage usage, and the mutable format flag when they are sRGB.
+class ComputeMipmapGenerator
+{
+public:
+    ComputeMipmapGenerator() = default;
+    ComputeMipmapGenerator(vk::Device const& device, std::string const& shaderFileName,
+                           vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    // Same layout expectations as RecordBlitMipmaps
+    void Record(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format, uint32_t width, uint32_t height,
+                uint32_t mipLevels);
+
+    // Frees the views and descriptor sets used by recorded work, only call once that work has completed
+    void ReleaseTransientResources();
+    void Destroy();
+
+private:
+    struct PushConstants
+    {
+        int32_t dstWidth;
+        int32_t dstHeight;
+        uint32_t encodeSrgb;
+    };
+
+    vk::Device m_device;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    vk::DescriptorSetLayout m_descriptorSetLayout;
+    vk::PipelineLayout m_pipelineLayout;
+    vk::Pipeline m_pipeline;
+    vk::Sampler m_sampler;
+
+    std::vector<vk::DescriptorPool> m_transientPools;
+    std::vector<vk::ImageView> m_transientViews;
+};
@@ -0,0 +1,489 @@
+#include "pch.h"
+#include "TexturePacker.h"
+#include "TextureHelpers.h"
+#include "HostImageCopy.h"
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height)
+    : m_width(width),
+      m_height(height),
+      m_skyline{ { 0, 0, width } }
+{
+}
+
+std::optional<PackedRect> SkylinePacker::Pack(uint32_t width, uint32_t height)
+{
+    std::optional<size_t> bestIndex;
+    uint32_t bestY = 0;
+
+    for (size_t i = 0; i < m_skyline.size(); i++)
+    {
+        auto const y = fitAt(i, width, height);
+        if (y && (!bestIndex || *y < bestY))
+        {
+            bestIndex = i;
+            bestY = *y;
+        }
+    }
+
+    if (!bestIndex)
+    {
+        return std::nullopt;
+    }
+
+    auto const x = m_skyline[*bestIndex].x;
+    m_skyline.insert(m_skyline.begin() + static_cast<ptrdiff_t>(*bestIndex), { x, bestY + height, width });
+
+    // Segments now under the rectangle are cut back to where it ends
+    for (auto i = *bestIndex + 1; i < m_skyline.size();)
+    {
+        auto& segment = m_skyline[i];
+        auto const right = x + width;
+        if (segment.x >= right)
+        {
+            break;
+        }
+
+        auto const overlap = right - segment.x;
+        if (segment.width <= overlap)
+        {
+            m_skyline.erase(m_skyline.begin() + static_cast<ptrdiff_t>(i));
+            continue;
+        }
+
+        segment.x += overlap;
+        segment.width -= overlap;
+        break;
+    }
+
+    for (size_t i = 0; i + 1 < m_skyline.size();)
+    {
+        if (m_skyline[i].y == m_skyline[i + 1].y)
+        {
+            m_skyline[i].width += m_skyline[i + 1].width;
+            m_skyline.erase(m_skyline.begin() + static_cast<ptrdiff_t>(i) + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    m_usedArea += static_cast<uint64_t>(width) * height;
+
+    return PackedRect{ x, bestY };
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+    return static_cast<float>(static_cast<double>(m_usedArea) / (static_cast<double>(m_width) * m_height));
+}
+
+std::optional<uint32_t> SkylinePacker::fitAt(size_t index, uint32_t width, uint32_t height) const
+{
+    if (m_skyline[index].x + width > m_width)
+    {
+        return std::nullopt;
+    }
+
+    // The rectangle rests on the highest segment it spans
+    uint32_t y = 0;
+    uint32_t remaining = width;
+    for (auto i = index; remaining > 0; i++)
+    {
+        y = std::max(y, m_skyline[i].y);
+        if (y + height > m_height)
+        {
+            return std::nullopt;
+        }
+
+        remaining -= std::min(remaining, m_skyline[i].width);
+    }
+
+    return y;
+}
+
+TexturePacker::TexturePacker(
+    vk::Device const& device,
+    vk::PhysicalDevice const& physicalDevice,
+    MemoryTracker& memoryTracker,
+    StreamingImageUploader& uploader,
+    uint32_t atlasSize,
+    uint32_t maxAtlasEntrySize,
+    CanCopyOnHost canCopyOnHost /*= {}*/,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_physicalDevice(physicalDevice),
+      m_pMemoryTracker(&memoryTracker),
+      m_pUploader(&uploader),
+      m_atlasSize(std::min(atlasSize, physicalDevice.getProperties().limits.maxImageDimension2D)),
+      m_maxAtlasEntrySize(std::min(maxAtlasEntrySize, m_atlasSize - 2 * AtlasPadding)),
+      m_canCopyOnHost(std::move(canCopyOnHost)),
+      m_pAllocator(pAllocator)
+{
+}
+
+PackedTextureId TexturePacker::Add(uint32_t width, uint32_t height, vk::Format format)
+{
+    m_entries.push_back({ width, height, format });
+    m_stats.textureCount++;
+
+    return static_cast<PackedTextureId>(m_entries.size() - 1);
+}
+
+void TexturePacker::Build()
+{
+    std::vector<PackedTextureId> atlasIds;
+    std::vector<PackedTextureId> arrayIds;
+
+    for (PackedTextureId id = 0; id < m_entries.size(); id++)
+    {
+        (fitsAtlas(m_entries[id]) ? atlasIds : arrayIds).push_back(id);
+    }
+
+    buildAtlases(atlasIds);
+    buildArrays(arrayIds);
+}
+
+void TexturePacker::Upload(PackedTextureId id, uint8_t const* pTexels)
+{
+    auto const& entry = m_entries[id];
+    auto const& array = m_arrays[entry.packed.arrayIndex];
+
+    auto const padding = array.atlas ? AtlasPadding : 0;
+    auto const width = entry.width + 2 * padding;
+    auto const height = entry.height + 2 * padding;
+    size_t const texelSize = vk::blockSize(entry.format);
+    auto const sourcePitch = (entry.width + vk::blockExtent(entry.format)[0] - 1) / vk::blockExtent(entry.format)[0] *
+                             texelSize;
+
+    // Padding rows and columns repeat the nearest edge of the texture
+    auto const writeRows = [&](uint8_t* pDst, uint32_t firstRow, uint32_t rowCount, size_t rowPitch)
+    {
+        for (uint32_t row = 0; row < rowCount; row++)
+        {
+            auto const sourceRow = std::clamp<int64_t>(static_cast<int64_t>(firstRow + row) - padding, 0,
+                                                       entry.height - 1);
+            auto const* pSource = pTexels + static_cast<size_t>(sourceRow) * sourcePitch;
+            auto* pRow = pDst + row * rowPitch;
+
+            memcpy(pRow + padding * texelSize, pSource, sourcePitch);
+
+            for (uint32_t i = 0; i < padding; i++)
+            {
+                memcpy(pRow + i * texelSize, pSource, texelSize);
+                memcpy(pRow + (padding + entry.width + i) * texelSize, pSource + sourcePitch - texelSize, texelSize);
+            }
+        }
+    };
+
+    vk::Offset2D const offset{ static_cast<int32_t>(entry.origin.x), static_cast<int32_t>(entry.origin.y) };
+
+    if (array.hostCopy)
+    {
+        auto const rowPitch = static_cast<size_t>(width) * texelSize;
+        std::vector<uint8_t> texels(array.atlas ? rowPitch * height : 0);
+        auto const* pUpload = pTexels;
+
+        if (array.atlas)
+        {
+            writeRows(texels.data(), 0, height, rowPitch);
+            pUpload = texels.data();
+        }
+
+        auto const layout = array.mipLevels > 1 ? vk::ImageLayout::eTransferDstOptimal
+                                                : vk::ImageLayout::eShaderReadOnlyOptimal;
+        CopyToImageOnHost(m_device, array.image, layout, 0, width, height, pUpload, entry.packed.layer, offset);
+    }
+    else
+    {
+        m_pUploader->UploadRegion(array.image, array.format, 0, entry.packed.layer, offset, width, height, writeRows);
+    }
+}
+
+void TexturePacker::Finish()
+{
+    // Single level arrays filled from the host are already in their final layout
+    if (std::ranges::all_of(m_arrays, [](PackedTextureArray const& array)
+    {
+        return array.hostCopy && array.mipLevels == 1;
+    }))
+    {
+        return;
+    }
+
+    m_pUploader->RecordCommands([this](vk::CommandBuffer commandBuffer)
+    {
+        for (auto const& array : m_arrays)
+        {
+            if (array.mipLevels > 1)
+            {
+                RecordBlitMipmaps(commandBuffer, array.image, array.width, array.height, array.mipLevels,
+                                  array.layerCount);
+            }
+            else if (!array.hostCopy)
+            {
+                std::vector toShaderRead = {
+                    MakeMipBarrier(array.image, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                                   vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, 0, 1,
+                                   array.layerCount)
+                };
+
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                              vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, toShaderRead);
+            }
+        }
+    });
+}
+
+PackedTexture const& TexturePacker::Get(PackedTextureId id) const
+{
+    return m_entries[id].packed;
+}
+
+std::vector<PackedTextureArray> const& TexturePacker::GetArrays() const
+{
+    return m_arrays;
+}
+
+TexturePackerStats TexturePacker::GetStats() const
+{
+    return m_stats;
+}
+
+void TexturePacker::Destroy()
+{
+    for (auto const& array : m_arrays)
+    {
+        m_device.destroyImageView(array.view, m_pAllocator);
+        m_device.destroyImage(array.image, m_pAllocator);
+        m_pMemoryTracker->Free(array.memory);
+    }
+
+    m_arrays.clear();
+    m_entries.clear();
+    m_stats = {};
+}
+
+bool TexturePacker::fitsAtlas(Entry const& entry) const
+{
+    auto const blockExtent = vk::blockExtent(entry.format);
+
+    return blockExtent[0] == 1 && blockExtent[1] == 1 && entry.width <= m_maxAtlasEntrySize &&
+           entry.height <= m_maxAtlasEntrySize;
+}
+
+void TexturePacker::buildAtlases(std::vector<PackedTextureId> const& ids)
+{
+    std::vector<vk::Format> formats;
+    for (auto const id : ids)
+    {
+        if (std::ranges::find(formats, m_entries[id].format) == formats.end())
+        {
+            formats.push_back(m_entries[id].format);
+        }
+    }
+
+    double usedArea = 0.0;
+
+    for (auto const format : formats)
+    {
+        // Tallest first keeps the skyline flat, which is where it packs best
+        std::vector<PackedTextureId> formatIds;
+        std::ranges::copy_if(ids, std::back_inserter(formatIds), [&](PackedTextureId id)
+        {
+            return m_entries[id].format == format;
+        });
+        std::ranges::stable_sort(formatIds, std::ranges::greater{}, [this](PackedTextureId id)
+        {
+            return std::pair(m_entries[id].height, m_entries[id].width);
+        });
+
+        std::vector<SkylinePacker> pages;
+        auto const arrayIndex = static_cast<uint32_t>(m_arrays.size());
+
+        for (auto const id : formatIds)
+        {
+            auto& entry = m_entries[id];
+            auto const paddedWidth = entry.width + 2 * AtlasPadding;
+            auto const paddedHeight = entry.height + 2 * AtlasPadding;
+
+            std::optional<PackedRect> rect;
+            uint32_t page = 0;
+            while (page < pages.size() && !(rect = pages[page].Pack(paddedWidth, paddedHeight)))
+            {
+                page++;
+            }
+
+            // Entries are never larger than a page, so a fresh one always takes it
+            if (!rect)
+            {
+                rect = pages.emplace_back(m_atlasSize, m_atlasSize).Pack(paddedWidth, paddedHeight);
+            }
+
+            auto const size = static_cast<float>(m_atlasSize);
+            entry.origin = *rect;
+            entry.packed = {
+                arrayIndex,
+                page,
+                {
+                    static_cast<float>(rect->x + AtlasPadding) / size,
+                    static_cast<float>(rect->y + AtlasPadding) / size,
+                    static_cast<float>(rect->x + AtlasPadding + entry.width) / size,
+                    static_cast<float>(rect->y + AtlasPadding + entry.height) / size
+                }
+            };
+        }
+
+        createArray(format, m_atlasSize, m_atlasSize, static_cast<uint32_t>(pages.size()), 1, true);
+
+        for (auto const& page : pages)
+        {
+            usedArea += page.GetOccupancy();
+        }
+
+        m_stats.atlasPages += static_cast<uint32_t>(pages.size());
+        m_stats.atlasTextures += static_cast<uint32_t>(formatIds.size());
+    }
+
+    m_stats.atlasOccupancy = m_stats.atlasPages > 0 ? static_cast<float>(usedArea / m_stats.atlasPages) : 0.0f;
+}
+
+void TexturePacker::buildArrays(std::vector<PackedTextureId> const& ids)
+{
+    auto const maxLayers = m_physicalDevice.getProperties().limits.maxImageArrayLayers;
+
+    // Keyed by format and size, in the order the first texture of each group was added
+    std::vector<std::vector<PackedTextureId>> groups;
+    for (auto const id : ids)
+    {
+        auto const& entry = m_entries[id];
+        auto const group = std::ranges::find_if(groups, [&](std::vector<PackedTextureId> const& members)
+        {
+            auto const& first = m_entries[members.front()];
+            return first.format == entry.format && first.width == entry.width && first.height == entry.height;
+        });
+
+        if (group == groups.end() || group->size() == maxLayers)
+        {
+            groups.push_back({ id });
+        }
+        else
+        {
+            group->push_back(id);
+        }
+    }
+
+    for (auto const& group : groups)
+    {
+        auto const& first = m_entries[group.front()];
+        auto const blockExtent = vk::blockExtent(first.format);
+        bool const blitMipmaps = blockExtent[0] == 1 && blockExtent[1] == 1 &&
+                                 SupportsLinearBlit(m_physicalDevice, first.format);
+
+        auto const arrayIndex = createArray(first.format, first.width, first.height,
+                                            static_cast<uint32_t>(group.size()),
+                                            blitMipmaps ? GetMipLevelCount(first.width, first.height) : 1, false);
+
+        for (uint32_t layer = 0; layer < group.size(); layer++)
+        {
+            auto& entry = m_entries[group[layer]];
+            entry.origin = { 0, 0 };
+            entry.packed = { arrayIndex, layer };
+        }
+    }
+}
+
+uint32_t TexturePacker::createArray(vk::Format format, uint32_t width, uint32_t height, uint32_t layerCount,
+                                    uint32_t mipLevels, bool atlas)
+{
+    auto usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    if (mipLevels > 1)
+    {
+        usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+
+    // Blitted mips start from level 0 in transfer dst layout, single levels are final once copied
+    auto const hostCopyLayout = mipLevels > 1 ? vk::ImageLayout::eTransferDstOptimal
+                                              : vk::ImageLayout::eShaderReadOnlyOptimal;
+    bool const hostCopy = m_canCopyOnHost && m_canCopyOnHost(format, usage, hostCopyLayout);
+
+    if (hostCopy)
+    {
+        usage |= vk::ImageUsageFlagBits::eHostTransferEXT;
+    }
+
+    vk::ImageCreateInfo const imageInfo{
+        {},
+        vk::ImageType::e2D,
+        format,
+        vk::Extent3D(width, height, 1),
+        mipLevels,
+        layerCount,
+        vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal,
+        usage,
+        vk::SharingMode::eExclusive
+    };
+
+    PackedTextureArray array{
+        m_device.createImage(imageInfo, m_pAllocator),
+        {},
+        {},
+        format,
+        width,
+        height,
+        layerCount,
+        mipLevels,
+        atlas,
+        hostCopy
+    };
+
+    auto const memoryRequirements = m_device.getImageMemoryRequirements(array.image);
+    auto const memoryTypeIndex = m_pMemoryTracker->FindMemoryType(memoryRequirements.memoryTypeBits,
+                                                                  vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                                  memoryRequirements.size);
+    if (!memoryTypeIndex)
+    {
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    array.memory = m_pMemoryTracker->Allocate({ memoryRequirements.size, *memoryTypeIndex }, MemoryUsage::eTexture);
+    m_device.bindImageMemory(array.image, array.memory, 0);
+
+    vk::ImageViewCreateInfo const viewInfo{
+        {},
+        array.image,
+        vk::ImageViewType::e2DArray,
+        format,
+        vk::ComponentMapping(),
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, layerCount)
+    };
+
+    array.view = m_device.createImageView(viewInfo, m_pAllocator);
+
+    if (hostCopy)
+    {
+        TransitionImageOnHost(m_device, array.image, vk::ImageLayout::eUndefined, hostCopyLayout, mipLevels,
+                              layerCount);
+    }
+    else
+    {
+        m_pUploader->RecordCommands([&](vk::CommandBuffer commandBuffer)
+        {
+            std::vector toTransferDst = {
+                MakeMipBarrier(array.image, {}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined,
+                               vk::ImageLayout::eTransferDstOptimal, 0, mipLevels, layerCount)
+            };
+
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                                          {}, {}, {}, toTransferDst);
+        });
+    }
+
+    m_arrays.push_back(array);
+    m_stats.arrayCount++;
+    m_stats.arrayLayers += layerCount;
+
+    return static_cast<uint32_t>(m_arrays.size() - 1);
+}
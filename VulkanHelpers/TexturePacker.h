@@ -0,0 +1,154 @@
+#pragma once
+#include "MemoryTracker.h"
+#include "StreamingImageUploader.h"
+
+struct PackedRect
+{
+    uint32_t x;
+    uint32_t y;
+};
+
+// Bottom-left skyline rectangle packer. The skyline is the top edge of everything packed so far, each rectangle goes
+// where it ends up lowest, which keeps the wasted space under it small for rectangles of similar heights.
+class SkylinePacker
+{
+public:
+    SkylinePacker(uint32_t width, uint32_t height);
+
+    // nullopt when the rectangle doesn't fit anywhere
+    std::optional<PackedRect> Pack(uint32_t width, uint32_t height);
+
+    // Fraction of the area covered by packed rectangles
+    float GetOccupancy() const;
+
+private:
+    struct Segment
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    // The lowest y a rectangle starting at the segment's left edge can be placed at
+    std::optional<uint32_t> fitAt(size_t index, uint32_t width, uint32_t height) const;
+
+    uint32_t m_width;
+    uint32_t m_height;
+    uint64_t m_usedArea = 0;
+    // Covers the whole width left to right
+    std::vector<Segment> m_skyline;
+};
+
+using PackedTextureId = uint32_t;
+
+struct UvRect
+{
+    float u0;
+    float v0;
+    float u1;
+    float v1;
+};
+
+// Where a texture ended up, sample the array at layer within uvRect
+struct PackedTexture
+{
+    uint32_t arrayIndex = 0;
+    uint32_t layer = 0;
+    UvRect uvRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+};
+
+struct PackedTextureArray
+{
+    vk::Image image;
+    vk::DeviceMemory memory;
+    // 2D array view of every layer
+    vk::ImageView view;
+    vk::Format format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t layerCount;
+    uint32_t mipLevels;
+    // Atlas pages are layers holding many small textures each, other arrays hold one texture per layer
+    bool atlas;
+    bool hostCopy;
+};
+
+struct TexturePackerStats
+{
+    uint32_t textureCount = 0;
+    uint32_t arrayCount = 0;
+    uint32_t arrayLayers = 0;
+    uint32_t atlasPages = 0;
+    uint32_t atlasTextures = 0;
+    float atlasOccupancy = 0.0f;
+};
+
+// Groups textures so a batch of differently textured draws can sample all of them from one descriptor set. Textures
+// of the same format and size become layers of a 2D array, small ones are packed into the layers of atlas arrays with
+// a skyline packer. Either way a texture is a (layer, uv rect) in one of the arrays.
+//
+// Every texture is added first, Build then places them and creates the arrays, after which each texture is uploaded
+// and Finish readies the arrays for sampling. Arrays get full mip chains when the format can be blitted, atlases keep
+// a single level so neighbouring textures never bleed into each other.
+class TexturePacker
+{
+public:
+    // Whether images of the format with the usage can be filled from the host while in layout
+    using CanCopyOnHost = std::function<bool(vk::Format format, vk::ImageUsageFlags usage, vk::ImageLayout layout)>;
+
+    // Edge texels are repeated this far around atlas entries so bilinear filtering never reaches a neighbour
+    static constexpr uint32_t AtlasPadding = 1;
+
+    TexturePacker() = default;
+    TexturePacker(vk::Device const& device, vk::PhysicalDevice const& physicalDevice, MemoryTracker& memoryTracker,
+                  StreamingImageUploader& uploader, uint32_t atlasSize, uint32_t maxAtlasEntrySize,
+                  CanCopyOnHost canCopyOnHost = {}, vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    // Compressed formats always get arrays of their own
+    PackedTextureId Add(uint32_t width, uint32_t height, vk::Format format);
+
+    // Places every added texture and creates the arrays, recording their transitions on the uploader
+    void Build();
+
+    // Tightly packed texels of the texture's size, copied before returning
+    void Upload(PackedTextureId id, uint8_t const* pTexels);
+
+    // Records the mip generation and transitions to shader reads on the uploader, which still has to be submitted
+    void Finish();
+
+    PackedTexture const& Get(PackedTextureId id) const;
+    std::vector<PackedTextureArray> const& GetArrays() const;
+    TexturePackerStats GetStats() const;
+
+    void Destroy();
+
+private:
+    struct Entry
+    {
+        uint32_t width;
+        uint32_t height;
+        vk::Format format;
+        // Top left of the entry including its padding
+        PackedRect origin;
+        PackedTexture packed;
+    };
+
+    bool fitsAtlas(Entry const& entry) const;
+    void buildAtlases(std::vector<PackedTextureId> const& ids);
+    void buildArrays(std::vector<PackedTextureId> const& ids);
+    uint32_t createArray(vk::Format format, uint32_t width, uint32_t height, uint32_t layerCount, uint32_t mipLevels,
+                         bool atlas);
+
+    vk::Device m_device;
+    vk::PhysicalDevice m_physicalDevice;
+    MemoryTracker* m_pMemoryTracker = nullptr;
+    StreamingImageUploader* m_pUploader = nullptr;
+    uint32_t m_atlasSize = 0;
+    uint32_t m_maxAtlasEntrySize = 0;
+    CanCopyOnHost m_canCopyOnHost;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    std::vector<Entry> m_entries;
+    std::vector<PackedTextureArray> m_arrays;
+    TexturePackerStats m_stats;
+};
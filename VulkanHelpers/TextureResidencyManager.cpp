@@ -0,0 +1,390 @@
+#include "pch.h"
+#include "TextureResidencyManager.h"
+#include "TextureHelpers.h"
+
+namespace
+{
+    // Source of the copies that carry kept levels over into a texture's next image
+    constexpr vk::ImageUsageFlags ResidentImageUsage =
+        vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+}
+
+TextureResidencyManager::TextureResidencyManager(
+    vk::Device const& device,
+    MemoryTracker& memoryTracker,
+    StreamingImageUploader& uploader,
+    ImageFactory imageFactory,
+    vk::DeviceSize budget,
+    vk::DeviceSize uploadBytesPerUpdate,
+    vk::AllocationCallbacks const* pAllocator /*= nullptr*/
+)
+    : m_device(device),
+      m_pMemoryTracker(&memoryTracker),
+      m_pUploader(&uploader),
+      m_imageFactory(std::move(imageFactory)),
+      m_uploadBytesPerUpdate(uploadBytesPerUpdate),
+      m_pAllocator(pAllocator)
+{
+    m_stats.budget = budget;
+}
+
+ResidentTextureId TextureResidencyManager::AddTexture(uint32_t width, uint32_t height, vk::Format format,
+                                                      LevelSource source)
+{
+    auto const mipLevels = GetMipLevelCount(width, height);
+
+    uint32_t tailLevel = 0;
+    while (tailLevel + 1 < mipLevels && std::max(width, height) >> tailLevel > MipTailSize)
+    {
+        tailLevel++;
+    }
+
+    auto& texture = m_textures.emplace_back(Texture{
+        width,
+        height,
+        mipLevels,
+        tailLevel,
+        format,
+        std::move(source),
+        mipLevels
+    });
+    texture.allocationBytes.resize(mipLevels);
+
+    rebuild(texture, tailLevel);
+    m_stats.textureCount++;
+
+    return static_cast<ResidentTextureId>(m_textures.size() - 1);
+}
+
+void TextureResidencyManager::RequestLevel(ResidentTextureId id, uint32_t mipLevel)
+{
+    auto& texture = m_textures[id];
+    mipLevel = std::min(mipLevel, texture.mipLevels - 1);
+
+    texture.requestedLevel = std::min(texture.requestedLevel.value_or(mipLevel), mipLevel);
+}
+
+void TextureResidencyManager::Update(uint64_t frameNumber, uint64_t completedFrameCount)
+{
+    m_frameNumber = frameNumber;
+
+    std::erase_if(m_retiredImages, [&](RetiredImage const& retired)
+    {
+        if (completedFrameCount <= retired.lastUseFrame)
+        {
+            return false;
+        }
+
+        destroyImage(retired.image, retired.memory, retired.view);
+        m_stats.retiredBytes -= retired.bytes;
+        return true;
+    });
+
+    std::vector<ResidentTextureId> candidates;
+    m_stats.texturesRequested = 0;
+    m_stats.texturesSatisfied = 0;
+
+    for (ResidentTextureId id = 0; id < m_textures.size(); id++)
+    {
+        auto& texture = m_textures[id];
+        if (!texture.requestedLevel)
+        {
+            continue;
+        }
+
+        texture.lastRequestedFrame = frameNumber;
+        m_stats.texturesRequested++;
+
+        if (*texture.requestedLevel < texture.residentLevel)
+        {
+            candidates.push_back(id);
+        }
+    }
+
+    // The textures furthest from what they were asked for are the most visibly blurry, they load first
+    std::ranges::stable_sort(candidates, std::ranges::greater{}, [this](ResidentTextureId id)
+    {
+        return m_textures[id].residentLevel - *m_textures[id].requestedLevel;
+    });
+
+    vk::DeviceSize uploadedBytes = 0;
+
+    for (auto const id : candidates)
+    {
+        if (uploadedBytes >= m_uploadBytesPerUpdate)
+        {
+            break;
+        }
+
+        auto& texture = m_textures[id];
+        auto const residentLevel = texture.residentLevel - 1;
+        auto const bytes = getAllocationBytes(texture, residentLevel);
+
+        // Once retired, this texture's current image gives its memory back
+        bool fits = true;
+        while (fits && m_stats.residentBytes - texture.bytes + bytes > m_stats.budget)
+        {
+            fits = evictOneLevel(id);
+        }
+
+        // Replaced images stay allocated until the frames sampling them complete, the load waits for them if needed
+        if (!fits || m_stats.residentBytes + m_stats.retiredBytes + bytes > m_stats.budget)
+        {
+            break;
+        }
+
+        uploadedBytes += rebuild(texture, residentLevel);
+        m_stats.levelsLoaded++;
+    }
+
+    for (auto& texture : m_textures)
+    {
+        if (texture.requestedLevel && texture.residentLevel <= *texture.requestedLevel)
+        {
+            m_stats.texturesSatisfied++;
+        }
+        texture.requestedLevel.reset();
+    }
+
+    // Queued ahead of the frame's own submission, which is what orders the copies before any sampling
+    m_pUploader->Submit();
+}
+
+vk::ImageView TextureResidencyManager::GetView(ResidentTextureId id) const
+{
+    return m_textures[id].view;
+}
+
+uint32_t TextureResidencyManager::GetResidentLevel(ResidentTextureId id) const
+{
+    return m_textures[id].residentLevel;
+}
+
+ResidencyStats TextureResidencyManager::GetStats() const
+{
+    return m_stats;
+}
+
+void TextureResidencyManager::Destroy()
+{
+    for (auto const& retired : m_retiredImages)
+    {
+        destroyImage(retired.image, retired.memory, retired.view);
+    }
+    m_retiredImages.clear();
+
+    for (auto const& texture : m_textures)
+    {
+        destroyImage(texture.image, texture.memory, texture.view);
+    }
+    m_textures.clear();
+}
+
+vk::DeviceSize TextureResidencyManager::rebuild(Texture& texture, uint32_t residentLevel)
+{
+    auto const levelCount = texture.mipLevels - residentLevel;
+    auto const width = std::max(texture.width >> residentLevel, 1u);
+    auto const height = std::max(texture.height >> residentLevel, 1u);
+
+    vk::Image image;
+    vk::DeviceMemory memory;
+    std::tie(image, memory) = m_imageFactory(width, height, levelCount, texture.format, ResidentImageUsage);
+
+    // Levels the old image already holds are copied from it, only finer ones come from the source
+    auto const firstKeptLevel = texture.image ? std::max(residentLevel, texture.residentLevel) : texture.mipLevels;
+    auto const keptLevelCount = texture.mipLevels - firstKeptLevel;
+    auto const oldBaseLevel = firstKeptLevel - texture.residentLevel;
+
+    m_pUploader->RecordCommands([&](vk::CommandBuffer commandBuffer)
+    {
+        std::vector toTransferDst = {
+            MakeMipBarrier(image, {}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined,
+                           vk::ImageLayout::eTransferDstOptimal, 0, levelCount)
+        };
+
+        if (keptLevelCount == 0)
+        {
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                                          {}, {}, {}, toTransferDst);
+            return;
+        }
+
+        // Earlier frames may still be sampling the old image, its transition waits for their fragment shaders
+        toTransferDst.push_back(MakeMipBarrier(texture.image, {}, vk::AccessFlagBits::eTransferRead,
+                                               vk::ImageLayout::eShaderReadOnlyOptimal,
+                                               vk::ImageLayout::eTransferSrcOptimal, oldBaseLevel, keptLevelCount));
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+                                      {}, {}, {}, toTransferDst);
+
+        std::vector<vk::ImageCopy> regions;
+        for (auto level = firstKeptLevel; level < texture.mipLevels; level++)
+        {
+            regions.push_back(vk::ImageCopy{
+                { vk::ImageAspectFlagBits::eColor, level - texture.residentLevel, 0, 1 },
+                {},
+                { vk::ImageAspectFlagBits::eColor, level - residentLevel, 0, 1 },
+                {},
+                { std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u), 1 }
+            });
+        }
+
+        commandBuffer.copyImage(texture.image, vk::ImageLayout::eTransferSrcOptimal, image,
+                                vk::ImageLayout::eTransferDstOptimal, regions);
+
+        // Back to the layout the descriptors still pointing at it declare
+        std::vector toShaderRead = {
+            MakeMipBarrier(texture.image, {}, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferSrcOptimal,
+                           vk::ImageLayout::eShaderReadOnlyOptimal, oldBaseLevel, keptLevelCount)
+        };
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, toShaderRead);
+    });
+
+    for (auto level = residentLevel; level < firstKeptLevel; level++)
+    {
+        m_pUploader->UploadLevel(image, texture.format, level - residentLevel, std::max(texture.width >> level, 1u),
+                                 std::max(texture.height >> level, 1u),
+                                 [&source = texture.source, level](uint8_t* pDst, uint32_t firstRow, uint32_t rowCount,
+                                                                   size_t rowPitch)
+                                 {
+                                     source(level, pDst, firstRow, rowCount, rowPitch);
+                                 });
+    }
+
+    m_pUploader->RecordCommands([&](vk::CommandBuffer commandBuffer)
+    {
+        std::vector toShaderRead = {
+            MakeMipBarrier(image, vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                           vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, 0,
+                           levelCount)
+        };
+
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, toShaderRead);
+    });
+
+    vk::ImageViewCreateInfo const viewInfo{
+        {},
+        image,
+        vk::ImageViewType::e2D,
+        texture.format,
+        vk::ComponentMapping(),
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1)
+    };
+
+    auto const view = m_device.createImageView(viewInfo, m_pAllocator);
+    auto const bytes = m_device.getImageMemoryRequirements(image).size;
+    auto const uploadedBytes = estimateBytes(texture, residentLevel, firstKeptLevel);
+
+    // Frames up to and including the current one may still sample the old image, the current one because its
+    // descriptors could have been written before this update
+    if (texture.image)
+    {
+        m_retiredImages.push_back({ texture.image, texture.memory, texture.view, texture.bytes, m_frameNumber });
+        m_stats.retiredBytes += texture.bytes;
+        m_stats.viewSwaps++;
+    }
+
+    m_stats.residentBytes += bytes - texture.bytes;
+    m_stats.bytesUploaded += uploadedBytes;
+
+    texture.residentLevel = residentLevel;
+    texture.image = image;
+    texture.memory = memory;
+    texture.view = view;
+    texture.bytes = bytes;
+    texture.allocationBytes[residentLevel] = bytes;
+
+    return uploadedBytes;
+}
+
+vk::DeviceSize TextureResidencyManager::estimateBytes(Texture const& texture, uint32_t firstLevel,
+                                                      uint32_t endLevel) const
+{
+    auto const blockExtent = vk::blockExtent(texture.format);
+    vk::DeviceSize const blockSize = vk::blockSize(texture.format);
+
+    vk::DeviceSize bytes = 0;
+    for (auto level = firstLevel; level < endLevel; level++)
+    {
+        auto const width = std::max(texture.width >> level, 1u);
+        auto const height = std::max(texture.height >> level, 1u);
+        bytes += static_cast<vk::DeviceSize>((width + blockExtent[0] - 1) / blockExtent[0]) *
+                 ((height + blockExtent[1] - 1) / blockExtent[1]) * blockSize;
+    }
+
+    return bytes;
+}
+
+vk::DeviceSize TextureResidencyManager::getAllocationBytes(Texture& texture, uint32_t residentLevel)
+{
+    auto& bytes = texture.allocationBytes[residentLevel];
+    if (bytes != 0)
+    {
+        return bytes;
+    }
+
+    // Alignment and padding are the driver's, an unbound image with the same parameters reports them
+    vk::ImageCreateInfo const imageInfo{
+        {},
+        vk::ImageType::e2D,
+        texture.format,
+        vk::Extent3D{ std::max(texture.width >> residentLevel, 1u), std::max(texture.height >> residentLevel, 1u), 1 },
+        texture.mipLevels - residentLevel,
+        1,
+        vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal,
+        ResidentImageUsage,
+        vk::SharingMode::eExclusive
+    };
+
+    auto const image = m_device.createImage(imageInfo, m_pAllocator);
+    bytes = m_device.getImageMemoryRequirements(image).size;
+    m_device.destroyImage(image, m_pAllocator);
+
+    return bytes;
+}
+
+bool TextureResidencyManager::evictOneLevel(ResidentTextureId keep)
+{
+    Texture* pVictim = nullptr;
+
+    for (ResidentTextureId id = 0; id < m_textures.size(); id++)
+    {
+        auto& texture = m_textures[id];
+        if (id == keep || texture.residentLevel >= texture.tailLevel)
+        {
+            continue;
+        }
+
+        // Levels requested for the coming frame stay, finer ones than it asked for can go
+        if (texture.requestedLevel && texture.residentLevel >= *texture.requestedLevel)
+        {
+            continue;
+        }
+
+        if (!pVictim || texture.lastRequestedFrame < pVictim->lastRequestedFrame)
+        {
+            pVictim = &texture;
+        }
+    }
+
+    if (!pVictim)
+    {
+        return false;
+    }
+
+    rebuild(*pVictim, pVictim->residentLevel + 1);
+    m_stats.levelsEvicted++;
+
+    return true;
+}
+
+void TextureResidencyManager::destroyImage(vk::Image image, vk::DeviceMemory memory, vk::ImageView view)
+{
+    m_device.destroyImageView(view, m_pAllocator);
+    m_device.destroyImage(image, m_pAllocator);
+    m_pMemoryTracker->Free(memory);
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "MemoryTracker.h"
+#include "StreamingImageUploader.h"
+
+using ResidentTextureId = uint32_t;
+
+struct ResidencyStats
+{
+    vk::DeviceSize budget = 0;
+    vk::DeviceSize residentBytes = 0;
+    // Replaced images kept alive until the frames that might still sample them have completed
+    vk::DeviceSize retiredBytes = 0;
+    uint32_t textureCount = 0;
+    // Requested this frame and resident down to the requested level
+    uint32_t texturesSatisfied = 0;
+    uint32_t texturesRequested = 0;
+    uint64_t levelsLoaded = 0;
+    uint64_t levelsEvicted = 0;
+    uint64_t viewSwaps = 0;
+    vk::DeviceSize bytesUploaded = 0;
+};
+
+// Keeps every texture's coarse mip tail resident and streams finer levels in as usage feedback asks for them, one
+// level per texture per update so the tail shows up first. When the resident set would exceed the budget the least
+// recently used textures give up their finest levels.
+//
+// Changing a texture's resident levels builds a new image holding exactly those levels, so frames in flight keep
+// sampling the old one. Levels the old image already holds are copied across on the GPU and only finer ones are read
+// from the texture's source, so giving up levels uploads nothing. The new view is returned from GetView as of the
+// update that built it, and the old image is destroyed once every earlier frame has completed.
+//
+// The budget covers the allocations of resident and retired images alike. Loads wait until the memory given up by
+// evictions has been released, evictions themselves may briefly go over by the smaller images they build.
+class TextureResidencyManager
+{
+public:
+    // Creates a 2D, optimally tiled image with memory bound, allocation sizes are predicted from an image like it
+    using ImageFactory = std::function<std::pair<vk::Image, vk::DeviceMemory>(
+        uint32_t width, uint32_t height, uint32_t mipLevels, vk::Format format, vk::ImageUsageFlags usage)>;
+    // Writes rows of one mip level of the full texture, rows are block rows for compressed formats
+    using LevelSource = std::function<void(uint32_t mipLevel, uint8_t* pDst, uint32_t firstRow, uint32_t rowCount,
+                                           size_t rowPitch)>;
+
+    // Levels no larger than this are always resident
+    static constexpr uint32_t MipTailSize = 32;
+
+    TextureResidencyManager() = default;
+    TextureResidencyManager(vk::Device const& device, MemoryTracker& memoryTracker, StreamingImageUploader& uploader,
+                            ImageFactory imageFactory, vk::DeviceSize budget, vk::DeviceSize uploadBytesPerUpdate,
+                            vk::AllocationCallbacks const* pAllocator = nullptr);
+
+    // Loads the mip tail, finer levels only stream in once they are requested
+    ResidentTextureId AddTexture(uint32_t width, uint32_t height, vk::Format format, LevelSource source);
+
+    // Screen-space usage feedback for the coming frame, the finest level the texture will be sampled at.
+    // Textures not requested in a frame keep their levels until the budget needs them.
+    void RequestLevel(ResidentTextureId id, uint32_t mipLevel);
+
+    // Call at a frame boundary before anything for the frame is recorded. completedFrameCount is how many frames from
+    // the start have finished on the GPU. Uploads are submitted but never waited for.
+    void Update(uint64_t frameNumber, uint64_t completedFrameCount);
+
+    // Covers the resident levels only, so the view's level 0 is the finest resident level
+    vk::ImageView GetView(ResidentTextureId id) const;
+    uint32_t GetResidentLevel(ResidentTextureId id) const;
+
+    ResidencyStats GetStats() const;
+
+    void Destroy();
+
+private:
+    struct Texture
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        uint32_t tailLevel;
+        vk::Format format;
+        LevelSource source;
+
+        uint32_t residentLevel;
+        vk::Image image;
+        vk::DeviceMemory memory;
+        vk::ImageView view;
+        vk::DeviceSize bytes = 0;
+        // Allocation size of an image starting at each level, measured when first needed
+        std::vector<vk::DeviceSize> allocationBytes;
+
+        std::optional<uint32_t> requestedLevel;
+        uint64_t lastRequestedFrame = 0;
+    };
+
+    struct RetiredImage
+    {
+        vk::Image image;
+        vk::DeviceMemory memory;
+        vk::ImageView view;
+        vk::DeviceSize bytes;
+        uint64_t lastUseFrame;
+    };
+
+    // Builds a new image holding residentLevel and everything coarser, and retires the old one. Returns the bytes
+    // uploaded from the source.
+    vk::DeviceSize rebuild(Texture& texture, uint32_t residentLevel);
+    // Tightly packed bytes of levels firstLevel up to but not including endLevel
+    vk::DeviceSize estimateBytes(Texture const& texture, uint32_t firstLevel, uint32_t endLevel) const;
+    vk::DeviceSize getAllocationBytes(Texture& texture, uint32_t residentLevel);
+    // Drops the finest level of the least recently used texture that can spare one
+    bool evictOneLevel(ResidentTextureId keep);
+    void destroyImage(vk::Image image, vk::DeviceMemory memory, vk::ImageView view);
+
+    vk::Device m_device;
+    MemoryTracker* m_pMemoryTracker = nullptr;
+    StreamingImageUploader* m_pUploader = nullptr;
+    ImageFactory m_imageFactory;
+    vk::DeviceSize m_uploadBytesPerUpdate = 0;
+    vk::AllocationCallbacks const* m_pAllocator = nullptr;
+
+    std::vector<Texture> m_textures;
+    std::vector<RetiredImage> m_retiredImages;
+    uint64_t m_frameNumber = 0;
+
+    ResidencyStats m_stats;
+};
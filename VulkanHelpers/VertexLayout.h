@@ -0,0 +1,208 @@
+#pragma once
+
+// Compact attribute types, the shader still reads them as vec4 or vec2 of float
+
+// Four bytes read as [0, 1], colors mostly
+struct Unorm8x4
+{
+    uint8_t x, y, z, w;
+};
+
+// Four bytes read as [-1, 1], normals and tangents
+struct Snorm8x4
+{
+    int8_t x, y, z, w;
+};
+
+// Two shorts read as [0, 1], texture coordinates within an atlas or array layer
+struct Unorm16x2
+{
+    uint16_t x, y;
+};
+
+// Half floats, fill them with FloatToHalf
+struct Half2
+{
+    uint16_t x, y;
+};
+
+struct Half4
+{
+    uint16_t x, y, z, w;
+};
+
+// IEEE half float bits of the value, rounded to nearest even like the GPU converts
+constexpr uint16_t FloatToHalf(float value)
+{
+    auto const bits = std::bit_cast<uint32_t>(value);
+    auto const sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    auto const floatExponent = static_cast<int32_t>((bits >> 23) & 0xff);
+    auto mantissa = bits & 0x7fffff;
+
+    if (floatExponent == 0xff)
+    {
+        // Infinity stays infinity, NaN stays a quiet NaN
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+    }
+
+    auto const exponent = floatExponent - 127 + 15;
+    if (exponent >= 0x1f)
+    {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+
+    // Normals keep their implicit one, subnormals shift it into the mantissa
+    uint32_t shift = 13;
+    uint32_t half = static_cast<uint32_t>(exponent) << 10;
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return sign;
+        }
+
+        mantissa |= 0x800000;
+        shift = static_cast<uint32_t>(14 - exponent);
+        half = 0;
+    }
+
+    half |= mantissa >> shift;
+    auto const remainder = mantissa & ((1u << shift) - 1);
+    auto const halfway = 1u << (shift - 1);
+    // A carry out of the mantissa correctly rounds up into the exponent, up to infinity
+    if (remainder > halfway || (remainder == halfway && (half & 1) != 0))
+    {
+        half++;
+    }
+
+    return static_cast<uint16_t>(sign | half);
+}
+
+namespace VertexLayoutDetail
+{
+    template <typename Component>
+    constexpr vk::Format getVectorFormat(int length)
+    {
+        constexpr auto formats = []
+        {
+            if constexpr (std::is_same_v<Component, float>)
+            {
+                return std::array{ vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat,
+                                   vk::Format::eR32G32B32A32Sfloat };
+            }
+            else if constexpr (std::is_same_v<Component, int32_t>)
+            {
+                return std::array{ vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint,
+                                   vk::Format::eR32G32B32A32Sint };
+            }
+            else
+            {
+                static_assert(std::is_same_v<Component, uint32_t>, "Vertex vectors are of float, int32_t or uint32_t");
+                return std::array{ vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint,
+                                   vk::Format::eR32G32B32A32Uint };
+            }
+        }();
+
+        return formats[length - 1];
+    }
+
+    // glm::vec and anything else with a value_type and a static length
+    template <typename T>
+    concept VectorType = requires
+    {
+        typename T::value_type;
+        { T::length() } -> std::convertible_to<int>;
+    } && T::length() >= 1 && T::length() <= 4 && sizeof(T) == sizeof(typename T::value_type) * T::length();
+}
+
+// The format a vertex attribute of type T is read with. Undefined for types without one, so an unsupported member
+// fails to compile instead of being read wrong. Matrices and doubles are left out, they take several locations.
+template <typename T>
+struct VertexAttributeFormat;
+
+template <>
+struct VertexAttributeFormat<float>
+{
+    static constexpr vk::Format Value = vk::Format::eR32Sfloat;
+};
+
+template <>
+struct VertexAttributeFormat<int32_t>
+{
+    static constexpr vk::Format Value = vk::Format::eR32Sint;
+};
+
+template <>
+struct VertexAttributeFormat<uint32_t>
+{
+    static constexpr vk::Format Value = vk::Format::eR32Uint;
+};
+
+template <VertexLayoutDetail::VectorType T>
+struct VertexAttributeFormat<T>
+{
+    static constexpr vk::Format Value = VertexLayoutDetail::getVectorFormat<typename T::value_type>(T::length());
+};
+
+template <>
+struct VertexAttributeFormat<Unorm8x4>
+{
+    static constexpr vk::Format Value = vk::Format::eR8G8B8A8Unorm;
+};
+
+template <>
+struct VertexAttributeFormat<Snorm8x4>
+{
+    static constexpr vk::Format Value = vk::Format::eR8G8B8A8Snorm;
+};
+
+template <>
+struct VertexAttributeFormat<Unorm16x2>
+{
+    static constexpr vk::Format Value = vk::Format::eR16G16Unorm;
+};
+
+template <>
+struct VertexAttributeFormat<Half2>
+{
+    static constexpr vk::Format Value = vk::Format::eR16G16Sfloat;
+};
+
+template <>
+struct VertexAttributeFormat<Half4>
+{
+    static constexpr vk::Format Value = vk::Format::eR16G16B16A16Sfloat;
+};
+
+// Format and offset of one member, see VERTEX_ATTRIBUTE
+struct VertexMember
+{
+    vk::Format format;
+    uint32_t offset;
+};
+
+// offsetof needs the member's name, so this one's a macro. Only use it where the vertex type is complete, in the
+// body of its member functions rather than in the initializer of a static member.
+#define VERTEX_ATTRIBUTE(Vertex, member)                                                                               \
+    VertexMember                                                                                                       \
+    {                                                                                                                  \
+        VertexAttributeFormat<std::remove_cvref_t<decltype(Vertex::member)>>::Value,                                  \
+        static_cast<uint32_t>(offsetof(Vertex, member))                                                                \
+    }
+
+// The attributes of the members at consecutive locations from the first, in the order given
+template <typename... Members>
+    requires (std::is_same_v<Members, VertexMember> && ...)
+constexpr std::array<vk::VertexInputAttributeDescription, sizeof...(Members)> GetVertexAttributes(
+    uint32_t binding, uint32_t firstLocation, Members... members)
+{
+    uint32_t location = firstLocation;
+    return { vk::VertexInputAttributeDescription{ location++, binding, members.format, members.offset }... };
+}
+
+template <typename Vertex>
+constexpr vk::VertexInputBindingDescription GetVertexBinding(
+    uint32_t binding = 0, vk::VertexInputRate inputRate = vk::VertexInputRate::eVertex)
+{
+    return { binding, sizeof(Vertex), inputRate };
+}
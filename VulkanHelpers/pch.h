@@ -2,6 +2,7 @@
 #define PCH_H
 
 #include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_format_traits.hpp>
 #include <GLFW/glfw3.h>
 
 #include <iostream>
@@ -10,5 +11,19 @@
 #include <optional>
 #include <functional>
 #include <fstream>
+#include <chrono>
+#include <format>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <span>
+#include <numeric>
+#include <bit>
 
 #endif //PCH_H